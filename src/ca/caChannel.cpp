@@ -10,10 +10,7 @@
 #include <pv/standardField.h>
 #include <pv/logger.h>
 #include <pv/pvAccess.h>
-#include "channelConnectThread.h"
-#include "monitorEventThread.h"
-#include "getDoneThread.h"
-#include "putDoneThread.h"
+#include "notificationPool.h"
 
 #define epicsExportSharedSymbols
 #include "caChannel.h"
@@ -67,7 +64,14 @@ void CAChannel::connect(bool isConnected)
          Lock lock(requestsMutex);
          channelConnected = isConnected;
     }
-    channelConnectThread->channelConnected(notifyChannelRequester);
+    notificationPool->notify(notifyChannelRequester);
+}
+
+int CAChannel::requestFlush()
+{
+    CAChannelProviderPtr provider(channelProvider.lock());
+    if(provider) return provider->requestFlush();
+    return ca_flush_io();
 }
 
 void CAChannel::notifyClient()
@@ -125,7 +129,7 @@ CAChannel::CAChannel(std::string const & channelName,
     channelID(0),
     channelCreated(false),
     channelConnected(false),
-    channelConnectThread(ChannelConnectThread::get())
+    notificationPool(channelProvider->getNotificationPool())
 {
     if(DEBUG_LEVEL>0) {
           cout<< "CAChannel::CAChannel " << channelName << endl;
@@ -139,7 +143,8 @@ void CAChannel::activate(short priority)
     if(DEBUG_LEVEL>0) {
           cout<< "CAChannel::activate " << channelName << endl;
     }
-    notifyChannelRequester = NotifyChannelRequesterPtr(new NotifyChannelRequester());
+    notifyChannelRequester = NotifyChannelRequesterPtr(
+        new NotifyChannelRequester(notificationPool->shard(this)));
     notifyChannelRequester->setChannel(shared_from_this());
     attachContext();
     int result = ca_create_channel(channelName.c_str(),
@@ -452,7 +457,7 @@ CAChannelGet::CAChannelGet(CAChannel::shared_pointer const & channel,
     channelGetRequester(channelGetRequester),
     pvRequest(pvRequest),
     getStatus(Status::Ok),
-    getDoneThread(GetDoneThread::get())
+    notificationPool(channel->getNotificationPool())
 {}
 
 CAChannelGet::~CAChannelGet()
@@ -473,7 +478,8 @@ void CAChannelGet::activate()
     dbdToPv->getChoices(channel);
     pvStructure = dbdToPv->createPVStructure();
     bitSet = BitSetPtr(new BitSet(pvStructure->getStructure()->getNumberFields()));
-    notifyGetRequester = NotifyGetRequesterPtr(new NotifyGetRequester());
+    notifyGetRequester = NotifyGetRequesterPtr(
+        new NotifyGetRequester(notificationPool->shard(channel.get())));
     notifyGetRequester->setChannelGet(shared_from_this());
     EXCEPTION_GUARD(getRequester->channelGetConnect(Status::Ok, shared_from_this(),
                     pvStructure->getStructure()));
@@ -503,7 +509,7 @@ void CAChannelGet::getDone(struct event_handler_args &args)
     ChannelGetRequester::shared_pointer getRequester(channelGetRequester.lock());
     if(!getRequester) return;
     getStatus = dbdToPv->getFromDBD(pvStructure,bitSet,args);
-    getDoneThread->getDone(notifyGetRequester);
+    notificationPool->notify(notifyGetRequester);
 }
 
 void CAChannelGet::notifyClient()
@@ -530,7 +536,7 @@ void CAChannelGet::get()
          channel->getChannelID(), ca_get_handler, this);
     if (result == ECA_NORMAL)
     {
-        result = ca_flush_io();
+        result = channel->requestFlush();
     }
     if (result != ECA_NORMAL)
     {
@@ -576,7 +582,7 @@ CAChannelPut::CAChannelPut(CAChannel::shared_pointer const & channel,
     isPut(false),
     getStatus(Status::Ok),
     putStatus(Status::Ok),
-    putDoneThread(PutDoneThread::get())
+    notificationPool(channel->getNotificationPool())
 {}
 
 CAChannelPut::~CAChannelPut()
@@ -603,7 +609,8 @@ void CAChannelPut::activate()
         std::string val = pvString->get();
         if(val.compare("true")==0) block = true;
     }
-    notifyPutRequester = NotifyPutRequesterPtr(new NotifyPutRequester());
+    notifyPutRequester = NotifyPutRequesterPtr(
+        new NotifyPutRequester(notificationPool->shard(channel.get())));
     notifyPutRequester->setChannelPut(shared_from_this());
     EXCEPTION_GUARD(putRequester->channelPutConnect(Status::Ok, shared_from_this(),
                     pvStructure->getStructure()));
@@ -663,7 +670,7 @@ void CAChannelPut::putDone(struct event_handler_args &args)
     } else {
         putStatus = Status::Ok;
     }
-    putDoneThread->putDone(notifyPutRequester);
+    notificationPool->notify(notifyPutRequester);
 }
 
 void CAChannelPut::getDone(struct event_handler_args &args)
@@ -675,7 +682,7 @@ void CAChannelPut::getDone(struct event_handler_args &args)
     ChannelPutRequester::shared_pointer putRequester(channelPutRequester.lock());
     if(!putRequester) return;
     getStatus = dbdToPv->getFromDBD(pvStructure,bitSet,args);
-    putDoneThread->putDone(notifyPutRequester);
+    notificationPool->notify(notifyPutRequester);
 }
 
 void CAChannelPut::notifyClient()
@@ -709,7 +716,7 @@ void CAChannelPut::get()
          channel->getChannelID(), ca_put_get_handler, this);
     if (result == ECA_NORMAL)
     {
-        result = ca_flush_io();
+        result = channel->requestFlush();
     }
     if (result != ECA_NORMAL)
     {
@@ -832,7 +839,7 @@ CAChannelMonitor::CAChannelMonitor(
     monitorRequester(monitorRequester),
     pvRequest(pvRequest),
     isStarted(false),
-    monitorEventThread(MonitorEventThread::get()),
+    notificationPool(channel->getNotificationPool()),
     pevid(NULL),
     eventMask(DBE_VALUE | DBE_ALARM)
 {}
@@ -880,7 +887,8 @@ void CAChannelMonitor::activate()
             if(value.find("PROPERTY")!=std::string::npos) eventMask|=DBE_PROPERTY;
         }
     }
-    notifyMonitorRequester = NotifyMonitorRequesterPtr(new NotifyMonitorRequester());
+    notifyMonitorRequester = NotifyMonitorRequesterPtr(
+        new NotifyMonitorRequester(notificationPool->shard(channel.get())));
     notifyMonitorRequester->setChannelMonitor(shared_from_this());
     monitorQueue = CACMonitorQueuePtr(new CACMonitorQueue(queueSize));
     EXCEPTION_GUARD(requester->monitorConnect(Status::Ok, shared_from_this(),
@@ -910,7 +918,7 @@ void CAChannelMonitor::subscriptionEvent(struct event_handler_args &args)
         } else {
             *(activeElement->overrunBitSet) |= *(activeElement->changedBitSet);
         }
-        monitorEventThread->event(notifyMonitorRequester);
+        notificationPool->notify(notifyMonitorRequester);
     }
     else
     {
@@ -956,7 +964,7 @@ Status CAChannelMonitor::start()
          &pevid);
     if (result == ECA_NORMAL)
     {
-        result = ca_flush_io();
+        result = channel->requestFlush();
     }
     if (result == ECA_NORMAL) return status;
     isStarted = false;
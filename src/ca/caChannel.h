@@ -31,28 +31,18 @@ namespace ca {
 class CAChannel;
 typedef std::tr1::shared_ptr<CAChannel> CAChannelPtr;
 typedef std::tr1::weak_ptr<CAChannel> CAChannelWPtr;
-class ChannelConnectThread;
-typedef std::tr1::shared_ptr<ChannelConnectThread> ChannelConnectThreadPtr;
 
 class NotifyChannelRequester;
 typedef std::tr1::shared_ptr<NotifyChannelRequester> NotifyChannelRequesterPtr;
 
 class NotifyMonitorRequester;
 typedef std::tr1::shared_ptr<NotifyMonitorRequester> NotifyMonitorRequesterPtr;
-class MonitorEventThread;
-typedef std::tr1::shared_ptr<MonitorEventThread> MonitorEventThreadPtr;
 
 class NotifyGetRequester;
 typedef std::tr1::shared_ptr<NotifyGetRequester> NotifyGetRequesterPtr;
-typedef std::tr1::weak_ptr<NotifyGetRequester> NotifyGetRequesterWPtr;
-class GetDoneThread;
-typedef std::tr1::shared_ptr<GetDoneThread> GetDoneThreadPtr;
 
 class NotifyPutRequester;
 typedef std::tr1::shared_ptr<NotifyPutRequester> NotifyPutRequesterPtr;
-typedef std::tr1::weak_ptr<NotifyPutRequester> NotifyPutRequesterWPtr;
-class PutDoneThread;
-typedef std::tr1::shared_ptr<PutDoneThread> PutDoneThreadPtr;
 
 class CAChannelGetField;
 typedef std::tr1::shared_ptr<CAChannelGetField> CAChannelGetFieldPtr;
@@ -120,7 +110,9 @@ public:
     void attachContext();
     void disconnectChannel();
     void connect(bool isConnected);
+    int requestFlush();
     void notifyClient();
+    const NotificationPoolPtr& getNotificationPool() const { return notificationPool; }
 private:
     virtual void destroy() {}
     CAChannel(std::string const & channelName,
@@ -135,7 +127,7 @@ private:
     chid channelID;
     bool channelCreated;
     bool channelConnected;
-    ChannelConnectThreadPtr channelConnectThread;
+    NotificationPoolPtr notificationPool;
     NotifyChannelRequesterPtr notifyChannelRequester;
 
     epics::pvData::Mutex requestsMutex;
@@ -176,7 +168,7 @@ private:
     ChannelGetRequester::weak_pointer channelGetRequester;
     const epics::pvData::PVStructure::shared_pointer pvRequest;
     epics::pvData::Status getStatus;
-    GetDoneThreadPtr getDoneThread;
+    NotificationPoolPtr notificationPool;
     NotifyGetRequesterPtr notifyGetRequester;
     DbdToPvPtr dbdToPv;
     epics::pvData::Mutex mutex;
@@ -221,7 +213,7 @@ private:
     bool isPut;
     epics::pvData::Status getStatus;
     epics::pvData::Status putStatus;
-    PutDoneThreadPtr putDoneThread;
+    NotificationPoolPtr notificationPool;
     NotifyPutRequesterPtr notifyPutRequester;
     DbdToPvPtr dbdToPv;
     epics::pvData::Mutex mutex;
@@ -262,7 +254,7 @@ private:
     MonitorRequester::weak_pointer monitorRequester;
     const epics::pvData::PVStructure::shared_pointer pvRequest;
     bool isStarted;
-    MonitorEventThreadPtr monitorEventThread;
+    NotificationPoolPtr notificationPool;
     evid pevid;
     unsigned long eventMask;
     NotifyMonitorRequesterPtr notifyMonitorRequester;
@@ -10,11 +10,9 @@
 #include <epicsExit.h>
 #include <pv/logger.h>
 #include <pv/pvAccess.h>
+#include <pv/configuration.h>
 
-#include "channelConnectThread.h"
-#include "monitorEventThread.h"
-#include "getDoneThread.h"
-#include "putDoneThread.h"
+#include "notificationPool.h"
 
 #define epicsExportSharedSymbols
 #include <pv/caProvider.h>
@@ -33,22 +31,22 @@ using namespace epics::pvData;
                 catch (...) { LOG(logLevelError, "Unhandled exception caught from client code at %s:%d.", __FILE__, __LINE__); }
 
 CAChannelProvider::CAChannelProvider() 
-    : current_context(0)
+    : current_context(0),
+      flushDelay(0.0),
+      flushScheduled(false)
 {
-    initialize();
+    initialize(std::tr1::shared_ptr<Configuration>());
 }
 
-CAChannelProvider::CAChannelProvider(const std::tr1::shared_ptr<Configuration>&)
+CAChannelProvider::CAChannelProvider(const std::tr1::shared_ptr<Configuration>& conf)
     :  current_context(0),
-       channelConnectThread(ChannelConnectThread::get()),
-       monitorEventThread(MonitorEventThread::get()),
-       getDoneThread(GetDoneThread::get()),
-       putDoneThread(PutDoneThread::get())
+       flushDelay(0.0),
+       flushScheduled(false)
 {
     if(DEBUG_LEVEL>0) {
           std::cout<< "CAChannelProvider::CAChannelProvider\n";
     }
-    initialize();
+    initialize(conf);
 }
 
 CAChannelProvider::~CAChannelProvider()
@@ -77,10 +75,10 @@ CAChannelProvider::~CAChannelProvider()
        channelQ.front()->disconnectChannel();
        channelQ.pop();
     }
-    putDoneThread->stop();
-    getDoneThread->stop();
-    monitorEventThread->stop();
-    channelConnectThread->stop();
+    if(flushTimer) {
+        flushTimer->close();
+    }
+    notificationPool->stop();
     if(DEBUG_LEVEL>0) {
         std::cout << "CAChannelProvider::~CAChannelProvider() calling ca_context_destroy\n";
     }
@@ -165,12 +163,56 @@ void CAChannelProvider::configure(epics::pvData::PVStructure::shared_pointer /*c
 {
 }
 
+int CAChannelProvider::requestFlush()
+{
+    if(flushDelay<=0.0) {
+        return ca_flush_io();
+    }
+    Lock lock(flushMutex);
+    if(!flushScheduled) {
+        flushScheduled = true;
+        flushTimer->scheduleAfterDelay(flushCallback, flushDelay);
+    }
+    return ECA_NORMAL;
+}
+
+bool CAChannelProvider::cancelFlush()
+{
+    Lock lock(flushMutex);
+    if(!flushScheduled) return false;
+    flushScheduled = false;
+    flushTimer->cancel(flushCallback);
+    return true;
+}
+
+void CAChannelProvider::flushTimeout()
+{
+    {
+        Lock lock(flushMutex);
+        if(!flushScheduled) return; // flush() or poll() was first
+        flushScheduled = false;
+    }
+    try {
+        attachContext();
+        ca_flush_io();
+    } catch(std::exception& e) {
+        LOG(logLevelError, "CAChannelProvider flush error: %s", e.what());
+    }
+}
+
 void CAChannelProvider::flush()
 {
+    if(flushDelay>0.0 && !cancelFlush()) return;
+    attachContext();
+    ca_flush_io();
 }
 
 void CAChannelProvider::poll()
 {
+    if(flushDelay>0.0) cancelFlush();
+    attachContext();
+    // also flushes
+    ca_poll();
 }
 
 void CAChannelProvider::attachContext()
@@ -186,9 +228,21 @@ void CAChannelProvider::attachContext()
     }
 }
 
-void CAChannelProvider::initialize()
+void CAChannelProvider::initialize(const std::tr1::shared_ptr<Configuration>& conf)
 {
     if(DEBUG_LEVEL>0) std::cout << "CAChannelProvider::initialize()\n";
+    Configuration::shared_pointer config(conf);
+    if(!config)
+        config = ConfigurationBuilder().push_env().build();
+    int32 nworkers = config->getPropertyAsInteger("EPICS_PVA_CA_NOTIFY_THREADS", 4);
+    if(nworkers<1)
+        nworkers = 1;
+    notificationPool.reset(new NotificationPool(nworkers));
+    flushDelay = config->getPropertyAsDouble("EPICS_PVA_CA_FLUSH_DELAY", 0.0);
+    if(flushDelay>0.0) {
+        flushTimer.reset(new Timer("CAflush", middlePriority));
+        flushCallback.reset(new FlushTimer(this));
+    }
     int result = ca_context_create(ca_enable_preemptive_callback);
     if (result != ECA_NORMAL) {
         std::string mess("CAChannelProvider::initialize error calling ca_context_create ");
@@ -217,5 +271,14 @@ void CAClientFactory::stop()
     // unregister now done with exit hook
 }
 
+void CAClientFactory::notificationStats(std::vector<NotificationStats>& stats)
+{
+    stats.clear();
+    CAChannelProviderPtr provider(std::tr1::dynamic_pointer_cast<CAChannelProvider>(
+        ChannelProviderRegistry::clients()->getProvider("ca")));
+    if(provider)
+        provider->getNotificationPool()->stats(stats);
+}
+
 }}}
 
@@ -16,6 +16,7 @@
 
 #include <pv/caProvider.h>
 #include <pv/pvAccess.h>
+#include <pv/timer.h>
 
 
 namespace epics {
@@ -24,17 +25,8 @@ namespace ca {
 
 #define DEBUG_LEVEL 0
 
-class ChannelConnectThread;
-typedef std::tr1::shared_ptr<ChannelConnectThread> ChannelConnectThreadPtr;
-
-class MonitorEventThread;
-typedef std::tr1::shared_ptr<MonitorEventThread> MonitorEventThreadPtr;
-
-class GetDoneThread;
-typedef std::tr1::shared_ptr<GetDoneThread> GetDoneThreadPtr;
-
-class PutDoneThread;
-typedef std::tr1::shared_ptr<PutDoneThread> PutDoneThreadPtr;
+class NotificationPool;
+typedef std::tr1::shared_ptr<NotificationPool> NotificationPoolPtr;
 
 class CAChannel;
 typedef std::tr1::shared_ptr<CAChannel> CAChannelPtr;
@@ -82,17 +74,43 @@ public:
 
     void attachContext();
     void addChannel(const CAChannelPtr & channel);
+    /** Send the requests queued by ca_array_get_callback() and the like.
+     *
+     * Calls ca_flush_io() now, or when batching ($EPICS_PVA_CA_FLUSH_DELAY > 0)
+     * after that delay, unless flush() or poll() is called first.
+     * Returns the result of ca_flush_io(), or ECA_NORMAL when deferred.
+     */
+    int requestFlush();
+    const NotificationPoolPtr& getNotificationPool() const { return notificationPool; }
 private:
     
     virtual void destroy() EPICS_DEPRECATED {}
-    void initialize();
+    void initialize(const std::tr1::shared_ptr<Configuration>& conf);
+    void flushTimeout();
+    bool cancelFlush();
+
+    struct FlushTimer : public epics::pvData::TimerCallback
+    {
+        CAChannelProvider *provider;
+        explicit FlushTimer(CAChannelProvider *provider) :provider(provider) {}
+        virtual ~FlushTimer() {}
+        virtual void callback() OVERRIDE FINAL { provider->flushTimeout(); }
+        virtual void timerStopped() OVERRIDE FINAL {}
+    };
+
     ca_client_context* current_context;
     epics::pvData::Mutex channelListMutex;
     std::vector<CAChannelWPtr> caChannelList;
-    ChannelConnectThreadPtr channelConnectThread;
-    MonitorEventThreadPtr monitorEventThread;
-    GetDoneThreadPtr getDoneThread;
-    PutDoneThreadPtr putDoneThread;
+    NotificationPoolPtr notificationPool;
+
+    // 0.0 to flush each request
+    double flushDelay;
+    epics::pvData::Mutex flushMutex;
+    // guarded by flushMutex
+    bool flushScheduled;
+    // only when flushDelay > 0
+    epics::pvData::Timer::shared_pointer flushTimer;
+    epics::pvData::TimerCallbackPtr flushCallback;
 };
 
 }}}
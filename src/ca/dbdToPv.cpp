@@ -6,7 +6,9 @@
 
 
 #include <epicsVersion.h>
+#include <epicsStdio.h>
 #include <sstream>
+#include <algorithm>
 #include <alarm.h>
 #include <alarmString.h>
 
@@ -62,7 +64,24 @@ DbdToPv::DbdToPv(IOType ioType)
    firstTime(true),
    caValueType(-1),
    caRequestType(-1),
-   maxElements(0)
+   maxElements(0),
+   copyValue(NULL),
+   copyLimits(NULL),
+   pvValue(NULL),
+   pvIndex(NULL),
+   pvChoices(NULL),
+   pvAlarm(NULL),
+   pvSeverity(NULL),
+   pvStatus(NULL),
+   pvMessage(NULL),
+   pvSeconds(NULL),
+   pvNanoseconds(NULL),
+   pvControlHigh(NULL),
+   pvControlLow(NULL),
+   pvDisplayHigh(NULL),
+   pvDisplayLow(NULL),
+   pvUnits(NULL),
+   pvFormat(NULL)
 {
    caTimeStamp.secPastEpoch = 0;
    caTimeStamp.nsec = 0;
@@ -136,6 +155,76 @@ static dbr_short_t convertDBstatus(dbr_short_t dbStatus)
 
 }
 
+template<typename dbrT, typename pvT>
+void copy_DBRScalar(const void * dbr, unsigned long /*count*/, PVField *pvField)
+{
+    static_cast<pvT*>(pvField)->put(static_cast<const dbrT*>(dbr)[0]);
+}
+
+template<typename dbrT, typename pvT>
+void copy_DBRScalarArray(const void * dbr, unsigned long count, PVField *pvField)
+{
+    pvT *value = static_cast<pvT*>(pvField);
+    typename pvT::const_svector prev;
+    value->swap(prev);
+    typename pvT::svector temp;
+    // overwrite the previous array in place, unless it is
+    // still referenced (eg. by a monitor queue element)
+    if(prev.unique() && prev.size()==count) {
+        temp = thaw(prev);
+    } else {
+        prev.clear();
+        temp.resize(count);
+    }
+    std::copy(
+        static_cast<const dbrT*>(dbr),
+        static_cast<const dbrT*>(dbr) + count,
+        temp.begin());
+    value->replace(freeze(temp));
+}
+
+static void copy_DBRCharString(const void * dbr, unsigned long count, PVField *pvField)
+{
+    const char *pchar = static_cast<const char *>(dbr);
+    static_cast<PVString*>(pvField)->put(
+        std::string(pchar, std::find(pchar, pchar + count, '\0')));
+}
+
+template<typename dbrT, typename pvScalarT, typename pvArrayT>
+dbrCopyValueFunc* copy_DBRValue(bool isArray)
+{
+    return isArray ? &copy_DBRScalarArray<dbrT,pvArrayT> : &copy_DBRScalar<dbrT,pvScalarT>;
+}
+
+static string dbrFormat(const dbr_ctrl_char *) { return "I4"; }
+static string dbrFormat(const dbr_ctrl_short *) { return "I6"; }
+static string dbrFormat(const dbr_ctrl_long *) { return "I12"; }
+
+static string dbrFormat(int prec)
+{
+    char buf[32];
+    epicsSnprintf(buf, sizeof(buf), "F%d.%d", prec + 6, prec);
+    return buf;
+}
+static string dbrFormat(const dbr_ctrl_float *data) { return dbrFormat(data->precision); }
+static string dbrFormat(const dbr_ctrl_double *data) { return dbrFormat(data->precision); }
+
+template<typename dbrT>
+void copy_DBRLimits(const void * dbr, CaDisplay *display, CaControl *control, CaValueAlarm *valueAlarm)
+{
+    const dbrT *data = static_cast<const dbrT*>(dbr);
+    display->upper_disp_limit = data->upper_disp_limit;
+    display->lower_disp_limit = data->lower_disp_limit;
+    display->units = data->units;
+    display->format = dbrFormat(data);
+    control->upper_ctrl_limit = data->upper_ctrl_limit;
+    control->lower_ctrl_limit = data->lower_ctrl_limit;
+    valueAlarm->upper_alarm_limit = data->upper_alarm_limit;
+    valueAlarm->upper_warning_limit = data->upper_warning_limit;
+    valueAlarm->lower_warning_limit = data->lower_warning_limit;
+    valueAlarm->lower_alarm_limit = data->lower_alarm_limit;
+}
+
 void DbdToPv::activate(
     CAChannelPtr const & caChannel,
     PVStructurePtr const & pvRequest)
@@ -315,6 +404,93 @@ void DbdToPv::activate(
        caRequestType = dbf_type_to_DBR(caValueType);
     }
 
+    switch(caValueType) {
+    case DBR_STRING:
+        copyValue = copy_DBRValue<dbr_string_t,PVString,PVStringArray>(isArray);
+        break;
+    case DBR_CHAR:
+        if(charArrayIsString)
+            copyValue = &copy_DBRCharString;
+        else if(dbfIsUCHAR)
+            copyValue = copy_DBRValue<dbr_char_t,PVUByte,PVUByteArray>(isArray);
+        else
+            copyValue = copy_DBRValue<dbr_char_t,PVByte,PVByteArray>(isArray);
+        break;
+    case DBR_SHORT:
+        if(dbfIsUSHORT)
+            copyValue = copy_DBRValue<dbr_short_t,PVUShort,PVUShortArray>(isArray);
+        else
+            copyValue = copy_DBRValue<dbr_short_t,PVShort,PVShortArray>(isArray);
+        break;
+    case DBR_LONG:
+        if(dbfIsULONG)
+            copyValue = copy_DBRValue<dbr_long_t,PVUInt,PVUIntArray>(isArray);
+        else
+            copyValue = copy_DBRValue<dbr_long_t,PVInt,PVIntArray>(isArray);
+        break;
+    case DBR_FLOAT:
+        copyValue = copy_DBRValue<dbr_float_t,PVFloat,PVFloatArray>(isArray);
+        break;
+    case DBR_DOUBLE:
+        if(dbfIsINT64)
+            copyValue = copy_DBRValue<dbr_double_t,PVLong,PVLongArray>(isArray);
+        else if(dbfIsUINT64)
+            copyValue = copy_DBRValue<dbr_double_t,PVULong,PVULongArray>(isArray);
+        else
+            copyValue = copy_DBRValue<dbr_double_t,PVDouble,PVDoubleArray>(isArray);
+        break;
+    default:
+        throw  std::runtime_error("DbDToPv::activate: bad type");
+    }
+    switch(caRequestType) {
+    case DBR_CTRL_CHAR: copyLimits = &copy_DBRLimits<dbr_ctrl_char>; break;
+    case DBR_CTRL_SHORT: copyLimits = &copy_DBRLimits<dbr_ctrl_short>; break;
+    case DBR_CTRL_LONG: copyLimits = &copy_DBRLimits<dbr_ctrl_long>; break;
+    case DBR_CTRL_FLOAT: copyLimits = &copy_DBRLimits<dbr_ctrl_float>; break;
+    case DBR_CTRL_DOUBLE: copyLimits = &copy_DBRLimits<dbr_ctrl_double>; break;
+    default:
+        if(displayRequested || controlRequested || valueAlarmRequested)
+            throw  std::runtime_error("DbDToPv::activate: bad request type");
+    }
+}
+
+void DbdToPv::bind(PVStructurePtr const & pvStructure)
+{
+    pvBound = pvStructure;
+    PVStructure *top = pvStructure.get();
+    if(valueRequested) {
+        pvValue = top->getSubFieldT<PVField>("value").get();
+        if(caValueType==DBR_ENUM) {
+            pvIndex = top->getSubFieldT<PVInt>("value.index").get();
+            pvChoices = top->getSubFieldT<PVStringArray>("value.choices").get();
+        }
+    }
+    if(alarmRequested) {
+        pvAlarm = top->getSubFieldT<PVStructure>("alarm").get();
+        pvSeverity = pvAlarm->getSubFieldT<PVInt>("severity").get();
+        pvStatus = pvAlarm->getSubFieldT<PVInt>("status").get();
+        pvMessage = pvAlarm->getSubFieldT<PVString>("message").get();
+    }
+    if(timeStampRequested) {
+        pvSeconds = top->getSubFieldT<PVLong>("timeStamp.secondsPastEpoch").get();
+        pvNanoseconds = top->getSubFieldT<PVInt>("timeStamp.nanoseconds").get();
+    }
+    if(controlRequested) {
+        pvControlHigh = top->getSubFieldT<PVDouble>("control.limitHigh").get();
+        pvControlLow = top->getSubFieldT<PVDouble>("control.limitLow").get();
+    }
+    if(displayRequested) {
+        pvDisplayHigh = top->getSubFieldT<PVDouble>("display.limitHigh").get();
+        pvDisplayLow = top->getSubFieldT<PVDouble>("display.limitLow").get();
+        pvUnits = top->getSubFieldT<PVString>("display.units").get();
+        pvFormat = top->getSubField<PVString>("display.format").get(); // optional
+    }
+    if(valueAlarmRequested) {
+        pvHighAlarm = top->getSubFieldT<PVScalar>("valueAlarm.highAlarmLimit");
+        pvHighWarning = top->getSubFieldT<PVScalar>("valueAlarm.highWarningLimit");
+        pvLowWarning = top->getSubFieldT<PVScalar>("valueAlarm.lowWarningLimit");
+        pvLowAlarm = top->getSubFieldT<PVScalar>("valueAlarm.lowAlarmLimit");
+    }
 }
 
 chtype DbdToPv::getRequestType()
@@ -379,54 +555,6 @@ PVStructurePtr DbdToPv::createPVStructure()
     return getPVDataCreate()->createPVStructure(structure);
 }
 
-template<typename dbrT, typename pvT>
-void copy_DBRScalar(const void * dbr, PVScalar::shared_pointer const & pvScalar)
-{
-    std::tr1::shared_ptr<pvT> value = std::tr1::static_pointer_cast<pvT>(pvScalar);
-    value->put(static_cast<const dbrT*>(dbr)[0]);
-}
-
-template<typename dbrT, typename pvT>
-void copy_DBRScalarArray(const void * dbr, unsigned count, PVScalarArray::shared_pointer const & pvArray)
-{
-    std::tr1::shared_ptr<pvT> value = std::tr1::static_pointer_cast<pvT>(pvArray);
-    typename pvT::svector temp(value->reuse());
-    temp.resize(count);
-    std::copy(
-        static_cast<const dbrT*>(dbr),
-        static_cast<const dbrT*>(dbr) + count,
-        temp.begin());
-    value->replace(freeze(temp));
-}
-
-template<typename dbrT>
-void get_DBRControl(const void * dbr, double *upper_ctrl_limit,double *lower_ctrl_limit)
-{
-    *upper_ctrl_limit =  static_cast<const dbrT*>(dbr)->upper_ctrl_limit;
-    *lower_ctrl_limit =  static_cast<const dbrT*>(dbr)->lower_ctrl_limit;
-}
-
-template<typename dbrT>
-void get_DBRDisplay(
-    const void * dbr, double *upper_disp_limit,double *lower_disp_limit,string *units)
-{
-    *upper_disp_limit =  static_cast<const dbrT*>(dbr)->upper_disp_limit;
-    *lower_disp_limit =  static_cast<const dbrT*>(dbr)->lower_disp_limit;
-     *units = static_cast<const dbrT*>(dbr)->units;
-}
-
-template<typename dbrT>
-void get_DBRValueAlarm(
-    const void * dbr,
-    double *upper_alarm_limit,double *upper_warning_limit,
-    double *lower_warning_limit,double *lower_alarm_limit)
-{
-    *upper_alarm_limit =  static_cast<const dbrT*>(dbr)->upper_alarm_limit;
-    *upper_warning_limit =  static_cast<const dbrT*>(dbr)->upper_warning_limit;
-    *lower_warning_limit =  static_cast<const dbrT*>(dbr)->lower_warning_limit;
-    *lower_alarm_limit =  static_cast<const dbrT*>(dbr)->lower_alarm_limit;
-}
-
 Status DbdToPv::getFromDBD(
      PVStructurePtr const & pvStructure,
      BitSet::shared_pointer const & bitSet,
@@ -437,141 +565,25 @@ Status DbdToPv::getFromDBD(
      Status errorStatus(Status::STATUSTYPE_ERROR, string(ca_message(args.status)));
      return errorStatus;
    }
+   if(pvStructure!=pvBound) bind(pvStructure);
    if(valueRequested)
    {
-       void * value = dbr_value_ptr(args.dbr,caRequestType);
-       if(isArray) {
-           long count = args.count;
-           PVScalarArrayPtr pvValue = pvStructure->getSubField<PVScalarArray>("value");
-           switch(caValueType) {
-           case DBR_STRING:
-           {
-                const dbr_string_t *dbrval = static_cast<const dbr_string_t *>(value);
-                PVStringArrayPtr pvValue = pvStructure->getSubField<PVStringArray>("value");
-                PVStringArray::svector arr(pvValue->reuse());
-                arr.resize(count);
-                std::copy(dbrval, dbrval + count, arr.begin());
-                pvValue->replace(freeze(arr));
-                break;
-           }
-           case DBR_CHAR:
-               if(charArrayIsString)
-               {
-                   const char * pchar = static_cast<const char *>(value);
-                   std::string str(pchar);
-                   PVStringPtr pvValue(pvStructure->getSubField<PVString>("value"));
-                   pvValue->put(str);
-                   break;
-               }
-               if(dbfIsUCHAR)
-               {
-                   copy_DBRScalarArray<dbr_char_t,PVUByteArray>(value,count,pvValue);
-                   break;
-               }
-               copy_DBRScalarArray<dbr_char_t,PVByteArray>(value,count,pvValue);
-               break;
-           case DBR_SHORT:
-               if(dbfIsUSHORT)
-               {
-                   copy_DBRScalarArray<dbr_short_t,PVUShortArray>(value,count,pvValue);
-                   break;
-               }
-               copy_DBRScalarArray<dbr_short_t,PVShortArray>(value,count,pvValue);
-               break;
-           case DBR_LONG:
-               if(dbfIsULONG)
-               {
-                   copy_DBRScalarArray<dbr_long_t,PVUIntArray>(value,count,pvValue);
-                   break;
-               }
-               copy_DBRScalarArray<dbr_long_t,PVIntArray>(value,count,pvValue);
-               break;
-           case DBR_FLOAT:
-               copy_DBRScalarArray<dbr_float_t,PVFloatArray>(value,count,pvValue);
-               break;
-           case DBR_DOUBLE:
-               if(dbfIsINT64)
-               {
-                   copy_DBRScalarArray<dbr_double_t,PVLongArray>(value,count,pvValue);
-                   break;
-               }
-               if(dbfIsUINT64)
-               {
-                   copy_DBRScalarArray<dbr_double_t,PVULongArray>(value,count,pvValue);
-                   break;
-               }
-               copy_DBRScalarArray<dbr_double_t,PVDoubleArray>(value,count,pvValue);
-               break;
-           default:
-                Status errorStatus(
-                    Status::STATUSTYPE_ERROR, string("DbdToPv::getFromDBD logic error"));
-                return errorStatus;
-           }
+       const void * value = dbr_value_ptr(args.dbr,caRequestType);
+       if(caValueType==DBR_ENUM) {
+            const dbr_enum_t *dbrval = static_cast<const dbr_enum_t *>(value);
+            pvIndex->put(*dbrval);
+            if(pvChoices->getLength()==0)
+            {
+                 PVStringArray::svector temp(choices.size());
+                 std::copy(choices.begin(), choices.end(), temp.begin());
+                 pvChoices->replace(freeze(temp));
+                 bitSet->set(pvValue->getFieldOffset());
+            } else {
+                 bitSet->set(pvIndex->getFieldOffset());
+            }
        } else {
-           PVScalarPtr pvValue = pvStructure->getSubField<PVScalar>("value");
-           switch(caValueType) {
-           case DBR_ENUM:
-           {
-                const dbr_enum_t *dbrval = static_cast<const dbr_enum_t *>(value);
-                PVIntPtr value = pvStructure->getSubField<PVInt>("value.index");
-                value->put(*dbrval);
-                PVStringArrayPtr pvChoices
-                     = pvStructure->getSubField<PVStringArray>("value.choices");
-                if(pvChoices->getLength()==0)
-                {
-                     ConvertPtr convert = getConvert();
-                     size_t n = choices.size();
-                     pvChoices->setLength(n);
-                     convert->fromStringArray(pvChoices,0,n,choices,0);       
-                     bitSet->set(pvStructure->getSubField("value")->getFieldOffset());
-                } else {
-                     bitSet->set(value->getFieldOffset());
-                }
-                break;
-           }
-           case DBR_STRING: copy_DBRScalar<dbr_string_t,PVString>(value,pvValue); break;
-           case DBR_CHAR:
-                if(dbfIsUCHAR)
-                {
-                   copy_DBRScalar<dbr_char_t,PVUByte>(value,pvValue);
-                   break;
-                }
-                copy_DBRScalar<dbr_char_t,PVByte>(value,pvValue); break;
-           case DBR_SHORT:
-                if(dbfIsUSHORT)
-                {
-                   copy_DBRScalar<dbr_short_t,PVUShort>(value,pvValue);
-                   break;
-                }
-                copy_DBRScalar<dbr_short_t,PVShort>(value,pvValue); break;
-           case DBR_LONG:
-                if(dbfIsULONG)
-                {
-                   copy_DBRScalar<dbr_long_t,PVUInt>(value,pvValue);
-                   break;
-                }
-                copy_DBRScalar<dbr_long_t,PVInt>(value,pvValue); break;
-           case DBR_FLOAT: copy_DBRScalar<dbr_float_t,PVFloat>(value,pvValue); break;
-           case DBR_DOUBLE: 
-                if(dbfIsINT64)
-                {
-                   copy_DBRScalar<dbr_double_t,PVLong>(value,pvValue);
-                   break;
-                }
-                if(dbfIsUINT64)
-                {
-                   copy_DBRScalar<dbr_double_t,PVULong>(value,pvValue);
-                   break;
-                }
-                copy_DBRScalar<dbr_double_t,PVDouble>(value,pvValue); break;
-           default:
-                Status errorStatus(
-                    Status::STATUSTYPE_ERROR, string("DbdToPv::getFromDBD logic error"));
-                return errorStatus;
-           }
-       }
-       if(caValueType!=DBR_ENUM) {
-            bitSet->set(pvStructure->getSubField("value")->getFieldOffset());
+            copyValue(value, args.count, pvValue);
+            bitSet->set(pvValue->getFieldOffset());
        }
     }
     if(alarmRequested) {
@@ -581,15 +593,11 @@ Status DbdToPv::getFromDBD(
         dbr_short_t severity = data->severity;
         bool statusChanged = false;
         bool severityChanged = false;
-        PVStructurePtr pvAlarm(pvStructure->getSubField<PVStructure>("alarm"));
-        PVIntPtr pvSeverity(pvAlarm->getSubField<PVInt>("severity"));
         if(caAlarm.severity!=severity) {
             caAlarm.severity = severity;
             pvSeverity->put(severity);
             severityChanged = true;
         }
-        PVStringPtr pvMessage(pvAlarm->getSubField<PVString>("message"));
-        PVIntPtr pvStatus(pvAlarm->getSubField<PVInt>("status"));
         if(caAlarm.status!=status) {
             caAlarm.status = status;
             pvStatus->put(convertDBstatus(status));
@@ -611,180 +619,84 @@ Status DbdToPv::getFromDBD(
         // Note that epicsTimeStamp always follows status and severity
         const dbr_time_string *data = static_cast<const dbr_time_string *>(args.dbr);
         epicsTimeStamp stamp = data->stamp;
-        PVStructurePtr pvTimeStamp(pvStructure->getSubField<PVStructure>("timeStamp"));
         if(caTimeStamp.secPastEpoch!=stamp.secPastEpoch) {
             caTimeStamp.secPastEpoch = stamp.secPastEpoch;
-            PVLongPtr pvSeconds(pvTimeStamp->getSubField<PVLong>("secondsPastEpoch"));
             pvSeconds->put(stamp.secPastEpoch+posixEpochAtEpicsEpoch);
             bitSet->set(pvSeconds->getFieldOffset());
         }
         if(caTimeStamp.nsec!=stamp.nsec) {
             caTimeStamp.nsec = stamp.nsec;
-            PVIntPtr pvNano(pvTimeStamp->getSubField<PVInt>("nanoseconds"));
-            pvNano->put(stamp.nsec);
-            bitSet->set(pvNano->getFieldOffset());
+            pvNanoseconds->put(stamp.nsec);
+            bitSet->set(pvNanoseconds->getFieldOffset());
         }
     }
-    if(controlRequested)
-    {
-         double upper_ctrl_limit = 0.0;
-         double lower_ctrl_limit = 0.0;
-         switch(caRequestType) {
-             case DBR_CTRL_CHAR:
-                 get_DBRControl<dbr_ctrl_char>(args.dbr,&upper_ctrl_limit,&lower_ctrl_limit); break;
-             case DBR_CTRL_SHORT:
-                 get_DBRControl<dbr_ctrl_short>(args.dbr,&upper_ctrl_limit,&lower_ctrl_limit); break;
-             case DBR_CTRL_LONG:
-                 get_DBRControl<dbr_ctrl_long>(args.dbr,&upper_ctrl_limit,&lower_ctrl_limit); break;
-             case DBR_CTRL_FLOAT:
-                 get_DBRControl<dbr_ctrl_float>(args.dbr,&upper_ctrl_limit,&lower_ctrl_limit); break;
-             case DBR_CTRL_DOUBLE:
-                 get_DBRControl<dbr_ctrl_double>(args.dbr,&upper_ctrl_limit,&lower_ctrl_limit); break;
-             default :
-                 throw  std::runtime_error("DbdToPv::getFromDBD logic error");
-         }
-         PVStructurePtr pvControl(pvStructure->getSubField<PVStructure>("control"));
-         if(caControl.upper_ctrl_limit!=upper_ctrl_limit) {
-             caControl.upper_ctrl_limit = upper_ctrl_limit;
-             PVDoublePtr pv = pvControl->getSubField<PVDouble>("limitHigh");
-             pv->put(upper_ctrl_limit);
-             bitSet->set(pv->getFieldOffset());
-         }
-         if(caControl.lower_ctrl_limit!=lower_ctrl_limit) {
-             caControl.lower_ctrl_limit = lower_ctrl_limit;
-             PVDoublePtr pv = pvControl->getSubField<PVDouble>("limitLow");
-             pv->put(lower_ctrl_limit);
-             bitSet->set(pv->getFieldOffset());
-         }
-    }
-    if(displayRequested)
+    if(controlRequested || displayRequested || valueAlarmRequested)
     {
-        string units;
-        string format;
-        double upper_disp_limit = 0.0;
-        double lower_disp_limit = 0.0;
-        switch(caRequestType) {
-             case DBR_CTRL_CHAR:
-                 get_DBRDisplay<dbr_ctrl_char>(args.dbr,&upper_disp_limit,&lower_disp_limit,&units);
-                 format = "I4"; break;
-             case DBR_CTRL_SHORT:
-                 get_DBRDisplay<dbr_ctrl_short>(args.dbr,&upper_disp_limit,&lower_disp_limit,&units);
-                 format = "I6"; break;
-             case DBR_CTRL_LONG:
-                 get_DBRDisplay<dbr_ctrl_long>(args.dbr,&upper_disp_limit,&lower_disp_limit,&units);
-                 format = "I12"; break;
-             case DBR_CTRL_FLOAT:
-                 get_DBRDisplay<dbr_ctrl_float>(args.dbr,&upper_disp_limit,&lower_disp_limit,&units);
-                 {
-                 const dbr_ctrl_float *data = static_cast<const dbr_ctrl_float *>(args.dbr);
-                 int prec = data->precision;
-                 ostringstream s;
-                 s << "F" << prec + 6 << "." << prec;
-                 format = s.str();
-                 }
-                 break;
-             case DBR_CTRL_DOUBLE:
-                 get_DBRDisplay<dbr_ctrl_double>(args.dbr,&upper_disp_limit,&lower_disp_limit,&units);
-                 {
-                 const dbr_ctrl_double *data = static_cast<const dbr_ctrl_double *>(args.dbr);
-                 int prec = data->precision;
-                 ostringstream s;
-                 s << "F" << prec + 6 << "." << prec;
-                 format = s.str();
-                 }
-                 break;
-             default :
-                 throw  std::runtime_error("DbdToPv::getFromDBD logic error");
-         }
-         PVStructurePtr pvDisplay(pvStructure->getSubField<PVStructure>("display"));
-         if(caDisplay.lower_disp_limit!=lower_disp_limit) {
-            caDisplay.lower_disp_limit = lower_disp_limit;
-            PVDoublePtr pvDouble = pvDisplay->getSubField<PVDouble>("limitLow");
-            pvDouble->put(lower_disp_limit);
-            bitSet->set(pvDouble->getFieldOffset());
-         }
-         if(caDisplay.upper_disp_limit!=upper_disp_limit) {
-            caDisplay.upper_disp_limit = upper_disp_limit;
-            PVDoublePtr pvDouble = pvDisplay->getSubField<PVDouble>("limitHigh");
-            pvDouble->put(upper_disp_limit);
-            bitSet->set(pvDouble->getFieldOffset());
+         CaDisplay display;
+         CaControl control;
+         CaValueAlarm valueAlarm;
+         copyLimits(args.dbr, &display, &control, &valueAlarm);
+
+         if(controlRequested) {
+             if(caControl.upper_ctrl_limit!=control.upper_ctrl_limit) {
+                 caControl.upper_ctrl_limit = control.upper_ctrl_limit;
+                 pvControlHigh->put(control.upper_ctrl_limit);
+                 bitSet->set(pvControlHigh->getFieldOffset());
+             }
+             if(caControl.lower_ctrl_limit!=control.lower_ctrl_limit) {
+                 caControl.lower_ctrl_limit = control.lower_ctrl_limit;
+                 pvControlLow->put(control.lower_ctrl_limit);
+                 bitSet->set(pvControlLow->getFieldOffset());
+             }
          }
-         if(caDisplay.units!=units) {
-            caDisplay.units = units;
-            PVStringPtr pvString = pvDisplay->getSubField<PVString>("units");
-            pvString->put(units);
-            bitSet->set(pvString->getFieldOffset());
+         if(displayRequested) {
+             if(caDisplay.lower_disp_limit!=display.lower_disp_limit) {
+                caDisplay.lower_disp_limit = display.lower_disp_limit;
+                pvDisplayLow->put(display.lower_disp_limit);
+                bitSet->set(pvDisplayLow->getFieldOffset());
+             }
+             if(caDisplay.upper_disp_limit!=display.upper_disp_limit) {
+                caDisplay.upper_disp_limit = display.upper_disp_limit;
+                pvDisplayHigh->put(display.upper_disp_limit);
+                bitSet->set(pvDisplayHigh->getFieldOffset());
+             }
+             if(caDisplay.units!=display.units) {
+                caDisplay.units = display.units;
+                pvUnits->put(display.units);
+                bitSet->set(pvUnits->getFieldOffset());
+             }
+             if(caDisplay.format!=display.format) {
+                caDisplay.format = display.format;
+                if(pvFormat) {
+                    pvFormat->put(display.format);
+                    bitSet->set(pvFormat->getFieldOffset());
+                }
+             }
          }
-         if(caDisplay.format!=format) {
-            caDisplay.format = format;
-            PVStringPtr pvString = pvDisplay->getSubField<PVString>("format");
-            if(pvString) {
-                pvString->put(format);
-                bitSet->set(pvString->getFieldOffset());
+         if(valueAlarmRequested) {
+            ConvertPtr convert(getConvert());
+            if(caValueAlarm.upper_alarm_limit!=valueAlarm.upper_alarm_limit) {
+                caValueAlarm.upper_alarm_limit = valueAlarm.upper_alarm_limit;
+                convert->fromDouble(pvHighAlarm,valueAlarm.upper_alarm_limit);
+                bitSet->set(pvHighAlarm->getFieldOffset());
+            }
+            if(caValueAlarm.upper_warning_limit!=valueAlarm.upper_warning_limit) {
+                caValueAlarm.upper_warning_limit = valueAlarm.upper_warning_limit;
+                convert->fromDouble(pvHighWarning,valueAlarm.upper_warning_limit);
+                bitSet->set(pvHighWarning->getFieldOffset());
+            }
+            if(caValueAlarm.lower_warning_limit!=valueAlarm.lower_warning_limit) {
+                caValueAlarm.lower_warning_limit = valueAlarm.lower_warning_limit;
+                convert->fromDouble(pvLowWarning,valueAlarm.lower_warning_limit);
+                bitSet->set(pvLowWarning->getFieldOffset());
+            }
+            if(caValueAlarm.lower_alarm_limit!=valueAlarm.lower_alarm_limit) {
+                caValueAlarm.lower_alarm_limit = valueAlarm.lower_alarm_limit;
+                convert->fromDouble(pvLowAlarm,valueAlarm.lower_alarm_limit);
+                bitSet->set(pvLowAlarm->getFieldOffset());
             }
          }
     }
-    if(valueAlarmRequested) {
-        double upper_alarm_limit = 0.0;
-        double upper_warning_limit = 0.0;
-        double lower_warning_limit = 0.0;
-        double lower_alarm_limit = 0.0;
-        switch(caRequestType) {
-             case DBR_CTRL_CHAR:
-                 get_DBRValueAlarm<dbr_ctrl_char>(args.dbr,
-                     &upper_alarm_limit,&upper_warning_limit,
-                     &lower_warning_limit,&lower_alarm_limit);
-                 break;
-             case DBR_CTRL_SHORT:
-                 get_DBRValueAlarm<dbr_ctrl_short>(args.dbr,
-                     &upper_alarm_limit,&upper_warning_limit,
-                     &lower_warning_limit,&lower_alarm_limit);
-                 break;
-             case DBR_CTRL_LONG:
-                 get_DBRValueAlarm<dbr_ctrl_long>(args.dbr,
-                     &upper_alarm_limit,&upper_warning_limit,
-                     &lower_warning_limit,&lower_alarm_limit);
-                 break;
-             case DBR_CTRL_FLOAT:
-                 get_DBRValueAlarm<dbr_ctrl_float>(args.dbr,
-                     &upper_alarm_limit,&upper_warning_limit,
-                     &lower_warning_limit,&lower_alarm_limit);
-                 break;
-             case DBR_CTRL_DOUBLE:
-                 get_DBRValueAlarm<dbr_ctrl_double>(args.dbr,
-                     &upper_alarm_limit,&upper_warning_limit,
-                     &lower_warning_limit,&lower_alarm_limit);
-                 break;
-             default :
-                 throw  std::runtime_error("DbdToPv::getFromDBD logic error");
-        }
-        ConvertPtr convert(getConvert());
-        PVStructurePtr pvValueAlarm(pvStructure->getSubField<PVStructure>("valueAlarm"));
-        if(caValueAlarm.upper_alarm_limit!=upper_alarm_limit) {
-            caValueAlarm.upper_alarm_limit = upper_alarm_limit;
-            PVScalarPtr pv = pvValueAlarm->getSubField<PVScalar>("highAlarmLimit");
-            convert->fromDouble(pv,upper_alarm_limit);
-            bitSet->set(pv->getFieldOffset());
-        }
-        if(caValueAlarm.upper_warning_limit!=upper_warning_limit) {
-            caValueAlarm.upper_warning_limit = upper_warning_limit;
-            PVScalarPtr pv = pvValueAlarm->getSubField<PVScalar>("highWarningLimit");
-                convert->fromDouble(pv,upper_warning_limit);
-            bitSet->set(pv->getFieldOffset());
-        }
-        if(caValueAlarm.lower_warning_limit!=lower_warning_limit) {
-            caValueAlarm.lower_warning_limit = lower_warning_limit;
-            PVScalarPtr pv = pvValueAlarm->getSubField<PVScalar>("lowWarningLimit");
-            convert->fromDouble(pv,lower_warning_limit);
-            bitSet->set(pv->getFieldOffset());
-        }
-        if(caValueAlarm.lower_alarm_limit!=lower_alarm_limit) {
-            caValueAlarm.lower_alarm_limit = lower_alarm_limit;
-            PVScalarPtr pv = pvValueAlarm->getSubField<PVScalar>("lowAlarmLimit");
-            convert->fromDouble(pv,lower_alarm_limit);
-            bitSet->set(pv->getFieldOffset());
-        }
-    }
     if(firstTime) {
         firstTime = false;
         bitSet->clear();
@@ -976,7 +888,7 @@ Status DbdToPv::putToDBD(
         result = ca_array_put(caValueType,count,channelID,pValue);
     }
     if(result==ECA_NORMAL) {
-         ca_flush_io();
+         caChannel->requestFlush();
     } else {
          status = Status(Status::STATUSTYPE_ERROR, string(ca_message(result)));
     }
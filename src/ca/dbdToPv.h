@@ -75,10 +75,20 @@ typedef std::tr1::shared_ptr<DbdToPv> DbdToPvPtr;
 
 typedef void ( caCallbackFunc ) (struct event_handler_args);
 
+//! Copy the value of a DBR to pvValue
+typedef void ( dbrCopyValueFunc ) (
+    const void *dbrValue, unsigned long count, epics::pvData::PVField *pvValue);
+//! Copy the limits of a DBR_CTRL_*
+typedef void ( dbrCopyLimitsFunc ) (
+    const void *dbr, CaDisplay *display, CaControl *control, CaValueAlarm *valueAlarm);
+
 /**
  * @brief  DbdToPv converts between DBD data and pvData.
  *
- * 
+ * The conversion of DBR data to pvData is planned by activate().
+ * A copy function is chosen for the value, and another for the limits,
+ * according to the DBR type.  The fields of the PVStructure are found
+ * once, rather than on each call of getFromDBD().
  */
 class DbdToPv
 {
@@ -112,6 +122,7 @@ private:
         CAChannelPtr const & caChannel,
         epics::pvData::PVStructurePtr const & pvRequest
     );
+    void bind(epics::pvData::PVStructurePtr const & pvStructure);
     IOType ioType;
     bool dbfIsUCHAR;
     bool dbfIsUSHORT;
@@ -139,6 +150,31 @@ private:
     epics::pvData::Structure::const_shared_pointer structure;
     std::vector<std::string> choices;
     epics::pvData::PVDoubleArrayPtr pvDoubleArray; //for dbfIsINT64 and dbfIsUINT64
+
+    // conversion plan, chosen by activate()
+    dbrCopyValueFunc *copyValue;   // NULL for DBR_ENUM
+    dbrCopyLimitsFunc *copyLimits; // for DBR_CTRL_*
+    // fields of the PVStructure last given to getFromDBD(), found by bind()
+    epics::pvData::PVStructurePtr pvBound;
+    epics::pvData::PVField *pvValue;
+    epics::pvData::PVInt *pvIndex;
+    epics::pvData::PVStringArray *pvChoices;
+    epics::pvData::PVStructure *pvAlarm;
+    epics::pvData::PVInt *pvSeverity;
+    epics::pvData::PVInt *pvStatus;
+    epics::pvData::PVString *pvMessage;
+    epics::pvData::PVLong *pvSeconds;
+    epics::pvData::PVInt *pvNanoseconds;
+    epics::pvData::PVDouble *pvControlHigh;
+    epics::pvData::PVDouble *pvControlLow;
+    epics::pvData::PVDouble *pvDisplayHigh;
+    epics::pvData::PVDouble *pvDisplayLow;
+    epics::pvData::PVString *pvUnits;
+    epics::pvData::PVString *pvFormat;
+    epics::pvData::PVScalarPtr pvHighAlarm;
+    epics::pvData::PVScalarPtr pvHighWarning;
+    epics::pvData::PVScalarPtr pvLowWarning;
+    epics::pvData::PVScalarPtr pvLowAlarm;
 };
 
 }
@@ -0,0 +1,186 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <epicsStdio.h>
+
+#include <epicsGuard.h>
+#include <pv/logger.h>
+
+#include "caChannel.h"
+#define epicsExportSharedSymbols
+#include "notificationPool.h"
+
+using namespace epics::pvData;
+
+typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
+
+namespace epics {
+namespace pvAccess {
+namespace ca {
+
+void NotifyChannelRequester::notify()
+{
+    CAChannelPtr ch(channel.lock());
+    if(ch) ch->notifyClient();
+}
+
+void NotifyGetRequester::notify()
+{
+    CAChannelGetPtr get(channelGet.lock());
+    if(get) get->notifyClient();
+}
+
+void NotifyPutRequester::notify()
+{
+    CAChannelPutPtr put(channelPut.lock());
+    if(put) put->notifyClient();
+}
+
+void NotifyMonitorRequester::notify()
+{
+    CAChannelMonitorPtr mon(channelMonitor.lock());
+    if(mon) mon->notifyClient();
+}
+
+NotificationPool::Worker::Worker(const char *name)
+    :stopping(false)
+    ,latencySum(0.0)
+    ,thread(*this, name,
+            epicsThreadGetStackSize(epicsThreadStackSmall),
+            epicsThreadPriorityLow)
+{
+    stats.depth = stats.maxDepth = 0u;
+    stats.notified = stats.batches = 0u;
+    stats.latencyMean = stats.latencyMax = 0.0;
+}
+
+void NotificationPool::Worker::run()
+{
+    std::vector<NotifyRequesterWPtr> batch;
+    std::vector<NotifyRequesterPtr> todo;
+
+    Guard G(mutex);
+    while(!stopping) {
+        if(queue.empty()) {
+            UnGuard U(G);
+            wakeup.wait();
+            continue;
+        }
+
+        batch.swap(queue);
+
+        epicsTimeStamp now;
+        epicsTimeGetCurrent(&now);
+
+        todo.reserve(batch.size());
+        for(size_t i=0, N=batch.size(); i<N; i++) {
+            NotifyRequesterPtr req(batch[i].lock());
+            if(!req) continue;
+            // events arriving from here on queue another notify()
+            req->isOnQueue = false;
+
+            double latency = epicsTimeDiffInSeconds(&now, &req->queued);
+            latencySum += latency;
+            if(stats.latencyMax < latency)
+                stats.latencyMax = latency;
+            todo.push_back(req);
+        }
+        batch.clear();
+        stats.depth = 0u;
+        stats.notified += todo.size();
+        stats.batches++;
+
+        {
+            UnGuard U(G);
+            for(size_t i=0, N=todo.size(); i<N; i++) {
+                try {
+                    todo[i]->notify();
+                } catch(std::exception& e) {
+                    LOG(logLevelError, "Unhandled exception from CA notification: %s", e.what());
+                }
+            }
+            // release outside of our lock
+            todo.clear();
+        }
+    }
+}
+
+NotificationPool::NotificationPool(size_t nworkers)
+{
+    if(nworkers==0u)
+        nworkers = 1u;
+    workers.reserve(nworkers);
+    for(size_t i=0; i<nworkers; i++) {
+        char name[32];
+        epicsSnprintf(name, sizeof(name), "CAnotify%u", unsigned(i));
+        workers.push_back(new Worker(name));
+        workers.back()->thread.start();
+    }
+}
+
+NotificationPool::~NotificationPool()
+{
+    stop();
+    for(size_t i=0; i<workers.size(); i++)
+        delete workers[i];
+}
+
+size_t NotificationPool::shard(const CAChannel* channel) const
+{
+    // heap addresses are aligned, so discard the low bits
+    size_t key = size_t(channel)/sizeof(void*);
+    key ^= key>>11;
+    return key%workers.size();
+}
+
+void NotificationPool::notify(const NotifyRequesterPtr& req)
+{
+    Worker *worker = workers[req->shard];
+    bool wake;
+    {
+        Guard G(worker->mutex);
+        if(req->isOnQueue || worker->stopping) return;
+        req->isOnQueue = true;
+        epicsTimeGetCurrent(&req->queued);
+        wake = worker->queue.empty();
+        worker->queue.push_back(req);
+        worker->stats.depth = worker->queue.size();
+        if(worker->stats.maxDepth < worker->stats.depth)
+            worker->stats.maxDepth = worker->stats.depth;
+    }
+    if(wake)
+        worker->wakeup.signal();
+}
+
+void NotificationPool::stop()
+{
+    for(size_t i=0; i<workers.size(); i++) {
+        Worker *worker = workers[i];
+        {
+            Guard G(worker->mutex);
+            if(worker->stopping) continue;
+            worker->stopping = true;
+        }
+        worker->wakeup.signal();
+    }
+    for(size_t i=0; i<workers.size(); i++)
+        workers[i]->thread.exitWait();
+}
+
+void NotificationPool::stats(std::vector<CAClientFactory::NotificationStats>& stats) const
+{
+    stats.resize(workers.size());
+    for(size_t i=0; i<workers.size(); i++) {
+        const Worker *worker = workers[i];
+        Guard G(worker->mutex);
+        stats[i] = worker->stats;
+        if(worker->stats.notified)
+            stats[i].latencyMean = worker->latencySum/worker->stats.notified;
+    }
+}
+
+}}}
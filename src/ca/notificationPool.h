@@ -0,0 +1,151 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef NotificationPool_H
+#define NotificationPool_H
+
+#include <vector>
+
+#include <shareLib.h>
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <pv/lock.h>
+#include <pv/sharedPtr.h>
+
+#include <pv/caProvider.h>
+
+namespace epics {
+namespace pvAccess {
+namespace ca {
+
+class CAChannel;
+typedef std::tr1::weak_ptr<CAChannel> CAChannelWPtr;
+class CAChannelGet;
+typedef std::tr1::weak_ptr<CAChannelGet> CAChannelGetWPtr;
+class CAChannelPut;
+typedef std::tr1::weak_ptr<CAChannelPut> CAChannelPutWPtr;
+class CAChannelMonitor;
+typedef std::tr1::weak_ptr<CAChannelMonitor> CAChannelMonitorWPtr;
+
+class NotifyRequester;
+typedef std::tr1::shared_ptr<NotifyRequester> NotifyRequesterPtr;
+typedef std::tr1::weak_ptr<NotifyRequester> NotifyRequesterWPtr;
+
+class NotificationPool;
+typedef std::tr1::shared_ptr<NotificationPool> NotificationPoolPtr;
+
+/** A pending call of notifyClient() on a channel, get, put, or monitor.
+ *
+ * Queued at most once.  Events which arrive while queued are
+ * coalesced into the one notifyClient() call.
+ */
+class NotifyRequester
+{
+public:
+    //! worker which calls notify()
+    const size_t shard;
+    // guarded by the mutex of that worker
+    bool isOnQueue;
+    epicsTimeStamp queued;
+
+    explicit NotifyRequester(size_t shard) : shard(shard), isOnQueue(false) {}
+    virtual ~NotifyRequester() {}
+    virtual void notify() =0;
+};
+
+class NotifyChannelRequester : public NotifyRequester
+{
+public:
+    CAChannelWPtr channel;
+    explicit NotifyChannelRequester(size_t shard) : NotifyRequester(shard) {}
+    void setChannel(std::tr1::shared_ptr<CAChannel> const &channel)
+    { this->channel = channel;}
+    virtual void notify();
+};
+typedef std::tr1::shared_ptr<NotifyChannelRequester> NotifyChannelRequesterPtr;
+
+class NotifyGetRequester : public NotifyRequester
+{
+public:
+    CAChannelGetWPtr channelGet;
+    explicit NotifyGetRequester(size_t shard) : NotifyRequester(shard) {}
+    void setChannelGet(std::tr1::shared_ptr<CAChannelGet> const &channelGet)
+    { this->channelGet = channelGet;}
+    virtual void notify();
+};
+typedef std::tr1::shared_ptr<NotifyGetRequester> NotifyGetRequesterPtr;
+
+class NotifyPutRequester : public NotifyRequester
+{
+public:
+    CAChannelPutWPtr channelPut;
+    explicit NotifyPutRequester(size_t shard) : NotifyRequester(shard) {}
+    void setChannelPut(std::tr1::shared_ptr<CAChannelPut> const &channelPut)
+    { this->channelPut = channelPut;}
+    virtual void notify();
+};
+typedef std::tr1::shared_ptr<NotifyPutRequester> NotifyPutRequesterPtr;
+
+class NotifyMonitorRequester : public NotifyRequester
+{
+public:
+    CAChannelMonitorWPtr channelMonitor;
+    explicit NotifyMonitorRequester(size_t shard) : NotifyRequester(shard) {}
+    void setChannelMonitor(std::tr1::shared_ptr<CAChannelMonitor> const &channelMonitor)
+    { this->channelMonitor = channelMonitor;}
+    virtual void notify();
+};
+typedef std::tr1::shared_ptr<NotifyMonitorRequester> NotifyMonitorRequesterPtr;
+
+/** Worker threads which call notifyClient() for one CAChannelProvider.
+ *
+ * Notifications are sharded by channel, so those of one channel
+ * (connect, get, put, and monitor) are made in order by one worker.
+ * Each worker takes all queued notifications in one batch.
+ */
+class NotificationPool
+{
+public:
+    POINTER_DEFINITIONS(NotificationPool);
+
+    explicit NotificationPool(size_t nworkers);
+    ~NotificationPool();
+
+    //! Worker for all notifications of a channel
+    size_t shard(const CAChannel* channel) const;
+    //! Queue notify() unless already queued.  Ignored once stopped.
+    void notify(const NotifyRequesterPtr& req);
+    //! Wait for workers to exit.  Queued notifications are dropped.
+    void stop();
+
+    void stats(std::vector<CAClientFactory::NotificationStats>& stats) const;
+
+private:
+    struct Worker : public epicsThreadRunable
+    {
+        mutable epicsMutex mutex;
+        epicsEvent wakeup;
+        bool stopping;
+        std::vector<NotifyRequesterWPtr> queue;
+        CAClientFactory::NotificationStats stats;
+        double latencySum;
+        epicsThread thread;
+
+        explicit Worker(const char *name);
+        virtual ~Worker() {}
+        virtual void run();
+    };
+
+    std::vector<Worker*> workers;
+
+    NotificationPool(const NotificationPool&);
+    NotificationPool& operator=(const NotificationPool&);
+};
+
+}}}
+
+#endif  /* NotificationPool_H */
@@ -10,6 +10,8 @@
 #ifndef CAPROVIDER_H
 #define CAPROVIDER_H
 
+#include <vector>
+
 #include <shareLib.h>
 #include <pv/pvAccess.h>
 
@@ -36,7 +38,9 @@ namespace ca {
  *         when rapid gets, puts, and monitor events are happening.
  *    The callbacks should not call any pvAccess method.
  *    If any such call is made the separate thread becomes a ca auxillary thread.
- * 
+ *
+ * These callbacks are made by a pool of $EPICS_PVA_CA_NOTIFY_THREADS worker threads
+ * (default 4).  All callbacks for one channel are made by the same worker.
  */
 class epicsShareClass CAClientFactory
 {
@@ -50,6 +54,25 @@ public:
      * This does nothing since epicsAtExit is used to destroy the instance.
      */
     static void stop();
+
+    //! Counters of one notification worker thread
+    struct NotificationStats {
+        //! notifications now queued
+        size_t depth;
+        //! largest depth seen
+        size_t maxDepth;
+        //! notifications made
+        size_t notified;
+        //! times the queue was drained
+        size_t batches;
+        //! seconds from queueing to being taken by the worker
+        double latencyMean, latencyMax;
+    };
+    /** @brief Counters of each notification worker of provider ca
+     *
+     * Leaves stats empty if start() has not been called.
+     */
+    static void notificationStats(std::vector<NotificationStats>& stats);
 };
 
 }}}
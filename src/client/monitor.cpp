@@ -51,6 +51,7 @@ MonitorFIFO::MonitorFIFO(const std::tr1::shared_ptr<MonitorRequester> &requester
     ,needClosed(false)
     ,freeHighLevel(0u)
     ,flowCount(0)
+    ,nallocated(0u)
 {
     REFTRACE_INCREMENT(num_instances);
 
@@ -163,6 +164,7 @@ void MonitorFIFO::open(const pvd::StructureConstPtr& type)
             while(empty.size() < conf.actualCount+1) {
                 MonitorElementPtr elem(new MonitorElement(mapper.buildRequested()));
                 empty.push_back(elem);
+                nallocated++;
             }
 
             state = Opened;
@@ -229,6 +231,7 @@ bool MonitorFIFO::tryPost(const pvData::PVStructure& value,
     } else if(force) {
         // allocate an extra element
         elem.reset(new MonitorElement(mapper.buildRequested()));
+        nallocated++;
     }
 
     if(elem) {
@@ -238,6 +241,7 @@ bool MonitorFIFO::tryPost(const pvData::PVStructure& value,
                                        *elem->pvStructurePtr, *elem->changedBitSet);
             elem->overrunBitSet->clear();
             mapper.maskBaseToRequested(overrun, *elem->overrunBitSet);
+            elem->fanout.reset();
 
             if(inuse.empty() && running)
                 needEvent = true;
@@ -259,6 +263,14 @@ bool MonitorFIFO::tryPost(const pvData::PVStructure& value,
 void MonitorFIFO::post(const pvData::PVStructure& value,
                        const pvd::BitSet& changed,
                        const pvd::BitSet& overrun)
+{
+    post(value, changed, overrun, MonitorFanout::shared_pointer());
+}
+
+void MonitorFIFO::post(const pvData::PVStructure& value,
+                       const pvd::BitSet& changed,
+                       const pvd::BitSet& overrun,
+                       const MonitorFanout::shared_pointer& fanout)
 {
     Guard G(mutex);
 
@@ -293,6 +305,7 @@ void MonitorFIFO::post(const pvData::PVStructure& value,
         *elem->changedBitSet = scratch;
         elem->overrunBitSet->clear();
         mapper.maskBaseToRequested(overrun, *elem->overrunBitSet);
+        elem->fanout = fanout;
 
         if(inuse.empty() && running)
             needEvent = true;
@@ -310,6 +323,8 @@ void MonitorFIFO::post(const pvData::PVStructure& value,
         oscratch.clear();
         mapper.maskBaseToRequested(overrun, oscratch);
         elem->overrunBitSet->or_and(oscratch, scratch);
+        // no longer the same as any other
+        elem->fanout.reset();
 
         // leave as inuse.back()
     }
@@ -428,6 +443,9 @@ void MonitorFIFO::release(MonitorElementPtr const & elem)
     {
         Guard G(mutex);
 
+        // don't keep the encoding until re-use
+        elem->fanout.reset();
+
         assert(!inuse.empty() || !empty.empty());
 
         const pvd::StructureConstPtr& type((!inuse.empty() ? inuse.front() : empty.back())->pvStructurePtr->getStructure());
@@ -464,6 +482,7 @@ void MonitorFIFO::getStats(Stats& s) const
     s.nempty = empty.size() + returned.size();
     s.nfilled = inuse.size();
     s.noutstanding = conf.actualCount - s.nempty - s.nfilled;
+    s.nallocated = nallocated;
 }
 
 void MonitorFIFO::reportRemoteQueueStatus(pvd::int32 nfree)
@@ -514,4 +533,53 @@ size_t MonitorFIFO::_freeCount() const
     }
 }
 
+size_t MonitorFanout::num_instances;
+
+MonitorFanout::MonitorFanout()
+{
+    REFTRACE_INCREMENT(num_instances);
+}
+
+MonitorFanout::~MonitorFanout()
+{
+    REFTRACE_DECREMENT(num_instances);
+}
+
+const MonitorFanout::Entry* MonitorFanout::lookup(const MonitorElement& elem, int byteOrder) const
+{
+    for(size_t i=0, N=entries.size(); i<N; i++) {
+        const Entry& ent = entries[i];
+        if(ent.byteOrder==byteOrder
+                && ent.type==elem.pvStructurePtr->getStructure()
+                && ent.changed==*elem.changedBitSet
+                && ent.overrun==*elem.overrunBitSet)
+            return &ent;
+    }
+    return 0;
+}
+
+MonitorFanout::encoded_t MonitorFanout::find(const MonitorElement& elem, int byteOrder) const
+{
+    Guard G(mutex);
+    const Entry *ent = lookup(elem, byteOrder);
+    return ent ? ent->encoded : encoded_t();
+}
+
+MonitorFanout::encoded_t MonitorFanout::store(const MonitorElement& elem, int byteOrder, const encoded_t& encoded)
+{
+    Guard G(mutex);
+    const Entry *ent = lookup(elem, byteOrder);
+    if(ent)
+        return ent->encoded;
+
+    entries.push_back(Entry());
+    Entry& nent = entries.back();
+    nent.type = elem.pvStructurePtr->getStructure();
+    nent.changed = *elem.changedBitSet;
+    nent.overrun = *elem.overrunBitSet;
+    nent.byteOrder = byteOrder;
+    nent.encoded = encoded;
+    return encoded;
+}
+
 }} // namespace epics::pvAccess
@@ -0,0 +1,470 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <sstream>
+#include <stdexcept>
+
+#include <epicsGuard.h>
+#include <epicsAtomic.h>
+
+#define epicsExportSharedSymbols
+#include <pv/monitor.h>
+#include <pv/pvAccess.h>
+#include <pv/reftrack.h>
+
+namespace pvd = epics::pvData;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+// epicsAtomicCmpAndSwapIntT() is a full barrier.  Used for flags where
+// each side stores, then loads what the other side stored.
+
+// clear flag, and return true if it was set
+inline bool testAndClear(int *flag) { return epicsAtomicCmpAndSwapIntT(flag, 1, 0)==1; }
+// set flag, and return true if it was clear
+inline bool testAndSet(int *flag) { return epicsAtomicCmpAndSwapIntT(flag, 0, 1)==0; }
+}
+
+namespace epics {namespace pvAccess {
+
+size_t MonitorRing::num_instances;
+
+MonitorRing::MonitorRing(const std::tr1::shared_ptr<MonitorRequester> &requester,
+                         const pvData::PVStructure::const_shared_pointer &pvRequest,
+                         MonitorFIFO::Config *inconf)
+    :conf(inconf ? *inconf : MonitorFIFO::Config())
+    ,nelems(0u)
+    ,requester(requester)
+    ,pvRequest(pvRequest)
+    ,state(Closed)
+    ,opened(false)
+    ,running(false)
+    ,needConnected(false)
+    ,needUnlisten(false)
+    ,needClosed(false)
+    ,accepting(0)
+    ,finished(0)
+    ,needEvent(0)
+    ,needCtrl(0)
+    ,unlistened(0)
+    ,waiting(1)
+    ,missed(0)
+    ,outstanding(0u)
+    ,filledHead(0u)
+    ,filledTail(0u)
+    ,lastFilled(0u)
+    ,havePosted(false)
+    ,emptyHead(0u)
+    ,emptyTail(0u)
+{
+    REFTRACE_INCREMENT(num_instances);
+
+    if(conf.maxCount==0)
+        conf.maxCount = 1;
+
+    if(conf.defCount==0)
+        conf.defCount = 1;
+
+    pvd::PVScalar::const_shared_pointer O(pvRequest->getSubField<pvd::PVScalar>("record._options.queueSize"));
+    if(O && conf.actualCount==0) {
+        try {
+            conf.actualCount = O->getAs<pvd::uint32>();
+        } catch(std::exception& e) {
+            std::ostringstream strm;
+            strm<<"invalid queueSize : "<<e.what();
+            requester->message(strm.str());
+        }
+    }
+
+    if(conf.actualCount==0)
+        conf.actualCount = conf.defCount;
+
+    if(conf.actualCount > conf.maxCount)
+        conf.actualCount = conf.maxCount;
+
+    O = pvRequest->getSubField<pvd::PVScalar>("record._options.pipeline");
+    if(O) {
+        try {
+            if(O->getAs<pvd::boolean>())
+                requester->message("pipeline not supported, ignored", warningMessage);
+        } catch(std::exception& e) {
+            std::ostringstream strm;
+            strm<<"invalid pipeline : "<<e.what();
+            requester->message(strm.str());
+        }
+    }
+
+    // one extra element to hold data when post()
+    // while all others are poll()'d
+    nelems = conf.actualCount+1u;
+
+    filled.resize(nelems);
+    // one extra slot to distinguish full from empty
+    empty.resize(nelems+1u);
+
+    if(inconf)
+        *inconf = conf;
+}
+
+MonitorRing::~MonitorRing() {
+    REFTRACE_DECREMENT(num_instances);
+}
+
+void MonitorRing::destroy()
+{}
+
+void MonitorRing::show(std::ostream& strm) const
+{
+    Stats s;
+    getStats(s);
+
+    strm<<"MonitorRing"
+          " size="<<conf.actualCount
+        <<"\n";
+
+    Guard G(mutex);
+
+    switch(state) {
+    case Closed: strm<<"  Closed"; break;
+    case Opened: strm<<"  Opened"; break;
+    case Error:  strm<<"  Error:"<<error; break;
+    }
+
+    strm<<" running="<<running<<" finished="<<epicsAtomicGetIntT(&finished)<<"\n";
+    strm<<"  #empty="<<s.nempty<<" #filled="<<s.nfilled<<" #outstanding="<<s.noutstanding<<"\n";
+}
+
+void MonitorRing::open(const pvd::StructureConstPtr& type)
+{
+    std::string message;
+    {
+        Guard G(mutex);
+
+        if(opened)
+            throw std::logic_error("MonitorRing can not be re-opened");
+        opened = true;
+
+        pvd::PVDataCreatePtr create(pvd::getPVDataCreate());
+
+        try {
+            mapper.compute(*create->createPVStructure(type), *pvRequest, conf.mapperMode);
+            message = mapper.warnings();
+
+            for(size_t i=0; i<nelems; i++)
+                empty[i].reset(new MonitorElement(mapper.buildRequested()));
+            epicsAtomicSetSizeT(&emptyHead, nelems);
+
+            state = Opened;
+            error = pvd::Status(); // ok
+            epicsAtomicSetIntT(&accepting, 1);
+
+        }catch(std::runtime_error& e){
+            // error from compute()
+            error = pvd::Status::error(e.what());
+            state = Error;
+        }
+        needConnected = true;
+        epicsAtomicSetIntT(&needCtrl, 1);
+    }
+    if(message.empty()) return;
+    requester_type::shared_pointer req(requester.lock());
+    if(req) {
+        req->message(message, warningMessage);
+    }
+}
+
+void MonitorRing::close()
+{
+    Guard G(mutex);
+    epicsAtomicSetIntT(&accepting, 0);
+    needClosed = state==Opened;
+    state = Closed;
+    if(needClosed)
+        epicsAtomicSetIntT(&needCtrl, 1);
+}
+
+void MonitorRing::finish()
+{
+    Guard G(mutex);
+    if(state==Closed)
+        throw std::logic_error("Can not finish() a closed Monitor");
+    else if(epicsAtomicGetIntT(&finished))
+        return; // no-op
+
+    epicsAtomicSetIntT(&accepting, 0);
+    epicsAtomicSetIntT(&finished, 1);
+    // if not empty, poll() of the last element will unlisten()
+    if(ringEmpty() && running && state==Opened) {
+        needUnlisten = true;
+        epicsAtomicSetIntT(&needCtrl, 1);
+    }
+}
+
+// called from post()
+MonitorElementPtr MonitorRing::takeEmpty()
+{
+    MonitorElementPtr ret;
+    const size_t tail = emptyTail;
+    if(tail != epicsAtomicGetSizeT(&emptyHead)) {
+        ret.swap(empty[tail]);
+        epicsAtomicSetSizeT(&emptyTail, (tail+1u)%empty.size());
+    }
+    return ret;
+}
+
+bool MonitorRing::ringEmpty() const
+{
+    const Slot& slot = filled[epicsAtomicGetSizeT(&filledTail)];
+    return epicsAtomicGetIntT(&slot.state)==SlotEmpty;
+}
+
+void MonitorRing::post(const pvData::PVStructure& value,
+                       const pvd::BitSet& changed,
+                       const pvd::BitSet& overrun)
+{
+    if(!epicsAtomicGetIntT(&accepting)) return;
+
+    if(conf.dropEmptyUpdates && !changed.logical_and(mapper.requestedMask()))
+        return; // drop empty update
+
+    for(;;) {
+        MonitorElementPtr elem(takeEmpty());
+
+        if(elem) {
+            // fill an empty element
+            elem->changedBitSet->clear();
+            mapper.copyBaseToRequested(value, changed, *elem->pvStructurePtr, *elem->changedBitSet);
+            elem->overrunBitSet->clear();
+            mapper.maskBaseToRequested(overrun, *elem->overrunBitSet);
+
+            // we just took one of nelems elements, so at most nelems-1 are filled
+            Slot& slot = filled[filledHead];
+            assert(epicsAtomicGetIntT(&slot.state)==SlotEmpty);
+            slot.elem.swap(elem);
+
+            lastFilled = filledHead;
+            havePosted = true;
+            epicsAtomicSetSizeT(&filledHead, (filledHead+1u)%nelems);
+
+            epicsAtomicCmpAndSwapIntT(&slot.state, SlotEmpty, SlotFilled);
+
+            if(testAndClear(&waiting))
+                epicsAtomicSetIntT(&needEvent, 1);
+            return;
+
+        } else if(!havePosted) {
+            // can't happen.  poll() never takes every element
+            return;
+        }
+
+        // in overflow.  squash with the most recent element, unless it has just been poll()'d
+        Slot& slot = filled[lastFilled];
+        if(epicsAtomicCmpAndSwapIntT(&slot.state, SlotFilled, SlotSquash)==SlotFilled) {
+            MonitorElement& last = *slot.elem;
+
+            scratch.clear();
+            mapper.copyBaseToRequested(value, changed, *last.pvStructurePtr, scratch);
+
+            last.overrunBitSet->or_and(*last.changedBitSet, scratch);
+            *last.changedBitSet |= scratch;
+            oscratch.clear();
+            mapper.maskBaseToRequested(overrun, oscratch);
+            last.overrunBitSet->or_and(oscratch, scratch);
+
+            epicsAtomicCmpAndSwapIntT(&slot.state, SlotSquash, SlotFilled);
+
+            if(testAndClear(&missed))
+                epicsAtomicSetIntT(&needEvent, 1);
+            return;
+        }
+
+        // poll() took the most recent element after takeEmpty() found nothing.
+        // Since poll() leaves one element, another has been release()'d.  retry
+    }
+}
+
+void MonitorRing::notify()
+{
+    // common case for post() while the consumer is busy.  No locking.
+    if(!epicsAtomicGetIntT(&needEvent) && !epicsAtomicGetIntT(&needCtrl))
+        return;
+
+    Monitor::shared_pointer self;
+    MonitorRequester::shared_pointer req;
+    pvd::StructureConstPtr type;
+    bool conn = false,
+         evt = false,
+         unl = false,
+         clo = false;
+    pvd::Status err;
+
+    {
+        Guard G(mutex);
+
+        epicsAtomicSetIntT(&needCtrl, 0);
+
+        std::swap(conn, needConnected);
+        std::swap(unl, needUnlisten);
+        std::swap(clo, needClosed);
+        std::swap(err, error);
+
+        evt = testAndClear(&needEvent) && running;
+        unl = unl && testAndSet(&unlistened);
+
+        if(conn | evt | unl | clo) {
+            req = requester.lock();
+            self = shared_from_this();
+        }
+        if(conn && err.isSuccess())
+            type = mapper.requested();
+    }
+
+    if(!req)
+        return;
+    if(conn && err.isSuccess())
+        req->monitorConnect(pvd::Status(), self, type);
+    else if(conn)
+        req->monitorConnect(err, self, type);
+    if(evt)
+        req->monitorEvent(self);
+    if(unl)
+        req->unlisten(self);
+    if(clo)
+        req->channelDisconnect(false);
+}
+
+pvd::Status MonitorRing::start()
+{
+    Monitor::shared_pointer self;
+    MonitorRequester::shared_pointer req;
+
+    {
+        Guard G(mutex);
+
+        if(state==Closed)
+            throw std::logic_error("Monitor can't start() before open()");
+
+        if(running || state!=Opened)
+            return pvd::Status();
+
+        if(!ringEmpty()) {
+            self = shared_from_this();
+            req = requester.lock();
+        }
+
+        running = true;
+    }
+
+    if(req)
+        req->monitorEvent(self);
+
+    return pvd::Status();
+}
+
+pvd::Status MonitorRing::stop()
+{
+    Guard G(mutex);
+
+    running = false;
+
+    return pvd::Status();
+}
+
+MonitorElementPtr MonitorRing::poll()
+{
+    MonitorElementPtr ret;
+
+    // leave one element for post() to squash into
+    if(epicsAtomicGetSizeT(&outstanding) >= nelems-1u)
+        return ret;
+
+    Slot& slot = filled[filledTail];
+    bool announced = false;
+
+    for(;;) {
+        const int sstate = epicsAtomicGetIntT(&slot.state);
+
+        if(sstate==SlotFilled) {
+            // elem is only replaced while Empty
+            MonitorElementPtr elem(slot.elem);
+            if(epicsAtomicCmpAndSwapIntT(&slot.state, SlotFilled, SlotEmpty)==SlotFilled) {
+                ret.swap(elem);
+                break;
+            }
+            // post() began squashing
+            continue;
+
+        } else if(announced) {
+            break;
+        }
+
+        // Nothing to take (Empty), or post() is squashing (Squash).
+        // Ask post() to wake us, then check once more.
+        testAndSet(sstate==SlotEmpty ? &waiting : &missed);
+        announced = true;
+    }
+
+    if(!ret)
+        return ret;
+
+    epicsAtomicIncrSizeT(&outstanding);
+    epicsAtomicSetSizeT(&filledTail, (filledTail+1u)%nelems);
+
+    if(epicsAtomicGetIntT(&finished) && ringEmpty() && testAndSet(&unlistened)) {
+        Monitor::shared_pointer self(shared_from_this());
+        MonitorRequester::shared_pointer req(requester.lock());
+        if(req)
+            req->unlisten(self);
+    }
+
+    return ret;
+}
+
+void MonitorRing::release(MonitorElementPtr const & elem)
+{
+    if(!elem || elem->pvStructurePtr->getStructure()!=mapper.requested())
+        return; // not one of ours
+
+    if(epicsAtomicGetSizeT(&outstanding)==0u)
+        return; // paranoia
+
+    const size_t head = emptyHead;
+    empty[head] = elem;
+    epicsAtomicSetSizeT(&emptyHead, (head+1u)%empty.size());
+
+    epicsAtomicDecrSizeT(&outstanding);
+}
+
+void MonitorRing::getStats(Stats& s) const
+{
+    s.nfilled = s.noutstanding = s.nempty = s.nallocated = 0u;
+
+    {
+        Guard G(mutex);
+        if(!opened || state==Error)
+            return;
+    }
+
+    const size_t esize = empty.size();
+    s.nempty = (epicsAtomicGetSizeT(&emptyHead)
+                + esize - epicsAtomicGetSizeT(&emptyTail))%esize;
+    s.noutstanding = epicsAtomicGetSizeT(&outstanding);
+    // only open() allocates
+    s.nallocated = nelems;
+    // may be briefly inconsistent
+    if(s.nempty + s.noutstanding < nelems)
+        s.nfilled = nelems - s.nempty - s.noutstanding;
+}
+
+size_t MonitorRing::freeCount() const
+{
+    Stats s;
+    getStats(s);
+    // as with MonitorFIFO, the last element is not counted as free
+    return s.nempty ? s.nempty-1u : 0u;
+}
+
+}} // namespace epics::pvAccess
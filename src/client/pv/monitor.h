@@ -10,6 +10,7 @@
 #define MONITOR_H
 
 #include <list>
+#include <vector>
 #include <ostream>
 
 #ifdef epicsExportSharedSymbols
@@ -44,6 +45,8 @@ typedef std::vector<MonitorElementPtr> MonitorElementPtrArray;
 class Monitor;
 typedef std::tr1::shared_ptr<Monitor> MonitorPtr;
 
+class MonitorFanout;
+
 
 /**
  * @brief An element for a monitorQueue.
@@ -58,10 +61,56 @@ public:
     const epics::pvData::PVStructurePtr pvStructurePtr;
     const epics::pvData::BitSet::shared_pointer changedBitSet;
     const epics::pvData::BitSet::shared_pointer overrunBitSet;
+    /** Shared with the elements of other subscriptions which were filled from the same update.
+     *  Allows a server to encode the update once.  May be NULL.
+     *  Set by MonitorFIFO::post(), and cleared when the element is re-used.
+     */
+    std::tr1::shared_ptr<MonitorFanout> fanout;
 
     class Ref;
 };
 
+/** Encoded forms of one update, shared by the MonitorElement of each subscription filled from it.
+ *
+ * An encoding is the changed BitSet, the changed fields, and the overrun BitSet,
+ * as sent in a CMD_MONITOR message.  Elements with the same type, changed, and overrun
+ * BitSets have the same encoding for a given byte order.
+ *
+ * @since >7.1.0
+ */
+class epicsShareClass MonitorFanout {
+public:
+    POINTER_DEFINITIONS(MonitorFanout);
+
+    typedef std::vector<char> buffer_t;
+    typedef std::tr1::shared_ptr<const buffer_t> encoded_t;
+
+    MonitorFanout();
+    ~MonitorFanout();
+
+    //! Previously stored encoding of an element like elem, or NULL
+    encoded_t find(const MonitorElement& elem, int byteOrder) const;
+    //! Store an encoding of elem.  Returns the one already stored by a racing caller, if any.
+    encoded_t store(const MonitorElement& elem, int byteOrder, const encoded_t& encoded);
+
+private:
+    friend void providerRegInit(void*);
+    static size_t num_instances;
+
+    struct Entry {
+        epics::pvData::StructureConstPtr type;
+        epics::pvData::BitSet changed, overrun;
+        int byteOrder;
+        encoded_t encoded;
+    };
+    mutable epicsMutex mutex;
+    std::vector<Entry> entries; // few.  one per distinct field mask
+
+    const Entry* lookup(const MonitorElement& elem, int byteOrder) const;
+
+    EPICS_NOT_COPYABLE(MonitorFanout)
+};
+
 /** Access to Monitor subscription and queue
  *
  * Downstream interface to access a monitor queue (via poll() and release() )
@@ -101,10 +150,13 @@ class epicsShareClass Monitor : public virtual Destroyable{
         size_t nfilled; //!< # of elements ready to be poll()d
         size_t noutstanding; //!< # of elements poll()d but not released()d
         size_t nempty; //!< # of elements available for new remote data
+        //! # of elements allocated since creation.  Does not change while updates are delivered
+        //! unless the queue has to grow.  Zero if not tracked.
+        size_t nallocated;
     };
 
     virtual void getStats(Stats& s) const {
-        s.nfilled = s.noutstanding = s.nempty = 0;
+        s.nfilled = s.noutstanding = s.nempty = s.nallocated = 0;
     }
 
     /**
@@ -326,6 +378,12 @@ public:
     void post(const pvData::PVStructure& value,
               const epics::pvData::BitSet& changed,
               const epics::pvData::BitSet& overrun = epics::pvData::BitSet());
+    //! As post().  A newly filled element also references fanout, which the caller
+    //! should pass to the post() of each subscription receiving the same update.  May be NULL.
+    void post(const pvData::PVStructure& value,
+              const epics::pvData::BitSet& changed,
+              const epics::pvData::BitSet& overrun,
+              const std::tr1::shared_ptr<MonitorFanout>& fanout);
     //! Call after calling any other upstream interface methods (open()/close()/finish()/post()/...)
     //! when no upstream mutexes are locked.
     //! Do not call from Source::freeHighMark().  This is done automatically.
@@ -399,6 +457,7 @@ private:
 
     size_t freeHighLevel;
     epicsInt32 flowCount;
+    size_t nallocated; // # of MonitorElement allocated
 
     epics::pvData::PVRequestMapper mapper;
 
@@ -423,6 +482,152 @@ std::ostream& operator<<(std::ostream& strm, const MonitorFIFO& fifo) {
     return strm;
 }
 
+/** Alternative to MonitorFIFO for one producer and one consumer thread.
+ *
+ * Elements are preallocated by open() and handed between the producer (post())
+ * and the consumer (poll() and release()) through bounded lock-free rings,
+ * so that neither side waits for the other.
+ *
+ * post() has the same overflow behavior as MonitorFIFO::post().
+ * When all elements are in use, a new update is combined with the most
+ * recent element not yet poll()'d, and overrun bits are set.
+ *
+ * Compared to MonitorFIFO
+ *
+ * - Calls to post() must be made from a single thread, or externally serialized.
+ * - Calls to poll() and release() must be made from a single thread, or externally serialized.
+ * - There is no tryPost() or Source::freeHighMark() callback.
+ * - pvRequest option record._options.pipeline=true is not supported, and is ignored.
+ * - open() may only be called once.
+ *
+ * @note As with MonitorFIFO, calls to post() __must__ be followed with a call to notify().
+ *       notify() only locks if there is something to notify.
+ * @since >7.1.0
+ */
+class epicsShareClass MonitorRing : public Monitor,
+                                    public std::tr1::enable_shared_from_this<MonitorRing>
+{
+public:
+    POINTER_DEFINITIONS(MonitorRing);
+
+    /**
+     * @param requester Downstream/consumer callbacks
+     * @param pvRequest Downstream provided options
+     * @param conf Upstream provided options.  Updated with actual values used.  May be NULL to use defaults.
+     */
+    MonitorRing(const std::tr1::shared_ptr<MonitorRequester> &requester,
+                const pvData::PVStructure::const_shared_pointer &pvRequest,
+                MonitorFIFO::Config *conf=0);
+    virtual ~MonitorRing();
+
+    inline const std::tr1::shared_ptr<MonitorRequester> getRequester() const { return requester.lock(); }
+
+    void show(std::ostream& strm) const;
+
+    virtual void destroy() OVERRIDE FINAL;
+
+    // up-stream interface (putting data into ring)
+    //! Mark subscription as "open" with the associated structure type.
+    void open(const epics::pvData::StructureConstPtr& type);
+    //! Abnormal closure (eg. due to upstream dis-connection)
+    void close();
+    //! Successful closure (eg. RDB query done)
+    void finish();
+    //! Consume a free element if available, otherwise squash with most recent
+    void post(const pvData::PVStructure& value,
+              const epics::pvData::BitSet& changed,
+              const epics::pvData::BitSet& overrun = epics::pvData::BitSet());
+    //! Call after calling any other upstream interface methods (open()/close()/finish()/post())
+    //! when no upstream mutexes are locked.
+    //! Call any MonitorRequester methods.
+    void notify();
+
+    // down-stream interface (taking data from ring)
+    virtual epics::pvData::Status start() OVERRIDE FINAL;
+    virtual epics::pvData::Status stop() OVERRIDE FINAL;
+    virtual MonitorElementPtr poll() OVERRIDE FINAL;
+    virtual void release(MonitorElementPtr const & monitorElement) OVERRIDE FINAL;
+    virtual void getStats(Stats& s) const OVERRIDE FINAL;
+
+    //! Number of free elements at this moment, which may changed in the next.
+    size_t freeCount() const;
+
+private:
+    friend void providerRegInit(void*);
+    static size_t num_instances;
+
+    // const after ctor
+    MonitorFIFO::Config conf;
+    // number of elements, conf.actualCount+1.  const after ctor
+    size_t nelems;
+
+    const std::tr1::weak_ptr<MonitorRequester> requester;
+    const epics::pvData::PVStructure::const_shared_pointer pvRequest;
+
+    // guards open()/close()/finish()/start()/stop()/notify() state
+    mutable epicsMutex mutex;
+
+    enum state_t {
+        Closed, // not open()'d
+        Opened, // successful open()
+        Error,  // unsuccessful open()
+    } state;
+    bool opened; // open() has been called
+    bool running; // start() vs. stop()
+    bool needConnected;
+    bool needUnlisten;
+    bool needClosed;
+    epics::pvData::Status error; // Set when entering Error state
+
+    // accessed with epicsAtomic*()
+    int accepting;   // post() allowed.  Opened and !finished
+    int finished;    // finish() called
+    int needEvent;   // set by producer when a waiting consumer should be woken
+    int needCtrl;    // set when notify() has something other than an event to deliver
+    int unlistened;  // unlisten() delivered
+    int waiting;     // consumer found nothing to poll()
+    int missed;      // consumer found the next element being squashed
+    size_t outstanding; // poll()'d but not release()'d
+
+    // producer side.  const after open()
+    epics::pvData::PVRequestMapper mapper;
+    epics::pvData::BitSet scratch, oscratch; // using during post to avoid re-alloc
+
+    // Filled elements, producer -> consumer.
+    // A slot is written only by the producer while Empty.
+    enum slot_state_t {
+        SlotEmpty,
+        SlotFilled,
+        SlotSquash, // producer is combining an update with this element
+    };
+    struct Slot {
+        MonitorElementPtr elem;
+        int state;
+        Slot() :state(SlotEmpty) {}
+    };
+    std::vector<Slot> filled;
+    size_t filledHead; // next slot to fill.  producer owned
+    size_t filledTail; // next slot to poll().  consumer owned
+    size_t lastFilled; // most recently filled slot.  producer owned
+    bool havePosted;   // lastFilled is valid.  producer owned
+
+    // Free elements, consumer -> producer.
+    std::vector<MonitorElementPtr> empty;
+    size_t emptyHead; // next slot to release() into.  written by consumer
+    size_t emptyTail; // next slot to take in post().  written by producer
+
+    MonitorElementPtr takeEmpty();
+    bool ringEmpty() const;
+
+    EPICS_NOT_COPYABLE(MonitorRing)
+};
+
+static inline
+std::ostream& operator<<(std::ostream& strm, const MonitorRing& ring) {
+    ring.show(strm);
+    return strm;
+}
+
 }}
 
 namespace epics { namespace pvData {
@@ -225,6 +225,8 @@ void providerRegInit(void*)
     registerRefCounter("ChannelRequest (ABC)", &ChannelRequest::num_instances);
     registerRefCounter("ResponseHandler (ABC)", &ResponseHandler::num_instances);
     registerRefCounter("MonitorFIFO", &MonitorFIFO::num_instances);
+    registerRefCounter("MonitorRing", &MonitorRing::num_instances);
+    registerRefCounter("MonitorFanout", &MonitorFanout::num_instances);
     pvas::registerRefTrackServer();
     registerRefCounter("pvas::SharedChannel", &pvas::detail::SharedChannel::num_instances);
     registerRefCounter("pvas::SharedPut", &pvas::detail::SharedPut::num_instances);
@@ -21,29 +21,39 @@ BeaconHandler::BeaconHandler(Context::shared_pointer const & context,
     _mutex(),
     _serverGUID(),
     _serverChangeCount(-1),
-    _first(true)
+    _first(true),
+    _restarts(0u)
 {
-
+    memset(&_serverAddress, 0, sizeof(_serverAddress));
 }
 
 BeaconHandler::~BeaconHandler()
 {
 }
 
-void BeaconHandler::beaconNotify(osiSockAddr* /*from*/, int8 remoteTransportRevision,
+void BeaconHandler::beaconNotify(osiSockAddr* /*from*/, osiSockAddr* serverAddress,
+                                 int8 remoteTransportRevision,
                                  TimeStamp* timestamp, ServerGUID const & guid, int16 sequentalID,
                                  int16 changeCount,
                                  const PVFieldPtr& /*data*/)
 {
-    bool networkChanged = updateBeacon(remoteTransportRevision, timestamp, guid, sequentalID, changeCount);
-    // TODO: reduce search timers
+    bool networkChanged = updateBeacon(*serverAddress, remoteTransportRevision, timestamp, guid, sequentalID, changeCount);
     (void)networkChanged;
 }
 
-bool BeaconHandler::updateBeacon(int8 /*remoteTransportRevision*/, TimeStamp* /*timestamp*/,
+size_t BeaconHandler::getRestartCount()
+{
+    Lock guard(_mutex);
+    return _restarts;
+}
+
+bool BeaconHandler::updateBeacon(const osiSockAddr& serverAddress,
+                                 int8 /*remoteTransportRevision*/, TimeStamp* /*timestamp*/,
                                  ServerGUID const & guid, int16 /*sequentalID*/, int16 changeCount)
 {
     Lock guard(_mutex);
+    _serverAddress = serverAddress;
+
     // first beacon notification check
     if (_first)
     {
@@ -51,8 +61,8 @@ bool BeaconHandler::updateBeacon(int8 /*remoteTransportRevision*/, TimeStamp* /*
         _serverGUID = guid;
         _serverChangeCount = changeCount;
 
-        // new server up..
-        _context.lock()->newServerDetected();
+        // new server up, or one which restarted before its first beacon was seen
+        _context.lock()->serverRestarted(guid, serverAddress);
 
         return false;
     }
@@ -63,8 +73,9 @@ bool BeaconHandler::updateBeacon(int8 /*remoteTransportRevision*/, TimeStamp* /*
         // update startup time and change count
         _serverGUID = guid;
         _serverChangeCount = changeCount;
+        _restarts++;
 
-        _context.lock()->newServerDetected();
+        _context.lock()->serverRestarted(guid, serverAddress);
 
         return true;
     }
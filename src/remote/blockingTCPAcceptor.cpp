@@ -25,13 +25,15 @@ namespace pvAccess {
 
 BlockingTCPAcceptor::BlockingTCPAcceptor(Context::shared_pointer const & context,
         ResponseHandler::shared_pointer const & responseHandler,
-        const osiSockAddr& addr, int receiveBufferSize) :
+        const osiSockAddr& addr, int receiveBufferSize,
+        const TCPSocketOptions& socketOptions) :
     _context(context),
     _responseHandler(responseHandler),
     _bindAddress(),
     _serverSocketChannel(INVALID_SOCKET),
     _receiveBufferSize(receiveBufferSize),
     _destroyed(false),
+    _socketOptions(socketOptions),
     _thread(*this, "TCP-acceptor",
             epicsThreadGetStackSize(
                 epicsThreadStackBig),
@@ -45,6 +47,11 @@ BlockingTCPAcceptor::~BlockingTCPAcceptor() {
     destroy();
 }
 
+TCPSocketOptions BlockingTCPAcceptor::getAppliedSocketOptions() const {
+    Lock guard(_mutex);
+    return _appliedSocketOptions;
+}
+
 int BlockingTCPAcceptor::initialize() {
 
     char ipAddrStr[24];
@@ -108,6 +115,14 @@ int BlockingTCPAcceptor::initialize() {
                     }
                 }
 
+                // accepted sockets inherit buffer sizes, which must be set before
+                // listen() to take effect on the TCP window scale.
+                {
+                    TCPSocketOptions applied(_socketOptions.apply(_serverSocketChannel));
+                    Lock guard(_mutex);
+                    _appliedSocketOptions = applied;
+                }
+
                 retval = ::listen(_serverSocketChannel, 4);
                 if(retval<0) {
                     epicsSocketConvertErrnoToString(strBuffer, sizeof(strBuffer));
@@ -174,7 +189,12 @@ void BlockingTCPAcceptor::run() {
                 LOG(logLevelDebug, "Error setting SO_KEEPALIVE: %s.", strBuffer);
             }
 
-            // do NOT tune socket buffer sizes, this will disable auto-tunning
+            // only tune when configured, setting socket buffer sizes disables auto-tuning
+            {
+                TCPSocketOptions applied(_socketOptions.apply(newClient));
+                Lock guard(_mutex);
+                _appliedSocketOptions = applied;
+            }
 
             // get TCP send buffer size
             osiSocklen_t intLen = sizeof(int);
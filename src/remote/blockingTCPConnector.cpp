@@ -24,13 +24,20 @@ namespace pvAccess {
 BlockingTCPConnector::BlockingTCPConnector(
     Context::shared_pointer const & context,
     int receiveBufferSize,
-    float heartbeatInterval) :
+    float heartbeatInterval,
+    const TCPSocketOptions& socketOptions) :
     _context(context),
     _receiveBufferSize(receiveBufferSize),
-    _heartbeatInterval(heartbeatInterval)
+    _heartbeatInterval(heartbeatInterval),
+    _socketOptions(socketOptions)
 {
 }
 
+TCPSocketOptions BlockingTCPConnector::getAppliedSocketOptions() const {
+    Lock guard(_mutex);
+    return _appliedSocketOptions;
+}
+
 SOCKET BlockingTCPConnector::tryConnect(osiSockAddr& address, int tries) {
 
     char strBuffer[24];
@@ -51,6 +58,15 @@ SOCKET BlockingTCPConnector::tryConnect(osiSockAddr& address, int tries) {
             THROW_EXCEPTION2(std::runtime_error, temp.str());
         }
         else {
+            // buffer sizes must be set before connect() to take effect on the TCP window scale.
+            // Only tuned when configured, as this disables auto-tuning.
+            // Win32 defaults are 8k, which is OK
+            {
+                TCPSocketOptions applied(_socketOptions.apply(socket));
+                Lock guard(_mutex);
+                _appliedSocketOptions = applied;
+            }
+
             // TODO: use non-blocking connect() to have controllable timeout
             if(::connect(socket, &address.sa, sizeof(sockaddr))==0) {
                 return socket;
@@ -122,8 +138,6 @@ Transport::shared_pointer BlockingTCPConnector::connect(std::tr1::shared_ptr<Cli
             LOG(logLevelWarn, "Error setting SO_KEEPALIVE: %s.", errStr);
         }
 
-        // TODO tune buffer sizes?! Win32 defaults are 8k, which is OK
-
         // create transport
         // TODO introduce factory
         // get TCP send buffer size
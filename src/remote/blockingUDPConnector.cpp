@@ -86,6 +86,8 @@ BlockingUDPTransport::shared_pointer BlockingUDPConnector::connect(ResponseHandl
     BlockingUDPTransport::shared_pointer transport(new BlockingUDPTransport(_serverFlag, responseHandler,
             socket, bindAddress, transportRevision));
     transport->internal_this = transport;
+    transport->setReceiveBatch(_receiveBatch);
+    transport->setDispatcher(_dispatcher);
 
     // the worker thread holds a strong ref, which is released by transport->close()
     BlockingUDPTransport::shared_pointer ret(transport.get(), closer(transport));
@@ -10,10 +10,21 @@
 #endif
 
 #include <sstream>
+#include <vector>
 
 #include <sys/types.h>
 #include <cstdio>
 
+#if defined(__linux__)
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#  include <errno.h>
+#  if defined(MSG_WAITFORONE)
+     // recvmmsg() and sendmmsg(), glibc >= 2.14
+#    define USE_MMSG
+#  endif
+#endif
+
 #include <epicsThread.h>
 #include <osiSock.h>
 #include <epicsAtomic.h>
@@ -29,6 +40,7 @@
 #include <pv/logger.h>
 #include <pv/likely.h>
 #include <pv/hexDump.h>
+#include <pv/reactor.h>
 
 using namespace epics::pvData;
 using namespace std;
@@ -47,6 +59,9 @@ inline int sendto(int s, const char *buf, size_t len, int flags, const struct so
 // reserve some space for CMD_ORIGIN_TAG message
 #define RECEIVE_BUFFER_PRE_RESERVE (PVA_MESSAGE_HEADER_SIZE + 16)
 
+// max. datagrams received per UDPDispatcher wakeup, so that a busy socket does not starve others
+#define MAX_DISPATCH_DATAGRAMS 64
+
 size_t BlockingUDPTransport::num_instances;
 
 BlockingUDPTransport::BlockingUDPTransport(bool serverFlag,
@@ -66,7 +81,14 @@ BlockingUDPTransport::BlockingUDPTransport(bool serverFlag,
     _sendBuffer(MAX_UDP_RECV),
     _lastMessageStartPosition(0),
     _clientServerWithEndianFlag(
-        (serverFlag ? 0x40 : 0x00) | ((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00))
+        (serverFlag ? 0x40 : 0x00) | ((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00)),
+    _receiveBatch(0u),
+    _dispatched(false),
+#ifdef USE_MMSG
+    _useSendBatch(true)
+#else
+    _useSendBatch(false)
+#endif
 {
     assert(_responseHandler.get());
 
@@ -100,6 +122,14 @@ BlockingUDPTransport::~BlockingUDPTransport() {
 
 void BlockingUDPTransport::start() {
 
+    {
+        detail::UDPDispatcher::shared_pointer dispatcher(_dispatcher.lock());
+        if(dispatcher && dispatcher->add(internal_this.lock(), _channel)) {
+            _dispatched = true;
+            return;
+        }
+    }
+
     string threadName = "UDP-rx " + inetAddressToString(_bindAddress);
 
     if (IS_LOGGABLE(logLevelTrace))
@@ -141,6 +171,13 @@ void BlockingUDPTransport::close(bool waitForThreadToComplete) {
             inetAddressToString(_bindAddress).c_str());
     }
 
+    if (_dispatched)
+    {
+        detail::UDPDispatcher::shared_pointer dispatcher(_dispatcher.lock());
+        if (dispatcher)
+            dispatcher->remove(this, _channel);
+    }
+
     epicsSocketSystemCallInterruptMechanismQueryInfo info  =
         epicsSocketSystemCallInterruptMechanismQuery ();
     switch ( info )
@@ -220,6 +257,149 @@ void BlockingUDPTransport::endMessage() {
         _sendBuffer.getPosition()-_lastMessageStartPosition-PVA_MESSAGE_HEADER_SIZE);
 }
 
+void BlockingUDPTransport::setReceiveBatch(size_t batch)
+{
+    _receiveBatch = batch;
+}
+
+void BlockingUDPTransport::setDispatcher(const std::tr1::shared_ptr<detail::UDPDispatcher>& dispatcher)
+{
+    _dispatcher = dispatcher;
+}
+
+void BlockingUDPTransport::processDatagram(Transport::shared_pointer const & transport,
+                                           osiSockAddr& fromAddress, int bytesRead)
+{
+    atomic::add(_totalBytesRecv, bytesRead);
+
+    for(size_t i = 0; i <_ignoredAddresses.size(); i++)
+    {
+        if(_ignoredAddresses[i].ia.sin_addr.s_addr==fromAddress.ia.sin_addr.s_addr)
+        {
+            if(pvAccessIsLoggable(logLevelDebug)) {
+                char strBuffer[64];
+                sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
+                LOG(logLevelDebug, "UDP Ignore (%d) %s x- %s", bytesRead, _remoteName.c_str(), strBuffer);
+            }
+            return;
+        }
+    }
+
+    if(pvAccessIsLoggable(logLevelDebug)) {
+        char strBuffer[64];
+        sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
+        LOG(logLevelDebug, "UDP %s Rx (%d) %s <- %s", (_clientServerWithEndianFlag&0x40)?"Server":"Client", bytesRead, _remoteName.c_str(), strBuffer);
+    }
+
+    _receiveBuffer.setPosition(RECEIVE_BUFFER_PRE_RESERVE);
+    _receiveBuffer.setLimit(RECEIVE_BUFFER_PRE_RESERVE+bytesRead);
+
+    try {
+        processBuffer(transport, fromAddress, &_receiveBuffer);
+    } catch(std::exception& e) {
+        if(IS_LOGGABLE(logLevelError)) {
+            char strBuffer[64];
+            sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
+            size_t epos = _receiveBuffer.getPosition();
+
+            // of course _receiveBuffer _may_ have been modified during processing...
+            _receiveBuffer.setPosition(RECEIVE_BUFFER_PRE_RESERVE);
+            _receiveBuffer.setLimit(RECEIVE_BUFFER_PRE_RESERVE+bytesRead);
+
+            std::cerr<<"Error on UDP RX "<<strBuffer<<" -> "<<_remoteName<<" at "<<epos<<" : "<<e.what()<<"\n"
+                      <<HexDump(_receiveBuffer).limit(256u);
+        }
+    }
+}
+
+// returns true if the error means the socket is still usable
+static bool recvErrorIsTransient(int socketError)
+{
+    // interrupted or timeout
+    if (socketError == SOCK_EINTR ||
+            socketError == EAGAIN ||        // no alias in libCom
+            // windows times out with this
+            socketError == SOCK_ETIMEDOUT ||
+            socketError == SOCK_EWOULDBLOCK)
+        return true;
+
+    if (socketError == SOCK_ECONNREFUSED || // avoid spurious ECONNREFUSED in Linux
+            socketError == SOCK_ECONNRESET)     // or ECONNRESET in Windows
+        return true;
+
+    return false;
+}
+
+bool BlockingUDPTransport::runBatched(Transport::shared_pointer const & transport)
+{
+#ifdef USE_MMSG
+    const size_t slotSize = _receiveBuffer.getSize()-RECEIVE_BUFFER_PRE_RESERVE;
+    const size_t nslots = _receiveBatch;
+
+    // slot 0 is received in place, the others are copied into _receiveBuffer before processing
+    _receiveBatchBuffer.resize((nslots-1u)*slotSize);
+
+    std::vector<mmsghdr> msgs(nslots);
+    std::vector<iovec> iovs(nslots);
+    std::vector<osiSockAddr> fromAddresses(nslots);
+
+    for(size_t i=0; i<nslots; i++) {
+        iovs[i].iov_base = i==0 ? (void*)(_receiveBuffer.getBuffer()+RECEIVE_BUFFER_PRE_RESERVE)
+                                : (void*)&_receiveBatchBuffer[(i-1u)*slotSize];
+        iovs[i].iov_len = slotSize;
+    }
+
+    while(!_closed.get())
+    {
+        for(size_t i=0; i<nslots; i++) {
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &fromAddresses[i].sa;
+            msgs[i].msg_hdr.msg_namelen = sizeof(fromAddresses[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // block for the first datagram, then take what is already queued
+        int nmsgs = recvmmsg(_channel, &msgs[0], nslots, MSG_WAITFORONE, NULL);
+
+        if(likely(nmsgs>=0)) {
+            for(int i=0; i<nmsgs && !_closed.get(); i++) {
+                int bytesRead = msgs[i].msg_len;
+                if(i>0)
+                    memcpy(_receiveBuffer.getBuffer()+RECEIVE_BUFFER_PRE_RESERVE, iovs[i].iov_base, bytesRead);
+                processDatagram(transport, fromAddresses[i], bytesRead);
+            }
+        } else {
+            int socketError = SOCKERRNO;
+
+            if(socketError == ENOSYS && !_closed.get()) {
+                LOG(logLevelDebug, "recvmmsg() not available, receiving one datagram per call");
+                _receiveBatchBuffer.clear();
+                return false;
+            }
+
+            if(recvErrorIsTransient(socketError))
+                continue;
+
+            // log a 'recvmmsg' error
+            if(!_closed.get())
+            {
+                char errStr[64];
+                epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+                LOG(logLevelError, "Socket recvmmsg error: %s.", errStr);
+            }
+
+            close(false);
+            break;
+        }
+    }
+    return true;
+#else
+    (void)transport;
+    return false;
+#endif
+}
+
 void BlockingUDPTransport::run() {
     // This function is always called from only one thread - this
     // object's own thread.
@@ -230,6 +410,10 @@ void BlockingUDPTransport::run() {
 
     try {
 
+        if(_receiveBatch>1u && runBatched(thisTransport)) {
+            // done
+        } else {
+
         char* recvfrom_buffer_start = (char*)(_receiveBuffer.getBuffer()+RECEIVE_BUFFER_PRE_RESERVE);
         size_t recvfrom_buffer_len =_receiveBuffer.getSize()-RECEIVE_BUFFER_PRE_RESERVE;
         while(!_closed.get())
@@ -241,63 +425,12 @@ void BlockingUDPTransport::run() {
 
             if(likely(bytesRead>=0)) {
                 // successfully got datagram
-                atomic::add(_totalBytesRecv, bytesRead);
-                bool ignore = false;
-                for(size_t i = 0; i <_ignoredAddresses.size(); i++)
-                {
-                    if(_ignoredAddresses[i].ia.sin_addr.s_addr==fromAddress.ia.sin_addr.s_addr)
-                    {
-                        ignore = true;
-                        if(pvAccessIsLoggable(logLevelDebug)) {
-                            char strBuffer[64];
-                            sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
-                            LOG(logLevelDebug, "UDP Ignore (%d) %s x- %s", bytesRead, _remoteName.c_str(), strBuffer);
-                        }
-                        break;
-                    }
-                }
-
-                if(likely(!ignore)) {
-                    if(pvAccessIsLoggable(logLevelDebug)) {
-                        char strBuffer[64];
-                        sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
-                        LOG(logLevelDebug, "UDP %s Rx (%d) %s <- %s", (_clientServerWithEndianFlag&0x40)?"Server":"Client", bytesRead, _remoteName.c_str(), strBuffer);
-                    }
-
-                    _receiveBuffer.setPosition(RECEIVE_BUFFER_PRE_RESERVE);
-                    _receiveBuffer.setLimit(RECEIVE_BUFFER_PRE_RESERVE+bytesRead);
-
-                    try {
-                        processBuffer(thisTransport, fromAddress, &_receiveBuffer);
-                    } catch(std::exception& e) {
-                        if(IS_LOGGABLE(logLevelError)) {
-                            char strBuffer[64];
-                            sockAddrToDottedIP(&fromAddress.sa, strBuffer, sizeof(strBuffer));
-                            size_t epos = _receiveBuffer.getPosition();
-
-                            // of course _receiveBuffer _may_ have been modified during processing...
-                            _receiveBuffer.setPosition(RECEIVE_BUFFER_PRE_RESERVE);
-                            _receiveBuffer.setLimit(RECEIVE_BUFFER_PRE_RESERVE+bytesRead);
-
-                            std::cerr<<"Error on UDP RX "<<strBuffer<<" -> "<<_remoteName<<" at "<<epos<<" : "<<e.what()<<"\n"
-                                      <<HexDump(_receiveBuffer).limit(256u);
-                        }
-                    }
-                }
+                processDatagram(thisTransport, fromAddress, bytesRead);
             } else {
 
                 int socketError = SOCKERRNO;
 
-                // interrupted or timeout
-                if (socketError == SOCK_EINTR ||
-                        socketError == EAGAIN ||        // no alias in libCom
-                        // windows times out with this
-                        socketError == SOCK_ETIMEDOUT ||
-                        socketError == SOCK_EWOULDBLOCK)
-                    continue;
-
-                if (socketError == SOCK_ECONNREFUSED || // avoid spurious ECONNREFUSED in Linux
-                        socketError == SOCK_ECONNRESET)     // or ECONNRESET in Windows
+                if (recvErrorIsTransient(socketError))
                     continue;
 
                 // log a 'recvfrom' error
@@ -313,6 +446,7 @@ void BlockingUDPTransport::run() {
             }
 
         }
+        }
     } catch(...) {
         // TODO: catch all exceptions, and act accordingly
         close(false);
@@ -325,6 +459,56 @@ void BlockingUDPTransport::run() {
     }
 }
 
+void BlockingUDPTransport::reactorRead()
+{
+    // Only called from the UDPDispatcher thread
+#ifdef MSG_DONTWAIT
+    Transport::shared_pointer thisTransport(internal_this.lock());
+    if(!thisTransport)
+        return;
+
+    char* recvfrom_buffer_start = (char*)(_receiveBuffer.getBuffer()+RECEIVE_BUFFER_PRE_RESERVE);
+    size_t recvfrom_buffer_len =_receiveBuffer.getSize()-RECEIVE_BUFFER_PRE_RESERVE;
+
+    try {
+        for(unsigned n=0; n<MAX_DISPATCH_DATAGRAMS && !_closed.get(); n++)
+        {
+            osiSockAddr fromAddress;
+            osiSocklen_t addrStructSize = sizeof(sockaddr);
+
+            int bytesRead = recvfrom(_channel,
+                                     recvfrom_buffer_start, recvfrom_buffer_len,
+                                     MSG_DONTWAIT, (sockaddr*)&fromAddress,
+                                     &addrStructSize);
+
+            if(likely(bytesRead>=0)) {
+                processDatagram(thisTransport, fromAddress, bytesRead);
+                continue;
+            }
+
+            int socketError = SOCKERRNO;
+
+            if (socketError == SOCK_EWOULDBLOCK || socketError == EAGAIN)
+                break; // drained
+            else if (recvErrorIsTransient(socketError))
+                continue;
+
+            if(!_closed.get())
+            {
+                char errStr[64];
+                epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+                LOG(logLevelError, "Socket recvfrom error: %s.", errStr);
+            }
+
+            close(false);
+            break;
+        }
+    } catch(...) {
+        close(false);
+    }
+#endif
+}
+
 bool BlockingUDPTransport::processBuffer(Transport::shared_pointer const & transport,
         osiSockAddr& fromAddress, ByteBuffer* receiveBuffer) {
 
@@ -487,6 +671,108 @@ bool BlockingUDPTransport::send(ByteBuffer* buffer, InetAddressType target) {
     buffer->flip();
 
     bool allOK = true;
+
+#ifdef USE_MMSG
+    if(_useSendBatch) {
+        // one message per destination, all referencing the same payload
+        iovec iov;
+        iov.iov_base = (void*)buffer->getBuffer();
+        iov.iov_len = buffer->getLimit();
+
+        std::vector<mmsghdr> msgs;
+        std::vector<size_t> dest;
+        msgs.reserve(_sendAddresses.size());
+        dest.reserve(_sendAddresses.size());
+
+        for(size_t i = 0; i<_sendAddresses.size(); i++) {
+
+            // filter
+            if (target != inetAddressType_all)
+                if ((target == inetAddressType_unicast && !_isSendAddressUnicast[i]) ||
+                        (target == inetAddressType_broadcast_multicast && _isSendAddressUnicast[i]))
+                    continue;
+
+            if (IS_LOGGABLE(logLevelDebug))
+            {
+                LOG(logLevelDebug, "Sending %zu bytes %s -> %s.",
+                    buffer->getRemaining(), _remoteName.c_str(), inetAddressToString(_sendAddresses[i]).c_str());
+            }
+
+            mmsghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_hdr.msg_name = (void*)&_sendAddresses[i].sa;
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr);
+            msg.msg_hdr.msg_iov = &iov;
+            msg.msg_hdr.msg_iovlen = 1;
+            msgs.push_back(msg);
+            dest.push_back(i);
+        }
+
+        size_t next = 0u;
+        unsigned zeroSent = 0u;
+        while(next < msgs.size()) {
+            int nsent = sendmmsg(_channel, &msgs[next], msgs.size()-next, 0);
+            if(likely(nsent>0)) {
+                atomic::add(_totalBytesSent, buffer->getLimit()*nsent);
+                next += nsent;
+                zeroSent = 0u;
+                continue;
+            }
+
+            if(nsent==0) {
+                // nothing sent, but no error either, so errno is stale.
+                // retry the rest, then send one datagram per call.
+                if(++zeroSent < 3u)
+                    continue;
+                break;
+            }
+
+            int socketError = SOCKERRNO;
+            if(socketError==SOCK_EINTR)
+                continue;
+
+            if(socketError==ENOSYS) {
+                LOG(logLevelDebug, "sendmmsg() not available, sending one datagram per call");
+                _useSendBatch = false;
+                break;
+            }
+
+            // error is for the first unsent message, skip it
+            char errStr[64];
+            epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+            LOG(logLevelDebug, "Socket sendto to %s error: %s.",
+                inetAddressToString(_sendAddresses[dest[next]]).c_str(), errStr);
+            atomic::add(_totalBytesSent, buffer->getLimit());
+            allOK = false;
+            next++;
+        }
+
+        if(next==msgs.size()) {
+            // all sent
+            buffer->setPosition(buffer->getLimit());
+            return allOK;
+        }
+        // fall back for the remaining destinations
+        for(; next < msgs.size(); next++) {
+            const osiSockAddr& addr = _sendAddresses[dest[next]];
+            int retval = sendto(_channel, buffer->getBuffer(),
+                                buffer->getLimit(), 0, &(addr.sa),
+                                sizeof(sockaddr));
+            if(unlikely(retval<0))
+            {
+                char errStr[64];
+                epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+                LOG(logLevelDebug, "Socket sendto to %s error: %s.",
+                    inetAddressToString(addr).c_str(), errStr);
+                allOK = false;
+            }
+            atomic::add(_totalBytesSent, buffer->getLimit());
+        }
+        buffer->setPosition(buffer->getLimit());
+        return allOK;
+    }
+#endif
+
     for(size_t i = 0; i<_sendAddresses.size(); i++) {
 
         // filter
@@ -581,9 +867,11 @@ void initializeUDPTransports(bool serverFlag,
                              int32& listenPort,
                              bool autoAddressList,
                              const std::string& addressList,
-                             const std::string& ignoreAddressList)
+                             const std::string& ignoreAddressList,
+                             size_t receiveBatch,
+                             const std::tr1::shared_ptr<detail::UDPDispatcher>& dispatcher)
 {
-    BlockingUDPConnector connector(serverFlag);
+    BlockingUDPConnector connector(serverFlag, receiveBatch, dispatcher);
 
     const int8_t protoVer = serverFlag ? PVA_SERVER_PROTOCOL_REVISION : PVA_CLIENT_PROTOCOL_REVISION;
 
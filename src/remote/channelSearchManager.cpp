@@ -5,8 +5,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <vector>
+#include <algorithm>
 
 #include <epicsMutex.h>
 
@@ -63,23 +65,52 @@ static const int PAYLOAD_POSITION = 4;
 static const double ATOMIC_PERIOD = 0.225;
 static const double PERIOD_JITTER_MS = 0.025;
 
-static const int DEFAULT_USER_VALUE = 1;
-static const int BOOST_VALUE = 1;
-// must be power of two (so that search is done)
-static const int MAX_COUNT_VALUE = 1 << 8;
-static const int MAX_FALLBACK_COUNT_VALUE = (1 << 7) + 1;
+// A channel at backoff level N is next searched 2^N periods after the last search.
+// Level starts at 0, and increases with each search, up to MAX_LEVEL (~29 seconds).
+static const int32_t MAX_LEVEL = 7;
+// penalized channels start at the longest period
+static const int32_t PENALIZE_LEVEL = MAX_LEVEL;
 
-static const int MAX_FRAMES_AT_ONCE = 10;
-static const int DELAY_BETWEEN_FRAMES_MS = 50;
+// must be a power of two greater than 2^MAX_LEVEL
+static const size_t WHEEL_SIZE = 1u << (MAX_LEVEL+1);
+static const size_t WHEEL_MASK = WHEEL_SIZE-1u;
+// Pending::slot while a search is being sent
+static const size_t IN_FLIGHT = WHEEL_SIZE;
 
+// IP and UDP headers, plus reserve.  Difference between ethernet MTU and MAX_UDP_UNFRAGMENTED_SEND
+static const int32 MTU_OVERHEAD = 1500 - MAX_UDP_UNFRAGMENTED_SEND;
+// must hold the search header and a useful number of names
+static const int32 MIN_FRAME_SIZE = 256;
 
-ChannelSearchManager::ChannelSearchManager(Context::shared_pointer const & context) :
+static size_t searchFrameSize(int32 mtu)
+{
+    if (mtu <= 0)
+        return MAX_UDP_UNFRAGMENTED_SEND;
+    return size_t(std::max(MIN_FRAME_SIZE, std::min(mtu - MTU_OVERHEAD, MAX_UDP_RECV)));
+}
+
+
+ChannelSearchManager::ChannelSearchManager(Context::shared_pointer const & context, double maxFramesPerSecond,
+                                           int32 mtu, bool targeted) :
     m_context(context),
     m_responseAddress(), // initialized in activate()
     m_canceled(),
     m_sequenceNumber(0),
-    m_sendBuffer(MAX_UDP_UNFRAGMENTED_SEND),
+    m_sendBuffer(searchFrameSize(mtu)),
     m_channels(),
+    m_targeted(targeted),
+    m_resolutions(),
+    m_servers(),
+    m_targetBuffer(searchFrameSize(mtu)),
+    m_wheel(WHEEL_SIZE),
+    m_wheelPosition(0u),
+    m_maxFramesPerSecond(maxFramesPerSecond),
+    m_maxFramesPerPeriod((size_t)-1),
+    m_framesSent(0u),
+    m_namesSent(0u),
+    m_deferred(0u),
+    m_restarts(0u),
+    m_retargeted(0u),
     m_lastTimeSent(),
     m_channelMutex(),
     m_userValueMutex(),
@@ -99,6 +130,12 @@ void ChannelSearchManager::activate()
     // add some jitter so that all the clients do not send at the same time
     double period = ATOMIC_PERIOD + double(rand())/RAND_MAX*PERIOD_JITTER_MS;
 
+    if (m_maxFramesPerSecond > 0.0)
+    {
+        Lock guard(m_channelMutex);
+        m_maxFramesPerPeriod = std::max(size_t(1u), size_t(m_maxFramesPerSecond*period));
+    }
+
     Context::shared_pointer context(m_context.lock());
     if (context)
         context->getTimer()->schedulePeriodic(shared_from_this(), period, period);
@@ -136,21 +173,32 @@ void ChannelSearchManager::registerSearchInstance(SearchInstance::shared_pointer
     if (m_canceled.get())
         return;
 
+    // ID and name never change, so encode once outside of the lock
+    record_t record(encodeRecord(channel));
+
     bool immediateTrigger;
     {
         Lock guard(m_channelMutex);
 
         // overrides if already registered
-        m_channels[channel->getSearchInstanceID()] = channel;
+        const pvAccessID id = channel->getSearchInstanceID();
+        Pending& pending = m_channels[id];
+        pending.instance = channel;
+        pending.record = record;
         immediateTrigger = (m_channels.size() == 1);
 
-        Lock guard2(m_userValueMutex);
-        int32_t& userValue = channel->getUserValue();
-        userValue = (penalize ? MAX_FALLBACK_COUNT_VALUE : DEFAULT_USER_VALUE);
+        {
+            Lock guard2(m_userValueMutex);
+            int32_t& userValue = channel->getUserValue();
+            userValue = (penalize ? PENALIZE_LEVEL : 0);
+        }
+
+        // the first is searched now, others with the next period
+        schedule(id, pending, penalize ? (1u << PENALIZE_LEVEL) : immediateTrigger ? 0u : 1u);
     }
 
     if (immediateTrigger)
-        callback();
+        trigger();
 }
 
 void ChannelSearchManager::unregisterSearchInstance(SearchInstance::shared_pointer const & channel)
@@ -158,6 +206,8 @@ void ChannelSearchManager::unregisterSearchInstance(SearchInstance::shared_point
     Lock guard(m_channelMutex);
     pvAccessID id = channel->getSearchInstanceID();
     m_channels.erase(id);
+    if (m_targeted)
+        forgetResolved(id);
 }
 
 void ChannelSearchManager::searchResponse(const ServerGUID & guid, pvAccessID cid, int32_t /*seqNo*/, int8_t minorRevision, osiSockAddr* serverAddress)
@@ -178,11 +228,14 @@ void ChannelSearchManager::searchResponse(const ServerGUID & guid, pvAccessID ci
     }
     else
     {
-        SearchInstance::shared_pointer si(channelsIter->second.lock());
+        SearchInstance::shared_pointer si(channelsIter->second.instance.lock());
 
         // remove from search list
         m_channels.erase(cid);
 
+        if (m_targeted && serverAddress)
+            resolvedOn(cid, guid, *serverAddress);
+
         guard.unlock();
 
         // then notify SearchInstance
@@ -194,43 +247,170 @@ void ChannelSearchManager::searchResponse(const ServerGUID & guid, pvAccessID ci
 void ChannelSearchManager::newServerDetected()
 {
     boost();
-    callback();
+    trigger();
+}
+
+void ChannelSearchManager::serverRestarted(const ServerGUID& guid, const osiSockAddr& serverAddress,
+                                           const osiSockAddr& searchAddress)
+{
+    if (!m_targeted)
+    {
+        newServerDetected();
+        return;
+    }
+
+    if (m_canceled.get())
+        return;
+
+    vector<record_t> records;
+    {
+        Lock guard(m_channelMutex);
+        Lock guard2(m_userValueMutex);
+
+        // empty if no channels were resolved on this server
+        const std::set<pvAccessID> none;
+        m_servers_t::const_iterator serverIter = m_servers.find(serverAddress);
+        const std::set<pvAccessID>& resolved = serverIter != m_servers.end() ? serverIter->second : none;
+        for (std::set<pvAccessID>::const_iterator it = resolved.begin(); it != resolved.end(); ++it)
+        {
+            m_resolutions_t::const_iterator resIter = m_resolutions.find(*it);
+            if (resIter == m_resolutions.end()
+                    || memcmp(resIter->second.guid.value, guid.value, sizeof(guid.value)) == 0)
+                continue; // already resolved on the new instance
+
+            m_channels_t::iterator channelsIter = m_channels.find(*it);
+            if (channelsIter == m_channels.end() || channelsIter->second.slot == IN_FLIGHT)
+                continue; // not searching, or being searched now
+
+            SearchInstance::shared_pointer inst(channelsIter->second.instance.lock());
+            if (!inst)
+                continue;
+
+            // search again from the shortest period, in case the channel has moved
+            inst->getUserValue() = 0;
+            schedule(channelsIter->first, channelsIter->second, 1u);
+            records.push_back(channelsIter->second.record);
+        }
+
+        if (!records.empty())
+        {
+            m_restarts++;
+            m_retargeted += records.size();
+        }
+    }
+
+    if (records.empty())
+    {
+        // a server we have not resolved channels on, or none are left to retarget.
+        // It may have any of the unresolved channels.
+        newServerDetected();
+        return;
+    }
+
+    size_t frames = sendTargeted(records, searchAddress);
+
+    Lock guard(m_channelMutex);
+    m_framesSent += frames;
+    m_namesSent += records.size();
+}
+
+void ChannelSearchManager::resolvedOn(pvAccessID cid, const ServerGUID& guid, const osiSockAddr& serverAddress)
+{
+    Resolution& res = m_resolutions[cid];
+    if (res.server.sa.sa_family != AF_UNSPEC && sockAddrAreIdentical(&res.server, &serverAddress) == 0)
+        forgetResolved(cid); // moved to another server, invalidates res
+
+    Resolution& current = m_resolutions[cid];
+    current.server = serverAddress;
+    current.guid = guid;
+    m_servers[serverAddress].insert(cid);
+}
+
+void ChannelSearchManager::forgetResolved(pvAccessID cid)
+{
+    m_resolutions_t::iterator resIter = m_resolutions.find(cid);
+    if (resIter == m_resolutions.end())
+        return;
+
+    m_servers_t::iterator serverIter = m_servers.find(resIter->second.server);
+    if (serverIter != m_servers.end())
+    {
+        serverIter->second.erase(cid);
+        if (serverIter->second.empty())
+            m_servers.erase(serverIter);
+    }
+    m_resolutions.erase(resIter);
+}
+
+size_t ChannelSearchManager::sendTargeted(const vector<record_t>& records, const osiSockAddr& searchAddress)
+{
+    Lock guard(m_mutex);
+
+    Context::shared_pointer context(m_context.lock());
+    if (!context)
+        return 0u;
+    BlockingUDPTransport::shared_pointer ut = std::tr1::static_pointer_cast<BlockingUDPTransport>(context->getSearchTransport());
+
+    size_t frames = 0u;
+    initializeSendBuffer(m_targetBuffer);
+    m_targetBuffer.putByte(CAST_POSITION, (int8_t)0x80);  // unicast, no reply required
+
+    for (size_t i = 0u; i < records.size(); i++)
+    {
+        if (appendRecord(m_targetBuffer, *records[i]))
+            continue;
+
+        // full
+        ut->send(&m_targetBuffer, searchAddress);
+        frames++;
+
+        initializeSendBuffer(m_targetBuffer);
+        m_targetBuffer.putByte(CAST_POSITION, (int8_t)0x80);
+        if (!appendRecord(m_targetBuffer, *records[i]))
+            LOG(logLevelDebug, "Search request of %u bytes exceeds search frame size %u",
+                unsigned(records[i]->size()), unsigned(m_targetBuffer.getSize()));
+    }
+
+    ut->send(&m_targetBuffer, searchAddress);
+    frames++;
+
+    return frames;
 }
 
-void ChannelSearchManager::initializeSendBuffer()
+void ChannelSearchManager::initializeSendBuffer(ByteBuffer& buffer)
 {
     // for now OK, since it is only set here
     m_sequenceNumber++;
 
 
     // new buffer
-    m_sendBuffer.clear();
-    m_sendBuffer.putByte(PVA_MAGIC);
-    m_sendBuffer.putByte(PVA_CLIENT_PROTOCOL_REVISION);
-    m_sendBuffer.putByte((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00); // data + 7-bit endianess
-    m_sendBuffer.putByte(CMD_SEARCH);
-    m_sendBuffer.putInt(4+1+3+16+2+1);		// "zero" payload
-    m_sendBuffer.putInt(m_sequenceNumber);
+    buffer.clear();
+    buffer.putByte(PVA_MAGIC);
+    buffer.putByte(PVA_CLIENT_PROTOCOL_REVISION);
+    buffer.putByte((EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG) ? 0x80 : 0x00); // data + 7-bit endianess
+    buffer.putByte(CMD_SEARCH);
+    buffer.putInt(4+1+3+16+2+1);		// "zero" payload
+    buffer.putInt(m_sequenceNumber);
 
     // multicast vs unicast mask
     // This is CAST_POSITION, which is overwritten before send
-    m_sendBuffer.putByte((int8_t)0);
+    buffer.putByte((int8_t)0);
 
     // reserved part
-    m_sendBuffer.putByte((int8_t)0);
-    m_sendBuffer.putShort((int16_t)0);
+    buffer.putByte((int8_t)0);
+    buffer.putShort((int16_t)0);
 
     // NOTE: is it possible (very likely) that address is any local address ::ffff:0.0.0.0
-    encodeAsIPv6Address(&m_sendBuffer, &m_responseAddress);
-    m_sendBuffer.putShort((int16_t)ntohs(m_responseAddress.ia.sin_port));
+    encodeAsIPv6Address(&buffer, &m_responseAddress);
+    buffer.putShort((int16_t)ntohs(m_responseAddress.ia.sin_port));
 
     // TODO now only TCP is supported
     // note: this affects DATA_COUNT_POSITION
-    m_sendBuffer.putByte((int8_t)1);
+    buffer.putByte((int8_t)1);
 
     MockTransportSendControl control;
-    SerializeHelper::serializeString("tcp", &m_sendBuffer, &control);
-    m_sendBuffer.putShort((int16_t)0);	// count
+    SerializeHelper::serializeString("tcp", &buffer, &control);
+    buffer.putShort((int16_t)0);	// count
 }
 
 void ChannelSearchManager::flushSendBuffer()
@@ -250,45 +430,46 @@ void ChannelSearchManager::flushSendBuffer()
 }
 
 
-bool ChannelSearchManager::generateSearchRequestMessage(SearchInstance::shared_pointer const & channel,
-        ByteBuffer* requestMessage, TransportSendControl* control)
+ChannelSearchManager::record_t ChannelSearchManager::encodeRecord(SearchInstance::shared_pointer const & channel)
 {
-    epics::pvData::int16 dataCount = requestMessage->getShort(DATA_COUNT_POSITION);
+    const std::string& name(channel->getSearchInstanceName());
 
-    dataCount++;
+    // same byte order as m_sendBuffer.  size prefix is at most 5 bytes
+    ByteBuffer buffer(sizeof(int32) + 5u + name.length());
+    MockTransportSendControl control;
 
-    /*
-    if(dataCount >= MAX_SEARCH_BATCH_COUNT)
-        return false;
-    */
+    buffer.putInt(channel->getSearchInstanceID());
+    SerializeHelper::serializeString(name, &buffer, &control);
 
-    const std::string& name(channel->getSearchInstanceName());
-    // not nice...
-    const int addedPayloadSize = sizeof(int32)/sizeof(int8) + (1 + sizeof(int32)/sizeof(int8) + name.length());
-    if(((int)requestMessage->getRemaining()) < addedPayloadSize)
+    return record_t(new std::string(buffer.getBuffer(), buffer.getPosition()));
+}
+
+bool ChannelSearchManager::appendRecord(ByteBuffer& buffer, const std::string& record)
+{
+    if(buffer.getRemaining() < record.size())
         return false;
 
-    requestMessage->putInt(channel->getSearchInstanceID());
-    SerializeHelper::serializeString(name, requestMessage, control);
+    epics::pvData::int16 dataCount = buffer.getShort(DATA_COUNT_POSITION);
 
-    requestMessage->putInt(PAYLOAD_POSITION, requestMessage->getPosition() - PVA_MESSAGE_HEADER_SIZE);
-    requestMessage->putShort(DATA_COUNT_POSITION, dataCount);
+    buffer.put(record.data(), 0u, record.size());
+
+    buffer.putInt(PAYLOAD_POSITION, buffer.getPosition() - PVA_MESSAGE_HEADER_SIZE);
+    buffer.putShort(DATA_COUNT_POSITION, dataCount + 1);
     return true;
 }
 
-bool ChannelSearchManager::generateSearchRequestMessage(SearchInstance::shared_pointer const & channel,
+bool ChannelSearchManager::generateSearchRequestMessage(const std::string& record,
         bool allowNewFrame, bool flush)
 {
-    MockTransportSendControl control;
-
     Lock guard(m_mutex);
-    bool success = generateSearchRequestMessage(channel, &m_sendBuffer, &control);
+    bool success = appendRecord(m_sendBuffer, record);
     // buffer full, flush
     if(!success)
     {
         flushSendBuffer();
-        if(allowNewFrame)
-            generateSearchRequestMessage(channel, &m_sendBuffer, &control);
+        if(allowNewFrame && !appendRecord(m_sendBuffer, record))
+            LOG(logLevelDebug, "Search request of %u bytes exceeds search frame size %u",
+                unsigned(record.size()), unsigned(m_sendBuffer.getSize()));
         if (flush)
             flushSendBuffer();
         return true;
@@ -300,6 +481,12 @@ bool ChannelSearchManager::generateSearchRequestMessage(SearchInstance::shared_p
     return flush;
 }
 
+void ChannelSearchManager::schedule(pvAccessID id, Pending& pending, size_t delay)
+{
+    pending.slot = (m_wheelPosition + delay) & WHEEL_MASK;
+    m_wheel[pending.slot].push_back(id);
+}
+
 void ChannelSearchManager::boost()
 {
     Lock guard(m_channelMutex);
@@ -307,16 +494,32 @@ void ChannelSearchManager::boost()
     m_channels_t::iterator channelsIter = m_channels.begin();
     for(; channelsIter != m_channels.end(); channelsIter++)
     {
-        SearchInstance::shared_pointer inst(channelsIter->second.lock());
+        SearchInstance::shared_pointer inst(channelsIter->second.instance.lock());
         if(!inst) continue;
         int32_t& userValue = inst->getUserValue();
-        userValue = BOOST_VALUE;
+        userValue = 0;
+        // previous slot entry becomes stale, searched by the following trigger()
+        schedule(channelsIter->first, channelsIter->second, 0u);
     }
 }
 
 void ChannelSearchManager::callback()
 {
-    // high-frequency beacon anomaly trigger guard
+    {
+        Lock guard(m_mutex);
+
+        epics::pvData::TimeStamp now;
+        now.getCurrent();
+        m_lastTimeSent = now.getMilliseconds();
+    }
+
+    searchDue(true);
+}
+
+void ChannelSearchManager::trigger()
+{
+    // high-frequency beacon anomaly trigger guard.
+    // Suppressed searches are sent with the next period.
     {
         Lock guard(m_mutex);
 
@@ -329,61 +532,156 @@ void ChannelSearchManager::callback()
         m_lastTimeSent = nowMS;
     }
 
+    // only the timer moves the wheel on
+    searchDue(false);
+}
+
+void ChannelSearchManager::collectDue(size_t slot, vector<SearchInstance::shared_pointer>& toSend,
+                                      vector<record_t>& records)
+{
+    vector<pvAccessID> due;
+    due.swap(m_wheel[slot]);
+    toSend.reserve(toSend.size() + due.size());
+    records.reserve(records.size() + due.size());
 
-    int count = 0;
-    int frameSent = 0;
+    for(vector<pvAccessID>::const_iterator it = due.begin(); it != due.end(); ++it)
+    {
+        m_channels_t::iterator channelsIter = m_channels.find(*it);
+        if(channelsIter == m_channels.end() || channelsIter->second.slot != slot)
+            continue; // stale
 
+        SearchInstance::shared_pointer inst(channelsIter->second.instance.lock());
+        if(!inst) {
+            m_channels.erase(channelsIter);
+            continue;
+        }
+        channelsIter->second.slot = IN_FLIGHT;
+        toSend.push_back(inst);
+        records.push_back(channelsIter->second.record);
+    }
+}
+
+void ChannelSearchManager::searchDue(bool advance)
+{
+    // only visit the channels due in this period
+    size_t maxFrames;
     vector<SearchInstance::shared_pointer> toSend;
+    vector<record_t> records;
     {
         Lock guard(m_channelMutex);
-        toSend.reserve(m_channels.size());
 
-        for(m_channels_t::iterator channelsIter = m_channels.begin();
-            channelsIter != m_channels.end(); channelsIter++)
+        if (advance)
         {
-            SearchInstance::shared_pointer inst(channelsIter->second.lock());
-            if(!inst) continue;
-            toSend.push_back(inst);
+            // scheduled for the current period after the last timer tick, but not sent by trigger()
+            collectDue(m_wheelPosition, toSend, records);
+            m_wheelPosition = (m_wheelPosition + 1u) & WHEEL_MASK;
         }
+        maxFrames = m_maxFramesPerPeriod;
+
+        collectDue(m_wheelPosition, toSend, records);
     }
 
-    vector<SearchInstance::shared_pointer>::iterator siter = toSend.begin();
-    for (; siter != toSend.end(); siter++)
+    if (toSend.empty())
+        return;
+
+    size_t frames = 0u, searched = 0u;
+    bool partial = false;
+    for (; searched < toSend.size(); searched++)
     {
-        bool skip;
+        // once the limit is reached, the remainder waits for the next period
+        const bool lastFrame = frames + 1u >= maxFrames;
+        if (generateSearchRequestMessage(*records[searched], !lastFrame, false))
         {
-            epicsGuard<epicsMutex> G(m_userValueMutex);
-            int32_t& countValue = (*siter)->getUserValue();
-            skip = !isPowerOfTwo(countValue);
-
-            if (countValue >= MAX_COUNT_VALUE)
-                countValue = MAX_FALLBACK_COUNT_VALUE;
-            else
-                countValue++;
+            frames++;
+            if (lastFrame)
+            {
+                partial = false;
+                break;
+            }
         }
+        partial = true;
+    }
 
-        // back-off
-        if (skip)
-            continue;
+    if (partial)
+    {
+        flushSendBuffer();
+        frames++;
+    }
 
-        count++;
+    // re-schedule with backoff
+    {
+        Lock guard(m_channelMutex);
+        Lock guard2(m_userValueMutex);
+
+        m_framesSent += frames;
+        m_namesSent += searched;
 
-        if (generateSearchRequestMessage(*siter, true, false))
-            frameSent++;
-        if (frameSent == MAX_FRAMES_AT_ONCE)
+        for (size_t i = 0u; i < toSend.size(); i++)
         {
-            epicsThreadSleep(DELAY_BETWEEN_FRAMES_MS/(double)1000.0);
-            frameSent = 0;
+            const pvAccessID id = toSend[i]->getSearchInstanceID();
+            m_channels_t::iterator channelsIter = m_channels.find(id);
+            if(channelsIter == m_channels.end() || channelsIter->second.slot != IN_FLIGHT)
+                continue; // found, or re-scheduled, while sending
+
+            if (i < searched)
+            {
+                int32_t& level = toSend[i]->getUserValue();
+                if (level < 0 || level >= MAX_LEVEL)
+                    level = MAX_LEVEL;
+                else
+                    level++;
+                schedule(id, channelsIter->second, 1u << level);
+            }
+            else
+            {
+                schedule(id, channelsIter->second, 1u);
+                m_deferred++;
+            }
         }
     }
+}
 
-    if (count > 0)
-        flushSendBuffer();
+void ChannelSearchManager::getStats(Stats& stats)
+{
+    Lock guard(m_channelMutex);
+    Lock guard2(m_userValueMutex);
+
+    stats.registered = m_channels.size();
+    stats.pending.assign(MAX_LEVEL+1, 0u);
+    stats.framesSent = m_framesSent;
+    stats.namesSent = m_namesSent;
+    stats.deferred = m_deferred;
+    stats.restarts = m_restarts;
+    stats.retargeted = m_retargeted;
+
+    for(m_channels_t::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    {
+        SearchInstance::shared_pointer inst(it->second.instance.lock());
+        if(!inst) continue;
+        int32_t level = inst->getUserValue();
+        if (level < 0 || level > MAX_LEVEL)
+            level = MAX_LEVEL;
+        stats.pending[level]++;
+    }
 }
 
-bool ChannelSearchManager::isPowerOfTwo(int32_t x)
+void ChannelSearchManager::printInfo(std::ostream& out)
 {
-    return ((x > 0) && (x & (x - 1)) == 0);
+    Stats stats;
+    getStats(stats);
+
+    out << "SEARCH             : " << stats.registered << " channel(s), "
+        << stats.namesSent << " name(s) sent in "
+        << stats.framesSent << " frame(s), "
+        << stats.deferred << " deferred" << std::endl;
+    if (m_targeted)
+        out << "  targeted : " << stats.retargeted << " channel(s) searched after "
+            << stats.restarts << " server restart(s)" << std::endl;
+    for (size_t i = 0u; i < stats.pending.size(); i++)
+    {
+        if (!stats.pending[i]) continue;
+        out << "  every " << (ATOMIC_PERIOD * (1u << i)) << "s : " << stats.pending[i] << std::endl;
+    }
 }
 
 void ChannelSearchManager::timerStopped()
@@ -5,12 +5,18 @@
 */
 
 #include <map>
+#include <new>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <limits>
 #include <stdexcept>
 #include <sstream>
+#include <string.h>
 #include <sys/types.h>
+#ifndef _WIN32
+#  include <sys/uio.h>
+#endif
 
 #include <osiSock.h>
 #include <epicsTime.h>
@@ -18,6 +24,7 @@
 #include <epicsVersion.h>
 #include <errlog.h>
 #include <epicsAtomic.h>
+#include <epicsEndian.h>
 
 #include <pv/byteBuffer.h>
 #include <pv/pvType.h>
@@ -80,6 +87,8 @@ const std::size_t AbstractCodec::MAX_ENSURE_SIZE = 1024;
 const std::size_t AbstractCodec::MAX_ENSURE_DATA_SIZE = MAX_ENSURE_SIZE/2;
 const std::size_t AbstractCodec::MAX_ENSURE_BUFFER_SIZE = MAX_ENSURE_SIZE;
 const std::size_t AbstractCodec::MAX_ENSURE_DATA_BUFFER_SIZE = 1024;
+const std::size_t AbstractCodec::SMALL_MESSAGE_SIZE = 4*1024;
+const std::size_t AbstractCodec::LARGE_MESSAGE_SIZE = 256*1024;
 
 static
 size_t bufSizeSelect(size_t request)
@@ -102,10 +111,20 @@ AbstractCodec::AbstractCodec(
     _socketBuffer(bufSizeSelect(receiveBufferSize)),
     _sendBuffer(bufSizeSelect(sendBufferSize)),
     //PRIVATE
+    _resumableIO(false),
     _storedPayloadSize(0), _storedPosition(0), _startPosition(0),
+    _unsentOffset(0),
+    _blockingProcessQueue(blockingProcessQueue),
     _maxSendPayloadSize(_sendBuffer.getSize() - 2*PVA_MESSAGE_HEADER_SIZE),    // start msg + control
+    _baseReceiveBufferSize(_socketBuffer.getSize()),
+    _baseSendBufferSize(_sendBuffer.getSize()),
+    _maxMessageSize(0u),
+    _peerMaxMessageSize(0u),
     _lastMessageStartPosition(std::numeric_limits<size_t>::max()),_lastSegmentedMessageType(0),
     _lastSegmentedMessageCommand(0), _nextMessagePayloadOffset(0),
+    _sendHighWatermark(0u), _sendLowWatermark(0u),
+    _sendCongested(false),
+    _congestedCount(0u), _deferredCount(0u),
     _byteOrderFlag(EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG ? 0x80 : 0x00),
     _clientServerFlag(serverFlag ? 0x40 : 0x00)
 {
@@ -193,6 +212,10 @@ void AbstractCodec::processReadNormal()  {
                 return;
             }
 
+            // non-blocking mode, returns to the reactor until the rest arrives
+            if (_resumableIO && !readWholeMessage())
+                return;
+
             // read header fields
             processHeader();
             bool isControl = ((_flags & 0x01) == 0x01);
@@ -219,6 +242,20 @@ void AbstractCodec::processReadNormal()  {
                         "not-a-first segmented message received in normal mode");
                 }
 
+                // make room for all of a large message, so it is read with fewer,
+                // larger, reads.  Returned to the usual size by readToBuffer()
+                if (_payloadSize > 0 && std::size_t(_payloadSize) <= _maxMessageSize
+                        && MAX_ENSURE_SIZE + std::size_t(_payloadSize) > _socketBuffer.getSize())
+                {
+                    const std::size_t pos = _socketBuffer.getPosition(),
+                                      limit = _socketBuffer.getLimit();
+                    resizeBuffer(_socketBuffer, _socketStorage,
+                                 MAX_ENSURE_SIZE + std::size_t(_payloadSize) + PVA_MESSAGE_HEADER_SIZE,
+                                 0u, limit, 0u);
+                    _socketBuffer.setLimit(limit);
+                    _socketBuffer.setPosition(pos);
+                }
+
                 _storedPayloadSize = _payloadSize;
                 _storedPosition = _socketBuffer.getPosition();
                 _storedLimit = _socketBuffer.getLimit();
@@ -376,8 +413,18 @@ bool AbstractCodec::readToBuffer(
 
     std::size_t endPosition = _startPosition + remainingBytes;
 
-    for (std::size_t i = _startPosition; i < endPosition; i++)
-        _socketBuffer.putByte(i, _socketBuffer.getByte());
+    if (!persistent && _socketBuffer.getSize() > _baseReceiveBufferSize
+            && MAX_ENSURE_SIZE + requiredBytes <= _baseReceiveBufferSize)
+    {
+        // between messages, return a grown buffer to its usual size
+        resizeBuffer(_socketBuffer, _socketStorage, _baseReceiveBufferSize,
+                     _socketBuffer.getPosition(), remainingBytes, _startPosition);
+    }
+    else
+    {
+        for (std::size_t i = _startPosition; i < endPosition; i++)
+            _socketBuffer.putByte(i, _socketBuffer.getByte());
+    }
 
     // update buffer to the new position
     _socketBuffer.setLimit(_socketBuffer.getSize());
@@ -420,6 +467,89 @@ bool AbstractCodec::readToBuffer(
 }
 
 
+// Non-blocking mode: bytes from the current position to the end of the message there,
+// including all of its segments.  While not all headers are buffered, to the end of
+// the last header known to be needed.  Stops counting, and returns more than 'max',
+// once the message is known to be larger.
+std::size_t AbstractCodec::wholeMessageSize(std::size_t max)
+{
+    const std::size_t start = _socketBuffer.getPosition(),
+                      limit = _socketBuffer.getLimit();
+    std::size_t offset = start;
+    bool segmented = false;
+
+    while (true)
+    {
+        if (offset + PVA_MESSAGE_HEADER_SIZE > limit)
+            return offset + PVA_MESSAGE_HEADER_SIZE - start;
+
+        const std::size_t header = offset;
+        const int8_t flags = _socketBuffer.getByte(header + 2);
+        offset += PVA_MESSAGE_HEADER_SIZE;
+
+        // rejected by processHeader()
+        if (_socketBuffer.getByte(header) != PVA_MAGIC)
+            return offset - start;
+
+        // control messages have no payload, and may appear between segments
+        if (flags & 0x01)
+        {
+            if (segmented)
+                continue;
+            return offset - start;
+        }
+
+        // as read by processHeader().  Summed over segments, so may overflow
+        const std::size_t payload = epicsUInt32(_socketBuffer.getInt(header + 4));
+        if (payload > max || offset - start > max - payload)
+            return std::numeric_limits<std::size_t>::max();
+        offset += payload;
+
+        // not segmented, or the last segment
+        if ((flags & 0x10) == 0)
+            return offset - start;
+        segmented = true;
+    }
+}
+
+// Non-blocking mode: read until the message at the current position is buffered, growing
+// _socketBuffer if necessary.  Returns false once the socket has no more data for now.
+bool AbstractCodec::readWholeMessage()
+{
+    // as the buffer grows for one message in processReadNormal()
+    const std::size_t maxNeeded = std::max(_maxMessageSize, _baseReceiveBufferSize);
+
+    while (true)
+    {
+        const std::size_t needed = wholeMessageSize(maxNeeded);
+        if (needed <= _socketBuffer.getRemaining())
+            return true;
+
+        if (needed > maxNeeded)
+        {
+            LOG(logLevelError,
+                "Message, with all of its segments, larger than %u bytes received from %s, disconnecting...",
+                unsigned(maxNeeded), inetAddressToString(*getLastReadBufferSocketAddress()).c_str());
+            invalidDataStreamHandler();
+            throw invalid_data_stream_exception("message too large");
+        }
+
+        // readToBuffer() keeps unread data at MAX_ENSURE_SIZE
+        if (MAX_ENSURE_SIZE + needed > _socketBuffer.getSize())
+        {
+            const std::size_t remaining = _socketBuffer.getRemaining();
+            resizeBuffer(_socketBuffer, _socketStorage, MAX_ENSURE_SIZE + needed,
+                         _socketBuffer.getPosition(), remaining, MAX_ENSURE_SIZE);
+            _socketBuffer.setLimit(MAX_ENSURE_SIZE + remaining);
+            _socketBuffer.setPosition(MAX_ENSURE_SIZE);
+        }
+
+        if (!readToBuffer(needed, false))
+            return false;
+    }
+}
+
+
 void AbstractCodec::ensureData(std::size_t size) {
 
     // enough of data?
@@ -714,21 +844,67 @@ void AbstractCodec::ensureBuffer(std::size_t size) {
         throw std::invalid_argument(s);
     }
 
+    // grow instead of segmenting the message being built
+    if (growSendBuffer(_sendBuffer.getPosition() + size))
+        return;
+
     while (_sendBuffer.getRemaining() < size)
         flush(false);
 }
 
 // assumes startMessage was called (or header is in place), because endMessage(true) is later called that peeks and sets _lastSegmentedMessageType
 void AbstractCodec::flushSerializeBuffer() {
-    flush(false);
+    if (!growSendBuffer(_sendBuffer.getSize() + 1))
+        flush(false);
 }
 
-void AbstractCodec::flushSendBuffer() {
+bool AbstractCodec::growSendBuffer(std::size_t required)
+{
+    // only when both ends accept large messages, and a message is being built
+    const std::size_t maxMessage = std::min(_maxMessageSize, getPeerMaxMessageSize());
+    if (maxMessage == 0 || _lastMessageStartPosition == std::numeric_limits<size_t>::max())
+        return false;
+
+    const std::size_t limit = _lastMessageStartPosition + PVA_MESSAGE_HEADER_SIZE + maxMessage;
+    if (required > limit)
+        return false; // segment
+
+    const std::size_t newSize = std::min(std::max(required, 2*_sendBuffer.getSize()), limit),
+                      pos = _sendBuffer.getPosition();
+    resizeBuffer(_sendBuffer, _sendStorage, newSize, 0u, pos, 0u);
+    _sendBuffer.setPosition(pos);
+    return true;
+}
+
+// Replace the storage of 'buf' with 'newSize' bytes, copying 'count' bytes from 'from' to 'to'.
+// Position and limit are reset.  Callers hold a pointer to buf, so it is re-constructed in place.
+void AbstractCodec::resizeBuffer(ByteBuffer& buf, std::vector<char>& storage,
+                                 std::size_t newSize, std::size_t from, std::size_t count, std::size_t to)
+{
+    assert(to + count <= newSize);
+
+    std::vector<char> next(newSize);
+    if (count)
+        memcpy(&next[0] + to, buf.getBuffer() + from, count);
+
+    const int byteOrder = buf.getByteOrder();
+
+    buf.~ByteBuffer(); // frees only memory it allocated, not storage
+    storage.swap(next);
+    new (&buf) ByteBuffer(&storage[0], storage.size());
+    buf.setEndianess(byteOrder);
+}
+
+// tail, if provided, is sent following the content of _sendBuffer
+void AbstractCodec::flushSendBuffer(ByteBuffer *tail) {
 
     _sendBuffer.flip();
 
     try {
-        send(&_sendBuffer);
+        if (tail)
+            send(&_sendBuffer, tail);
+        else
+            send(&_sendBuffer);
     } catch (io_exception &) {
         try {
             if (isOpen())
@@ -752,6 +928,10 @@ void AbstractCodec::flush(bool lastMessageCompleted) {
     // flush send buffer
     flushSendBuffer();
 
+    // return a buffer grown for a large message to its usual size
+    if (lastMessageCompleted && _sendBuffer.getSize() > _baseSendBufferSize)
+        resizeBuffer(_sendBuffer, _sendStorage, _baseSendBufferSize, 0u, 0u, 0u);
+
     // start with last header
     if (!lastMessageCompleted && _lastSegmentedMessageType != 0)
         startMessage(_lastSegmentedMessageCommand, 0);
@@ -797,6 +977,12 @@ void AbstractCodec::send(ByteBuffer *buffer)
     int tries = 0;
     while (buffer->getRemaining() > 0)
     {
+        // non-blocking mode, after what the socket refused earlier
+        if (hasUnsentBytes())
+        {
+            queueUnsent(buffer);
+            break;
+        }
 
         //int p = buffer.position();
         int bytesSent = write(buffer);
@@ -809,6 +995,12 @@ void AbstractCodec::send(ByteBuffer *buffer)
         }
         else if (bytesSent == 0)
         {
+            if (_resumableIO)
+            {
+                queueUnsent(buffer);
+                armWritable();
+                break;
+            }
             sendBufferFull(tries++);
             continue;
         }
@@ -830,8 +1022,93 @@ void AbstractCodec::send(ByteBuffer *buffer)
 }
 
 
+void AbstractCodec::send(ByteBuffer *head, ByteBuffer *tail)
+{
+    int tries = 0;
+    while (head->getRemaining() > 0)
+    {
+        if (hasUnsentBytes())
+        {
+            queueUnsent(head);
+            break;
+        }
+
+        int bytesSent = writeGather(head, tail);
+
+        if (bytesSent < 0)
+        {
+            // connection lost
+            close();
+            throw connection_closed_exception("bytesSent < 0");
+        }
+        else if (bytesSent == 0)
+        {
+            if (_resumableIO)
+            {
+                queueUnsent(head);
+                armWritable();
+                break;
+            }
+            sendBufferFull(tries++);
+            continue;
+        }
+
+        atomic::add(_totalBytesSent, bytesSent);
+        tries = 0;
+    }
+
+    send(tail);
+}
+
+
+// Non-blocking mode: keep what the socket did not accept, to be sent by sendUnsent()
+void AbstractCodec::queueUnsent(ByteBuffer *buffer)
+{
+    const std::size_t remaining = buffer->getRemaining();
+    if (remaining == 0)
+        return;
+
+    const char *data = buffer->getBuffer() + buffer->getPosition();
+    _unsentBytes.insert(_unsentBytes.end(), data, data + remaining);
+    buffer->setPosition(buffer->getLimit());
+}
+
+
+// Non-blocking mode: returns true once all which was queued by queueUnsent() is sent
+bool AbstractCodec::sendUnsent()
+{
+    while (hasUnsentBytes())
+    {
+        ByteBuffer pending(&_unsentBytes[_unsentOffset], _unsentBytes.size() - _unsentOffset);
+        int bytesSent = write(&pending);
+
+        if (bytesSent < 0)
+        {
+            // connection lost
+            close();
+            throw connection_closed_exception("bytesSent < 0");
+        }
+        else if (bytesSent == 0)
+        {
+            armWritable();
+            return false;
+        }
+
+        atomic::add(_totalBytesSent, bytesSent);
+        _unsentOffset += bytesSent;
+    }
+
+    _unsentBytes.clear();
+    _unsentOffset = 0;
+    return true;
+}
+
+
 void AbstractCodec::processSendQueue()
 {
+    // non-blocking mode, nothing more until the socket accepts what it refused
+    if (!sendUnsent())
+        return;
 
     {
         std::size_t senderProcessed = 0;
@@ -849,6 +1126,12 @@ void AbstractCodec::processSendQueue()
 
                 if (terminated())			// termination
                     break;
+                // senders held back by output backpressure
+                if (resumeDeferredSenders())
+                    continue;
+                // non-blocking mode, return to the reactor
+                if (!_blockingProcessQueue)
+                    break;
                 // termination (we want to process even if shutdown)
                 _sendQueue.pop_front(sender);
             }
@@ -861,6 +1144,10 @@ void AbstractCodec::processSendQueue()
                 sendCompleted();
                 throw;
             }
+
+            // non-blocking mode, continued once the socket is writable
+            if (hasUnsentBytes())
+                break;
         }
     }
 
@@ -870,9 +1157,125 @@ void AbstractCodec::processSendQueue()
 }
 
 
+void AbstractCodec::setSendWatermarks(std::size_t high, std::size_t low)
+{
+    if(low==0u || low>=high)
+        low = high/2u;
+    _sendHighWatermark = high;
+    _sendLowWatermark = low;
+}
+
+
+std::size_t AbstractCodec::getQueuedSendBytes()
+{
+    return _sendBuffer.getPosition() + (_unsentBytes.size() - _unsentOffset) + getUnsentSocketBytes();
+}
+
+
+bool AbstractCodec::deferIfCongested(TransportSender::shared_pointer const & sender)
+{
+    if(_sendHighWatermark==0u)
+        return false;
+
+    // once congested, stay so until resumeDeferredSenders() sees the low watermark
+    bool congested;
+    {
+        epicsGuard<epicsMutex> G(_mutex);
+        congested = _sendCongested;
+    }
+    if(!congested && getQueuedSendBytes() < _sendHighWatermark)
+        return false;
+
+    epicsGuard<epicsMutex> G(_mutex);
+    if(!_sendCongested) {
+        _sendCongested = true;
+        _congestedCount++;
+    }
+    // a sender re-queued while deferred is only resumed once
+    if(!sender->sendDeferred) {
+        sender->sendDeferred = true;
+        _deferredSenders.push_back(sender);
+    }
+    _deferredCount++;
+    return true;
+}
+
+
+bool AbstractCodec::resumeDeferredSenders()
+{
+    {
+        epicsGuard<epicsMutex> G(_mutex);
+        if(_deferredSenders.empty())
+            return false;
+    }
+
+    // Wait for output to drain, unless other senders are queued meanwhile.
+    // Those are sent, and we are called again when the queue is next empty.
+    while(getQueuedSendBytes() > _sendLowWatermark) {
+        if(!_sendQueue.empty())
+            return true;
+        if(terminated())
+            return false;
+        if(!_blockingProcessQueue) {
+            // never wait in a reactor worker.  processWrite() calls again once drained
+            armSendDrain(_sendLowWatermark);
+            return false;
+        }
+        waitSendDrain(_sendLowWatermark, 0.1);
+    }
+
+    std::vector<TransportSender::shared_pointer> deferred;
+    {
+        epicsGuard<epicsMutex> G(_mutex);
+        deferred.swap(_deferredSenders);
+        _sendCongested = false;
+        for(size_t i=0, N=deferred.size(); i<N; i++)
+            deferred[i]->sendDeferred = false;
+    }
+
+    for(size_t i=0, N=deferred.size(); i<N; i++)
+        _sendQueue.push_back(deferred[i], sendQueueLevel(*deferred[i]));
+    return true;
+}
+
+
+void AbstractCodec::clearSendQueue()
+{
+    _sendQueue.clear();
+
+    std::vector<TransportSender::shared_pointer> deferred;
+    {
+        epicsGuard<epicsMutex> G(_mutex);
+        deferred.swap(_deferredSenders);
+        _sendCongested = false;
+        for(size_t i=0, N=deferred.size(); i<N; i++)
+            deferred[i]->sendDeferred = false;
+    }
+    // release outside of lock
+}
+
+
+unsigned AbstractCodec::sendQueueLevel(const TransportSender& sender)
+{
+    // level 0 is reserved for elevated priority small messages
+    const size_t lastSize = atomic::get(sender.lastSendBytes);
+    unsigned level;
+    if(lastSize <= SMALL_MESSAGE_SIZE)
+        level = 1u;
+    else if(lastSize <= LARGE_MESSAGE_SIZE)
+        level = 2u;
+    else
+        level = 3u;
+
+    if(sender.sendPriority > ChannelProvider::PRIORITY_DEFAULT)
+        level--;
+    return level;
+}
+
+
 void AbstractCodec::enqueueSendRequest(
     TransportSender::shared_pointer const & sender) {
-    _sendQueue.push_back(sender);
+    _sendQueue.push_back(sender, sendQueueLevel(*sender));
     scheduleSend();
 }
 
@@ -902,6 +1305,7 @@ void AbstractCodec::processSender(
         size_t after = atomic::get(_totalBytesSent) + _sendBuffer.getPosition();
 
         atomic::add(sender->bytesTX, after - before);
+        atomic::set(sender->lastSendBytes, after - before);
     }
     catch (connection_closed_exception & ) {
         throw;
@@ -961,7 +1365,6 @@ void AbstractCodec::setByteOrder(int byteOrder)
 bool AbstractCodec::directSerialize(ByteBuffer* /*existingBuffer*/, const char* toSerialize,
                                     std::size_t elementCount, std::size_t elementSize)
 {
-    // TODO overflow check of "size_t count", overflow int32 field of payloadSize header field
     // TODO max message size in connection validation
     std::size_t count = elementCount * elementSize;
 
@@ -970,6 +1373,14 @@ bool AbstractCodec::directSerialize(ByteBuffer* /*existingBuffer*/, const char*
     if (count < 64*1024)
         return false;
 
+    // overflow of size_t, or of int32 payloadSize header field
+    if (count / elementSize != elementCount || count > (std::size_t)std::numeric_limits<int32>::max())
+        return false;
+
+    // data is sent as-is, so must already be in peer byte order
+    if (elementSize > 1 && _sendBuffer.getByteOrder() != EPICS_BYTE_ORDER)
+        return false;
+
     //
     // first end current message, and write a header of next "directly serialized" message
     //
@@ -981,16 +1392,15 @@ bool AbstractCodec::directSerialize(ByteBuffer* /*existingBuffer*/, const char*
     // TODO size_t to int32
     startMessage(_lastSegmentedMessageCommand, 0, static_cast<int32>(count));
 
-    // flush
-    flushSendBuffer();
-
     // TODO think if alignment is preserved after...
 
     //
-    // send toSerialize buffer
+    // send pending messages, the segment header, and toSerialize
+    // with one gather write.  toSerialize belongs to the caller of
+    // serialize(), so stays valid until the send completes.
     //
     ByteBuffer wrappedBuffer(const_cast<char*>(toSerialize), count);
-    send(&wrappedBuffer);
+    flushSendBuffer(&wrappedBuffer);
 
     //
     // continue where we left before calling directSerialize
@@ -1000,10 +1410,90 @@ bool AbstractCodec::directSerialize(ByteBuffer* /*existingBuffer*/, const char*
     return true;
 }
 
+namespace {
+// reverse the byte order of each element
+void swapInPlace(char* buf, std::size_t elementCount, std::size_t elementSize)
+{
+    for (std::size_t i = 0; i < elementCount; i++, buf += elementSize)
+        std::reverse(buf, buf + elementSize);
+}
+}
+
 bool AbstractCodec::directDeserialize(ByteBuffer *existingBuffer, char* deserializeTo,
                                       std::size_t elementCount, std::size_t elementSize)
 {
-    return false;
+    std::size_t count = elementCount * elementSize;
+
+    // same threshold as directSerialize()
+    if (count < 64*1024 || count / elementSize != elementCount)
+        return false;
+
+    if (existingBuffer != &_socketBuffer)
+        return false;
+
+    char* dest = deserializeTo;
+    std::size_t remaining = count;
+
+    while (remaining > 0)
+    {
+        // first take what has already been read into _socketBuffer
+        std::size_t available = std::min(_socketBuffer.getRemaining(), remaining);
+        if (available > 0)
+        {
+            std::size_t pos = _socketBuffer.getPosition();
+            memcpy(dest, _socketBuffer.getBuffer() + pos, available);
+            _socketBuffer.setPosition(pos + available);
+            dest += available;
+            remaining -= available;
+            continue;
+        }
+
+        // subtract what was already processed (cf. ensureData())
+        std::size_t pos = _socketBuffer.getPosition();
+        _storedPayloadSize -= pos - _storedPosition;
+        _storedPosition = pos;
+
+        if (_storedPayloadSize > 0 && pos == _storedLimit)
+        {
+            // SPLIT message case, with _socketBuffer empty.
+            // read the remainder of this payload directly into place.
+            ByteBuffer wrappedBuffer(dest, std::min(remaining, _storedPayloadSize));
+            while (wrappedBuffer.getRemaining() > 0)
+            {
+                int bytesRead = read(&wrappedBuffer);
+
+                if (bytesRead < 0)
+                {
+                    close();
+                    throw connection_closed_exception("bytesRead < 0");
+                }
+                // non-blocking IO support
+                else if (bytesRead == 0)
+                {
+                    readPollOne();
+                    continue;
+                }
+
+                atomic::add(_totalBytesRecv, bytesRead);
+            }
+
+            std::size_t nread = wrappedBuffer.getPosition();
+            dest += nread;
+            remaining -= nread;
+            _storedPayloadSize -= nread;
+        }
+        else
+        {
+            // SEGMENTED message case, let ensureData() handle the header(s)
+            ensureData(1);
+        }
+    }
+
+    // wire data is in peer byte order
+    if (elementSize > 1 && _socketBuffer.getByteOrder() != EPICS_BYTE_ORDER)
+        swapInPlace(deserializeTo, elementCount, elementSize);
+
+    return true;
 }
 
 //
@@ -1021,12 +1511,145 @@ BlockingTCPTransportCodec::~BlockingTCPTransportCodec()
 }
 
 void BlockingTCPTransportCodec::readPollOne() {
-    throw std::logic_error("should not be called for blocking IO");
+    if(!_nonBlocking)
+        throw std::logic_error("should not be called for blocking IO");
+
+    // messages are only processed once all of them is buffered (cf. readWholeMessage())
+    throw std::logic_error("incomplete message with non-blocking IO");
 }
 
 
 void BlockingTCPTransportCodec::writePollOne() {
-    throw std::logic_error("should not be called for blocking IO");
+    if(!_nonBlocking)
+        throw std::logic_error("should not be called for blocking IO");
+
+    // unsent bytes are queued (cf. queueUnsent())
+    throw std::logic_error("should not wait with non-blocking IO");
+}
+
+void BlockingTCPTransportCodec::armWritable() {
+    if(!_sendStalled) {
+        _sendStalled = true;
+        epicsTimeGetCurrent(&_sendStalledSince);
+    }
+
+    TransportReactor::shared_pointer reactor(_reactor.lock());
+    if(reactor)
+        reactor->armWritable(this);
+}
+
+void BlockingTCPTransportCodec::armSendDrain(std::size_t low) {
+    // EPOLLOUT is then only reported once less than 'low' bytes are unsent.
+    // restored by reactorWrite()
+    TCPSocketOptions::setUnsentLowat(_channel, low>0u ? low : 1u);
+    _sendDrainArmed = true;
+    armWritable();
+}
+
+void BlockingTCPTransportCodec::scheduleSend() {
+    if(!_nonBlocking)
+        return; // sendThread() is waiting on _sendQueue
+
+    if(_sendScheduled.getAndSet(true))
+        return; // already pending
+
+    TransportReactor::shared_pointer reactor(_reactor.lock());
+    if(reactor)
+        reactor->scheduleSend(shared_from_this());
+}
+
+void BlockingTCPTransportCodec::reactorRead()
+{
+    // cf. the comment in receiveThread()
+    Transport::shared_pointer ptr(this->shared_from_this());
+
+    try {
+        // drain the socket, and any complete messages already buffered
+        do {
+            _readWouldBlock = false;
+            processRead();
+        } while(isOpen() && !_readWouldBlock);
+        return;
+    } catch (std::exception &e) {
+        PRINT_EXCEPTION(e);
+        LOG(logLevelError,
+            "an exception caught while in reactorRead at %s:%d: %s",
+            __FILE__, __LINE__, e.what());
+    } catch (...) {
+        LOG(logLevelError,
+            "unknown exception caught while in reactorRead at %s:%d.",
+            __FILE__, __LINE__);
+    }
+    close();
+}
+
+void BlockingTCPTransportCodec::reactorWrite()
+{
+    Transport::shared_pointer ptr(this->shared_from_this());
+
+    // clear before processing so that concurrent enqueueSendRequest()
+    // will schedule us again
+    _sendScheduled.getAndSet(false);
+
+    if(!isOpen()) {
+        clearSendQueue();
+        return;
+    }
+
+    if(_sendDrainArmed) {
+        _sendDrainArmed = false;
+        TCPSocketOptions::setUnsentLowat(_channel, _notSentLowat>0 ? std::size_t(_notSentLowat) : 0u);
+    }
+
+    try {
+        processWrite();
+        // socket is full, armWritable() calls back
+        if(hasUnsentBytes())
+            return;
+        _sendStalled = false;
+        // processSendQueue() gives up after MAX_MESSAGE_SEND senders
+        if(!sendQueueEmpty())
+            scheduleSend();
+        return;
+    } catch (connection_closed_exception &cce) {
+        // noop
+    } catch (std::exception &e) {
+        PRINT_EXCEPTION(e);
+        LOG(logLevelWarn,
+            "an exception caught while in reactorWrite at %s:%d: %s",
+            __FILE__, __LINE__, e.what());
+    } catch (...) {
+        LOG(logLevelWarn,
+            "unknown exception caught while in reactorWrite at %s:%d.",
+            __FILE__, __LINE__);
+    }
+    close();
+    clearSendQueue();
+}
+
+void BlockingTCPTransportCodec::reactorCheckTimeout(const epicsTimeStamp& now)
+{
+    if(!isOpen())
+        return;
+
+    // peer stopped reading
+    if(_sendStalled && epicsTimeDiffInSeconds(&now, &_sendStalledSince) > _ioTimeout) {
+        LOG(logLevelDebug,
+            "Unable to send to %s for %f seconds, closing.",
+            _socketName.c_str(), _ioTimeout);
+        close();
+        return;
+    }
+
+    if(_rxTimeout<=0.0)
+        return;
+
+    if(epicsTimeDiffInSeconds(&now, &_lastRx) > _rxTimeout) {
+        LOG(logLevelDebug,
+            "No data received from %s in %f seconds, closing.",
+            _socketName.c_str(), _rxTimeout);
+        close();
+    }
 }
 
 
@@ -1040,21 +1663,37 @@ void BlockingTCPTransportCodec::close() {
         // clean resources (close socket)
         internalClose();
 
-        // Break sender from queue wait
-        BreakTransport::shared_pointer B(new BreakTransport);
-        enqueueSendRequest(B);
+        if(_nonBlocking) {
+            // no sender thread to wake up, drop queued senders now
+            clearSendQueue();
+        } else {
+            // Break sender from queue wait
+            BreakTransport::shared_pointer B(new BreakTransport);
+            enqueueSendRequest(B);
+        }
     }
 }
 
 void BlockingTCPTransportCodec::waitJoin()
 {
     assert(!_isOpen.get());
-    _sendThread.exitWait();
-    _readThread.exitWait();
+    // with a TransportReactor, workers hold a reference while
+    // servicing us, so there is nothing to wait for.
+    if(_sendThread.get())
+        _sendThread->exitWait();
+    if(_readThread.get())
+        _readThread->exitWait();
 }
 
 void BlockingTCPTransportCodec::internalClose()
 {
+    if(_nonBlocking) {
+        // must be removed from the epoll set before the socket is closed
+        TransportReactor::shared_pointer reactor(_reactor.lock());
+        if(reactor)
+            reactor->remove(this, _channel);
+    }
+
     {
 
         epicsSocketSystemCallInterruptMechanismQueryInfo info  =
@@ -1111,9 +1750,20 @@ bool BlockingTCPTransportCodec::isOpen() {
 // NOTE: must not be called from constructor (e.g. needs shared_from_this())
 void BlockingTCPTransportCodec::start() {
 
-    _readThread.start();
+    if(_nonBlocking) {
+        epicsTimeGetCurrent(&_lastRx);
+
+        TransportReactor::shared_pointer reactor(_reactor.lock());
+        if(!reactor || !reactor->add(shared_from_this(), _channel)) {
+            LOG(logLevelError, "Unable to register connection to %s with I/O reactor", _socketName.c_str());
+            close();
+        }
+        return;
+    }
 
-    _sendThread.start();
+    _readThread->start();
+
+    _sendThread->start();
 
 }
 
@@ -1183,12 +1833,20 @@ void BlockingTCPTransportCodec::sendThread()
         // exception
         close();
     }
-    _sendQueue.clear();
+    clearSendQueue();
 }
 
 void BlockingTCPTransportCodec::setRxTimeout(bool ena)
 {
     double timeout = !ena ? 0.0 : std::max(0.0, _context->getConfiguration()->getPropertyAsDouble("EPICS_PVA_CONN_TMO", 30.0));
+
+    if(_nonBlocking) {
+        // SO_RCVTIMEO has no effect on non-blocking sockets.
+        // applied by reactorCheckTimeout()
+        _rxTimeout = timeout;
+        return;
+    }
+
 #ifdef _WIN32
     DWORD timo = DWORD(timeout*1000); // in milliseconds
 #else
@@ -1209,8 +1867,26 @@ void BlockingTCPTransportCodec::setRxTimeout(bool ena)
 }
 
 void BlockingTCPTransportCodec::sendBufferFull(int tries) {
-    // TODO constants
-    epicsThreadSleep(std::max<double>(tries * 0.1, 1));
+    if(_nonBlocking) {
+        writePollOne();
+        return;
+    }
+    // A blocking send() only returns without progress when the OS is short
+    // of buffers (ENOBUFS).  Wait for the socket to be writable, backing off
+    // briefly if this persists.
+    TransportReactor::waitReady(_channel, true, _ioTimeout);
+    if(tries>0)
+        epicsThreadSleep(std::min(tries * 0.01, 0.1));
+}
+
+std::size_t BlockingTCPTransportCodec::getUnsentSocketBytes()
+{
+    return TCPSocketOptions::unsentBytes(_channel);
+}
+
+void BlockingTCPTransportCodec::waitSendDrain(std::size_t low, double timeout)
+{
+    TCPSocketOptions::waitUnsentBelow(_channel, low, _notSentLowat, timeout);
 }
 
 
@@ -1232,18 +1908,17 @@ BlockingTCPTransportCodec::BlockingTCPTransportCodec(bool serverFlag, const Cont
          sendBufferSize,
          receiveBufferSize,
          sendBufferSize,
-         true)
-    ,_readThread(epics::pvData::Thread::Config(this, &BlockingTCPTransportCodec::receiveThread)
-                 .prio(epicsThreadPriorityCAServerLow)
-                 .name("TCP-rx")
-                 .stack(epicsThreadStackBig)
-                 .autostart(false))
-    ,_sendThread(epics::pvData::Thread::Config(this, &BlockingTCPTransportCodec::sendThread)
-                 .prio(epicsThreadPriorityCAServerLow)
-                 .name("TCP-tx")
-                 .stack(epicsThreadStackBig)
-                 .autostart(false))
+         !context->getTransportReactor())
     ,_channel(channel)
+    ,_reactor(context->getTransportReactor())
+    ,_nonBlocking(!!context->getTransportReactor())
+    ,_readWouldBlock(false)
+    ,_rxTimeout(0.0)
+    ,_ioTimeout(std::max(1.0, context->getConfiguration()->getPropertyAsDouble("EPICS_PVA_CONN_TMO", 30.0)))
+    ,_sendStalled(false)
+    ,_quickAck(false)
+    ,_notSentLowat(0)
+    ,_sendDrainArmed(false)
     ,_context(context), _responseHandler(responseHandler)
     ,_remoteTransportReceiveBufferSize(MAX_TCP_RECV)
     ,_priority(priority)
@@ -1252,6 +1927,44 @@ BlockingTCPTransportCodec::BlockingTCPTransportCodec(bool serverFlag, const Cont
     REFTRACE_INCREMENT(num_instances);
 
     _isOpen.getAndSet(true);
+    _resumableIO = _nonBlocking;
+    _sendStalledSince.secPastEpoch = _sendStalledSince.nsec = 0u;
+
+    {
+        const Configuration::const_shared_pointer& conf(context->getConfiguration());
+
+        TCPSocketOptions opts;
+        opts.load(conf, serverFlag);
+        _quickAck = opts.quickAck;
+        _notSentLowat = opts.notSentLowat;
+
+        int32 maxMessage = conf->getPropertyAsInteger("EPICS_PVA_MAX_MESSAGE_BYTES", 0);
+        if (serverFlag)
+            maxMessage = conf->getPropertyAsInteger("EPICS_PVAS_MAX_MESSAGE_BYTES", maxMessage);
+        setMaxMessageSize(maxMessage > 0 ? size_t(maxMessage) : 0u);
+
+        int32 highWater = conf->getPropertyAsInteger("EPICS_PVA_SEND_HIGH_WATER", 0),
+              lowWater = conf->getPropertyAsInteger("EPICS_PVA_SEND_LOW_WATER", 0);
+        if (serverFlag) {
+            highWater = conf->getPropertyAsInteger("EPICS_PVAS_SEND_HIGH_WATER", highWater);
+            lowWater = conf->getPropertyAsInteger("EPICS_PVAS_SEND_LOW_WATER", lowWater);
+        }
+        setSendWatermarks(highWater > 0 ? size_t(highWater) : 0u,
+                          lowWater > 0 ? size_t(lowWater) : 0u);
+    }
+
+    if(!_nonBlocking) {
+        _readThread.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &BlockingTCPTransportCodec::receiveThread)
+                                                    .prio(epicsThreadPriorityCAServerLow)
+                                                    .name("TCP-rx")
+                                                    .stack(epicsThreadStackBig)
+                                                    .autostart(false)));
+        _sendThread.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &BlockingTCPTransportCodec::sendThread)
+                                                    .prio(epicsThreadPriorityCAServerLow)
+                                                    .name("TCP-tx")
+                                                    .stack(epicsThreadStackBig)
+                                                    .autostart(false)));
+    }
 
     // get remote address
     osiSocklen_t saSize = sizeof(sockaddr);
@@ -1299,6 +2012,8 @@ int BlockingTCPTransportCodec::write(
                 continue;
             else if (socketError==SOCK_ENOBUFS)
                 return 0;
+            else if (_nonBlocking && (socketError==SOCK_EWOULDBLOCK || socketError==EAGAIN))
+                return 0; // socket send buffer full
         }
 
         if (bytesSent > 0) {
@@ -1313,6 +2028,60 @@ int BlockingTCPTransportCodec::write(
 }
 
 
+int BlockingTCPTransportCodec::writeGather(
+    epics::pvData::ByteBuffer *head, epics::pvData::ByteBuffer *tail) {
+
+#ifdef _WIN32
+    return write(head);
+#else
+    const std::size_t headRemaining = head->getRemaining();
+    if (headRemaining == 0)
+        return write(tail);
+
+    iovec iov[2];
+    iov[0].iov_base = (void*)&head->getBuffer()[head->getPosition()];
+    iov[0].iov_len = headRemaining;
+    iov[1].iov_base = (void*)&tail->getBuffer()[tail->getPosition()];
+    iov[1].iov_len = tail->getRemaining();
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov[1].iov_len ? 2 : 1;
+
+    while(true) {
+        ssize_t bytesSent = ::sendmsg(_channel, &msg, 0);
+
+        // NOTE: do not log here, you might override SOCKERRNO relevant to recv() operation above
+
+        if(unlikely(bytesSent<0)) {
+
+            int socketError = SOCKERRNO;
+
+            // spurious EINTR check
+            if (socketError==SOCK_EINTR)
+                continue;
+            else if (socketError==SOCK_ENOBUFS)
+                return 0;
+            else if (_nonBlocking && (socketError==SOCK_EWOULDBLOCK || socketError==EAGAIN))
+                return 0; // socket send buffer full
+            return -1;
+        }
+
+        std::size_t sent = bytesSent;
+        if (sent <= headRemaining) {
+            head->setPosition(head->getPosition() + sent);
+        } else {
+            head->setPosition(head->getLimit());
+            tail->setPosition(tail->getPosition() + (sent - headRemaining));
+        }
+
+        return (int)bytesSent;
+    }
+#endif
+}
+
+
 int BlockingTCPTransportCodec::read(epics::pvData::ByteBuffer* dst) {
 
     std::size_t remaining;
@@ -1336,6 +2105,11 @@ int BlockingTCPTransportCodec::read(epics::pvData::ByteBuffer* dst) {
                 // interrupted by signal.  Retry
                 continue;
 
+            } else if(_nonBlocking && (err==SOCK_EWOULDBLOCK || err==EAGAIN)) {
+                // no more data available now
+                _readWouldBlock = true;
+                return 0;
+
             } else if(err==SOCK_EWOULDBLOCK || err==EAGAIN || err==SOCK_EINPROGRESS
                       || err==SOCK_ETIMEDOUT
                       || err==SOCK_ECONNABORTED || err==SOCK_ECONNRESET
@@ -1358,6 +2132,12 @@ int BlockingTCPTransportCodec::read(epics::pvData::ByteBuffer* dst) {
             }
         }
 
+        if(_nonBlocking)
+            epicsTimeGetCurrent(&_lastRx);
+
+        if(_quickAck)
+            TCPSocketOptions::rearmQuickAck(_channel);
+
         dst->setPosition(dst->getPosition() + bytesRead);
         return bytesRead;
     }
@@ -1439,7 +2219,6 @@ BlockingServerTCPTransportCodec::BlockingServerTCPTransportCodec(
     int32_t receiveBufferSize)
     :BlockingTCPTransportCodec(true, context, channel, responseHandler,
                                sendBufferSize, receiveBufferSize, PVA_DEFAULT_PRIORITY)
-    ,_lastChannelSID(0)
     ,_verificationStatus(pvData::Status::fatal("Uninitialized error"))
     ,_verifyOrVerified(false)
 {
@@ -1456,12 +2235,13 @@ BlockingServerTCPTransportCodec::~BlockingServerTCPTransportCodec() {
 
 pvAccessID BlockingServerTCPTransportCodec::preallocateChannelSID() {
 
-    Lock lock(_channelsMutex);
-    // search first free (theoretically possible loop of death)
-    pvAccessID sid = ++_lastChannelSID;
-    while(_channels.find(sid)!=_channels.end())
-        sid = ++_lastChannelSID;
-    return sid;
+    return _channels.reserve();
+}
+
+
+void BlockingServerTCPTransportCodec::depreallocateChannelSID(pvAccessID sid) {
+
+    _channels.erase(sid);
 }
 
 
@@ -1469,15 +2249,13 @@ void BlockingServerTCPTransportCodec::registerChannel(
     pvAccessID sid,
     ServerChannel::shared_pointer const & channel) {
 
-    Lock lock(_channelsMutex);
-    _channels[sid] = channel;
-
+    if(!_channels.set(sid, channel))
+        throw std::logic_error("registerChannel() for SID not preallocated");
 }
 
 
 void BlockingServerTCPTransportCodec::unregisterChannel(pvAccessID sid) {
 
-    Lock lock(_channelsMutex);
     _channels.erase(sid);
 }
 
@@ -1485,31 +2263,22 @@ void BlockingServerTCPTransportCodec::unregisterChannel(pvAccessID sid) {
 ServerChannel::shared_pointer
 BlockingServerTCPTransportCodec::getChannel(pvAccessID sid) {
 
-    Lock lock(_channelsMutex);
-
-    std::map<pvAccessID, ServerChannel::shared_pointer>::iterator it =
-        _channels.find(sid);
-
-    if(it!=_channels.end()) return it->second;
-
-    return ServerChannel::shared_pointer();
+    return _channels.find(sid);
 }
 
 
 size_t BlockingServerTCPTransportCodec::getChannelCount() const {
 
-    Lock lock(_channelsMutex);
     return _channels.size();
 }
 
 void BlockingServerTCPTransportCodec::getChannels(std::vector<ServerChannel::shared_pointer>& channels) const
 {
-    Lock lock(_channelsMutex);
-    for(_channels_t::const_iterator it(_channels.begin()), end(_channels.end());
-        it!=end; ++it)
-    {
-        channels.push_back(it->second);
-    }
+    const size_t first = channels.size();
+    _channels.values(channels);
+    // skip SIDs preallocated, but not yet registered
+    channels.erase(std::remove(channels.begin()+first, channels.end(), ServerChannel::shared_pointer()),
+                   channels.end());
 }
 
 void BlockingServerTCPTransportCodec::send(ByteBuffer* buffer,
@@ -1532,6 +2301,10 @@ void BlockingServerTCPTransportCodec::send(ByteBuffer* buffer,
         buffer->putByte(CMD_SET_ENDIANESS);		// set byte order
         buffer->putInt(0);
 
+        // offer to accept large messages without segmentation
+        if (getMaxMessageSize() > 0)
+            putControlMessage(CMD_SET_MAX_MESSAGE_SIZE, static_cast<int32>(getMaxMessageSize()));
+
 
         //
         // send verification message
@@ -1602,22 +2375,22 @@ void BlockingServerTCPTransportCodec::send(ByteBuffer* buffer,
 }
 
 void BlockingServerTCPTransportCodec::destroyAllChannels() {
-    Lock lock(_channelsMutex);
-    if(_channels.size()==0) return;
+    std::vector<ServerChannel::shared_pointer> temp;
+    _channels.clear(temp);
+    if(temp.empty()) return;
 
     if (IS_LOGGABLE(logLevelDebug))
     {
         LOG(
             logLevelDebug,
             "Transport to %s still has %zu channel(s) active and closing...",
-            _socketName.c_str(), _channels.size());
+            _socketName.c_str(), temp.size());
     }
 
-    _channels_t temp;
-    temp.swap(_channels);
-
-    for(_channels_t::iterator it(temp.begin()), end(temp.end()); it!=end; ++it)
-        it->second->destroy();
+    for(size_t i=0, N=temp.size(); i<N; i++) {
+        if(temp[i])
+            temp[i]->destroy();
+    }
 }
 
 void BlockingServerTCPTransportCodec::internalClose() {
@@ -1626,6 +2399,32 @@ void BlockingServerTCPTransportCodec::internalClose() {
     destroyAllChannels();
 }
 
+namespace {
+// authorizes once the roles of the peer's account are cached
+struct RolesCompletion : public RoleCache::Listener
+{
+    const std::tr1::weak_ptr<BlockingServerTCPTransportCodec> transport;
+    const Status status;
+    const std::tr1::shared_ptr<PeerInfo> peer;
+
+    RolesCompletion(const std::tr1::shared_ptr<BlockingServerTCPTransportCodec>& transport,
+                    const Status& status,
+                    const std::tr1::shared_ptr<PeerInfo>& peer)
+        :transport(transport)
+        ,status(status)
+        ,peer(peer)
+    {}
+    virtual ~RolesCompletion() {}
+
+    virtual void rolesCached(const std::string& /*account*/) OVERRIDE FINAL
+    {
+        std::tr1::shared_ptr<BlockingServerTCPTransportCodec> T(transport.lock());
+        if(T)
+            T->authorize(status, peer);
+    }
+};
+} // namespace
+
 void BlockingServerTCPTransportCodec::authenticationCompleted(epics::pvData::Status const & status,
                                                               const std::tr1::shared_ptr<PeerInfo>& peer)
 {
@@ -1634,6 +2433,20 @@ void BlockingServerTCPTransportCodec::authenticationCompleted(epics::pvData::Sta
         LOG(logLevelDebug, "Authentication completed with status '%s' for PVA client: %s.", Status::StatusTypeName[status.getType()], _socketName.c_str());
     }
 
+    if(peer && peer->identified && status.isSuccess()) {
+        // authorization plugins find the roles in the cache, so the receive thread doesn't wait on the OS.
+        // A miss is looked up by the RoleCache worker, which then completes.
+        std::tr1::shared_ptr<RolesCompletion> done(new RolesCompletion(
+            std::tr1::static_pointer_cast<BlockingServerTCPTransportCodec>(shared_from_this()), status, peer));
+        RoleCache::instance().fetch(peer->account, done);
+    } else {
+        authorize(status, peer);
+    }
+}
+
+void BlockingServerTCPTransportCodec::authorize(epics::pvData::Status const & status,
+                                                const std::tr1::shared_ptr<PeerInfo>& peer)
+{
     if(peer)
         AuthorizationRegistry::plugins().run(peer);
 
@@ -1845,6 +2658,10 @@ void BlockingClientTCPTransportCodec::send(ByteBuffer* buffer,
          * send verification response message
          */
 
+        // offer to accept large messages without segmentation
+        if (getMaxMessageSize() > 0)
+            putControlMessage(CMD_SET_MAX_MESSAGE_SIZE, static_cast<int32>(getMaxMessageSize()));
+
         control->startMessage(CMD_CONNECTION_VALIDATION, 4+2+2);
 
         // receive buffer size
@@ -48,6 +48,7 @@ public:
     /**
      * Update beacon period and do analitical checks (server restared, routing problems, etc.)
      * @param from who is notifying.
+     * @param serverAddress server (TCP) address given in the beacon.
      * @param remoteTransportRevision encoded (major, minor) revision.
      * @param guid server GUID.
      * @param sequentalID sequential ID.
@@ -55,12 +56,18 @@ public:
      * @param data server status data, can be <code>NULL</code>.
      */
     void beaconNotify(osiSockAddr* from,
+                      osiSockAddr* serverAddress,
                       epics::pvData::int8 remoteTransportRevision,
                       epics::pvData::TimeStamp* timestamp,
                       ServerGUID const &guid,
                       epics::pvData::int16 sequentalID,
                       epics::pvData::int16 changeCount,
                       const epics::pvData::PVFieldPtr& data);
+
+    /**
+     * Number of times the server was seen to restart (GUID changed).
+     */
+    size_t getRestartCount();
 private:
     /**
      * Context instance.
@@ -77,6 +84,10 @@ private:
      * Server GUID.
      */
     ServerGUID _serverGUID;
+    /**
+     * Server (TCP) address from the last beacon.
+     */
+    osiSockAddr _serverAddress;
     /**
      * Server startup timestamp.
      */
@@ -85,9 +96,14 @@ private:
      * First beacon flag.
      */
     bool _first;
+    /**
+     * Number of GUID changes.
+     */
+    size_t _restarts;
 
     /**
      * Update beacon.
+     * @param serverAddress server (TCP) address.
      * @param remoteTransportRevision encoded (major, minor) revision.
      * @param timestamp time when beacon was received.
      * @param guid server GUID.
@@ -95,7 +111,8 @@ private:
      * @param changeCount change count.
      * @return network change (server restarted) detected.
      */
-    bool updateBeacon(epics::pvData::int8 remoteTransportRevision,
+    bool updateBeacon(const osiSockAddr& serverAddress,
+                      epics::pvData::int8 remoteTransportRevision,
                       epics::pvData::TimeStamp* timestamp,
                       ServerGUID const &guid,
                       epics::pvData::int16 sequentalID,
@@ -8,6 +8,7 @@
 #define BLOCKINGTCP_H_
 
 #include <set>
+#include <ostream>
 #include <map>
 #include <deque>
 
@@ -43,6 +44,63 @@ namespace pvAccess {
 
 class ClientChannelImpl;
 
+/**
+ * Options applied to each TCP connection socket, by both acceptor and connector.
+ * A value of zero leaves the OS default.
+ *
+ * Options not supported by the target are ignored.
+ */
+struct epicsShareClass TCPSocketOptions {
+    //! SO_SNDBUF bytes.  Setting disables OS auto-tuning.
+    int sendBufferSize;
+    //! SO_RCVBUF bytes.  Setting disables OS auto-tuning.
+    int receiveBufferSize;
+    //! SO_BUSY_POLL microseconds (Linux)
+    int busyPoll;
+    //! TCP_QUICKACK, re-armed after each receive (Linux)
+    bool quickAck;
+    //! TCP_NOTSENT_LOWAT bytes (Linux, OSX)
+    int notSentLowat;
+
+    TCPSocketOptions();
+
+    /** Read $EPICS_PVA_SOCK_SNDBUF, $EPICS_PVA_SOCK_RCVBUF, $EPICS_PVA_SOCK_BUSY_POLL,
+     *  $EPICS_PVA_SOCK_QUICKACK, and $EPICS_PVA_SOCK_NOTSENT_LOWAT.
+     *  For a server, each may be overridden by the $EPICS_PVAS_SOCK_* equivalent.
+     */
+    void load(const Configuration::const_shared_pointer& conf, bool server);
+
+    //! Add the $EPICS_PVA(S)_SOCK_* keys to a configuration
+    void save(ConfigurationBuilder& builder, bool server) const;
+
+    /** Set configured options on a socket.  Errors are logged, and not fatal.
+     * @return The values actually in effect, as read back.
+     */
+    TCPSocketOptions apply(SOCKET sock) const;
+
+    //! Read back the values in effect for a socket
+    static TCPSocketOptions read(SOCKET sock);
+
+    //! Re-arm TCP_QUICKACK, which the OS clears after some ACKs.
+    static void rearmQuickAck(SOCKET sock);
+
+    //! Bytes accepted by the OS but not yet sent (Linux).  Zero if unknown.
+    static std::size_t unsentBytes(SOCKET sock);
+
+    /** Wait up to timeout seconds for the unsent bytes of a socket to fall below 'low'.
+     *  Temporarily sets TCP_NOTSENT_LOWAT, then restores 'restoreLowat' (zero for OS default).
+     */
+    static void waitUnsentBelow(SOCKET sock, std::size_t low, int restoreLowat, double timeout);
+
+    /** Set TCP_NOTSENT_LOWAT, so that the socket polls writable only once less than 'low'
+     *  bytes are unsent.  Zero for OS default.  No-op where not supported.
+     */
+    static void setUnsentLowat(SOCKET sock, std::size_t low);
+};
+
+epicsShareFunc
+std::ostream& operator<<(std::ostream& strm, const TCPSocketOptions& opts);
+
 /**
  * Channel Access TCP connector.
  * @author <a href="mailto:matej.sekoranjaATcosylab.com">Matej Sekoranja</a>
@@ -53,7 +111,11 @@ public:
     POINTER_DEFINITIONS(BlockingTCPConnector);
 
     BlockingTCPConnector(Context::shared_pointer const & context, int receiveBufferSize,
-                         float beaconInterval);
+                         float beaconInterval,
+                         const TCPSocketOptions& socketOptions = TCPSocketOptions());
+
+    //! Socket options in effect for the most recent connection.
+    TCPSocketOptions getAppliedSocketOptions() const;
 
     Transport::shared_pointer connect(std::tr1::shared_ptr<ClientChannelImpl> const & client,
             ResponseHandler::shared_pointer const & responseHandler, osiSockAddr& address,
@@ -79,6 +141,11 @@ private:
      */
     float _heartbeatInterval;
 
+    const TCPSocketOptions _socketOptions;
+
+    mutable epics::pvData::Mutex _mutex;
+    TCPSocketOptions _appliedSocketOptions;
+
     /**
      * Tries to connect to the given address.
      * @param[in] address
@@ -101,10 +168,17 @@ public:
 
     BlockingTCPAcceptor(Context::shared_pointer const & context,
                         ResponseHandler::shared_pointer const & responseHandler,
-                        const osiSockAddr& addr, int receiveBufferSize);
+                        const osiSockAddr& addr, int receiveBufferSize,
+                        const TCPSocketOptions& socketOptions = TCPSocketOptions());
 
     virtual ~BlockingTCPAcceptor();
 
+    /**
+     * Socket options in effect for the most recently accepted connection,
+     * or for the listening socket until a connection is accepted.
+     */
+    TCPSocketOptions getAppliedSocketOptions() const;
+
     /**
      * Bind socket address.
      * @return bind socket address, <code>null</code> if not binded.
@@ -151,7 +225,10 @@ private:
      */
     bool _destroyed;
 
-    epics::pvData::Mutex _mutex;
+    const TCPSocketOptions _socketOptions;
+
+    mutable epics::pvData::Mutex _mutex;
+    TCPSocketOptions _appliedSocketOptions;
 
     epicsThread _thread;
 
@@ -39,6 +39,10 @@ namespace pvAccess {
 class ClientChannelImpl;
 class BlockingUDPConnector;
 
+namespace detail {
+class UDPDispatcher;
+}
+
 enum InetAddressType { inetAddressType_all, inetAddressType_unicast, inetAddressType_broadcast_multicast };
 
 class BlockingUDPTransport :
@@ -274,6 +278,22 @@ public:
 
     void join(const osiSockAddr & mcastAddr, const osiSockAddr & nifAddr);
 
+    /**
+     * Receive up to batch datagrams per system call (recvmmsg), where supported.
+     * Each datagram slot is MAX_UDP_RECV bytes.  Must be called before start().
+     * @param batch 0 or 1 receive one datagram per call.
+     */
+    void setReceiveBatch(size_t batch);
+
+    /**
+     * Have datagrams received by a shared UDPDispatcher instead of a thread of our own.
+     * Must be called before start().  If registration fails, start() falls back to a thread.
+     */
+    void setDispatcher(const std::tr1::shared_ptr<detail::UDPDispatcher>& dispatcher);
+
+    //! Called by UDPDispatcher when the socket is readable.  Receives queued datagrams.
+    void reactorRead();
+
     void setMutlicastNIF(const osiSockAddr & nifAddr, bool loopback);
 
 protected:
@@ -288,6 +308,10 @@ protected:
 
 private:
     bool processBuffer(Transport::shared_pointer const & transport, osiSockAddr& fromAddress, epics::pvData::ByteBuffer* receiveBuffer);
+    // datagram of bytesRead bytes is in _receiveBuffer, following RECEIVE_BUFFER_PRE_RESERVE
+    void processDatagram(Transport::shared_pointer const & transport, osiSockAddr& fromAddress, int bytesRead);
+    // @returns false if not supported
+    bool runBatched(Transport::shared_pointer const & transport);
 
     void close(bool waitForThreadToComplete);
 
@@ -374,13 +398,36 @@ private:
 
     epics::pvData::int8 _clientServerWithEndianFlag;
 
+    /**
+     * Datagrams per receive call, and storage for all but the first,
+     * which is received into _receiveBuffer.
+     */
+    size_t _receiveBatch;
+    std::vector<char> _receiveBatchBuffer;
+
+    /**
+     * Set when received by a UDPDispatcher, in which case there is no _thread.
+     */
+    std::tr1::weak_ptr<detail::UDPDispatcher> _dispatcher;
+    bool _dispatched;
+
+    /**
+     * Cleared if sendmmsg() turns out to be unavailable at runtime.
+     */
+    bool _useSendBatch;
+
 };
 
 class BlockingUDPConnector{
 public:
     POINTER_DEFINITIONS(BlockingUDPConnector);
 
-    BlockingUDPConnector(bool serverFlag) :_serverFlag(serverFlag) {}
+    BlockingUDPConnector(bool serverFlag, size_t receiveBatch = 0u,
+                         const std::tr1::shared_ptr<detail::UDPDispatcher>& dispatcher = std::tr1::shared_ptr<detail::UDPDispatcher>())
+        :_serverFlag(serverFlag)
+        ,_receiveBatch(receiveBatch)
+        ,_dispatcher(dispatcher)
+    {}
 
     /**
      * NOTE: transport client is ignored for broadcast (UDP).
@@ -397,6 +444,16 @@ private:
      */
     bool _serverFlag;
 
+    /**
+     * cf. BlockingUDPTransport::setReceiveBatch()
+     */
+    size_t _receiveBatch;
+
+    /**
+     * cf. BlockingUDPTransport::setDispatcher()
+     */
+    std::tr1::shared_ptr<detail::UDPDispatcher> _dispatcher;
+
     EPICS_NOT_COPYABLE(BlockingUDPConnector)
 };
 
@@ -411,7 +468,9 @@ void initializeUDPTransports(
     epics::pvData::int32& listenPort,
     bool autoAddressList,
     const std::string& addressList,
-    const std::string& ignoreAddressList);
+    const std::string& ignoreAddressList,
+    size_t receiveBatch = 0u,
+    const std::tr1::shared_ptr<detail::UDPDispatcher>& dispatcher = std::tr1::shared_ptr<detail::UDPDispatcher>());
 
 
 }
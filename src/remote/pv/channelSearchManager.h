@@ -12,6 +12,11 @@
 #   undef epicsExportSharedSymbols
 #endif
 
+#include <ostream>
+#include <vector>
+#include <map>
+#include <set>
+
 #include <osiSock.h>
 
 #ifdef channelSearchManagerEpicsExportSharedSymbols
@@ -21,6 +26,7 @@
 
 #include <pv/pvaDefs.h>
 #include <pv/remote.h>
+#include <pv/inetAddressUtil.h>
 
 namespace epics {
 namespace pvAccess {
@@ -38,6 +44,9 @@ public:
 
     virtual const std::string& getSearchInstanceName() = 0;
 
+    /**
+     * Search backoff level, owned by ChannelSearchManager.
+     */
     virtual int32_t& getUserValue() = 0;
 
     /**
@@ -92,6 +101,18 @@ public:
      * Boost searching of all channels.
      */
     void newServerDetected();
+    /**
+     * A server was started, or restarted with a new GUID.
+     * With targeted search, only channels last resolved on a server at this address
+     * with a different GUID are searched again.  They are searched immediately by unicast
+     * to searchAddress, and then as newly registered.  Other channels keep their backoff.
+     * If there are no such channels (eg. a server not seen before), or without targeted search,
+     * same as newServerDetected().
+     * @param guid new server GUID.
+     * @param serverAddress server (TCP) address, as given in beacons and search responses.
+     * @param searchAddress UDP address to which searches for this server are sent.
+     */
+    void serverRestarted(const ServerGUID& guid, const osiSockAddr& serverAddress, const osiSockAddr& searchAddress);
 
     /// Timer callback.
     virtual void callback() OVERRIDE FINAL;
@@ -99,26 +120,93 @@ public:
     /// Timer stooped callback.
     virtual void timerStopped() OVERRIDE FINAL;
 
+    struct Stats {
+        /** Number of registered channels. */
+        size_t registered;
+        /** Number of registered channels in each backoff bucket.
+         *  Those in bucket i are searched every 2^i periods.
+         */
+        std::vector<size_t> pending;
+        /** Number of search frames sent. */
+        size_t framesSent;
+        /** Number of channel names sent, over all frames. */
+        size_t namesSent;
+        /** Number of searches postponed to the next period by the rate limit. */
+        size_t deferred;
+        /** Number of server restarts which caused a targeted search. */
+        size_t restarts;
+        /** Number of channels searched by unicast to a restarted server. */
+        size_t retargeted;
+    };
+
+    /**
+     * Get search statistics.
+     * @param stats filled in.
+     */
+    void getStats(Stats& stats);
+
+    void printInfo(std::ostream& out);
+
     /**
      * Private constructor.
      * @param context
+     * @param maxFramesPerSecond Limit on search frames sent per second.  0 for no limit.
+     * @param mtu MTU of the network carrying search requests.  Frames are filled up to this size.
+     *            0 for the default, which gives frames of MAX_UDP_UNFRAGMENTED_SEND bytes.
+     * @param targeted Remember which server resolved each channel, and only re-search
+     *                 those channels when that server restarts.  See serverRestarted().
      */
-    ChannelSearchManager(Context::shared_pointer const & context);
+    ChannelSearchManager(Context::shared_pointer const & context, double maxFramesPerSecond = 0.0,
+                         epics::pvData::int32 mtu = 0, bool targeted = false);
     void activate();
 
 private:
 
-    bool generateSearchRequestMessage(SearchInstance::shared_pointer const & channel, bool allowNewFrame, bool flush);
+    /**
+     * Pre-encoded search request entry for one channel: the instance ID and name,
+     * exactly as they appear in a CMD_SEARCH message.  Encoded once on registration.
+     */
+    typedef std::tr1::shared_ptr<const std::string> record_t;
+
+    record_t encodeRecord(SearchInstance::shared_pointer const & channel);
 
-    static bool generateSearchRequestMessage(SearchInstance::shared_pointer const & channel,
-            epics::pvData::ByteBuffer* byteBuffer, TransportSendControl* control);
+    bool generateSearchRequestMessage(const std::string& record, bool allowNewFrame, bool flush);
+
+    // append record to buffer, call with m_mutex held
+    static bool appendRecord(epics::pvData::ByteBuffer& buffer, const std::string& record);
 
     void boost();
 
-    void initializeSendBuffer();
+    // search now the channels scheduled for the current period, outside of the timer
+    void trigger();
+    // search the channels due, after moving on to the next period if advance
+    void searchDue(bool advance);
+    // call with m_channelMutex held
+    void collectDue(size_t slot, std::vector<SearchInstance::shared_pointer>& toSend,
+                    std::vector<record_t>& records);
+
+    void initializeSendBuffer(epics::pvData::ByteBuffer& buffer);
+    void initializeSendBuffer() { initializeSendBuffer(m_sendBuffer); }
     void flushSendBuffer();
 
-    static bool isPowerOfTwo(int32_t x);
+    // unicast searches for records to one server, returns number of frames sent
+    size_t sendTargeted(const std::vector<record_t>& records, const osiSockAddr& searchAddress);
+
+    // call with m_channelMutex held
+    void resolvedOn(pvAccessID cid, const ServerGUID& guid, const osiSockAddr& serverAddress);
+    void forgetResolved(pvAccessID cid);
+
+    struct Pending {
+        SearchInstance::weak_pointer instance;
+        /**
+         * Index in m_wheel of the period when this channel is next searched.
+         */
+        size_t slot;
+        record_t record;
+    };
+
+    // call with m_channelMutex held
+    void schedule(pvAccessID id, Pending& pending, size_t delay);
 
     /**
      * Context.
@@ -148,9 +236,51 @@ private:
     /**
      * Set of registered channels.
      */
-    typedef std::map<pvAccessID,SearchInstance::weak_pointer> m_channels_t;
+    typedef std::map<pvAccessID,Pending> m_channels_t;
     m_channels_t m_channels;
 
+    /**
+     * Targeted search.  For each channel, the server (address and GUID) which last resolved it,
+     * and the reverse index from server address to channels.  Guarded by m_channelMutex.
+     */
+    bool m_targeted;
+    struct Resolution {
+        osiSockAddr server;
+        ServerGUID guid;
+    };
+    typedef std::map<pvAccessID, Resolution> m_resolutions_t;
+    m_resolutions_t m_resolutions;
+    typedef std::map<osiSockAddr, std::set<pvAccessID>, comp_osiSock_lt> m_servers_t;
+    m_servers_t m_servers;
+
+    /**
+     * Send byte buffer (frame) for targeted searches, guarded by m_mutex.
+     */
+    epics::pvData::ByteBuffer m_targetBuffer;
+
+    /**
+     * Timing wheel with one slot per period, listing the channels to search in that period.
+     * An ID whose Pending::slot does not match is stale (re-scheduled or unregistered), and ignored.
+     * Guarded by m_channelMutex.
+     */
+    std::vector<std::vector<pvAccessID> > m_wheel;
+    size_t m_wheelPosition;
+
+    /**
+     * Limit on search frames sent per period.
+     */
+    double m_maxFramesPerSecond;
+    size_t m_maxFramesPerPeriod;
+
+    /**
+     * Statistics, guarded by m_channelMutex.
+     */
+    size_t m_framesSent;
+    size_t m_namesSent;
+    size_t m_deferred;
+    size_t m_restarts;
+    size_t m_retargeted;
+
     /**
      * Time of last frame send.
      */
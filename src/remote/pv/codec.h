@@ -10,6 +10,7 @@
 #include <set>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include <shareLib.h>
 #include <osiSock.h>
@@ -30,7 +31,9 @@
 #include <pv/security.h>
 #include <pv/transportRegistry.h>
 #include <pv/introspectionRegistry.h>
+#include <pv/slotTable.h>
 #include <pv/inetAddressUtil.h>
+#include <pv/reactor.h>
 
 /* C++11 keywords
  @code
@@ -136,6 +139,9 @@ public:
     static const std::size_t MAX_ENSURE_DATA_SIZE;
     static const std::size_t MAX_ENSURE_BUFFER_SIZE;
     static const std::size_t MAX_ENSURE_DATA_BUFFER_SIZE;
+    //! Message size thresholds between send queue levels.  cf. sendQueueLevel()
+    static const std::size_t SMALL_MESSAGE_SIZE;
+    static const std::size_t LARGE_MESSAGE_SIZE;
 
     AbstractCodec(
         bool serverFlag,
@@ -155,6 +161,13 @@ public:
     virtual bool terminated() = 0;
     virtual int write(epics::pvData::ByteBuffer* src) = 0;
     virtual int read(epics::pvData::ByteBuffer* dst) = 0;
+    /** Write from two buffers with a single call, if possible.
+     * Must make progress on head before tail.
+     * Default writes from head only.
+     */
+    virtual int writeGather(epics::pvData::ByteBuffer* head, epics::pvData::ByteBuffer* /*tail*/) {
+        return write(head);
+    }
     virtual bool isOpen() = 0;
 
 
@@ -202,20 +215,83 @@ public:
         return _sendQueue.empty();
     }
 
+    /** Level at which a sender is queued for sending.  Senders whose last
+     *  message was small are sent ahead of those which sent large messages,
+     *  and a sendPriority above default moves a sender one level up.
+     *  A sender of a channel with other senders already queued takes their level instead.
+     */
+    static unsigned sendQueueLevel(const TransportSender& sender);
+
+    //! Queueing statistics of the send queue, one entry per level
+    void getSendQueueStats(std::vector<fair_queue_stats>& stats, bool reset = false) const {
+        _sendQueue.getStats(stats, reset);
+    }
+
+    virtual bool deferIfCongested(TransportSender::shared_pointer const & sender) OVERRIDE FINAL;
+
+    /** Output backpressure watermarks, in bytes queued for sending.  Zero 'high' disables.
+     *  'low' defaults to half of 'high'.
+     */
+    void setSendWatermarks(std::size_t high, std::size_t low);
+
+    //! Bytes written by senders, but not yet sent by the OS.  Call from the send thread.
+    std::size_t getQueuedSendBytes();
+
+    //! Number of times output became congested, and of sends deferred meanwhile.
+    void getBackpressureStats(std::size_t& congested, std::size_t& deferred) const {
+        epicsGuard<epicsMutex> G(_mutex);
+        congested = _congestedCount;
+        deferred = _deferredCount;
+    }
+
     epics::pvData::int8 getRevision() const {
         epicsGuard<epicsMutex> G(_mutex);
         int8_t myver = _clientServerFlag ? PVA_SERVER_PROTOCOL_REVISION : PVA_CLIENT_PROTOCOL_REVISION;
         return myver < _version ? myver : _version;
     }
 
+    /** Largest message payload which this end will accept, or send, without segmenting.
+     *  Buffers grow as needed up to this size.  Zero (default) disables.
+     *  Call before the connection is validated.
+     */
+    void setMaxMessageSize(std::size_t size) { _maxMessageSize = size; }
+    std::size_t getMaxMessageSize() const { return _maxMessageSize; }
+
+    //! As advertised by the peer with CMD_SET_MAX_MESSAGE_SIZE.  Zero if not.
+    void setPeerMaxMessageSize(std::size_t size) { epics::atomic::set(_peerMaxMessageSize, size); }
+    std::size_t getPeerMaxMessageSize() const { return epics::atomic::get(_peerMaxMessageSize); }
+
 protected:
 
     virtual void sendBufferFull(int tries) = 0;
     void send(epics::pvData::ByteBuffer *buffer);
-    void flushSendBuffer();
+    void send(epics::pvData::ByteBuffer *head, epics::pvData::ByteBuffer *tail);
+    void flushSendBuffer(epics::pvData::ByteBuffer *tail = 0);
 
     virtual void setRxTimeout(bool ena) {}
 
+    //! Bytes accepted by the OS, but not yet sent.  Zero if unknown.
+    virtual std::size_t getUnsentSocketBytes() { return 0u; }
+    //! Wait up to 'timeout' seconds for the OS to send until less than 'low' bytes remain.
+    virtual void waitSendDrain(std::size_t low, double timeout) {}
+
+    //! Drop queued and deferred senders
+    void clearSendQueue();
+
+    //! Non-blocking mode: ask for processWrite() once the socket is writable.
+    virtual void armWritable() {}
+    //! Non-blocking mode: ask for processWrite() once less than 'low' bytes are unsent.
+    virtual void armSendDrain(std::size_t low) { armWritable(); }
+    //! Non-blocking mode: bytes the socket did not accept are waiting to be sent.
+    bool hasUnsentBytes() const { return _unsentOffset < _unsentBytes.size(); }
+
+    /** Set by a socket driven by a TransportReactor, which must never wait.
+     *  Then a message is only processed once all of it, and all of its segments, are buffered,
+     *  and bytes the socket does not accept are kept until armWritable() calls back.
+     *  A message larger than getMaxMessageSize(), and the initial receive buffer, is invalid.
+     */
+    bool _resumableIO;
+
     ReadMode _readMode;
     int8_t _version;
     int8_t _flags;
@@ -240,21 +316,49 @@ private:
     void postProcessApplicationMessage();
     void processReadSegmented();
     bool readToBuffer(std::size_t requiredBytes, bool persistent);
+    std::size_t wholeMessageSize(std::size_t max);
+    bool readWholeMessage();
+    void queueUnsent(epics::pvData::ByteBuffer *buffer);
+    bool sendUnsent();
     void endMessage(bool hasMoreSegments);
     void processSender(
         epics::pvAccess::TransportSender::shared_pointer const & sender);
+    bool growSendBuffer(std::size_t required);
+    bool resumeDeferredSenders();
+    static void resizeBuffer(epics::pvData::ByteBuffer& buf, std::vector<char>& storage,
+                             std::size_t newSize, std::size_t from, std::size_t count, std::size_t to);
 
     std::size_t _storedPayloadSize;
     std::size_t _storedPosition;
     std::size_t _storedLimit;
     std::size_t _startPosition;
 
+    // non-blocking mode, not yet accepted by the socket
+    std::vector<char> _unsentBytes;
+    std::size_t _unsentOffset;
+
+    // false when driven by a TransportReactor
+    const bool _blockingProcessQueue;
+
     const std::size_t _maxSendPayloadSize;
+    // initial sizes of _socketBuffer and _sendBuffer, returned to after a large message
+    const std::size_t _baseReceiveBufferSize;
+    const std::size_t _baseSendBufferSize;
+    // storage of _socketBuffer and _sendBuffer, once grown
+    std::vector<char> _socketStorage, _sendStorage;
+    std::size_t _maxMessageSize;
+    std::size_t _peerMaxMessageSize;
     std::size_t _lastMessageStartPosition;
     std::size_t _lastSegmentedMessageType;
     int8_t _lastSegmentedMessageCommand;
     std::size_t _nextMessagePayloadOffset;
 
+    // output backpressure.  _deferredSenders and counters guarded by _mutex
+    std::size_t _sendHighWatermark, _sendLowWatermark;
+    bool _sendCongested;
+    std::vector<TransportSender::shared_pointer> _deferredSenders;
+    std::size_t _congestedCount, _deferredCount;
+
     epics::pvData::int8 _byteOrderFlag;
 protected:
     const epics::pvData::int8 _clientServerFlag;
@@ -289,7 +393,7 @@ public:
 
     virtual void readPollOne() OVERRIDE FINAL;
     virtual void writePollOne() OVERRIDE FINAL;
-    virtual void scheduleSend() OVERRIDE FINAL {}
+    virtual void scheduleSend() OVERRIDE FINAL;
     virtual void sendCompleted() OVERRIDE FINAL {}
     virtual void close() OVERRIDE FINAL;
     virtual void waitJoin() OVERRIDE FINAL;
@@ -299,6 +403,7 @@ public:
 
     virtual int read(epics::pvData::ByteBuffer* dst) OVERRIDE FINAL;
     virtual int write(epics::pvData::ByteBuffer* src) OVERRIDE FINAL;
+    virtual int writeGather(epics::pvData::ByteBuffer* head, epics::pvData::ByteBuffer* tail) OVERRIDE FINAL;
     virtual const osiSockAddr* getLastReadBufferSocketAddress() OVERRIDE FINAL  {
         return &_socketAddress;
     }
@@ -314,6 +419,10 @@ public:
             // check 7-th bit
             setByteOrder(_flags < 0 ? EPICS_ENDIAN_BIG : EPICS_ENDIAN_LITTLE);
         }
+        else if (_command == CMD_SET_MAX_MESSAGE_SIZE)
+        {
+            setPeerMaxMessageSize(_payloadSize > 0 ? std::size_t(_payloadSize) : 0u);
+        }
     }
 
 
@@ -392,6 +501,13 @@ public:
 
     virtual void sendSecurityPluginMessage(epics::pvData::PVStructure::const_shared_pointer const & data) OVERRIDE FINAL;
 
+    //! Called by TransportReactor when the socket is readable
+    void reactorRead();
+    //! Called by TransportReactor after scheduleSend(), or armWritable()
+    void reactorWrite();
+    //! Called periodically by TransportReactor to apply the receive timeout
+    void reactorCheckTimeout(const epicsTimeStamp& now);
+
 private:
     void receiveThread();
     void sendThread();
@@ -401,6 +517,11 @@ protected:
 
     virtual void sendBufferFull(int tries) OVERRIDE FINAL;
 
+    virtual std::size_t getUnsentSocketBytes() OVERRIDE FINAL;
+    virtual void waitSendDrain(std::size_t low, double timeout) OVERRIDE FINAL;
+    virtual void armWritable() OVERRIDE FINAL;
+    virtual void armSendDrain(std::size_t low) OVERRIDE FINAL;
+
     /**
      * Called from close(). after start of shutdown (isOpen()==false)
      * but before worker thread shutdown.
@@ -409,8 +530,29 @@ protected:
 
 private:
     AtomicValue<bool> _isOpen;
-    epics::pvData::Thread _readThread, _sendThread;
+    // only used when not serviced by a TransportReactor
+    epics::auto_ptr<epics::pvData::Thread> _readThread, _sendThread;
     const SOCKET _channel;
+
+    const std::tr1::weak_ptr<TransportReactor> _reactor;
+    const bool _nonBlocking;
+    AtomicValue<bool> _sendScheduled;
+    // last read() found no data (non-blocking mode)
+    bool _readWouldBlock;
+    // receive timeout (non-blocking mode), zero to disable
+    double _rxTimeout;
+    epicsTimeStamp _lastRx;
+    // max. wait for the socket to accept data
+    double _ioTimeout;
+    // non-blocking mode, since when hasUnsentBytes()
+    bool _sendStalled;
+    epicsTimeStamp _sendStalledSince;
+    // re-arm TCP_QUICKACK after each receive
+    bool _quickAck;
+    // configured TCP_NOTSENT_LOWAT, restored after waitSendDrain() and armSendDrain()
+    int _notSentLowat;
+    // non-blocking mode, TCP_NOTSENT_LOWAT changed by armSendDrain()
+    bool _sendDrainArmed;
 protected:
     osiSockAddr _socketAddress;
     std::string _socketName;
@@ -481,7 +623,7 @@ public:
 
     pvAccessID preallocateChannelSID();
 
-    void depreallocateChannelSID(pvAccessID /*sid*/) {}
+    void depreallocateChannelSID(pvAccessID sid);
 
     void registerChannel(
             pvAccessID sid,
@@ -522,6 +664,11 @@ public:
     virtual void authenticationCompleted(epics::pvData::Status const & status,
                                          const std::tr1::shared_ptr<PeerInfo>& peer) OVERRIDE FINAL;
 
+    //! Run the authorization plugins, and complete authentication.
+    //! Called by authenticationCompleted() once the roles of the peer's account are cached.
+    void authorize(epics::pvData::Status const & status,
+                   const std::tr1::shared_ptr<PeerInfo>& peer);
+
     virtual void send(epics::pvData::ByteBuffer* buffer,
                       TransportSendControl* control) OVERRIDE FINAL;
 
@@ -534,19 +681,12 @@ protected:
 
 private:
 
+    typedef SlotTable<std::tr1::shared_ptr<ServerChannel> > _channels_t;
     /**
-    * Last SID cache.
-    */
-    pvAccessID _lastChannelSID;
-
-    typedef std::map<pvAccessID, std::tr1::shared_ptr<ServerChannel> > _channels_t;
-    /**
-    * Channel table (SID -> channel mapping).
+    * Channel table (SID -> channel mapping).  Allocates SIDs.
     */
     _channels_t _channels;
 
-    mutable epics::pvData::Mutex _channelsMutex;
-
     epics::pvData::Status _verificationStatus;
 
     bool _verifyOrVerified;
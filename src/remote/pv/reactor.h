@@ -0,0 +1,195 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef REACTOR_H_
+#define REACTOR_H_
+
+#include <map>
+#include <vector>
+#include <ostream>
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define reactorEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+#include <osiSock.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTypes.h>
+
+#include <pv/noDefaultMethods.h>
+#include <pv/sharedPtr.h>
+#include <pv/thread.h>
+
+#ifdef reactorEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#   undef reactorEpicsExportSharedSymbols
+#endif
+
+namespace epics {
+namespace pvAccess {
+
+class BlockingUDPTransport;
+
+namespace detail {
+
+class BlockingTCPTransportCodec;
+
+/** @brief Event-driven I/O for TCP transports.
+ *
+ * Instead of a dedicated receive and send thread per connection, a reactor
+ * runs a small, fixed pool of worker threads.  Each worker waits on an epoll
+ * set and services every codec assigned to it through the non-blocking
+ * readPollOne()/writePollOne() path of AbstractCodec.
+ *
+ * A codec is bound to one worker for its lifetime, so reads and writes
+ * of a single connection are never processed concurrently.
+ * Workers never wait on a socket.  A partially received message is kept
+ * buffered until the rest arrives, and bytes which the socket does not
+ * accept are kept until it polls writable (EPOLLOUT).
+ *
+ * Enabled by setting $EPICS_PVA_IO_THREADS (client) or $EPICS_PVAS_IO_THREADS
+ * (server) to a non-zero value.  Only available on Linux, other targets
+ * fall back to per-connection threads.
+ */
+class epicsShareClass TransportReactor
+{
+    EPICS_NOT_COPYABLE(TransportReactor)
+public:
+    POINTER_DEFINITIONS(TransportReactor);
+
+    static size_t num_instances;
+
+    //! @returns true if the current target provides epoll()
+    static bool isSupported();
+
+    /** Wait until a (non-blocking) socket is readable or writable.
+     * @param sock socket to wait on
+     * @param forWrite wait for writable if true, readable otherwise
+     * @param timeout timeout in seconds, <=0 waits forever
+     * @returns false on timeout.
+     */
+    static bool waitReady(SOCKET sock, bool forWrite, double timeout);
+
+    /** Start worker threads
+     * @param nworkers number of I/O threads (at least 1)
+     * @param name prefix for thread names
+     */
+    TransportReactor(unsigned nworkers, const std::string& name);
+    ~TransportReactor();
+
+    /** Begin servicing a codec.
+     * Puts the codec socket into non-blocking mode.
+     * @returns false if the codec could not be registered.
+     */
+    bool add(const std::tr1::shared_ptr<BlockingTCPTransportCodec>& codec, SOCKET sock);
+    //! Stop servicing a codec.  Must be called before its socket is closed.
+    void remove(BlockingTCPTransportCodec* codec, SOCKET sock);
+    //! Ask the worker which owns this codec to process its send queue.
+    void scheduleSend(const std::tr1::shared_ptr<BlockingTCPTransportCodec>& codec);
+    //! Call reactorWrite() once, when the socket of this codec next becomes writable.
+    void armWritable(const BlockingTCPTransportCodec* codec);
+
+    //! Stop and join all worker threads.
+    void close();
+
+    //! Number of worker threads
+    size_t workers() const { return _workers.size(); }
+    //! Number of codecs currently serviced
+    size_t size() const;
+
+    void printInfo(std::ostream& strm) const;
+
+private:
+    struct Worker;
+    std::vector<Worker*> _workers;
+
+    mutable epicsMutex _mutex;
+    // assignment of codecs to workers
+    typedef std::map<const BlockingTCPTransportCodec*, size_t> assignment_t;
+    assignment_t _assignment;
+    size_t _nextWorker;
+    bool _closed;
+};
+
+/** @brief Event-driven receive for UDP transports.
+ *
+ * One thread waits on an epoll set of the UDP sockets used for search,
+ * beacons, and their multicast/broadcast variants, and dispatches
+ * each datagram to the ResponseHandler of its BlockingUDPTransport.
+ * Replaces one receive thread per socket.
+ *
+ * Enabled by setting $EPICS_PVA_UDP_DISPATCH (client) or $EPICS_PVAS_UDP_DISPATCH
+ * (server) to YES.  Only available on Linux (cf. TransportReactor::isSupported()),
+ * other targets fall back to a thread per socket.
+ */
+class epicsShareClass UDPDispatcher
+{
+    EPICS_NOT_COPYABLE(UDPDispatcher)
+public:
+    POINTER_DEFINITIONS(UDPDispatcher);
+
+    static size_t num_instances;
+
+    //! Start the dispatch thread
+    explicit UDPDispatcher(const std::string& name);
+    ~UDPDispatcher();
+
+    /** Begin servicing a transport.
+     * @returns false if the transport could not be registered.
+     */
+    bool add(const std::tr1::shared_ptr<BlockingUDPTransport>& transport, SOCKET sock);
+    /** Stop servicing a transport.  Must be called before its socket is closed.
+     *
+     * Returns once no reactorRead() of this transport is running,
+     * unless called from the dispatch thread itself (eg. from within reactorRead()).
+     */
+    void remove(const BlockingUDPTransport* transport, SOCKET sock);
+
+    //! Stop and join the dispatch thread.
+    void close();
+
+    //! Number of transports currently serviced
+    size_t size() const;
+
+    void printInfo(std::ostream& strm) const;
+
+private:
+    void run();
+
+    typedef std::map<epicsUInt64, std::tr1::weak_ptr<BlockingUDPTransport> > transports_t;
+    typedef std::map<const BlockingUDPTransport*, epicsUInt64> keys_t;
+
+    int _epfd, _evfd;
+
+    mutable epicsMutex _mutex;
+    // key 0 is reserved for the wakeup eventfd
+    epicsUInt64 _nextKey;
+    transports_t _transports;
+    keys_t _keys;
+    bool _running;
+
+    // key of the transport in reactorRead(), or 0
+    epicsUInt64 _dispatching;
+    epicsThreadId _dispatchThread;
+    // remove() calls waiting for _dispatching to change
+    size_t _removeWaiters;
+    epicsEvent _dispatchDone;
+
+    // statistics, only modified by the dispatch thread.  Guarded by _mutex
+    size_t _nReads, _nWakeups;
+
+    epics::auto_ptr<epics::pvData::Thread> _thread;
+};
+
+}}} // namespace epics::pvAccess::detail
+
+#endif // REACTOR_H_
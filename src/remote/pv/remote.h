@@ -43,6 +43,10 @@ namespace pvAccess {
 class TransportRegistry;
 class ClientChannelImpl;
 
+namespace detail {
+class TransportReactor;
+}
+
 enum QoS {
     /**
      * Default behavior.
@@ -111,7 +115,11 @@ enum ApplicationCommands {
 enum ControlCommands {
     CMD_SET_MARKER = 0,
     CMD_ACK_MARKER = 1,
-    CMD_SET_ENDIANESS = 2
+    CMD_SET_ENDIANESS = 2,
+    /** Largest message payload the sender will accept without segmentation.
+     *  Sent during connection validation, and ignored by peers which don't understand it.
+     */
+    CMD_SET_MAX_MESSAGE_SIZE = 5
 };
 
 /**
@@ -138,7 +146,17 @@ class TransportSender : public Lockable, public fair_queue<TransportSender>::ent
 public:
     POINTER_DEFINITIONS(TransportSender);
 
-    TransportSender() :bytesTX(0u), bytesRX(0u) {}
+    /** Senders of one channel share a group, so that the messages of the channel
+     *  are sent in the order queued whatever the level of each.  cf. setGroup()
+     */
+    typedef fair_queue<TransportSender>::group SendGroup;
+
+    TransportSender()
+        :bytesTX(0u), bytesRX(0u)
+        ,lastSendBytes(0u)
+        ,sendPriority(ChannelProvider::PRIORITY_DEFAULT)
+        ,sendDeferred(false)
+    {}
     virtual ~TransportSender() {}
 
     /**
@@ -153,6 +171,12 @@ public:
 
     size_t bytesTX;
     size_t bytesRX;
+    //! Size of the last message(s) sent by this sender.  Set by the transport.
+    size_t lastSendBytes;
+    //! Priority hint (see ChannelProvider::PRIORITY_*) used to order senders queued on one transport.
+    epics::pvData::int16 sendPriority;
+    //! Held back by Transport::deferIfCongested().  Set and cleared by the transport, under its lock.
+    bool sendDeferred;
 };
 
 class ClientChannelImpl;
@@ -232,6 +256,15 @@ public:
      */
     virtual void enqueueSendRequest(TransportSender::shared_pointer const & sender) = 0;
 
+    /**
+     * Output backpressure.  To be called from TransportSender::send() by senders
+     * whose data may be held back and squashed (eg. monitor updates).
+     * @param sender the sender, to be re-queued once output has drained.
+     * @return <code>true</code> if bytes queued for sending are above the high watermark,
+     *         in which case the caller should send nothing now.
+     */
+    virtual bool deferIfCongested(TransportSender::shared_pointer const & sender) { return false; }
+
     /**
      * Flush send queue (sent messages).
      */
@@ -290,6 +323,13 @@ public:
 
     virtual TransportRegistry* getTransportRegistry() = 0;
 
+    /**
+     * Reactor servicing TCP transports of this context.
+     * @return reactor, or NULL if each transport runs its own threads.
+     */
+    virtual std::tr1::shared_ptr<detail::TransportReactor> getTransportReactor() {
+        return std::tr1::shared_ptr<detail::TransportReactor>();
+    }
 
 
 
@@ -301,6 +341,17 @@ public:
 
     virtual void newServerDetected() = 0;
 
+    /**
+     * A beacon shows a server was started, or restarted with a new GUID.
+     * @param guid current server GUID.
+     * @param serverAddress server (TCP) address given in the beacon.
+     */
+    virtual void serverRestarted(const ServerGUID& guid, const osiSockAddr& serverAddress) {
+        (void)guid;
+        (void)serverAddress;
+        newServerDetected();
+    }
+
     virtual std::tr1::shared_ptr<Channel> getChannel(pvAccessID id) = 0;
     virtual Transport::shared_pointer getSearchTransport() = 0;
 };
@@ -79,12 +79,17 @@
 #endif
 
 #include <string>
+#include <map>
+#include <vector>
 #include <osiSock.h>
 #include <epicsMutex.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
 
 #include <pv/status.h>
 #include <pv/pvData.h>
 #include <pv/sharedPtr.h>
+#include <pv/thread.h>
 
 #ifdef securityEpicsExportSharedSymbols
 #   define epicsExportSharedSymbols
@@ -306,6 +311,104 @@ public:
 epicsShareFunc
 void osdGetRoles(const std::string &account, PeerInfo::roles_t& roles);
 
+class Configuration;
+
+/** @brief Cache of role/group names of user accounts, as found by osdGetRoles().
+ *
+ * Filled before the authorization plugins of a server are run, and used by the built-in "ca"
+ * authorization plugin, so that connection validation does not wait on the OS user/group
+ * database (eg. LDAP backed NSS).
+ * Accounts not cached are looked up by a worker thread, which also refreshes entries
+ * after their time to live, and evicts those not used since their last refresh.
+ * An expired entry is still returned until the worker has refreshed it.
+ */
+class epicsShareClass RoleCache
+{
+    EPICS_NOT_COPYABLE(RoleCache)
+public:
+    typedef void (*lookup_fn)(const std::string& account, PeerInfo::roles_t& roles);
+
+    struct epicsShareClass Listener {
+        virtual ~Listener();
+        //! Called once the roles of account are cached.  From the worker thread, or from fetch().
+        virtual void rolesCached(const std::string& account) =0;
+    };
+
+    struct Stats {
+        size_t hits;      //!< lookups answered from the cache
+        size_t misses;    //!< lookups of accounts not cached
+        size_t refreshes; //!< entries refreshed by the worker
+        size_t evictions; //!< entries dropped after going unused
+        size_t entries;   //!< accounts currently cached
+        size_t pending;   //!< accounts waiting to be looked up
+    };
+
+    /** Instance used by servers and the built-in plugins.
+     * Time to live is $EPICS_PVAS_ROLES_CACHE_TTL seconds (default 60) from the environment,
+     * or from the Configuration of the last server started.  cf. configure().  0 disables caching.
+     */
+    static RoleCache& instance();
+
+    /**
+     * @param ttl Time to live of entries in seconds.  <=0 disables caching, so every lookup calls fn.
+     * @param fn Lookup function.  Called from the worker thread, and from getRoles() on a miss.
+     */
+    explicit RoleCache(double ttl, lookup_fn fn = &osdGetRoles);
+    ~RoleCache();
+
+    /** Take the time to live from $EPICS_PVAS_ROLES_CACHE_TTL of conf, if set.
+     * Disabling caching forgets all entries.
+     */
+    void configure(const Configuration& conf);
+
+    /** Add the cached roles of account to roles.  Never waits.
+     * @returns false if account is not cached.
+     */
+    bool lookup(const std::string& account, PeerInfo::roles_t& roles);
+
+    //! Add the roles of account to roles.  On a miss, calls the lookup function, which may wait.
+    void getRoles(const std::string& account, PeerInfo::roles_t& roles);
+
+    /** Never waits.  Ensure the roles of account are cached, then call listener->rolesCached().
+     * Calls the listener before returning if already cached, or if caching is disabled.
+     * Concurrent fetch() of one account share a single lookup.
+     */
+    void fetch(const std::string& account, const std::tr1::shared_ptr<Listener>& listener);
+
+    double timeToLive() const;
+
+    //! Forget all entries.  Following lookups are misses.
+    void clear();
+
+    void stats(Stats& s) const;
+
+private:
+    void run();
+
+    double ttl; // guarded by mutex
+    const lookup_fn fn;
+
+    struct Entry {
+        PeerInfo::roles_t roles;
+        epicsTimeStamp expires;
+        //! looked up since the last refresh
+        bool used;
+    };
+    typedef std::map<std::string, Entry> entries_t;
+    typedef std::vector<std::tr1::shared_ptr<Listener> > listeners_t;
+    // accounts to look up, with the listeners waiting for each
+    typedef std::map<std::string, listeners_t> pending_t;
+
+    mutable epicsMutex mutex;
+    epicsEvent wakeup;
+    entries_t entries;
+    pending_t pending;
+    bool running;
+    size_t nhits, nmisses, nrefreshes, nevictions;
+    // started on first fetch()
+    epics::auto_ptr<epics::pvData::Thread> worker;
+};
+
 }
 }
 
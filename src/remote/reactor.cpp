@@ -0,0 +1,722 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <stdexcept>
+#include <sstream>
+
+#if defined(__linux__)
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  include <errno.h>
+#  define USE_EPOLL
+#endif
+
+#include <osiSock.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsTypes.h>
+#include <errlog.h>
+#include <dbDefs.h>
+
+#include <pv/reftrack.h>
+
+#define epicsExportSharedSymbols
+#include <pv/reactor.h>
+#include <pv/codec.h>
+#include <pv/blockingUDP.h>
+#include <pv/logger.h>
+
+typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
+
+namespace epics {
+namespace pvAccess {
+namespace detail {
+
+size_t TransportReactor::num_instances;
+
+bool TransportReactor::isSupported()
+{
+#ifdef USE_EPOLL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TransportReactor::waitReady(SOCKET sock, bool forWrite, double timeout)
+{
+#ifdef USE_EPOLL
+    pollfd fd;
+    fd.fd = sock;
+    fd.events = forWrite ? POLLOUT : POLLIN;
+    fd.revents = 0;
+
+    int tmo = timeout<=0.0 ? -1 : int(timeout*1000.0);
+
+    while(true) {
+        int ret = ::poll(&fd, 1, tmo);
+        if(ret<0 && errno==EINTR)
+            continue;
+        // errors and hang-ups are reported by the following read()/send()
+        return ret!=0;
+    }
+#else
+    return true;
+#endif
+}
+
+struct TransportReactor::Worker
+{
+    typedef std::tr1::shared_ptr<BlockingTCPTransportCodec> codec_ptr;
+    struct Entry {
+        std::tr1::weak_ptr<BlockingTCPTransportCodec> codec;
+        SOCKET sock;
+    };
+    typedef std::map<epicsUInt64, Entry> codecs_t;
+    typedef std::map<const BlockingTCPTransportCodec*, epicsUInt64> keys_t;
+    typedef std::vector<codec_ptr> pending_t;
+
+    const size_t index;
+    int epfd, evfd;
+
+    mutable epicsMutex mutex;
+    // key 0 is reserved for the wakeup eventfd
+    epicsUInt64 nextKey;
+    codecs_t codecs;
+    keys_t keys;
+    pending_t pendingSend;
+    bool running;
+    bool wakeupPending;
+
+    // statistics, only modified by the worker thread
+    size_t nReads, nWrites, nWakeups;
+
+    epics::auto_ptr<epics::pvData::Thread> thread;
+
+    Worker(size_t index, const std::string& name)
+        :index(index)
+        ,epfd(-1)
+        ,evfd(-1)
+        ,nextKey(1u)
+        ,running(true)
+        ,wakeupPending(false)
+        ,nReads(0u)
+        ,nWrites(0u)
+        ,nWakeups(0u)
+    {
+#ifdef USE_EPOLL
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if(epfd<0)
+            throw std::runtime_error("Unable to create epoll set");
+
+        evfd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+        if(evfd<0) {
+            ::close(epfd);
+            throw std::runtime_error("Unable to create eventfd");
+        }
+
+        epoll_event evt;
+        evt.events = EPOLLIN;
+        evt.data.u64 = 0u;
+        if(epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &evt)) {
+            ::close(evfd);
+            ::close(epfd);
+            throw std::runtime_error("Unable to add eventfd to epoll set");
+        }
+
+        std::ostringstream tname;
+        tname<<name<<"-"<<index;
+
+        thread.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &Worker::run)
+                                               .prio(epicsThreadPriorityCAServerLow)
+                                               .name(tname.str())
+                                               .stack(epicsThreadStackBig)
+                                               .autostart(true)));
+#else
+        throw std::logic_error("TransportReactor not supported on this target");
+#endif
+    }
+
+    ~Worker()
+    {
+        stop();
+#ifdef USE_EPOLL
+        ::close(evfd);
+        ::close(epfd);
+#endif
+    }
+
+    void stop()
+    {
+        {
+            Guard G(mutex);
+            if(!running)
+                return;
+            running = false;
+        }
+        wakeup();
+        if(thread.get())
+            thread->exitWait();
+
+        pending_t garbage;
+        {
+            Guard G(mutex);
+            garbage.swap(pendingSend);
+            codecs.clear();
+            keys.clear();
+        }
+    }
+
+    void wakeup()
+    {
+#ifdef USE_EPOLL
+        epicsUInt64 one = 1u;
+        // EAGAIN means the counter is already non-zero, which is sufficient
+        ssize_t ret = ::write(evfd, &one, sizeof(one));
+        (void)ret;
+#endif
+    }
+
+    bool add(const codec_ptr& codec, SOCKET sock)
+    {
+#ifdef USE_EPOLL
+        Guard G(mutex);
+        if(!running)
+            return false;
+
+        epicsUInt64 key = nextKey++;
+
+        epoll_event evt;
+        evt.events = EPOLLIN|EPOLLRDHUP;
+        evt.data.u64 = key;
+        if(epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &evt)) {
+            char errStr[64];
+            epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+            LOG(logLevelError, "Unable to add socket to epoll set: %s", errStr);
+            return false;
+        }
+
+        Entry& entry = codecs[key];
+        entry.codec = codec;
+        entry.sock = sock;
+        keys[codec.get()] = key;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void remove(const BlockingTCPTransportCodec* codec, SOCKET sock)
+    {
+        Guard G(mutex);
+        keys_t::iterator it(keys.find(codec));
+        if(it==keys.end())
+            return;
+
+#ifdef USE_EPOLL
+        epoll_event evt; // ignored, but must be non-NULL for old kernels
+        evt.events = 0;
+        evt.data.u64 = it->second;
+        // may fail if the socket is already closed, which also removes it from the set
+        (void)epoll_ctl(epfd, EPOLL_CTL_DEL, sock, &evt);
+#endif
+
+        codecs.erase(it->second);
+        keys.erase(it);
+    }
+
+    // until the next EPOLLOUT, which also disarms
+    void armWritable(const BlockingTCPTransportCodec* codec)
+    {
+#ifdef USE_EPOLL
+        Guard G(mutex);
+        keys_t::const_iterator it(keys.find(codec));
+        if(it==keys.end())
+            return;
+        codecs_t::const_iterator entry(codecs.find(it->second));
+
+        epoll_event evt;
+        evt.events = EPOLLIN|EPOLLRDHUP|EPOLLOUT;
+        evt.data.u64 = it->second;
+        if(epoll_ctl(epfd, EPOLL_CTL_MOD, entry->second.sock, &evt)) {
+            char errStr[64];
+            epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+            LOG(logLevelError, "Unable to wait for writable socket: %s", errStr);
+        }
+#endif
+    }
+
+    void schedule(const codec_ptr& codec)
+    {
+        bool wake;
+        {
+            Guard G(mutex);
+            if(!running)
+                return;
+            pendingSend.push_back(codec);
+            wake = !wakeupPending;
+            wakeupPending = true;
+        }
+        if(wake)
+            wakeup();
+    }
+
+    size_t size() const
+    {
+        Guard G(mutex);
+        return codecs.size();
+    }
+
+    void run()
+    {
+#ifdef USE_EPOLL
+        epoll_event events[64];
+        pending_t pending;
+
+        epicsTimeStamp lastSweep;
+        epicsTimeGetCurrent(&lastSweep);
+
+        while(true) {
+            // wake up periodically to apply receive timeouts
+            int nevt = epoll_wait(epfd, events, NELEMENTS(events), 1000);
+
+            if(nevt<0) {
+                if(errno==EINTR)
+                    continue;
+                errlogPrintf("TransportReactor: epoll_wait error %d\n", errno);
+                break;
+            }
+
+            for(int i=0; i<nevt; i++) {
+                if(events[i].data.u64==0u) {
+                    epicsUInt64 cnt;
+                    ssize_t ret = ::read(evfd, &cnt, sizeof(cnt));
+                    (void)ret;
+                    nWakeups++;
+                    continue;
+                }
+
+                const bool writable = events[i].events&EPOLLOUT;
+
+                codec_ptr codec;
+                {
+                    Guard G(mutex);
+                    codecs_t::const_iterator it(codecs.find(events[i].data.u64));
+                    if(it!=codecs.end()) {
+                        codec = it->second.codec.lock();
+
+                        if(writable) {
+                            // disarm.  re-armed by the codec if still unable to send
+                            epoll_event evt;
+                            evt.events = EPOLLIN|EPOLLRDHUP;
+                            evt.data.u64 = it->first;
+                            (void)epoll_ctl(epfd, EPOLL_CTL_MOD, it->second.sock, &evt);
+                        }
+                    }
+                }
+                // removed since epoll_wait() returned
+                if(!codec)
+                    continue;
+
+                if(events[i].events&~EPOLLOUT) {
+                    nReads++;
+                    codec->reactorRead();
+                }
+                if(writable) {
+                    nWrites++;
+                    codec->reactorWrite();
+                }
+            }
+
+            {
+                Guard G(mutex);
+                if(!running)
+                    break;
+                pending.swap(pendingSend);
+                wakeupPending = false;
+            }
+
+            for(size_t i=0, N=pending.size(); i<N; i++) {
+                nWrites++;
+                pending[i]->reactorWrite();
+            }
+            // may release last reference
+            pending.clear();
+
+            epicsTimeStamp now;
+            epicsTimeGetCurrent(&now);
+            if(epicsTimeDiffInSeconds(&now, &lastSweep)>=1.0) {
+                lastSweep = now;
+
+                std::vector<codec_ptr> active;
+                {
+                    Guard G(mutex);
+                    active.reserve(codecs.size());
+                    for(codecs_t::const_iterator it(codecs.begin()), end(codecs.end()); it!=end; ++it) {
+                        codec_ptr codec(it->second.codec.lock());
+                        if(codec)
+                            active.push_back(codec);
+                    }
+                }
+
+                for(size_t i=0, N=active.size(); i<N; i++)
+                    active[i]->reactorCheckTimeout(now);
+            }
+        }
+#endif
+    }
+};
+
+TransportReactor::TransportReactor(unsigned nworkers, const std::string& name)
+    :_nextWorker(0u)
+    ,_closed(false)
+{
+    REFTRACE_INCREMENT(num_instances);
+
+    if(nworkers==0)
+        nworkers = 1;
+
+    _workers.reserve(nworkers);
+    try {
+        for(unsigned i=0; i<nworkers; i++)
+            _workers.push_back(new Worker(i, name));
+    }catch(...){
+        close();
+        throw;
+    }
+}
+
+TransportReactor::~TransportReactor()
+{
+    close();
+    REFTRACE_DECREMENT(num_instances);
+}
+
+void TransportReactor::close()
+{
+    std::vector<Worker*> workers;
+    {
+        Guard G(_mutex);
+        _closed = true;
+        workers.swap(_workers);
+        _assignment.clear();
+    }
+
+    for(size_t i=0, N=workers.size(); i<N; i++) {
+        workers[i]->stop();
+        delete workers[i];
+    }
+}
+
+// Workers are called with _mutex held, as close() deletes them once removed from _workers.
+// Workers never lock _mutex, and close() stops them without holding it.
+
+bool TransportReactor::add(const std::tr1::shared_ptr<BlockingTCPTransportCodec>& codec, SOCKET sock)
+{
+    osiSockIoctl_t flag = 1;
+    if(socket_ioctl(sock, FIONBIO, &flag)) {
+        char errStr[64];
+        epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+        LOG(logLevelError, "Unable to set non-blocking mode: %s", errStr);
+        return false;
+    }
+
+    Guard G(_mutex);
+    if(_closed || _workers.empty())
+        return false;
+
+    // round-robin assignment
+    size_t idx = _nextWorker++ % _workers.size();
+    Worker *worker = _workers[idx];
+
+    if(!worker->add(codec, sock))
+        return false;
+
+    _assignment[codec.get()] = idx;
+
+    // anything queued before registration
+    worker->schedule(codec);
+    return true;
+}
+
+void TransportReactor::remove(BlockingTCPTransportCodec* codec, SOCKET sock)
+{
+    Guard G(_mutex);
+    assignment_t::iterator it(_assignment.find(codec));
+    if(it==_assignment.end())
+        return;
+    Worker *worker = _workers[it->second];
+    _assignment.erase(it);
+
+    worker->remove(codec, sock);
+}
+
+void TransportReactor::scheduleSend(const std::tr1::shared_ptr<BlockingTCPTransportCodec>& codec)
+{
+    Guard G(_mutex);
+    assignment_t::const_iterator it(_assignment.find(codec.get()));
+    if(it==_assignment.end())
+        return;
+
+    _workers[it->second]->schedule(codec);
+}
+
+void TransportReactor::armWritable(const BlockingTCPTransportCodec* codec)
+{
+    Guard G(_mutex);
+    assignment_t::const_iterator it(_assignment.find(codec));
+    if(it==_assignment.end())
+        return;
+
+    _workers[it->second]->armWritable(codec);
+}
+
+size_t TransportReactor::size() const
+{
+    Guard G(_mutex);
+    return _assignment.size();
+}
+
+void TransportReactor::printInfo(std::ostream& strm) const
+{
+    Guard G(_mutex);
+    strm<<"I/O reactor with "<<_workers.size()<<" thread(s), "<<_assignment.size()<<" connection(s)\n";
+    for(size_t i=0, N=_workers.size(); i<N; i++) {
+        const Worker *worker = _workers[i];
+        strm<<"  ["<<i<<"] "<<worker->size()<<" connection(s), "
+            <<worker->nReads<<" read events, "
+            <<worker->nWrites<<" send events, "
+            <<worker->nWakeups<<" wakeups\n";
+    }
+}
+
+
+size_t UDPDispatcher::num_instances;
+
+UDPDispatcher::UDPDispatcher(const std::string& name)
+    :_epfd(-1)
+    ,_evfd(-1)
+    ,_nextKey(1u)
+    ,_running(true)
+    ,_dispatching(0u)
+    ,_dispatchThread(0)
+    ,_removeWaiters(0u)
+    ,_nReads(0u)
+    ,_nWakeups(0u)
+{
+#ifdef USE_EPOLL
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(_epfd<0)
+        throw std::runtime_error("Unable to create epoll set");
+
+    _evfd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if(_evfd<0) {
+        ::close(_epfd);
+        throw std::runtime_error("Unable to create eventfd");
+    }
+
+    epoll_event evt;
+    evt.events = EPOLLIN;
+    evt.data.u64 = 0u;
+    if(epoll_ctl(_epfd, EPOLL_CTL_ADD, _evfd, &evt)) {
+        ::close(_evfd);
+        ::close(_epfd);
+        throw std::runtime_error("Unable to add eventfd to epoll set");
+    }
+
+    _thread.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &UDPDispatcher::run)
+                                            .prio(epicsThreadPriorityMedium)
+                                            .name(name)
+                                            .stack(epicsThreadStackBig)
+                                            .autostart(true)));
+#else
+    throw std::logic_error("UDPDispatcher not supported on this target");
+#endif
+
+    REFTRACE_INCREMENT(num_instances);
+}
+
+UDPDispatcher::~UDPDispatcher()
+{
+    close();
+#ifdef USE_EPOLL
+    ::close(_evfd);
+    ::close(_epfd);
+#endif
+    REFTRACE_DECREMENT(num_instances);
+}
+
+void UDPDispatcher::close()
+{
+    {
+        Guard G(_mutex);
+        if(!_running)
+            return;
+        _running = false;
+    }
+#ifdef USE_EPOLL
+    epicsUInt64 one = 1u;
+    ssize_t ret = ::write(_evfd, &one, sizeof(one));
+    (void)ret;
+#endif
+    if(_thread.get())
+        _thread->exitWait();
+
+    transports_t garbage;
+    {
+        Guard G(_mutex);
+        garbage.swap(_transports);
+        _keys.clear();
+    }
+}
+
+bool UDPDispatcher::add(const std::tr1::shared_ptr<BlockingUDPTransport>& transport, SOCKET sock)
+{
+#ifdef USE_EPOLL
+    Guard G(_mutex);
+    if(!_running)
+        return false;
+
+    epicsUInt64 key = _nextKey++;
+
+    epoll_event evt;
+    evt.events = EPOLLIN;
+    evt.data.u64 = key;
+    if(epoll_ctl(_epfd, EPOLL_CTL_ADD, sock, &evt)) {
+        char errStr[64];
+        epicsSocketConvertErrnoToString(errStr, sizeof(errStr));
+        LOG(logLevelError, "Unable to add UDP socket to epoll set: %s", errStr);
+        return false;
+    }
+
+    _transports[key] = transport;
+    _keys[transport.get()] = key;
+    return true;
+#else
+    (void)transport;
+    (void)sock;
+    return false;
+#endif
+}
+
+void UDPDispatcher::remove(const BlockingUDPTransport* transport, SOCKET sock)
+{
+    Guard G(_mutex);
+    keys_t::iterator it(_keys.find(transport));
+    if(it==_keys.end())
+        return;
+
+#ifdef USE_EPOLL
+    epoll_event evt; // ignored, but must be non-NULL for old kernels
+    evt.events = 0;
+    evt.data.u64 = it->second;
+    (void)epoll_ctl(_epfd, EPOLL_CTL_DEL, sock, &evt);
+#endif
+
+    const epicsUInt64 key = it->second;
+    _transports.erase(key);
+    _keys.erase(it);
+
+    // The transport may be in reactorRead() since before epoll_ctl().
+    // Wait for it to return, except when called from within (eg. reactorRead() -> close())
+    if(_dispatching!=key || epicsThreadGetIdSelf()==_dispatchThread)
+        return;
+
+    _removeWaiters++;
+    while(_dispatching==key) {
+        UnGuard U(G);
+        _dispatchDone.wait();
+    }
+    _removeWaiters--;
+    // pass on the wakeup to any other remove() which is still waiting
+    if(_removeWaiters)
+        _dispatchDone.signal();
+}
+
+size_t UDPDispatcher::size() const
+{
+    Guard G(_mutex);
+    return _transports.size();
+}
+
+void UDPDispatcher::printInfo(std::ostream& strm) const
+{
+    Guard G(_mutex);
+    strm<<"UDP dispatcher with "<<_transports.size()<<" socket(s), "
+        <<_nReads<<" read events, "<<_nWakeups<<" wakeups\n";
+}
+
+void UDPDispatcher::run()
+{
+#ifdef USE_EPOLL
+    typedef std::tr1::shared_ptr<BlockingUDPTransport> transport_ptr;
+    epoll_event events[64];
+
+    {
+        Guard G(_mutex);
+        _dispatchThread = epicsThreadGetIdSelf();
+    }
+
+    while(true) {
+        int nevt = epoll_wait(_epfd, events, NELEMENTS(events), -1);
+
+        if(nevt<0) {
+            if(errno==EINTR)
+                continue;
+            errlogPrintf("UDPDispatcher: epoll_wait error %d\n", errno);
+            break;
+        }
+
+        for(int i=0; i<nevt; i++) {
+            if(events[i].data.u64==0u) {
+                epicsUInt64 cnt;
+                ssize_t ret = ::read(_evfd, &cnt, sizeof(cnt));
+                (void)ret;
+                Guard G(_mutex);
+                _nWakeups++;
+                continue;
+            }
+
+            transport_ptr transport;
+            {
+                Guard G(_mutex);
+                transports_t::const_iterator it(_transports.find(events[i].data.u64));
+                if(it!=_transports.end())
+                    transport = it->second.lock();
+                if(transport) {
+                    _dispatching = events[i].data.u64;
+                    _nReads++;
+                }
+            }
+            // removed since epoll_wait() returned
+            if(!transport)
+                continue;
+
+            transport->reactorRead();
+
+            bool wakeup;
+            {
+                Guard G(_mutex);
+                _dispatching = 0u;
+                wakeup = _removeWaiters!=0u;
+            }
+            if(wakeup)
+                _dispatchDone.signal();
+            // may be the last reference, so release outside of _mutex
+            transport.reset();
+        }
+
+        Guard G(_mutex);
+        if(!_running)
+            break;
+    }
+#endif
+}
+
+}}} // namespace epics::pvAccess::detail
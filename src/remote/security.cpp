@@ -4,6 +4,8 @@
 * in file LICENSE that is included with this distribution.
 */
 
+#include <algorithm>
+
 #include <osiProcess.h>
 
 #include <epicsThread.h>
@@ -13,8 +15,10 @@
 
 #define epicsExportSharedSymbols
 #include <pv/securityImpl.h>
+#include <pv/configuration.h>
 
 typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
 
 namespace {
 namespace pvd = epics::pvData;
@@ -104,6 +108,7 @@ struct CAPlugin : public pva::AuthenticationPlugin
                 peer->identified = !peer->account.empty();
                 peer->aux = pvd::getPVDataCreate()->createPVStructure(data); // clone to ensure it won't be modified
             }
+
             control->authenticationCompleted(pvd::Status::Ok, peer);
         }
         return sess;
@@ -119,7 +124,8 @@ struct GroupsPlugin : public pva::AuthorizationPlugin
         if(!peer->identified)
             return; // no groups for anonymous
 
-        pva::osdGetRoles(peer->account, peer->roles);
+        // fetch()'d before authorization, so only waits when caching is disabled
+        pva::RoleCache::instance().getRoles(peer->account, peer->roles);
     }
 };
 
@@ -160,6 +166,11 @@ struct authGbl_t {
     mutable epicsMutex mutex;
     AuthenticationRegistry servers, clients;
     AuthorizationRegistry authorizers;
+    RoleCache roles;
+
+    authGbl_t()
+        :roles(ConfigurationBuilder().push_env().build()->getPropertyAsDouble("EPICS_PVAS_ROLES_CACHE_TTL", 60.0))
+    {}
 } *authGbl;
 
 void authGblInit(void *)
@@ -255,6 +266,241 @@ AuthorizationRegistry::AuthorizationRegistry()
     :busy(0)
 {}
 
+RoleCache& RoleCache::instance()
+{
+    epicsThreadOnce(&authGblOnce, &authGblInit, 0);
+    assert(authGbl);
+    return authGbl->roles;
+}
+
+RoleCache::Listener::~Listener() {}
+
+RoleCache::RoleCache(double ttl, lookup_fn fn)
+    :ttl(ttl)
+    ,fn(fn)
+    ,running(true)
+    ,nhits(0u)
+    ,nmisses(0u)
+    ,nrefreshes(0u)
+    ,nevictions(0u)
+{}
+
+RoleCache::~RoleCache()
+{
+    {
+        Guard G(mutex);
+        running = false;
+    }
+    wakeup.signal();
+    if(worker.get())
+        worker->exitWait();
+}
+
+void RoleCache::configure(const Configuration& conf)
+{
+    {
+        Guard G(mutex);
+        ttl = conf.getPropertyAsDouble("EPICS_PVAS_ROLES_CACHE_TTL", ttl);
+        if(ttl<=0.0)
+            entries.clear();
+    }
+    wakeup.signal(); // worker re-computes its delay
+}
+
+double RoleCache::timeToLive() const
+{
+    Guard G(mutex);
+    return ttl;
+}
+
+bool RoleCache::lookup(const std::string& account, PeerInfo::roles_t& roles)
+{
+    Guard G(mutex);
+    if(ttl<=0.0)
+        return false;
+
+    entries_t::iterator it(entries.find(account));
+    if(it==entries.end()) {
+        nmisses++;
+        return false;
+    }
+
+    nhits++;
+    it->second.used = true;
+    roles.insert(it->second.roles.begin(), it->second.roles.end());
+
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    if(epicsTimeDiffInSeconds(&it->second.expires, &now)<=0.0)
+        wakeup.signal(); // stale, have the worker refresh
+
+    return true;
+}
+
+void RoleCache::getRoles(const std::string& account, PeerInfo::roles_t& roles)
+{
+    if(lookup(account, roles))
+        return;
+
+    PeerInfo::roles_t found;
+    (*fn)(account, found);
+    roles.insert(found.begin(), found.end());
+
+    Guard G(mutex);
+    if(ttl<=0.0)
+        return;
+
+    Entry& ent = entries[account];
+    ent.roles.swap(found);
+    epicsTimeGetCurrent(&ent.expires);
+    epicsTimeAddSeconds(&ent.expires, ttl);
+    ent.used = true;
+}
+
+void RoleCache::fetch(const std::string& account, const std::tr1::shared_ptr<Listener>& listener)
+{
+    {
+        Guard G(mutex);
+        // nothing to wait for when caching is disabled
+        entries_t::iterator it(ttl>0.0 ? entries.find(account) : entries.end());
+        if(ttl<=0.0) {
+            // call listener now
+        } else if(it==entries.end()) {
+            nmisses++;
+            pending[account].push_back(listener);
+
+            if(!worker.get())
+                worker.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &RoleCache::run)
+                                                       .prio(epicsThreadPriorityLow)
+                                                       .name("PVA-roles")
+                                                       .autostart(true)));
+            wakeup.signal();
+            return;
+        } else {
+            nhits++;
+            it->second.used = true;
+        }
+    }
+
+    if(listener)
+        listener->rolesCached(account);
+}
+
+void RoleCache::clear()
+{
+    Guard G(mutex);
+    entries.clear();
+}
+
+void RoleCache::stats(Stats& s) const
+{
+    Guard G(mutex);
+    s.hits = nhits;
+    s.misses = nmisses;
+    s.refreshes = nrefreshes;
+    s.evictions = nevictions;
+    s.entries = entries.size();
+    s.pending = pending.size();
+}
+
+void RoleCache::run()
+{
+    Guard G(mutex);
+    while(running) {
+        if(!pending.empty()) {
+            // left in pending during lookup, so that concurrent fetch() joins the waiting listeners
+            const std::string account(pending.begin()->first);
+
+            PeerInfo::roles_t found;
+            try {
+                UnGuard U(G);
+                (*fn)(account, found);
+            }catch(std::exception& e){
+                LOG(logLevelError, "Unable to find roles of '%s' : %s", account.c_str(), e.what());
+            }
+
+            if(ttl>0.0) { // not disabled by configure() while unlocked
+                Entry& ent = entries[account];
+                ent.roles.swap(found);
+                epicsTimeGetCurrent(&ent.expires);
+                epicsTimeAddSeconds(&ent.expires, ttl);
+                ent.used = true;
+            }
+
+            listeners_t listeners;
+            pending_t::iterator it(pending.find(account));
+            if(it!=pending.end()) {
+                listeners.swap(it->second);
+                pending.erase(it);
+            }
+
+            UnGuard U(G);
+            for(size_t i=0, N=listeners.size(); i<N; i++) {
+                if(!listeners[i])
+                    continue;
+                try {
+                    listeners[i]->rolesCached(account);
+                }catch(std::exception& e){
+                    LOG(logLevelError, "Unhandled exception from RoleCache::Listener : %s", e.what());
+                }
+            }
+            continue;
+        }
+
+        // refresh one expired entry at a time, evict those unused since their last refresh
+        epicsTimeStamp now;
+        epicsTimeGetCurrent(&now);
+
+        double delay = ttl;
+        bool refreshed = false;
+        for(entries_t::iterator it(entries.begin()), end(entries.end()); it!=end;) {
+            const double remaining = epicsTimeDiffInSeconds(&it->second.expires, &now);
+            if(remaining>0.0) {
+                delay = std::min(delay, remaining);
+                ++it;
+
+            } else if(!it->second.used) {
+                entries.erase(it++);
+                nevictions++;
+
+            } else {
+                const std::string account(it->first);
+                PeerInfo::roles_t found;
+                bool ok = true;
+                try {
+                    UnGuard U(G);
+                    (*fn)(account, found);
+                }catch(std::exception& e){
+                    // keep the old roles, and try again after another ttl
+                    LOG(logLevelError, "Unable to refresh roles of '%s' : %s", account.c_str(), e.what());
+                    ok = false;
+                }
+
+                // may have been cleared while unlocked
+                entries_t::iterator ent(entries.find(account));
+                if(ent!=entries.end()) {
+                    if(ok)
+                        ent->second.roles.swap(found);
+                    epicsTimeGetCurrent(&ent->second.expires);
+                    epicsTimeAddSeconds(&ent->second.expires, ttl);
+                    ent->second.used = false;
+                    nrefreshes++;
+                }
+                refreshed = true;
+                break;
+            }
+        }
+        if(refreshed)
+            continue;
+
+        UnGuard U(G);
+        if(delay>0.0)
+            wakeup.wait(delay);
+        else
+            wakeup.wait(); // caching disabled, until the next fetch()
+    }
+}
+
 AuthorizationRegistry& AuthorizationRegistry::plugins()
 {
     epicsThreadOnce(&authGblOnce, &authGblInit, 0);
@@ -0,0 +1,200 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <ostream>
+#include <string>
+#include <limits>
+
+#include <osiSock.h>
+
+#ifdef __linux__
+#  include <sys/ioctl.h>
+#  include <linux/sockios.h>
+#endif
+
+#define epicsExportSharedSymbols
+#include <pv/blockingTCP.h>
+#include <pv/configuration.h>
+#include <pv/logger.h>
+#include <pv/reactor.h>
+
+namespace epics {
+namespace pvAccess {
+
+namespace {
+
+int getIntOption(SOCKET sock, int level, int opt, const char* name)
+{
+    int val = 0;
+    osiSocklen_t len = sizeof(val);
+    if(::getsockopt(sock, level, opt, (char*)&val, &len)<0) {
+        char strBuffer[64];
+        epicsSocketConvertErrnoToString(strBuffer, sizeof(strBuffer));
+        LOG(logLevelDebug, "Error getting %s: %s.", name, strBuffer);
+        return 0;
+    }
+    return val;
+}
+
+void setIntOption(SOCKET sock, int level, int opt, const char* name, int val)
+{
+    if(::setsockopt(sock, level, opt, (char*)&val, sizeof(val))<0) {
+        char strBuffer[64];
+        epicsSocketConvertErrnoToString(strBuffer, sizeof(strBuffer));
+        LOG(logLevelWarn, "Error setting %s=%d: %s.", name, val, strBuffer);
+    }
+}
+
+template<typename T>
+void loadKey(const Configuration::const_shared_pointer& conf, bool server, const char* suffix, T& val)
+{
+    std::string key("EPICS_PVA_SOCK_");
+    key += suffix;
+    val = T(conf->getPropertyAsInteger(key, val));
+    if(server) {
+        key.insert(9u, 1u, 'S'); // EPICS_PVAS_SOCK_*
+        val = T(conf->getPropertyAsInteger(key, val));
+    }
+    if(val<0)
+        val = 0;
+}
+
+} // namespace
+
+TCPSocketOptions::TCPSocketOptions()
+    :sendBufferSize(0)
+    ,receiveBufferSize(0)
+    ,busyPoll(0)
+    ,quickAck(false)
+    ,notSentLowat(0)
+{}
+
+void TCPSocketOptions::load(const Configuration::const_shared_pointer& conf, bool server)
+{
+    loadKey(conf, server, "SNDBUF", sendBufferSize);
+    loadKey(conf, server, "RCVBUF", receiveBufferSize);
+    loadKey(conf, server, "BUSY_POLL", busyPoll);
+    loadKey(conf, server, "NOTSENT_LOWAT", notSentLowat);
+
+    quickAck = conf->getPropertyAsBoolean("EPICS_PVA_SOCK_QUICKACK", quickAck);
+    if(server)
+        quickAck = conf->getPropertyAsBoolean("EPICS_PVAS_SOCK_QUICKACK", quickAck);
+}
+
+void TCPSocketOptions::save(ConfigurationBuilder& builder, bool server) const
+{
+    const char *prefix = server ? "EPICS_PVAS_SOCK_" : "EPICS_PVA_SOCK_";
+    builder.add(std::string(prefix)+"SNDBUF", sendBufferSize);
+    builder.add(std::string(prefix)+"RCVBUF", receiveBufferSize);
+    builder.add(std::string(prefix)+"BUSY_POLL", busyPoll);
+    builder.add(std::string(prefix)+"QUICKACK", quickAck ? "YES" : "NO");
+    builder.add(std::string(prefix)+"NOTSENT_LOWAT", notSentLowat);
+}
+
+TCPSocketOptions TCPSocketOptions::apply(SOCKET sock) const
+{
+    if(sendBufferSize>0)
+        setIntOption(sock, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", sendBufferSize);
+    if(receiveBufferSize>0)
+        setIntOption(sock, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", receiveBufferSize);
+
+#ifdef SO_BUSY_POLL
+    if(busyPoll>0)
+        setIntOption(sock, SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL", busyPoll);
+#else
+    if(busyPoll>0)
+        LOG(logLevelDebug, "SO_BUSY_POLL not supported by this target");
+#endif
+
+#ifdef TCP_QUICKACK
+    if(quickAck)
+        setIntOption(sock, IPPROTO_TCP, TCP_QUICKACK, "TCP_QUICKACK", 1);
+#else
+    if(quickAck)
+        LOG(logLevelDebug, "TCP_QUICKACK not supported by this target");
+#endif
+
+#ifdef TCP_NOTSENT_LOWAT
+    if(notSentLowat>0)
+        setIntOption(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT", notSentLowat);
+#else
+    if(notSentLowat>0)
+        LOG(logLevelDebug, "TCP_NOTSENT_LOWAT not supported by this target");
+#endif
+
+    TCPSocketOptions ret(read(sock));
+    // TCP_QUICKACK can't be meaningfully read back, and is re-armed after each receive.
+    ret.quickAck = quickAck;
+    return ret;
+}
+
+TCPSocketOptions TCPSocketOptions::read(SOCKET sock)
+{
+    TCPSocketOptions ret;
+    ret.sendBufferSize = getIntOption(sock, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF");
+    ret.receiveBufferSize = getIntOption(sock, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF");
+#ifdef SO_BUSY_POLL
+    ret.busyPoll = getIntOption(sock, SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL");
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+    ret.notSentLowat = getIntOption(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT");
+#endif
+    return ret;
+}
+
+void TCPSocketOptions::rearmQuickAck(SOCKET sock)
+{
+#ifdef TCP_QUICKACK
+    int val = 1;
+    // errors ignored, this is called after every receive
+    (void)::setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(val));
+#else
+    (void)sock;
+#endif
+}
+
+std::size_t TCPSocketOptions::unsentBytes(SOCKET sock)
+{
+#ifdef SIOCOUTQNSD
+    int val = 0;
+    if(::ioctl(sock, SIOCOUTQNSD, &val)==0 && val>0)
+        return std::size_t(val);
+#else
+    (void)sock;
+#endif
+    return 0u;
+}
+
+void TCPSocketOptions::waitUnsentBelow(SOCKET sock, std::size_t low, int restoreLowat, double timeout)
+{
+    // the socket polls writable only once less than TCP_NOTSENT_LOWAT bytes are unsent
+    setUnsentLowat(sock, low>0u ? low : 1u);
+    TransportReactor::waitReady(sock, true, timeout);
+    setUnsentLowat(sock, restoreLowat>0 ? std::size_t(restoreLowat) : 0u);
+}
+
+void TCPSocketOptions::setUnsentLowat(SOCKET sock, std::size_t low)
+{
+#ifdef TCP_NOTSENT_LOWAT
+    int val = low<std::size_t(std::numeric_limits<int>::max()) ? int(low) : std::numeric_limits<int>::max();
+    (void)::setsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (char*)&val, sizeof(val));
+#else
+    (void)sock;
+    (void)low;
+#endif
+}
+
+std::ostream& operator<<(std::ostream& strm, const TCPSocketOptions& opts)
+{
+    strm<<"SO_SNDBUF="<<opts.sendBufferSize
+        <<" SO_RCVBUF="<<opts.receiveBufferSize
+        <<" SO_BUSY_POLL="<<opts.busyPoll
+        <<" TCP_QUICKACK="<<(opts.quickAck ? "YES" : "NO")
+        <<" TCP_NOTSENT_LOWAT="<<opts.notSentLowat;
+    return strm;
+}
+
+}} // namespace epics::pvAccess
@@ -8,6 +8,7 @@
 #include <sstream>
 #include <memory>
 #include <queue>
+#include <algorithm>
 #include <stdexcept>
 
 #include <osiSock.h>
@@ -24,12 +25,14 @@
 #define epicsExportSharedSymbols
 #include <pv/pvAccess.h>
 #include <pv/pvaConstants.h>
+#include <pv/slotTable.h>
 #include <pv/blockingUDP.h>
 #include <pv/blockingTCP.h>
 #include <pv/inetAddressUtil.h>
 #include <pv/hexDump.h>
 #include <pv/remote.h>
 #include <pv/codec.h>
+#include <pv/reactor.h>
 #include <pv/channelSearchManager.h>
 #include <pv/serializationHelper.h>
 #include <pv/channelSearchManager.h>
@@ -211,6 +214,8 @@ protected:
         m_initialized(false),
         m_subscribed()
     {
+        sendPriority = channel->sendPriority;
+        setGroup(&channel->sendGroup); // m_channel outlives any queueing
         REFTRACE_INCREMENT(num_instances);
     }
 
@@ -1826,8 +1831,41 @@ public:
     virtual void unlisten() = 0;
 };
 
-typedef vector<MonitorElement::shared_pointer> FreeElementQueue;
-typedef queue<MonitorElement::shared_pointer> MonitorElementQueue;
+// Fixed capacity FIFO of elements.  Storage is only (re)allocated by reset()
+class MonitorElementRing {
+    vector<MonitorElement::shared_pointer> m_slots;
+    size_t m_head, m_count;
+public:
+    MonitorElementRing() :m_head(0u), m_count(0u) {}
+
+    void reset(size_t capacity) {
+        m_slots.clear();
+        m_slots.resize(capacity);
+        m_head = m_count = 0u;
+    }
+
+    bool empty() const { return m_count==0u; }
+    size_t size() const { return m_count; }
+    size_t capacity() const { return m_slots.size(); }
+
+    //! false if full
+    bool push(MonitorElement::shared_pointer const & elem) {
+        if(m_count==m_slots.size())
+            return false;
+        m_slots[(m_head+m_count)%m_slots.size()] = elem;
+        m_count++;
+        return true;
+    }
+
+    //! Caller must check !empty()
+    void pop(MonitorElement::shared_pointer& elem) {
+        assert(m_count>0u);
+        elem.reset();
+        elem.swap(m_slots[m_head]);
+        m_head = (m_head+1u)%m_slots.size();
+        m_count--;
+    }
+};
 
 
 class MonitorStrategyQueue :
@@ -1840,13 +1878,19 @@ private:
     const int32 m_queueSize;
 
     StructureConstPtr m_lastStructure;
-    FreeElementQueue m_freeQueue;
-    MonitorElementQueue m_monitorQueue;
+    // elements available for new updates
+    MonitorElementRing m_freeQueue;
+    // elements ready to poll()
+    MonitorElementRing m_monitorQueue;
+    // elements poll()'d and not yet release()'d.  Capacity reserved for m_queueSize
+    vector<MonitorElement*> m_outstanding;
+    // # of MonitorElement allocated.  Only changes in init()
+    size_t m_allocated;
 
 
     const MonitorRequester::weak_pointer m_callback;
 
-    Mutex m_mutex;
+    mutable Mutex m_mutex;
 
     BitSet m_bitSet1;
     BitSet m_bitSet2;
@@ -1876,6 +1920,8 @@ public:
         m_queueSize(queueSize), m_lastStructure(),
         m_freeQueue(),
         m_monitorQueue(),
+        m_outstanding(),
+        m_allocated(0u),
         m_callback(callback), m_mutex(),
         m_bitSet1(), m_bitSet2(), m_overrunInProgress(false),
         m_releasedCount(0),
@@ -1887,9 +1933,9 @@ public:
         if (queueSize <= 1)
             throw std::invalid_argument("queueSize <= 1");
 
-        m_freeQueue.reserve(m_queueSize);
-        // TODO array based deque
-        //m_monitorQueue.reserve(m_queueSize);
+        m_freeQueue.reset(m_queueSize);
+        m_monitorQueue.reset(m_queueSize);
+        m_outstanding.reserve(m_queueSize);
     }
 
     virtual ~MonitorStrategyQueue() {}
@@ -1901,24 +1947,80 @@ public:
         m_reportQueueStateInProgress = false;
 
         {
-            while (!m_monitorQueue.empty())
-                m_monitorQueue.pop();
-
-            m_freeQueue.clear();
-
             m_up2datePVStructure.reset();
 
-            for (int32 i = 0; i < m_queueSize; i++)
+            if (structure.get() == m_lastStructure.get())
+            {
+                // re-connect w/o type change.  keep the elements we hold.
+                // those poll()'d by the user still count against m_queueSize,
+                // and are accepted by release().
+                reclaim();
+            }
+            else
+            {
+                m_freeQueue.reset(m_queueSize);
+                m_monitorQueue.reset(m_queueSize);
+                m_overrunElement.reset();
+                m_overrunInProgress = false;
+                // elements of the old type are not taken back
+                m_outstanding.clear();
+            }
+
+            while (m_freeQueue.size() + m_outstanding.size() < size_t(m_queueSize))
             {
                 PVStructure::shared_pointer pvStructure = getPVDataCreate()->createPVStructure(structure);
                 MonitorElement::shared_pointer monitorElement(new MonitorElement(pvStructure));
-                m_freeQueue.push_back(monitorElement);
+                if (!m_freeQueue.push(monitorElement))
+                    break;
+                m_allocated++;
             }
 
             m_lastStructure = structure;
         }
     }
 
+    // move all queued elements back to the free queue.  call with m_mutex locked
+    // The free queue has room for all m_queueSize elements, so nothing is dropped
+    // unless the accounting is wrong.
+    void reclaim()
+    {
+        MonitorElement::shared_pointer elem;
+        while (!m_monitorQueue.empty())
+        {
+            m_monitorQueue.pop(elem);
+            if (!m_freeQueue.push(elem))
+                LOG(logLevelError, "MonitorStrategyQueue: free queue overflow, dropping element");
+        }
+        if (m_overrunElement)
+        {
+            if (!m_freeQueue.push(m_overrunElement))
+                LOG(logLevelError, "MonitorStrategyQueue: free queue overflow, dropping element");
+            m_overrunElement.reset();
+        }
+        m_overrunInProgress = false;
+    }
+
+    // forget a poll()'d element.  false if not poll()'d, or already release()'d.
+    // call with m_mutex locked
+    bool takeOutstanding(MonitorElement* elem)
+    {
+        vector<MonitorElement*>::iterator it(std::find(m_outstanding.begin(), m_outstanding.end(), elem));
+        if (it == m_outstanding.end())
+            return false;
+        *it = m_outstanding.back();
+        m_outstanding.pop_back();
+        return true;
+    }
+
+    virtual void getStats(Stats& s) const OVERRIDE FINAL
+    {
+        Lock guard(m_mutex);
+        s.nempty = m_freeQueue.size();
+        s.nfilled = m_monitorQueue.size() + (m_overrunElement ? 1u : 0u);
+        s.noutstanding = m_outstanding.size();
+        s.nallocated = m_allocated;
+    }
+
 
     virtual void response(Transport::shared_pointer const & transport, ByteBuffer* payloadBuffer) OVERRIDE FINAL {
 
@@ -1952,8 +2054,8 @@ public:
                 return;
             }
 
-            MonitorElementPtr newElement = m_freeQueue.back();
-            m_freeQueue.pop_back();
+            MonitorElementPtr newElement;
+            m_freeQueue.pop(newElement);
 
             if (m_freeQueue.empty())
             {
@@ -1977,8 +2079,14 @@ public:
 
             m_up2datePVStructure = pvStructure;
 
-            if (!m_overrunInProgress)
-                m_monitorQueue.push(newElement);
+            if (!m_overrunInProgress && !m_monitorQueue.push(newElement))
+            {
+                // can't happen as both rings hold m_queueSize.  treat as overrun
+                LOG(logLevelError, "MonitorStrategyQueue: monitor queue overflow");
+                m_overrunInProgress = true;
+                m_overrunElement = newElement;
+            }
+            // else the last free element accumulates updates in place until the next release()
         }
 
         if (!m_overrunInProgress)
@@ -2015,25 +2123,30 @@ public:
             return MonitorElement::shared_pointer();
         }
 
-        MonitorElement::shared_pointer retVal(m_monitorQueue.front());
-        m_monitorQueue.pop();
+        MonitorElement::shared_pointer retVal;
+        m_monitorQueue.pop(retVal);
+        m_outstanding.push_back(retVal.get());
         return retVal;
     }
 
     // NOTE: a client must always call poll() after release() to check the presence of any new monitor elements
     virtual void release(MonitorElement::shared_pointer const & monitorElement) OVERRIDE FINAL {
 
-        // fast sanity check check if monitorElement->pvStructurePtr->getStructure() matches
-        // not to accept wrong structure (might happen on monitor reconnect with different type)
-        // silent return
-        if (monitorElement->pvStructurePtr->getStructure().get() != m_lastStructure.get())
-            return;
-
         bool sendAck = false;
         {
             Lock guard(m_mutex);
 
-            m_freeQueue.push_back(monitorElement);
+            // only take back elements poll()'d since the last type change, and only once.
+            // others (eg. of an old type) are silently dropped.
+            if (!takeOutstanding(monitorElement.get()))
+                return;
+
+            if (!m_freeQueue.push(monitorElement))
+            {
+                // extra element, let it go
+                LOG(logLevelError, "MonitorStrategyQueue: free queue overflow, dropping element");
+                return;
+            }
 
             if (m_overrunInProgress)
             {
@@ -2042,10 +2155,15 @@ public:
                 BitSetUtil::compress(m_overrunElement->changedBitSet, pvStructure);
                 BitSetUtil::compress(m_overrunElement->overrunBitSet, pvStructure);
 
-                m_monitorQueue.push(m_overrunElement);
-
-                m_overrunElement.reset();
-                m_overrunInProgress = false;
+                if (m_monitorQueue.push(m_overrunElement))
+                {
+                    m_overrunElement.reset();
+                    m_overrunInProgress = false;
+                }
+                else
+                {
+                    LOG(logLevelError, "MonitorStrategyQueue: monitor queue overflow");
+                }
             }
 
             if (m_pipeline)
@@ -2097,17 +2215,7 @@ public:
 
     Status start() OVERRIDE FINAL {
         Lock guard(m_mutex);
-        while (!m_monitorQueue.empty())
-        {
-            m_freeQueue.push_back(m_monitorQueue.front());
-            m_monitorQueue.pop();
-        }
-        if (m_overrunElement)
-        {
-            m_freeQueue.push_back(m_overrunElement);
-            m_overrunElement.reset();
-        }
-        m_overrunInProgress = false;
+        reclaim();
         return Status::Ok;
     }
 
@@ -2259,6 +2367,14 @@ public:
 
     ChannelBaseRequester::shared_pointer getRequester() OVERRIDE FINAL { return m_callback.lock(); }
 
+    virtual void getStats(Stats& s) const OVERRIDE FINAL
+    {
+        if (m_monitorStrategy)
+            m_monitorStrategy->getStats(s);
+        else
+            Monitor::getStats(s);
+    }
+
     virtual void send(ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
         int32 pendingRequest = beginRequest();
         if (pendingRequest < 0)
@@ -2781,7 +2897,7 @@ public:
         }
 
         // notify beacon handler
-        beaconHandler->beaconNotify(responseFrom, version, &timestamp, guid, sequentalID, changeCount, data);
+        beaconHandler->beaconNotify(responseFrom, &serverAddress, version, &timestamp, guid, sequentalID, changeCount, data);
     }
 };
 
@@ -3270,6 +3386,8 @@ private:
             m_serverChannelID(0xFFFFFFFF),
             m_issueCreateMessage(true)
         {
+            sendPriority = priority;
+            setGroup(&sendGroup);
             REFTRACE_INCREMENT(num_instances);
         }
 
@@ -3972,7 +4090,13 @@ public:
     InternalClientContextImpl(const Configuration::shared_pointer& conf) :
         m_addressList(""), m_autoAddressList(true), m_connectionTimeout(30.0f), m_beaconPeriod(15.0f),
         m_broadcastPort(PVA_BROADCAST_PORT), m_receiveBufferSize(MAX_TCP_RECV),
-        m_lastCID(0), m_lastIOID(0),
+        m_ioThreads(0),
+        m_udpBatch(0),
+        m_udpDispatch(false),
+        m_searchMaxPPS(0.0),
+        m_searchMTU(1500),
+        m_targetedSearch(false),
+        m_maxMessageBytes(0),
         m_version("pvAccess Client", "cpp",
                   EPICS_PVA_MAJOR_VERSION,
                   EPICS_PVA_MINOR_VERSION,
@@ -4006,6 +4130,11 @@ public:
         return &m_transportRegistry;
     }
 
+    virtual std::tr1::shared_ptr<detail::TransportReactor> getTransportReactor() OVERRIDE FINAL
+    {
+        return m_reactor;
+    }
+
     virtual Transport::shared_pointer getSearchTransport() OVERRIDE FINAL
     {
         return m_searchTransport;
@@ -4035,6 +4164,30 @@ public:
         out << "BEACON_PERIOD      : " << m_beaconPeriod << std::endl;
         out << "BROADCAST_PORT     : " << m_broadcastPort << std::endl;;
         out << "RCV_BUFFER_SIZE    : " << m_receiveBufferSize << std::endl;
+        out << "IO_THREADS         : " << m_ioThreads << std::endl;
+        out << "UDP_BATCH          : " << m_udpBatch << std::endl;
+        out << "UDP_DISPATCH       : " << (m_udpDispatch ? "YES" : "NO") << std::endl;
+        out << "SEARCH_MAX_PPS     : " << m_searchMaxPPS << std::endl;
+        out << "SEARCH_MTU         : " << m_searchMTU << std::endl;
+        out << "TARGETED_SEARCH    : " << (m_targetedSearch ? "YES" : "NO") << std::endl;
+        {
+            Lock guard(m_beaconMapMutex);
+            size_t restarts = 0u;
+            for (AddressBeaconHandlerMap::const_iterator it = m_beaconHandlers.begin(); it != m_beaconHandlers.end(); ++it)
+                restarts += it->second->getRestartCount();
+            out << "BEACON_SERVERS     : " << m_beaconHandlers.size() << " server(s), "
+                << restarts << " restart(s)" << std::endl;
+        }
+        out << "SOCKET_OPTIONS     : " << m_socketOptions << std::endl;
+        out << "MAX_MESSAGE_BYTES  : " << m_maxMessageBytes << std::endl;
+        if (m_connector)
+            out << "SOCKET_APPLIED     : " << m_connector->getAppliedSocketOptions() << std::endl;
+        if (m_reactor)
+            m_reactor->printInfo(out);
+        if (m_udpDispatcher)
+            m_udpDispatcher->printInfo(out);
+        if (m_channelSearchManager)
+            m_channelSearchManager->printInfo(out);
         out << "STATE              : ";
         switch (m_contextState)
         {
@@ -4085,6 +4238,9 @@ public:
         if (m_searchTransport)
             m_searchTransport->close();
 
+        if (m_udpDispatcher)
+            m_udpDispatcher->close();
+
         // wait for all transports to cleanly exit
         int tries = 40;
         epics::pvData::int32 transportCount;
@@ -4098,6 +4254,9 @@ public:
 
         if (transportCount)
             LOG(logLevelDebug, "PVA client context destroyed with %u transport(s) active.", (unsigned)transportCount);
+
+        if (m_reactor)
+            m_reactor->close();
     }
 
     virtual ~InternalClientContextImpl()
@@ -4127,20 +4286,61 @@ private:
         m_beaconPeriod = m_configuration->getPropertyAsFloat("EPICS_PVA_BEACON_PERIOD", m_beaconPeriod);
         m_broadcastPort = m_configuration->getPropertyAsInteger("EPICS_PVA_BROADCAST_PORT", m_broadcastPort);
         m_receiveBufferSize = m_configuration->getPropertyAsInteger("EPICS_PVA_MAX_ARRAY_BYTES", m_receiveBufferSize);
+        m_ioThreads = m_configuration->getPropertyAsInteger("EPICS_PVA_IO_THREADS", m_ioThreads);
+        if (m_ioThreads < 0)
+            m_ioThreads = 0;
+        m_udpBatch = m_configuration->getPropertyAsInteger("EPICS_PVA_UDP_BATCH", m_udpBatch);
+        if (m_udpBatch < 0)
+            m_udpBatch = 0;
+        m_udpDispatch = m_configuration->getPropertyAsBoolean("EPICS_PVA_UDP_DISPATCH", m_udpDispatch);
+        m_searchMaxPPS = m_configuration->getPropertyAsDouble("EPICS_PVA_SEARCH_MAX_PPS", m_searchMaxPPS);
+        if (m_searchMaxPPS < 0.0)
+            m_searchMaxPPS = 0.0;
+        m_searchMTU = m_configuration->getPropertyAsInteger("EPICS_PVA_SEARCH_MTU", m_searchMTU);
+        m_targetedSearch = m_configuration->getPropertyAsBoolean("EPICS_PVA_TARGETED_SEARCH", m_targetedSearch);
+        m_socketOptions.load(m_configuration, false);
+        m_maxMessageBytes = m_configuration->getPropertyAsInteger("EPICS_PVA_MAX_MESSAGE_BYTES", m_maxMessageBytes);
+        if (m_maxMessageBytes < 0)
+            m_maxMessageBytes = 0;
     }
 
     void internalInitialize() {
 
         osiSockAttach();
         m_timer.reset(new Timer("pvAccess-client timer", lowPriority));
+
+        if (m_ioThreads > 0)
+        {
+            if (detail::TransportReactor::isSupported())
+                m_reactor.reset(new detail::TransportReactor(m_ioThreads, "PVA-io"));
+            else
+            {
+                LOG(logLevelWarn, "EPICS_PVA_IO_THREADS ignored, I/O reactor not supported on this target");
+                m_ioThreads = 0;
+            }
+        }
+
+        if (m_udpDispatch)
+        {
+            if (detail::TransportReactor::isSupported())
+                m_udpDispatcher.reset(new detail::UDPDispatcher("PVA-udp"));
+            else
+            {
+                LOG(logLevelWarn, "EPICS_PVA_UDP_DISPATCH ignored, not supported on this target");
+                m_udpDispatch = false;
+            }
+        }
+
         InternalClientContextImpl::shared_pointer thisPointer(internal_from_this());
         // stores weak_ptr
-        m_connector.reset(new BlockingTCPConnector(thisPointer, m_receiveBufferSize, m_connectionTimeout));
+        m_connector.reset(new BlockingTCPConnector(thisPointer, m_receiveBufferSize, m_connectionTimeout,
+                                                 m_socketOptions));
 
         // stores many weak_ptr
         m_responseHandler.reset(new ClientResponseHandler(thisPointer));
 
-        m_channelSearchManager.reset(new ChannelSearchManager(thisPointer));
+        m_channelSearchManager.reset(new ChannelSearchManager(thisPointer, m_searchMaxPPS, m_searchMTU,
+                                                          m_targetedSearch));
 
         // TODO put memory barrier here... (if not already called within a lock?)
 
@@ -4162,7 +4362,8 @@ private:
             epicsSocketDestroy (socket);
 
             initializeUDPTransports(false, m_udpTransports, ifaceList, m_responseHandler, m_searchTransport,
-                                    m_broadcastPort, m_autoAddressList, m_addressList, std::string());
+                                    m_broadcastPort, m_autoAddressList, m_addressList, std::string(),
+                                    m_udpBatch, m_udpDispatcher);
 
         }
 
@@ -4174,22 +4375,11 @@ private:
     }
 
     void destroyAllChannels() {
-        Lock guard(m_cidMapMutex);
-
-        int count = 0;
-        std::vector<ClientChannelImpl::weak_pointer> channels(m_channelsByCID.size());
-        for (CIDChannelMap::iterator iter = m_channelsByCID.begin();
-                iter != m_channelsByCID.end();
-                iter++)
-        {
-            channels[count++] = iter->second;
-        }
-
-        guard.unlock();
-
+        std::vector<ClientChannelImpl::weak_pointer> channels;
+        m_channelsByCID.values(channels);
 
         ClientChannelImpl::shared_pointer ptr;
-        for (int i = 0; i < count; i++)
+        for (size_t i = 0; i < channels.size(); i++)
         {
             ptr = channels[i].lock();
             if (ptr)
@@ -4227,8 +4417,8 @@ private:
      */
     void registerChannel(ClientChannelImpl::shared_pointer const & channel) OVERRIDE FINAL
     {
-        Lock guard(m_cidMapMutex);
-        m_channelsByCID[channel->getChannelID()] = ClientChannelImpl::weak_pointer(channel);
+        if (!m_channelsByCID.set(channel->getChannelID(), channel))
+            LOG(logLevelError, "registerChannel() for CID %d not generated", channel->getChannelID());
     }
 
     /**
@@ -4237,7 +4427,6 @@ private:
      */
     void unregisterChannel(ClientChannelImpl::shared_pointer const & channel) OVERRIDE FINAL
     {
-        Lock guard(m_cidMapMutex);
         m_channelsByCID.erase(channel->getChannelID());
     }
 
@@ -4248,9 +4437,7 @@ private:
      */
     Channel::shared_pointer getChannel(pvAccessID channelID) OVERRIDE FINAL
     {
-        Lock guard(m_cidMapMutex);
-        CIDChannelMap::iterator it = m_channelsByCID.find(channelID);
-        return (it == m_channelsByCID.end() ? Channel::shared_pointer() : static_pointer_cast<Channel>(it->second.lock()));
+        return static_pointer_cast<Channel>(m_channelsByCID.find(channelID).lock());
     }
 
     /**
@@ -4259,13 +4446,7 @@ private:
      */
     pvAccessID generateCID()
     {
-        Lock guard(m_cidMapMutex);
-
-        // search first free (theoretically possible loop of death)
-        while (m_channelsByCID.find(++m_lastCID) != m_channelsByCID.end()) ;
-        // reserve CID
-        m_channelsByCID[m_lastCID].reset();
-        return m_lastCID;
+        return m_channelsByCID.reserve();
     }
 
     /**
@@ -4273,7 +4454,6 @@ private:
      */
     void freeCID(int cid)
     {
-        Lock guard(m_cidMapMutex);
         m_channelsByCID.erase(cid);
     }
 
@@ -4285,10 +4465,7 @@ private:
      */
     ResponseRequest::shared_pointer getResponseRequest(pvAccessID ioid) OVERRIDE FINAL
     {
-        Lock guard(m_ioidMapMutex);
-        IOIDResponseRequestMap::iterator it = m_pendingResponseRequests.find(ioid);
-        if (it == m_pendingResponseRequests.end()) return ResponseRequest::shared_pointer();
-        return it->second.lock();
+        return m_pendingResponseRequests.find(ioid).lock();
     }
 
     /**
@@ -4298,10 +4475,7 @@ private:
      */
     pvAccessID registerResponseRequest(ResponseRequest::shared_pointer const & request) OVERRIDE FINAL
     {
-        Lock guard(m_ioidMapMutex);
-        pvAccessID ioid = generateIOID();
-        m_pendingResponseRequests[ioid] = ResponseRequest::weak_pointer(request);
-        return ioid;
+        return m_pendingResponseRequests.insert(request);
     }
 
     /**
@@ -4313,41 +4487,31 @@ private:
     {
         if (ioid == INVALID_IOID) return ResponseRequest::shared_pointer();
 
-        Lock guard(m_ioidMapMutex);
-        IOIDResponseRequestMap::iterator it = m_pendingResponseRequests.find(ioid);
-        if (it == m_pendingResponseRequests.end())
-            return ResponseRequest::shared_pointer();
-
-        ResponseRequest::shared_pointer retVal = it->second.lock();
-        m_pendingResponseRequests.erase(it);
-        return retVal;
+        return m_pendingResponseRequests.erase(ioid).lock();
     }
 
     /**
-     * Generate IOID.
-     * @return IOID.
+     * Called each time beacon anomaly is detected.
      */
-    pvAccessID generateIOID()
+    virtual void newServerDetected() OVERRIDE FINAL
     {
-        Lock guard(m_ioidMapMutex);
-
-        // search first free (theoretically possible loop of death)
-        do {
-            while (m_pendingResponseRequests.find(++m_lastIOID) != m_pendingResponseRequests.end()) ;
-        } while (m_lastIOID == INVALID_IOID);
-
-        // reserve IOID
-        m_pendingResponseRequests[m_lastIOID].reset();
-        return m_lastIOID;
+        if (m_channelSearchManager)
+            m_channelSearchManager->newServerDetected();
     }
 
     /**
-     * Called each time beacon anomaly is detected.
+     * Called when a beacon shows a server started or restarted.
      */
-    virtual void newServerDetected() OVERRIDE FINAL
+    virtual void serverRestarted(const ServerGUID& guid, const osiSockAddr& serverAddress) OVERRIDE FINAL
     {
-        if (m_channelSearchManager)
-            m_channelSearchManager->newServerDetected();
+        if (!m_channelSearchManager)
+            return;
+
+        // searched at the UDP broadcast port, as for $EPICS_PVA_ADDR_LIST entries without a port
+        osiSockAddr searchAddress(serverAddress);
+        searchAddress.ia.sin_port = htons((unsigned short)m_broadcastPort);
+
+        m_channelSearchManager->serverRestarted(guid, serverAddress, searchAddress);
     }
 
     /**
@@ -4465,6 +4629,57 @@ private:
      */
     int m_receiveBufferSize;
 
+    /**
+     * Number of I/O reactor threads servicing all TCP connections.
+     * Zero to use a receive and send thread per connection.
+     */
+    int m_ioThreads;
+
+    /**
+     * I/O reactor, if m_ioThreads>0.
+     */
+    std::tr1::shared_ptr<detail::TransportReactor> m_reactor;
+
+    /**
+     * Datagrams received per system call by UDP transports.
+     * 0 or 1 receives one at a time.
+     */
+    int m_udpBatch;
+
+    /**
+     * Receive on all UDP sockets with one UDPDispatcher thread.
+     */
+    bool m_udpDispatch;
+    std::tr1::shared_ptr<detail::UDPDispatcher> m_udpDispatcher;
+
+    /**
+     * Limit on search frames sent per second.
+     * 0 for no limit.
+     */
+    double m_searchMaxPPS;
+
+    /**
+     * MTU of the network carrying search requests.  Each search datagram is filled up to this size.
+     */
+    int32 m_searchMTU;
+
+    /**
+     * When a beacon shows a server restarted, only re-search the channels it served
+     * (by unicast to that server), instead of boosting the search of all channels.
+     */
+    bool m_targetedSearch;
+
+    /**
+     * Options applied to TCP sockets.
+     */
+    TCPSocketOptions m_socketOptions;
+
+    /**
+     * Largest message payload accepted or sent without segmentation, when the server agrees.
+     * 0 to always segment at the buffer size.  Applied by each transport.
+     */
+    int32 m_maxMessageBytes;
+
     /**
      * Timer.
      */
@@ -4497,36 +4712,14 @@ private:
     ClientResponseHandler::shared_pointer m_responseHandler;
 
     /**
-     * Map of channels (keys are CIDs).
-     */
-    // TODO consider std::unordered_map
-    typedef std::map<pvAccessID, ClientChannelImpl::weak_pointer> CIDChannelMap;
-    CIDChannelMap m_channelsByCID;
-
-    /**
-     *  CIDChannelMap mutex.
-     */
-    Mutex m_cidMapMutex;
-
-    /**
-     * Last CID cache.
-     */
-    pvAccessID m_lastCID;
-
-    /**
-     * Map of pending response requests (keys are IOID).
-     */
-    IOIDResponseRequestMap m_pendingResponseRequests;
-
-    /**
-     *  IOIDResponseRequestMap mutex.
+     * Table of channels (keys are CIDs).  Allocates CIDs.
      */
-    Mutex m_ioidMapMutex;
+    SlotTable<ClientChannelImpl::weak_pointer> m_channelsByCID;
 
     /**
-     * Last IOID cache.
+     * Table of pending response requests (keys are IOID).  Allocates IOIDs.
      */
-    pvAccessID m_lastIOID;
+    SlotTable<ResponseRequest::weak_pointer> m_pendingResponseRequests;
 
     /**
      * Channel search manager.
@@ -58,6 +58,9 @@ public:
     static epics::pvData::Status channelDestroyed;
     static epics::pvData::Status channelDisconnected;
 
+    //! Send queue group of this channel and its requests
+    SendGroup sendGroup;
+
 };
 
 class ClientContextImpl : public Context
@@ -12,6 +12,9 @@
 #   undef epicsExportSharedSymbols
 #endif
 
+#include <string>
+#include <vector>
+
 #include <pv/sharedPtr.h>
 
 #ifdef rpcServerEpicsExportSharedSymbols
@@ -31,7 +34,14 @@ namespace pvAccess {
 class ServerContext;
 class RPCChannelProvider;
 
-//! Serves (only) RPCServiceAsync and RPCService instances.
+/** Serves (only) RPCServiceAsync and RPCService instances.
+ *
+ * RPCService::request() is called by a pool of $EPICS_PVAS_RPC_THREADS worker threads
+ * (default 4), so that a slow service does not delay other messages from a client.
+ * By default, a service may not occupy every worker (see registerService()).
+ * With 0, it is called by the receiving thread of the client connection.
+ * RPCServiceAsync::request() is always called by that receiving thread.
+ */
 class epicsShareClass RPCServer :
     public std::tr1::enable_shared_from_this<RPCServer>
 {
@@ -43,12 +53,50 @@ private:
 public:
     POINTER_DEFINITIONS(RPCServer);
 
+    //! Limits on the requests of an RPCService.  Zero for no limit.
+    struct ServiceLimits {
+        //! requests executed at once by the worker pool
+        size_t maxConcurrent;
+        //! requests waiting for a worker.  Beyond this, requests fail.
+        size_t maxQueue;
+        ServiceLimits() :maxConcurrent(0u), maxQueue(0u) {}
+    };
+
+    //! Default ServiceLimits::maxQueue
+    static const size_t defaultMaxQueue = 100u;
+
+    //! Number of latency histogram bins.
+    static const size_t nLatencyBins = 6;
+    //! Upper bound of each latency bin, except the last, in seconds (1ms, 10ms, ..., 10s)
+    static const double latencyBins[nLatencyBins-1];
+
+    //! Counters of one registered service
+    struct ServiceStats {
+        std::string name;
+        //! requests now executing, or waiting for a worker
+        size_t running, queued;
+        //! requests completed, and refused because the queue was full
+        size_t completed, rejected;
+        //! completed requests by the time from receipt to completion.  See latencyBins.
+        size_t latency[nLatencyBins];
+        //! longest time from receipt to completion, in seconds
+        double latencyMax;
+    };
+
     explicit RPCServer(const Configuration::const_shared_pointer& conf = Configuration::const_shared_pointer());
 
     virtual ~RPCServer();
 
+    /** Register with default limits.  At most one less than the number of workers
+     *  (but at least one) execute requests to this service at once, and at most
+     *  defaultMaxQueue requests wait.
+     */
     void registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service);
 
+    //! Register with limits, which only apply to an RPCService executed by the worker pool.
+    void registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service,
+                         ServiceLimits const & limits);
+
     void unregisterService(std::string const & serviceName);
 
     void run(int seconds = 0);
@@ -64,9 +112,19 @@ public:
      */
     void printInfo();
 
+    //! Counters of each registered service.  Also available from the "server" channel with op=rpc
+    void stats(std::vector<ServiceStats>& stats) const;
+
     const std::tr1::shared_ptr<ServerContext>& getServer() const { return m_serverContext; }
 };
 
+/** Counters of the services of an RPCServer.
+ *
+ * @returns false if provider does not belong to an RPCServer.
+ */
+epicsShareFunc bool getRPCServiceStats(ChannelProvider::shared_pointer const & provider,
+                                       std::vector<RPCServer::ServiceStats>& stats);
+
 epicsShareFunc Channel::shared_pointer createRPCChannel(ChannelProvider::shared_pointer const & provider,
         std::string const & channelName,
         ChannelRequester::shared_pointer const & channelRequester,
@@ -6,19 +6,249 @@
 
 #include <stdexcept>
 #include <vector>
+#include <deque>
 #include <utility>
 
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
 #define epicsExportSharedSymbols
 #include <pv/rpcServer.h>
 #include <pv/serverContextImpl.h>
 #include <pv/wildcard.h>
+#include <pv/logger.h>
 
 using namespace epics::pvData;
 using std::string;
 
+typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
+
 namespace epics {
 namespace pvAccess {
 
+const size_t RPCServer::nLatencyBins;
+const size_t RPCServer::defaultMaxQueue;
+const double RPCServer::latencyBins[RPCServer::nLatencyBins-1] = {1e-3, 1e-2, 1e-1, 1.0, 10.0};
+
+// A registered service, with its limits and counters
+struct RPCServiceEntry
+{
+    POINTER_DEFINITIONS(RPCServiceEntry);
+
+    const string name;
+    const RPCServiceAsync::shared_pointer service;
+    // non-NULL if requests may be executed by RPCWorkers
+    const RPCService::shared_pointer syncService;
+    const RPCServer::ServiceLimits limits;
+
+    epics::pvData::Mutex mutex;
+    // guarded by mutex
+    RPCServer::ServiceStats stats;
+
+    RPCServiceEntry(string const & name,
+                    RPCServiceAsync::shared_pointer const & service,
+                    RPCServer::ServiceLimits const & limits)
+        :name(name)
+        ,service(service)
+        ,syncService(std::tr1::dynamic_pointer_cast<RPCService>(service))
+        ,limits(limits)
+    {
+        stats.name = name;
+        stats.running = stats.queued = 0u;
+        stats.completed = stats.rejected = 0u;
+        for(size_t i=0; i<RPCServer::nLatencyBins; i++)
+            stats.latency[i] = 0u;
+        stats.latencyMax = 0.0;
+    }
+
+    void completed(double latency)
+    {
+        size_t bin = 0u;
+        while(bin<RPCServer::nLatencyBins-1 && latency>=RPCServer::latencyBins[bin])
+            bin++;
+
+        Lock guard(mutex);
+        stats.completed++;
+        stats.latency[bin]++;
+        if(stats.latencyMax < latency)
+            stats.latencyMax = latency;
+    }
+};
+
+// Worker threads which call RPCService::request()
+class RPCWorkers : public epicsThreadRunable
+{
+public:
+    POINTER_DEFINITIONS(RPCWorkers);
+
+    struct Job {
+        RPCServiceEntry::shared_pointer entry;
+        PVStructure::shared_pointer args;
+        RPCResponseCallback::shared_pointer callback;
+    };
+
+    explicit RPCWorkers(size_t nworkers)
+        :stopping(false)
+    {
+        threads.reserve(nworkers);
+        for(size_t i=0; i<nworkers; i++) {
+            threads.push_back(new epicsThread(*this, "RPCWorker",
+                                              epicsThreadGetStackSize(epicsThreadStackBig),
+                                              epicsThreadPriorityMedium));
+            threads.back()->start();
+        }
+    }
+
+    virtual ~RPCWorkers()
+    {
+        stop();
+        for(size_t i=0; i<threads.size(); i++)
+            delete threads[i];
+    }
+
+    enum Submitted {
+        Queued,
+        QueueFull, // of this service
+        Stopped
+    };
+
+    Submitted submit(const Job& job)
+    {
+        {
+            Guard G(mutex);
+            if(stopping)
+                return Stopped;
+            {
+                Lock guard(job.entry->mutex);
+                if(job.entry->limits.maxQueue && job.entry->stats.queued>=job.entry->limits.maxQueue) {
+                    job.entry->stats.rejected++;
+                    return QueueFull;
+                }
+                job.entry->stats.queued++;
+            }
+            pending.push_back(job);
+        }
+        wakeup.signal();
+        return Queued;
+    }
+
+    void stop()
+    {
+        std::deque<Job> dropped;
+        {
+            Guard G(mutex);
+            if(stopping)
+                return;
+            stopping = true;
+            dropped.swap(pending);
+        }
+        wakeup.signal();
+        for(size_t i=0; i<threads.size(); i++)
+            threads[i]->exitWait();
+
+        for(size_t i=0; i<dropped.size(); i++) {
+            {
+                Lock guard(dropped[i].entry->mutex);
+                dropped[i].entry->stats.queued--;
+            }
+            dropped[i].callback->requestDone(stoppedStatus, PVStructure::shared_pointer());
+        }
+    }
+
+    size_t size() const { return threads.size(); }
+
+    static const Status stoppedStatus;
+
+    virtual void run()
+    {
+        Guard G(mutex);
+        while(!stopping) {
+            Job job;
+            if(!take(job)) {
+                UnGuard U(G);
+                wakeup.wait();
+                continue;
+            }
+            if(!pending.empty())
+                wakeup.signal(); // maybe another worker can start one
+
+            {
+                UnGuard U(G);
+
+                execute(job);
+                // release outside of our lock
+                job = Job();
+            }
+            if(!pending.empty())
+                wakeup.signal(); // maybe one was held back by maxConcurrent
+        }
+        // wake the next worker to exit
+        wakeup.signal();
+    }
+
+private:
+    // first request whose service has fewer than maxConcurrent running
+    bool take(Job& job)
+    {
+        for(std::deque<Job>::iterator it(pending.begin()), end(pending.end()); it!=end; ++it) {
+            RPCServiceEntry& entry = *it->entry;
+            Lock guard(entry.mutex);
+            if(entry.limits.maxConcurrent && entry.stats.running>=entry.limits.maxConcurrent)
+                continue;
+            entry.stats.queued--;
+            entry.stats.running++;
+            job = *it;
+            pending.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    static void execute(const Job& job)
+    {
+        PVStructure::shared_pointer ret;
+        Status sts;
+        try {
+            ret = job.entry->syncService->request(job.args);
+            if(!ret)
+                sts = Status(Status::STATUSTYPE_FATAL, "RPCService.request(PVStructure) returned null.");
+        }catch(RPCRequestException& e){
+            sts = e.asStatus();
+        }catch(std::exception& e){
+            sts = Status(Status::STATUSTYPE_FATAL, e.what());
+        }catch(...){
+            sts = Status(Status::STATUSTYPE_FATAL,
+                         "Unexpected exception caught while calling RPCService.request(PVStructure).");
+        }
+        {
+            Lock guard(job.entry->mutex);
+            job.entry->stats.running--;
+        }
+        try {
+            job.callback->requestDone(sts, ret);
+        }catch(std::exception& e){
+            LOG(logLevelError, "Unhandled exception completing RPC request to %s: %s",
+                job.entry->name.c_str(), e.what());
+        }
+    }
+
+    epicsMutex mutex;
+    epicsEvent wakeup;
+    // guarded by mutex
+    bool stopping;
+    std::deque<Job> pending;
+
+    std::vector<epicsThread*> threads;
+
+    RPCWorkers(const RPCWorkers&);
+    RPCWorkers& operator=(const RPCWorkers&);
+};
+
+const Status RPCWorkers::stoppedStatus(Status::STATUSTYPE_ERROR, "RPC server stopped");
+
 
 class ChannelRPCServiceImpl :
     public ChannelRPC,
@@ -30,17 +260,28 @@ private:
     ChannelRPCRequester::shared_pointer m_channelRPCRequester;
     RPCServiceAsync::shared_pointer m_rpcService;
     AtomicBoolean m_lastRequest;
+    // NULL for the "server" channel
+    RPCServiceEntry::shared_pointer m_entry;
+    // NULL when RPCService is called inline
+    RPCWorkers::shared_pointer m_workers;
+    // time of the request in progress
+    epicsTimeStamp m_start;
 
 public:
     ChannelRPCServiceImpl(
         Channel::shared_pointer const & channel,
         ChannelRPCRequester::shared_pointer const & channelRPCRequester,
-        RPCServiceAsync::shared_pointer const & rpcService) :
+        RPCServiceAsync::shared_pointer const & rpcService,
+        RPCServiceEntry::shared_pointer const & entry = RPCServiceEntry::shared_pointer(),
+        RPCWorkers::shared_pointer const & workers = RPCWorkers::shared_pointer()) :
         m_channel(channel),
         m_channelRPCRequester(channelRPCRequester),
         m_rpcService(rpcService),
-        m_lastRequest()
+        m_lastRequest(),
+        m_entry(entry),
+        m_workers(workers)
     {
+        m_start.secPastEpoch = m_start.nsec = 0u;
     }
 
     virtual ~ChannelRPCServiceImpl()
@@ -53,6 +294,13 @@ public:
         epics::pvData::PVStructure::shared_pointer const & result
     )
     {
+        if (m_entry)
+        {
+            epicsTimeStamp now;
+            epicsTimeGetCurrent(&now);
+            m_entry->completed(epicsTimeDiffInSeconds(&now, &m_start));
+        }
+
         m_channelRPCRequester->requestDone(status, shared_from_this(), result);
 
         if (m_lastRequest.get())
@@ -61,6 +309,29 @@ public:
 
     virtual void request(epics::pvData::PVStructure::shared_pointer const & pvArgument)
     {
+        epicsTimeGetCurrent(&m_start);
+
+        if (m_workers && m_entry->syncService)
+        {
+            RPCWorkers::Job job;
+            job.entry = m_entry;
+            job.args = pvArgument;
+            job.callback = shared_from_this();
+            RPCWorkers::Submitted result = m_workers->submit(job);
+            if (result != RPCWorkers::Queued)
+            {
+                Status errorStatus(result == RPCWorkers::Stopped ?
+                                   RPCWorkers::stoppedStatus :
+                                   Status(Status::STATUSTYPE_ERROR, "too many requests queued for " + m_entry->name));
+
+                m_channelRPCRequester->requestDone(errorStatus, shared_from_this(), PVStructure::shared_pointer());
+
+                if (m_lastRequest.get())
+                    destroy();
+            }
+            return;
+        }
+
         try
         {
             m_rpcService->request(pvArgument, shared_from_this());
@@ -127,6 +398,8 @@ private:
     ChannelRequester::shared_pointer m_channelRequester;
 
     RPCServiceAsync::shared_pointer m_rpcService;
+    RPCServiceEntry::shared_pointer m_entry;
+    RPCWorkers::shared_pointer m_workers;
 
 public:
     POINTER_DEFINITIONS(RPCChannel);
@@ -135,11 +408,15 @@ public:
         ChannelProvider::shared_pointer const & provider,
         string const & channelName,
         ChannelRequester::shared_pointer const & channelRequester,
-        RPCServiceAsync::shared_pointer const & rpcService) :
+        RPCServiceAsync::shared_pointer const & rpcService,
+        RPCServiceEntry::shared_pointer const & entry = RPCServiceEntry::shared_pointer(),
+        RPCWorkers::shared_pointer const & workers = RPCWorkers::shared_pointer()) :
         m_provider(provider),
         m_channelName(channelName),
         m_channelRequester(channelRequester),
-        m_rpcService(rpcService)
+        m_rpcService(rpcService),
+        m_entry(entry),
+        m_workers(workers)
     {
     }
 
@@ -199,7 +476,7 @@ public:
 
         // TODO use std::make_shared
         std::tr1::shared_ptr<ChannelRPCServiceImpl> tp(
-            new ChannelRPCServiceImpl(shared_from_this(), channelRPCRequester, m_rpcService)
+            new ChannelRPCServiceImpl(shared_from_this(), channelRPCRequester, m_rpcService, m_entry, m_workers)
         );
         ChannelRPC::shared_pointer channelRPCImpl = tp;
         channelRPCRequester->channelRPCConnect(Status::Ok, channelRPCImpl);
@@ -252,11 +529,60 @@ public:
 
     static const Status noSuchChannelStatus;
 
-    // TODO thread pool support
-
     RPCChannelProvider() {
     }
 
+    virtual ~RPCChannelProvider() {
+        stop();
+    }
+
+    void start(size_t nworkers)
+    {
+        if (nworkers)
+            m_workers.reset(new RPCWorkers(nworkers));
+    }
+
+    void stop()
+    {
+        if (m_workers)
+            m_workers->stop();
+    }
+
+    size_t workerCount() const
+    {
+        return m_workers ? m_workers->size() : 0u;
+    }
+
+    // leave at least one worker for other services
+    RPCServer::ServiceLimits defaultLimits() const
+    {
+        RPCServer::ServiceLimits limits;
+        const size_t nworkers = workerCount();
+        limits.maxConcurrent = nworkers>1u ? nworkers-1u : 1u;
+        limits.maxQueue = RPCServer::defaultMaxQueue;
+        return limits;
+    }
+
+    void stats(std::vector<RPCServer::ServiceStats>& stats)
+    {
+        std::vector<RPCServiceEntry::shared_pointer> entries;
+        {
+            Lock guard(m_mutex);
+            entries.reserve(m_services.size());
+            for (RPCServiceMap::const_iterator iter = m_services.begin();
+                    iter != m_services.end();
+                    iter++)
+                entries.push_back(iter->second);
+        }
+
+        stats.resize(entries.size());
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            Lock guard(entries[i]->mutex);
+            stats[i] = entries[i]->stats;
+        }
+    }
+
     virtual string getProviderName() {
         return PROVIDER_NAME;
     }
@@ -311,19 +637,17 @@ public:
         ChannelRequester::shared_pointer const & channelRequester,
         short /*priority*/)
     {
-        RPCServiceAsync::shared_pointer service;
-
-        RPCServiceMap::const_iterator iter;
+        RPCServiceEntry::shared_pointer service;
         {
             Lock guard(m_mutex);
-            iter = m_services.find(channelName);
-        }
-        if (iter != m_services.end())
-            service = iter->second;
+            RPCServiceMap::const_iterator iter = m_services.find(channelName);
+            if (iter != m_services.end())
+                service = iter->second;
 
-        // check for wild services
-        if (!service)
-            service = findWildService(channelName);
+            // check for wild services
+            if (!service)
+                service = findWildService(channelName);
+        }
 
         if (!service)
         {
@@ -338,7 +662,9 @@ public:
                 shared_from_this(),
                 channelName,
                 channelRequester,
-                service));
+                service->service,
+                service,
+                m_workers));
         Channel::shared_pointer rpcChannel = tp;
         channelRequester->channelCreated(Status::Ok, rpcChannel);
         return rpcChannel;
@@ -354,13 +680,16 @@ public:
         throw std::runtime_error("not supported");
     }
 
-    void registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service)
+    void registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service,
+                         RPCServer::ServiceLimits const & limits)
     {
+        RPCServiceEntry::shared_pointer entry(new RPCServiceEntry(serviceName, service, limits));
+
         Lock guard(m_mutex);
-        m_services[serviceName] = service;
+        m_services[serviceName] = entry;
 
         if (isWildcardPattern(serviceName))
-            m_wildServices.push_back(std::make_pair(serviceName, service));
+            m_wildServices.push_back(std::make_pair(serviceName, entry));
     }
 
     void unregisterService(std::string const & serviceName)
@@ -383,7 +712,7 @@ public:
 
 private:
     // assumes sync on services
-    RPCServiceAsync::shared_pointer findWildService(string const & wildcard)
+    RPCServiceEntry::shared_pointer findWildService(string const & wildcard)
     {
         if (!m_wildServices.empty())
             for (RPCWildServiceList::iterator iter = m_wildServices.begin();
@@ -392,7 +721,7 @@ private:
                 if (Wildcard::wildcardfit(iter->first.c_str(), wildcard.c_str()))
                     return iter->second;
 
-        return RPCServiceAsync::shared_pointer();
+        return RPCServiceEntry::shared_pointer();
     }
 
     // (too) simple check
@@ -404,13 +733,15 @@ private:
              (pattern.find('[') != string::npos && pattern.find(']') != string::npos));
     }
 
-    typedef std::map<string, RPCServiceAsync::shared_pointer> RPCServiceMap;
+    typedef std::map<string, RPCServiceEntry::shared_pointer> RPCServiceMap;
     RPCServiceMap m_services;
 
-    typedef std::vector<std::pair<string, RPCServiceAsync::shared_pointer> > RPCWildServiceList;
+    typedef std::vector<std::pair<string, RPCServiceEntry::shared_pointer> > RPCWildServiceList;
     RPCWildServiceList m_wildServices;
 
     epics::pvData::Mutex m_mutex;
+
+    RPCWorkers::shared_pointer m_workers;
 };
 
 const string RPCChannelProvider::PROVIDER_NAME("rpcService");
@@ -420,6 +751,12 @@ const Status RPCChannelProvider::noSuchChannelStatus(Status::STATUSTYPE_ERROR, "
 RPCServer::RPCServer(const Configuration::const_shared_pointer &conf)
     :m_channelProviderImpl(new RPCChannelProvider)
 {
+    Configuration::const_shared_pointer config(conf);
+    if (!config)
+        config = ConfigurationBuilder().push_env().build();
+    int32 nworkers = config->getPropertyAsInteger("EPICS_PVAS_RPC_THREADS", 4);
+    m_channelProviderImpl->start(nworkers>0 ? size_t(nworkers) : 0u);
+
     m_serverContext = ServerContext::create(ServerContext::Config()
                                             .config(conf)
                                             .provider(m_channelProviderImpl));
@@ -435,6 +772,25 @@ void RPCServer::printInfo()
 {
     std::cout << m_serverContext->getVersion().getVersionString() << std::endl;
     m_serverContext->printInfo();
+
+    std::vector<ServiceStats> services;
+    stats(services);
+    std::cout << "RPC workers: " << m_channelProviderImpl->workerCount() << std::endl;
+    for (size_t i = 0; i < services.size(); i++)
+    {
+        const ServiceStats& S = services[i];
+        std::cout << "RPC service " << S.name
+                  << ": running " << S.running
+                  << ", queued " << S.queued
+                  << ", completed " << S.completed
+                  << ", rejected " << S.rejected
+                  << ", max latency " << S.latencyMax << " s" << std::endl;
+    }
+}
+
+void RPCServer::stats(std::vector<ServiceStats>& stats) const
+{
+    m_channelProviderImpl->stats(stats);
 }
 
 void RPCServer::run(int seconds)
@@ -476,11 +832,18 @@ void RPCServer::runInNewThread(int seconds)
 void RPCServer::destroy()
 {
     m_serverContext->shutdown();
+    m_channelProviderImpl->stop();
 }
 
 void RPCServer::registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service)
 {
-    m_channelProviderImpl->registerService(serviceName, service);
+    m_channelProviderImpl->registerService(serviceName, service, m_channelProviderImpl->defaultLimits());
+}
+
+void RPCServer::registerService(std::string const & serviceName, RPCServiceAsync::shared_pointer const & service,
+                                ServiceLimits const & limits)
+{
+    m_channelProviderImpl->registerService(serviceName, service, limits);
 }
 
 void RPCServer::unregisterService(std::string const & serviceName)
@@ -488,5 +851,15 @@ void RPCServer::unregisterService(std::string const & serviceName)
     m_channelProviderImpl->unregisterService(serviceName);
 }
 
+bool getRPCServiceStats(ChannelProvider::shared_pointer const & provider,
+                        std::vector<RPCServer::ServiceStats>& stats)
+{
+    RPCChannelProvider::shared_pointer rpc(std::tr1::dynamic_pointer_cast<RPCChannelProvider>(provider));
+    if (!rpc)
+        return false;
+    rpc->stats(stats);
+    return true;
+}
+
 }
 }
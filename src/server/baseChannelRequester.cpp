@@ -37,7 +37,8 @@ BaseChannelRequester::BaseChannelRequester(
     _context(context),
     _pendingRequest(BaseChannelRequester::NULL_REQUEST)
 {
-
+    if(channel)
+        setGroup(&channel->getSendGroup()); // _channel outlives any queueing
 }
 
 bool BaseChannelRequester::startRequest(int32 qos)
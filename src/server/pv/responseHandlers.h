@@ -146,6 +146,8 @@ public:
     ServerChannelFindRequesterImpl* set(std::string _name, epics::pvData::int32 searchSequenceId,
                                         epics::pvData::int32 cid, osiSockAddr const & sendTo, bool responseRequired, bool serverSearch);
     virtual void channelFindResult(const epics::pvData::Status& status, ChannelFind::shared_pointer const & channelFind, bool wasFound) OVERRIDE FINAL;
+    //! Respond with a result from the search cache, without asking providers.
+    void cachedResult(bool wasFound);
 
     virtual std::tr1::shared_ptr<const PeerInfo> getPeerInfo() OVERRIDE FINAL;
     virtual void send(epics::pvData::ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL;
@@ -167,6 +169,8 @@ private:
     const epics::pvData::int32 _expectedResponseCount;
     epics::pvData::int32 _responseCount;
     bool _serverSearch;
+    // search cache generation when providers were asked
+    const size_t _searchCacheGeneration;
 };
 
 /****************************************************************************************/
@@ -253,6 +257,12 @@ class ServerDestroyChannelHandlerTransportSender : public TransportSender
 public:
     ServerDestroyChannelHandlerTransportSender(pvAccessID cid, pvAccessID sid): _cid(cid), _sid(sid) {
     }
+    //! Sent after any queued messages of this channel
+    explicit ServerDestroyChannelHandlerTransportSender(const ServerChannel::shared_pointer& channel)
+        :_cid(channel->getCID()), _sid(channel->getSID()), _channel(channel)
+    {
+        setGroup(&channel->getSendGroup());
+    }
 
     virtual ~ServerDestroyChannelHandlerTransportSender() {}
     virtual void send(epics::pvData::ByteBuffer* buffer, TransportSendControl* control) OVERRIDE FINAL {
@@ -264,6 +274,8 @@ public:
 private:
     pvAccessID _cid;
     pvAccessID _sid;
+    // keeps the send group alive
+    ServerChannel::shared_pointer _channel;
 };
 
 /****************************************************************************************/
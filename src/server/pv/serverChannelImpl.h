@@ -42,6 +42,9 @@ public:
 
     pvAccessID getSID() const { return _sid; }
 
+    //! Send queue group of the requests of this channel
+    TransportSender::SendGroup& getSendGroup() { return _sendGroup; }
+
     void registerRequest(pvAccessID id, const std::tr1::shared_ptr<BaseChannelRequester>& request);
 
     void unregisterRequest(pvAccessID id);
@@ -72,6 +75,8 @@ private:
 
     bool _destroyed;
 
+    TransportSender::SendGroup _sendGroup;
+
     mutable epics::pvData::Mutex _mutex;
 };
 
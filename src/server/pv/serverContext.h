@@ -89,6 +89,22 @@ public:
 
     virtual const std::vector<ChannelProvider::shared_pointer>& getChannelProviders() =0;
 
+    /**
+     * Forget cached search results (see $EPICS_PVAS_SEARCH_CACHE_TTL).
+     * A ChannelProvider should call this when it begins, or stops, serving a channel
+     * so that the next search is passed to all providers.
+     * @param name Channel name, or empty to forget all names.
+     */
+    virtual void invalidateSearchCache(const std::string& name = std::string()) {}
+
+    /**
+     * Call invalidateSearchCache() of every ServerContext in this process.
+     * For use by a ChannelProvider which does not know the servers it is attached to.
+     * pvas::StaticProvider::add() and remove() call this.
+     * @param name Channel name, or empty to forget all names.
+     */
+    static void invalidateSearchCaches(const std::string& name = std::string());
+
     // ************************************************************************** //
     // **************************** [ Plugins ] ********************************* //
     // ************************************************************************** //
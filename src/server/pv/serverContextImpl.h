@@ -16,6 +16,7 @@
 #include <pv/blockingUDP.h>
 #include <pv/blockingTCP.h>
 #include <pv/beaconEmitter.h>
+#include <pv/reactor.h>
 
 #include "serverContext.h"
 
@@ -51,6 +52,7 @@ public:
     Transport::shared_pointer getSearchTransport() OVERRIDE FINAL;
     Configuration::const_shared_pointer getConfiguration() OVERRIDE FINAL;
     TransportRegistry* getTransportRegistry() OVERRIDE FINAL;
+    std::tr1::shared_ptr<detail::TransportReactor> getTransportReactor() OVERRIDE FINAL;
 
     virtual void newServerDetected() OVERRIDE FINAL;
 
@@ -76,6 +78,13 @@ public:
      */
     epics::pvData::int32 getReceiveBufferSize();
 
+    /**
+     * Get the maximum number of monitor updates of one subscription
+     * which are written to the send buffer in a single turn.
+     * @return batch size, at least 1.
+     */
+    size_t getMonitorBatchSize() const { return _monitorBatch; }
+
     /**
      * Get server port.
      * @return server port.
@@ -121,6 +130,40 @@ public:
     // used by ServerChannelFindRequesterImpl
     typedef std::map<std::string, std::tr1::weak_ptr<ChannelProvider> > s_channelNameToProvider_t;
     s_channelNameToProvider_t s_channelNameToProvider;
+
+    virtual void invalidateSearchCache(const std::string& name = std::string()) OVERRIDE FINAL;
+
+    enum SearchCacheResult {
+        SearchCacheMiss,     //!< not cached, or expired.  Ask providers
+        SearchCacheFound,    //!< served by a provider
+        SearchCacheNotFound  //!< no provider serves this name
+    };
+
+    /**
+     * Look up the result of a recent search for this channel name.
+     * Always a miss if $EPICS_PVAS_SEARCH_CACHE_TTL is zero.
+     * @param name Channel name.
+     * @param provider Set to the owning provider when found.
+     */
+    SearchCacheResult lookupSearchCache(const std::string& name, ChannelProvider::shared_pointer& provider);
+
+    /**
+     * Current search cache generation, incremented by invalidateSearchCache().
+     * Taken before providers are asked, and passed back to updateSearchCache().
+     */
+    size_t searchCacheGeneration() const;
+
+    /**
+     * Remember the result of a search.
+     * Ignored if the cache has been invalidated since the search started,
+     * as the result may already be stale.
+     * @param name Channel name.
+     * @param provider Owning provider, or NULL if no provider serves this name.
+     * @param generation searchCacheGeneration() when the search started.
+     */
+    void updateSearchCache(const std::string& name, const ChannelProvider::shared_pointer& provider, size_t generation);
+
+    bool isSearchCacheEnabled() const { return _searchCacheTTL>0.0; }
 private:
 
     /**
@@ -172,6 +215,52 @@ private:
      */
     epics::pvData::int32 _receiveBufferSize;
 
+    /**
+     * Number of I/O reactor threads servicing all TCP connections.
+     * Zero to use a receive and send thread per connection.
+     */
+    epics::pvData::int32 _ioThreads;
+
+    /**
+     * Maximum number of queued monitor updates sent per subscription turn.
+     * 1 sends one update per turn (no batching).
+     */
+    epics::pvData::int32 _monitorBatch;
+
+    /**
+     * Datagrams received per system call by UDP transports.
+     * 0 or 1 receives one at a time.
+     */
+    epics::pvData::int32 _udpBatch;
+
+    /**
+     * Receive on all UDP sockets with one UDPDispatcher thread.
+     */
+    bool _udpDispatch;
+
+    /**
+     * Seconds for which search results are cached.
+     * 0 passes every search to all providers.
+     */
+    double _searchCacheTTL;
+
+    /**
+     * Options applied to accepted TCP sockets.
+     */
+    TCPSocketOptions _socketOptions;
+
+    /**
+     * Largest message payload accepted or sent without segmentation, when the peer agrees.
+     * 0 to always segment at the buffer size.
+     */
+    epics::pvData::int32 _maxMessageBytes;
+
+    /**
+     * Output backpressure watermarks, in bytes queued to a client.
+     * Monitor updates are held back above the high, and resume below the low.  0 to disable.
+     */
+    epics::pvData::int32 _sendHighWater, _sendLowWater;
+
     epics::pvData::Timer::shared_pointer _timer;
 
     /**
@@ -197,6 +286,18 @@ private:
      */
     TransportRegistry _transportRegistry;
 
+    /**
+     * I/O reactor, if _ioThreads>0.
+     * constant after ServerContextImpl::initialize()
+     */
+    std::tr1::shared_ptr<detail::TransportReactor> _reactor;
+
+    /**
+     * UDP receive dispatcher, if _udpDispatch.
+     * constant after ServerContextImpl::initialize()
+     */
+    std::tr1::shared_ptr<detail::UDPDispatcher> _udpDispatcher;
+
     ResponseHandler::shared_pointer _responseHandler;
 
     // const after loadConfiguration()
@@ -208,6 +309,22 @@ private:
 
     epics::pvData::Event _runEvent;
 
+    struct SearchCacheEntry {
+        // empty if not found
+        std::tr1::weak_ptr<ChannelProvider> provider;
+        bool found;
+        epicsTimeStamp expires;
+    };
+    typedef std::map<std::string, SearchCacheEntry> searchCache_t;
+
+    // guards following members
+    mutable epics::pvData::Mutex _searchCacheMutex;
+    searchCache_t _searchCache;
+    size_t _searchCacheGeneration;
+    // when expired entries are next removed
+    epicsTimeStamp _searchCacheSweep;
+    size_t _searchCacheHits, _searchCacheMisses;
+
     /**
      * Beacon server status provider interface (optional).
      */
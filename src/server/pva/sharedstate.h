@@ -85,6 +85,9 @@ public:
     struct epicsShareClass Config {
         bool dropEmptyUpdates; //!< default true.  Drop updates which don't include an field values.
         epics::pvData::PVRequestMapper::mode_t mapperMode; //!< default Mask.  @see epics::pvData::PVRequestMapper::mode_t
+        //! default 2.  When post() reaches at least this many subscribers, each update is
+        //! encoded once for all subscribers with the same field mask.  0 to disable.
+        size_t fanoutMin;
         Config();
     };
 
@@ -165,6 +168,13 @@ public:
     void post(const epics::pvData::PVStructure& value,
               const epics::pvData::BitSet& changed);
 
+    //! As post(), without checking the type of value.
+    //! For producers which always post() a container from build(), or one with the type given to open().
+    //! @pre value.getStructure() is equal to the type given to open()
+    //! @throws std::logic_error if !isOpen()
+    void postUnchecked(const epics::pvData::PVStructure& value,
+                       const epics::pvData::BitSet& changed);
+
     //! Update arguments with current value, which is the initial value from open() with accumulated post() calls.
     void fetch(epics::pvData::PVStructure& value, epics::pvData::BitSet& valid);
 
@@ -182,6 +192,9 @@ public:
 
 private:
     void realClose(bool destroy, bool close, const epics::pvAccess::ChannelProvider* provider);
+    void realPost(const epics::pvData::PVStructure& value,
+                  const epics::pvData::BitSet& changed,
+                  bool check);
 
     friend void epics::pvAccess::providerRegInit(void*);
     static size_t num_instances;
@@ -201,6 +214,8 @@ private:
     typedef std::list<detail::SharedChannel*> channels_t;
 
     std::tr1::shared_ptr<const epics::pvData::Structure> type;
+    //! another instance found equal to type by a post().  Avoids repeating a deep compare.
+    std::tr1::shared_ptr<const epics::pvData::Structure> equalType;
 
     puts_t puts;
     rpcs_t rpcs;
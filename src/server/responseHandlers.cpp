@@ -351,6 +351,21 @@ void ServerSearchHandler::handleResponse(osiSockAddr* responseFrom,
 
             if (allowed)
             {
+                ChannelProvider::shared_pointer owner;
+                ServerContextImpl::SearchCacheResult cached = _context->lookupSearchCache(name, owner);
+
+                if (cached == ServerContextImpl::SearchCacheNotFound && !responseRequired)
+                {
+                    continue; // recently ignored
+                }
+                else if (cached != ServerContextImpl::SearchCacheMiss)
+                {
+                    std::tr1::shared_ptr<ServerChannelFindRequesterImpl> tp(new ServerChannelFindRequesterImpl(_context, info, 1));
+                    tp->set(name, searchSequenceId, cid, responseAddress, responseRequired, false);
+                    tp->cachedResult(cached == ServerContextImpl::SearchCacheFound);
+                    continue;
+                }
+
                 const std::vector<ChannelProvider::shared_pointer>& _providers = _context->getChannelProviders();
 
                 int providerCount = _providers.size();
@@ -390,7 +405,8 @@ ServerChannelFindRequesterImpl::ServerChannelFindRequesterImpl(ServerContextImpl
     _peer(peer),
     _expectedResponseCount(expectedResponseCount),
     _responseCount(0),
-    _serverSearch(false)
+    _serverSearch(false),
+    _searchCacheGeneration(context->searchCacheGeneration())
 {}
 
 void ServerChannelFindRequesterImpl::clear()
@@ -445,6 +461,15 @@ void ServerChannelFindRequesterImpl::channelFindResult(const Status& /*status*/,
         return;
     }
 
+    if (!_serverSearch && _context->isSearchCacheEnabled())
+    {
+        ChannelProvider::shared_pointer owner;
+        if (wasFound && channelFind && (owner = channelFind->getChannelProvider()))
+            _context->updateSearchCache(_name, owner, _searchCacheGeneration);
+        else if (!wasFound && !_wasFound && _responseCount == _expectedResponseCount)
+            _context->updateSearchCache(_name, ChannelProvider::shared_pointer(), _searchCacheGeneration);
+    }
+
     if (wasFound || (_responseRequired && (_responseCount == _expectedResponseCount)))
     {
         if (wasFound && _expectedResponseCount > 1)
@@ -463,6 +488,22 @@ void ServerChannelFindRequesterImpl::channelFindResult(const Status& /*status*/,
     }
 }
 
+void ServerChannelFindRequesterImpl::cachedResult(bool wasFound)
+{
+    {
+        Lock guard(_mutex);
+        _responseCount = _expectedResponseCount;
+        _wasFound = wasFound;
+    }
+
+    BlockingUDPTransport::shared_pointer bt = _context->getBroadcastTransport();
+    if (bt)
+    {
+        TransportSender::shared_pointer thisSender = shared_from_this();
+        bt->enqueueSendRequest(thisSender);
+    }
+}
+
 std::tr1::shared_ptr<const PeerInfo> ServerChannelFindRequesterImpl::getPeerInfo()
 {
     return _peer;
@@ -551,6 +592,7 @@ private:
     static Structure::const_shared_pointer helpStructure;
     static Structure::const_shared_pointer channelListStructure;
     static Structure::const_shared_pointer infoStructure;
+    static Structure::const_shared_pointer rpcStatsStructure;
 
     static const std::string helpString;
 
@@ -561,6 +603,14 @@ private:
         return s2.size() <= s1.size() && s1.compare(0, s2.size(), s2) == 0;
     }
 
+    // column of RPCServer::latencyBins[bin], eg. "lt10ms", or "ge10s" for the last
+    static const char* latencyColumn(size_t bin) {
+        static const char* const names[RPCServer::nLatencyBins] = {
+            "lt1ms", "lt10ms", "lt100ms", "lt1s", "lt10s", "ge10s"
+        };
+        return names[bin];
+    }
+
 public:
 
     ServerRPCService(ServerContextImpl::shared_pointer const & context) :
@@ -672,6 +722,62 @@ public:
             result->getSubFieldT<PVString>("startTime")->put(timeText);
 
 
+            return result;
+        }
+        else if (op == "rpc")
+        {
+            std::vector<RPCServer::ServiceStats> stats, providerStats;
+
+            const std::vector<ChannelProvider::shared_pointer>& providers = m_serverContext->getChannelProviders();
+            for (size_t i = 0; i < providers.size(); i++)
+            {
+                if (getRPCServiceStats(providers[i], providerStats))
+                    stats.insert(stats.end(), providerStats.begin(), providerStats.end());
+            }
+
+            const size_t N = stats.size();
+            PVStringArray::svector names(N);
+            PVULongArray::svector running(N), queued(N), completed(N), rejected(N);
+            PVDoubleArray::svector latencyMax(N);
+            std::vector<PVULongArray::svector> latency(RPCServer::nLatencyBins);
+            for (size_t b = 0; b < RPCServer::nLatencyBins; b++)
+                latency[b].resize(N);
+            for (size_t i = 0; i < N; i++)
+            {
+                names[i] = stats[i].name;
+                running[i] = stats[i].running;
+                queued[i] = stats[i].queued;
+                completed[i] = stats[i].completed;
+                rejected[i] = stats[i].rejected;
+                latencyMax[i] = stats[i].latencyMax;
+                for (size_t b = 0; b < RPCServer::nLatencyBins; b++)
+                    latency[b][i] = stats[i].latency[b];
+            }
+
+            PVStructure::shared_pointer result =
+                getPVDataCreate()->createPVStructure(rpcStatsStructure);
+
+            PVStringArray::svector labels;
+            labels.push_back("name");
+            labels.push_back("running");
+            labels.push_back("queued");
+            labels.push_back("completed");
+            labels.push_back("rejected");
+            labels.push_back("latencyMax");
+            for (size_t b = 0; b < RPCServer::nLatencyBins; b++)
+                labels.push_back(latencyColumn(b));
+            result->getSubFieldT<PVStringArray>("labels")->replace(freeze(labels));
+
+            PVStructure::shared_pointer value(result->getSubFieldT<PVStructure>("value"));
+            value->getSubFieldT<PVStringArray>("name")->replace(freeze(names));
+            value->getSubFieldT<PVULongArray>("running")->replace(freeze(running));
+            value->getSubFieldT<PVULongArray>("queued")->replace(freeze(queued));
+            value->getSubFieldT<PVULongArray>("completed")->replace(freeze(completed));
+            value->getSubFieldT<PVULongArray>("rejected")->replace(freeze(rejected));
+            value->getSubFieldT<PVDoubleArray>("latencyMax")->replace(freeze(latencyMax));
+            for (size_t b = 0; b < RPCServer::nLatencyBins; b++)
+                value->getSubFieldT<PVULongArray>(latencyColumn(b))->replace(freeze(latency[b]));
+
             return result;
         }
         else
@@ -704,6 +810,26 @@ Structure::const_shared_pointer ServerRPCService::infoStructure =
 //                add("CPUs", pvInt)->
     createStructure();
 
+Structure::const_shared_pointer ServerRPCService::rpcStatsStructure =
+    getFieldCreate()->createFieldBuilder()->
+    setId("epics:nt/NTTable:1.0")->
+    addArray("labels", pvString)->
+    addNestedStructure("value")->
+        addArray("name", pvString)->
+        addArray("running", pvULong)->
+        addArray("queued", pvULong)->
+        addArray("completed", pvULong)->
+        addArray("rejected", pvULong)->
+        addArray("latencyMax", pvDouble)->
+        addArray("lt1ms", pvULong)->
+        addArray("lt10ms", pvULong)->
+        addArray("lt100ms", pvULong)->
+        addArray("lt1s", pvULong)->
+        addArray("lt10s", pvULong)->
+        addArray("ge10s", pvULong)->
+    endNested()->
+    createStructure();
+
 
 const std::string ServerRPCService::helpString =
     "pvAccess server RPC service.\n"
@@ -713,6 +839,7 @@ const std::string ServerRPCService::helpString =
     "\toperations:\n"
     "\t\tinfo\t\treturns some information about the server\n"
     "\t\tchannels\treturns a list of 'static' channels the server can provide\n"
+    "\t\trpc\t\treturns a table of the requests to each RPC service, and their latency\n"
 //        "\t\t\t (no arguments)\n"
     "\n";
 
@@ -898,7 +1025,7 @@ void ServerChannelRequesterImpl::channelStateChange(Channel::shared_pointer cons
         transport->unregisterChannel(channel->getSID());
 
         // send response back
-        TransportSender::shared_pointer sr(new ServerDestroyChannelHandlerTransportSender(channel->getCID(), channel->getSID()));
+        TransportSender::shared_pointer sr(new ServerDestroyChannelHandlerTransportSender(channel));
         transport->enqueueSendRequest(sr);
     }
 }
@@ -1960,6 +2087,70 @@ Monitor::shared_pointer ServerMonitorRequesterImpl::getChannelMonitor()
     return _channelMonitor;
 }
 
+namespace {
+// Serializes into a growing std::vector, for an update to be sent to many subscribers
+struct FanoutEncoder : public SerializableControl
+{
+    ByteBuffer buf;
+    MonitorFanout::buffer_t out;
+
+    explicit FanoutEncoder(int byteOrder) :buf(16*1024, byteOrder) {}
+    virtual ~FanoutEncoder() {}
+
+    void drain() {
+        out.insert(out.end(), buf.getBuffer(), buf.getBuffer()+buf.getPosition());
+        buf.clear();
+    }
+
+    virtual void flushSerializeBuffer() OVERRIDE FINAL { drain(); }
+    virtual void ensureBuffer(std::size_t size) OVERRIDE FINAL {
+        if(buf.getRemaining() < size)
+            drain();
+    }
+    virtual void alignBuffer(std::size_t alignment) OVERRIDE FINAL { buf.align(alignment); }
+    virtual bool directSerialize(ByteBuffer*, const char*, std::size_t, std::size_t) OVERRIDE FINAL { return false; }
+    virtual void cachedSerialize(std::tr1::shared_ptr<const Field> const & field, ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        field->serialize(buffer, this);
+    }
+};
+
+// the encoding of element in the given byte order, shared with other subscribers
+MonitorFanout::encoded_t encodeFanout(const MonitorElement& element, int byteOrder)
+{
+    MonitorFanout::encoded_t ret(element.fanout->find(element, byteOrder));
+    if(!ret) {
+        FanoutEncoder enc(byteOrder);
+        element.changedBitSet->serialize(&enc.buf, &enc);
+        element.pvStructurePtr->serialize(&enc.buf, &enc, element.changedBitSet.get());
+        element.overrunBitSet->serialize(&enc.buf, &enc);
+        enc.drain();
+
+        std::tr1::shared_ptr<MonitorFanout::buffer_t> encoded(new MonitorFanout::buffer_t);
+        encoded->swap(enc.out);
+        ret = element.fanout->store(element, byteOrder, encoded);
+    }
+    return ret;
+}
+
+// copy an encoding into the send buffer
+void sendEncoded(const MonitorFanout::buffer_t& encoded, ByteBuffer* buffer, TransportSendControl* control)
+{
+    if(encoded.empty() || control->directSerialize(buffer, &encoded[0], encoded.size(), 1u))
+        return;
+
+    for(size_t pos=0u, N=encoded.size(); pos<N; ) {
+        const size_t count = std::min(N-pos, buffer->getRemaining());
+        if(count==0u) {
+            control->flushSerializeBuffer();
+            continue;
+        }
+        buffer->put(&encoded[pos], 0u, count);
+        pos += count;
+    }
+}
+} // namespace
+
 void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl* control)
 {
     const int32 request = getPendingRequest();
@@ -1989,28 +2180,49 @@ void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl*
         if (!monitor)
             return;
 
+        // While output is congested, leave updates in the monitor queue, where
+        // they are squashed.  We are re-queued once the socket has drained.
+        if (_transport->deferIfCongested(shared_from_this()))
+            return;
+
         // TODO asCheck ?
 
-        bool busy = false;
-        if(_pipeline) {
-            Lock guard(_mutex);
-            busy = _window_open==0;
-        }
+        // Write up to getMonitorBatchSize() queued updates as consecutive CMD_MONITOR
+        // messages, which then leave in a single flush.  Stop early once the send buffer
+        // has been flushed, or is half full, so that other senders get a turn.
+        const size_t batch = _context->getMonitorBatchSize();
+        const size_t startPosition = buffer->getPosition();
+        size_t nsent = 0u;
 
-        MonitorElement::Ref element;
-        if(!busy) {
-            MonitorElement::Ref E(monitor);
-            E.swap(element);
-        }
-        if (element)
+        while(nsent < batch)
         {
+            bool busy = false;
+            if(_pipeline) {
+                Lock guard(_mutex);
+                busy = _window_open==0;
+            }
+
+            MonitorElement::Ref element;
+            if(!busy) {
+                MonitorElement::Ref E(monitor);
+                E.swap(element);
+            }
+            if (!element)
+                break;
+
             control->startMessage((int8)CMD_MONITOR, sizeof(int32)/sizeof(int8) + 1);
             buffer->putInt(_ioid);
             buffer->putByte((int8)request);
 
             // changedBitSet and data, if not notify only (i.e. queueSize == -1)
             const BitSet::shared_pointer& changedBitSet = element->changedBitSet;
-            if (changedBitSet)
+            if (changedBitSet && element->fanout)
+            {
+                // same update as other subscribers.  encoded by the first to send it.
+                MonitorFanout::encoded_t encoded(encodeFanout(*element, buffer->getByteOrder()));
+                sendEncoded(*encoded, buffer, control);
+            }
+            else if (changedBitSet)
             {
                 changedBitSet->serialize(buffer, control);
                 element->pvStructurePtr->serialize(buffer, control, changedBitSet.get());
@@ -2019,6 +2231,9 @@ void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl*
                 element->overrunBitSet->serialize(buffer, control);
             }
 
+            control->endMessage();
+            nsent++;
+
             {
                 Lock guard(_mutex);
                 if(!_pipeline) {
@@ -2036,8 +2251,14 @@ void ServerMonitorRequesterImpl::send(ByteBuffer* buffer, TransportSendControl*
 
             element.reset(); // calls Monitor::release() if not swap()'d
 
-            // TODO if we try to proces several monitors at once, then fairness suffers
-            // TODO compbine several monitors into one message (reduces payload)
+            const size_t position = buffer->getPosition();
+            if(position < startPosition || position - startPosition >= buffer->getSize()/2u)
+                break;
+        }
+
+        if (nsent)
+        {
+            // re-queue to check for more updates after other senders have had a turn
             TransportSender::shared_pointer thisSender = shared_from_this();
             _transport->enqueueSendRequest(thisSender);
         }
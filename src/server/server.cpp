@@ -18,6 +18,7 @@
 #include "pva/server.h"
 #include "pv/pvAccess.h"
 #include "pv/security.h"
+#include "pv/serverContext.h"
 #include "pv/reftrack.h"
 
 namespace pvd = epics::pvData;
@@ -150,10 +151,13 @@ std::tr1::shared_ptr<epics::pvAccess::ChannelProvider> StaticProvider::provider(
 void StaticProvider::add(const std::string& name,
          const std::tr1::shared_ptr<ChannelBuilder>& builder)
 {
-    Guard G(impl->mutex);
-    if(impl->builders.find(name)!=impl->builders.end())
-        throw std::logic_error("Duplicate PV name");
-    impl->builders[name] = builder;
+    {
+        Guard G(impl->mutex);
+        if(impl->builders.find(name)!=impl->builders.end())
+            throw std::logic_error("Duplicate PV name");
+        impl->builders[name] = builder;
+    }
+    pva::ServerContext::invalidateSearchCaches(name);
 }
 
 std::tr1::shared_ptr<StaticProvider::ChannelBuilder> StaticProvider::remove(const std::string& name)
@@ -167,8 +171,10 @@ std::tr1::shared_ptr<StaticProvider::ChannelBuilder> StaticProvider::remove(cons
             impl->builders.erase(it);
         }
     }
-    if(ret)
+    if(ret) {
+        pva::ServerContext::invalidateSearchCaches(name);
         ret->disconnect(true, impl.get());
+    }
     return ret;
 }
 
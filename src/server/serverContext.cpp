@@ -4,7 +4,13 @@
  * in file LICENSE that is included with this distribution.
  */
 
+#include <set>
+
 #include <epicsSignal.h>
+#include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsAssert.h>
 
 #include <pv/lock.h>
 #include <pv/timer.h>
@@ -31,6 +37,40 @@ const Version ServerContextImpl::VERSION("pvAccess Server", "cpp",
 
 size_t ServerContextImpl::num_instances;
 
+namespace {
+// all live ServerContextImpl, for ServerContext::invalidateSearchCaches()
+struct ServerRegistry {
+    epicsMutex mutex;
+    std::set<ServerContextImpl*> servers;
+};
+ServerRegistry* serverRegistry;
+
+void serverRegistryInit(void*)
+{
+    serverRegistry = new ServerRegistry;
+}
+
+epicsThreadOnceId serverRegistryOnce = EPICS_THREAD_ONCE_INIT;
+
+ServerRegistry& getServerRegistry()
+{
+    epicsThreadOnce(&serverRegistryOnce, &serverRegistryInit, 0);
+    assert(serverRegistry);
+    return *serverRegistry;
+}
+} // namespace
+
+void ServerContext::invalidateSearchCaches(const std::string& name)
+{
+    ServerRegistry& reg = getServerRegistry();
+    epicsGuard<epicsMutex> G(reg.mutex);
+    for(std::set<ServerContextImpl*>::const_iterator it(reg.servers.begin()), end(reg.servers.end());
+        it!=end; ++it)
+    {
+        (*it)->invalidateSearchCache(name);
+    }
+}
+
 ServerContextImpl::ServerContextImpl():
     _beaconAddressList(),
     _ignoreAddressList(),
@@ -39,27 +79,48 @@ ServerContextImpl::ServerContextImpl():
     _broadcastPort(PVA_BROADCAST_PORT),
     _serverPort(PVA_SERVER_PORT),
     _receiveBufferSize(MAX_TCP_RECV),
+    _ioThreads(0),
+    _monitorBatch(1),
+    _udpBatch(0),
+    _udpDispatch(false),
+    _searchCacheTTL(0.0),
+    _maxMessageBytes(0),
+    _sendHighWater(0),
+    _sendLowWater(0),
     _timer(new Timer("PVAS timers", lowerPriority)),
     _beaconEmitter(),
     _acceptor(),
     _transportRegistry(),
     _channelProviders(),
     _beaconServerStatusProvider(),
-    _startTime()
+    _startTime(),
+    _searchCacheGeneration(0u),
+    _searchCacheHits(0u),
+    _searchCacheMisses(0u)
 {
     REFTRACE_INCREMENT(num_instances);
 
     epicsTimeGetCurrent(&_startTime);
+    _searchCacheSweep = _startTime;
 
     // TODO maybe there is a better place for this (when there will be some factory)
     epicsSignalInstallSigAlarmIgnore ();
     epicsSignalInstallSigPipeIgnore ();
 
     generateGUID();
+
+    ServerRegistry& reg = getServerRegistry();
+    epicsGuard<epicsMutex> G(reg.mutex);
+    reg.servers.insert(this);
 }
 
 ServerContextImpl::~ServerContextImpl()
 {
+    {
+        ServerRegistry& reg = getServerRegistry();
+        epicsGuard<epicsMutex> G(reg.mutex);
+        reg.servers.erase(this);
+    }
     try
     {
         shutdown();
@@ -146,6 +207,46 @@ void ServerContextImpl::loadConfiguration()
     _receiveBufferSize = config->getPropertyAsInteger("EPICS_PVA_MAX_ARRAY_BYTES", _receiveBufferSize);
     _receiveBufferSize = config->getPropertyAsInteger("EPICS_PVAS_MAX_ARRAY_BYTES", _receiveBufferSize);
 
+    _ioThreads = config->getPropertyAsInteger("EPICS_PVA_IO_THREADS", _ioThreads);
+    _ioThreads = config->getPropertyAsInteger("EPICS_PVAS_IO_THREADS", _ioThreads);
+    if(_ioThreads<0)
+        _ioThreads = 0;
+
+    _monitorBatch = config->getPropertyAsInteger("EPICS_PVAS_MONITOR_BATCH", _monitorBatch);
+    if(_monitorBatch<1)
+        _monitorBatch = 1;
+
+    _udpBatch = config->getPropertyAsInteger("EPICS_PVA_UDP_BATCH", _udpBatch);
+    _udpBatch = config->getPropertyAsInteger("EPICS_PVAS_UDP_BATCH", _udpBatch);
+    if(_udpBatch<0)
+        _udpBatch = 0;
+
+    _udpDispatch = config->getPropertyAsBoolean("EPICS_PVA_UDP_DISPATCH", _udpDispatch);
+    _udpDispatch = config->getPropertyAsBoolean("EPICS_PVAS_UDP_DISPATCH", _udpDispatch);
+
+    _searchCacheTTL = config->getPropertyAsDouble("EPICS_PVAS_SEARCH_CACHE_TTL", _searchCacheTTL);
+    if(_searchCacheTTL<0.0)
+        _searchCacheTTL = 0.0;
+
+    // shared by all servers
+    RoleCache::instance().configure(*config);
+
+    _socketOptions.load(config, true);
+
+    _maxMessageBytes = config->getPropertyAsInteger("EPICS_PVA_MAX_MESSAGE_BYTES", _maxMessageBytes);
+    _maxMessageBytes = config->getPropertyAsInteger("EPICS_PVAS_MAX_MESSAGE_BYTES", _maxMessageBytes);
+    if(_maxMessageBytes<0)
+        _maxMessageBytes = 0;
+
+    _sendHighWater = config->getPropertyAsInteger("EPICS_PVA_SEND_HIGH_WATER", _sendHighWater);
+    _sendHighWater = config->getPropertyAsInteger("EPICS_PVAS_SEND_HIGH_WATER", _sendHighWater);
+    if(_sendHighWater<0)
+        _sendHighWater = 0;
+    _sendLowWater = config->getPropertyAsInteger("EPICS_PVA_SEND_LOW_WATER", _sendLowWater);
+    _sendLowWater = config->getPropertyAsInteger("EPICS_PVAS_SEND_LOW_WATER", _sendLowWater);
+    if(_sendLowWater<0)
+        _sendLowWater = 0;
+
     if(_channelProviders.empty()) {
         std::string providers = config->getPropertyAsString("EPICS_PVAS_PROVIDER_NAMES", PVACCESS_DEFAULT_PROVIDER);
 
@@ -251,6 +352,32 @@ ServerContextImpl::getCurrentConfig()
 
     SET("EPICS_PVAS_PROVIDER_NAMES", providerName.str());
 
+    SET("EPICS_PVAS_IO_THREADS", _ioThreads);
+    SET("EPICS_PVA_IO_THREADS", _ioThreads);
+
+    SET("EPICS_PVAS_MONITOR_BATCH", _monitorBatch);
+
+    SET("EPICS_PVAS_UDP_BATCH", _udpBatch);
+    SET("EPICS_PVA_UDP_BATCH", _udpBatch);
+
+    SET("EPICS_PVAS_UDP_DISPATCH", _udpDispatch ? "YES" : "NO");
+    SET("EPICS_PVA_UDP_DISPATCH", _udpDispatch ? "YES" : "NO");
+
+    SET("EPICS_PVAS_SEARCH_CACHE_TTL", _searchCacheTTL);
+
+    SET("EPICS_PVAS_ROLES_CACHE_TTL", RoleCache::instance().timeToLive());
+
+    _socketOptions.save(B, true);
+    _socketOptions.save(B, false);
+
+    SET("EPICS_PVAS_MAX_MESSAGE_BYTES", _maxMessageBytes);
+    SET("EPICS_PVA_MAX_MESSAGE_BYTES", _maxMessageBytes);
+
+    SET("EPICS_PVAS_SEND_HIGH_WATER", _sendHighWater);
+    SET("EPICS_PVA_SEND_HIGH_WATER", _sendHighWater);
+    SET("EPICS_PVAS_SEND_LOW_WATER", _sendLowWater);
+    SET("EPICS_PVA_SEND_LOW_WATER", _sendLowWater);
+
 #undef SET
 
     return B.push_map().build();
@@ -273,12 +400,32 @@ void ServerContextImpl::initialize()
     // we create reference cycles here which are broken by our shutdown() method,
     _responseHandler.reset(new ServerResponseHandler(thisServerContext));
 
-    _acceptor.reset(new BlockingTCPAcceptor(thisServerContext, _responseHandler, _ifaceAddr, _receiveBufferSize));
+    if(_ioThreads>0) {
+        if(detail::TransportReactor::isSupported()) {
+            _reactor.reset(new detail::TransportReactor(_ioThreads, "PVAS-io"));
+        } else {
+            LOG(logLevelWarn, "EPICS_PVAS_IO_THREADS ignored, I/O reactor not supported on this target");
+            _ioThreads = 0;
+        }
+    }
+
+    _acceptor.reset(new BlockingTCPAcceptor(thisServerContext, _responseHandler, _ifaceAddr, _receiveBufferSize,
+                                           _socketOptions));
     _serverPort = ntohs(_acceptor->getBindAddress()->ia.sin_port);
 
+    if(_udpDispatch) {
+        if(detail::TransportReactor::isSupported()) {
+            _udpDispatcher.reset(new detail::UDPDispatcher("PVAS-udp"));
+        } else {
+            LOG(logLevelWarn, "EPICS_PVAS_UDP_DISPATCH ignored, not supported on this target");
+            _udpDispatch = false;
+        }
+    }
+
     // setup broadcast UDP transport
     initializeUDPTransports(true, _udpTransports, _ifaceList, _responseHandler, _broadcastTransport,
-                            _broadcastPort, _autoBeaconAddressList, _beaconAddressList, _ignoreAddressList);
+                            _broadcastPort, _autoBeaconAddressList, _beaconAddressList, _ignoreAddressList,
+                            _udpBatch, _udpDispatcher);
 
     _beaconEmitter.reset(new BeaconEmitter("tcp", _broadcastTransport, thisServerContext));
 
@@ -338,6 +485,13 @@ void ServerContextImpl::shutdown()
         _broadcastTransport.reset();
     }
 
+    // after all UDP transports are closed
+    if (_udpDispatcher)
+    {
+        _udpDispatcher->close();
+        _udpDispatcher.reset();
+    }
+
     // stop accepting connections
     if (_acceptor)
     {
@@ -349,6 +503,16 @@ void ServerContextImpl::shutdown()
     // this will also destroy all channels
     _transportRegistry.clear();
 
+    // after all transports are closed.  Transports created meanwhile by an accept in progress
+    // (cf. getTransportReactor()) see either the reactor, or none.
+    std::tr1::shared_ptr<detail::TransportReactor> reactor;
+    {
+        Lock guard(_mutex);
+        reactor.swap(_reactor);
+    }
+    if (reactor)
+        reactor->close();
+
     // drop timer queue
     LEAK_CHECK(_timer, "_timer")
     _timer.reset();
@@ -382,14 +546,51 @@ void ServerContextImpl::printInfo(ostream& str, int lvl)
         SHOW(EPICS_PVAS_BROADCAST_PORT)
         SHOW(EPICS_PVAS_SERVER_PORT)
         SHOW(EPICS_PVAS_PROVIDER_NAMES)
+        SHOW(EPICS_PVAS_IO_THREADS)
+        SHOW(EPICS_PVAS_MONITOR_BATCH)
+        SHOW(EPICS_PVAS_UDP_BATCH)
+        SHOW(EPICS_PVAS_UDP_DISPATCH)
+        SHOW(EPICS_PVAS_SEARCH_CACHE_TTL)
+        SHOW(EPICS_PVAS_SOCK_SNDBUF)
+        SHOW(EPICS_PVAS_SOCK_RCVBUF)
+        SHOW(EPICS_PVAS_SOCK_BUSY_POLL)
+        SHOW(EPICS_PVAS_SOCK_QUICKACK)
+        SHOW(EPICS_PVAS_SOCK_NOTSENT_LOWAT)
+        SHOW(EPICS_PVAS_MAX_MESSAGE_BYTES)
+        SHOW(EPICS_PVAS_SEND_HIGH_WATER)
+        SHOW(EPICS_PVAS_SEND_LOW_WATER)
 #undef SHOW
 
+        if(_acceptor)
+            str << "TCP socket options applied: "<<_acceptor->getAppliedSocketOptions()<<"\n";
+
+        if(isSearchCacheEnabled()) {
+            Lock G(_searchCacheMutex);
+            str << "Search cache: "<<_searchCache.size()<<" names, "
+                <<_searchCacheHits<<" hits, "<<_searchCacheMisses<<" misses\n";
+        }
+
+        {
+            RoleCache::Stats rstats;
+            RoleCache::instance().stats(rstats);
+            str << "Role cache: "<<rstats.entries<<" accounts, "
+                <<rstats.hits<<" hits, "<<rstats.misses<<" misses, "
+                <<rstats.refreshes<<" refreshed, "<<rstats.evictions<<" evicted, "
+                <<rstats.pending<<" pending (ttl "<<RoleCache::instance().timeToLive()<<" s)\n";
+        }
+
     } else {
         // lvl >= 1
 
         TransportRegistry::transportVector_t transports;
         _transportRegistry.toArray(transports);
 
+        std::tr1::shared_ptr<detail::TransportReactor> reactor(getTransportReactor());
+        if(reactor)
+            reactor->printInfo(str);
+        if(_udpDispatcher)
+            _udpDispatcher->printInfo(str);
+
         str<<"Clients:\n";
         for(TransportRegistry::transportVector_t::const_iterator it(transports.begin()), end(transports.end());
             it!=end; ++it)
@@ -433,6 +634,24 @@ void ServerContextImpl::printInfo(ostream& str, int lvl)
 
             str<<"\n";
 
+            if(casTransport) {
+                std::vector<fair_queue_stats> qstats;
+                casTransport->getSendQueueStats(qstats);
+                for(size_t i=0; i<qstats.size(); i++) {
+                    const fair_queue_stats& S = qstats[i];
+                    if(S.count==0u && S.depth==0u)
+                        continue;
+                    str<<"    send level "<<i<<": "<<S.count<<" sent, "<<S.starved<<" starved, "
+                       <<S.depth<<" queued, latency mean "<<S.latencyMean()*1e6
+                       <<" us, max "<<S.latencyMax*1e6<<" us\n";
+                }
+
+                size_t congested, deferred;
+                casTransport->getBackpressureStats(congested, deferred);
+                if(congested)
+                    str<<"    output congested "<<congested<<" times, "<<deferred<<" sends deferred\n";
+            }
+
             if(!casTransport || lvl<2)
                 return;
             // lvl >= 2
@@ -509,6 +728,81 @@ const std::vector<ChannelProvider::shared_pointer>& ServerContextImpl::getChanne
     return _channelProviders;
 }
 
+ServerContextImpl::SearchCacheResult ServerContextImpl::lookupSearchCache(const std::string& name, ChannelProvider::shared_pointer& provider)
+{
+    if(!isSearchCacheEnabled())
+        return SearchCacheMiss;
+
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+
+    Lock G(_searchCacheMutex);
+
+    searchCache_t::iterator it(_searchCache.find(name));
+    if(it!=_searchCache.end() && epicsTimeLessThan(&now, &it->second.expires)) {
+        if(!it->second.found) {
+            _searchCacheHits++;
+            return SearchCacheNotFound;
+        }
+        provider = it->second.provider.lock();
+        if(provider) {
+            _searchCacheHits++;
+            return SearchCacheFound;
+        }
+    }
+    if(it!=_searchCache.end())
+        _searchCache.erase(it); // expired, or provider gone
+    _searchCacheMisses++;
+    return SearchCacheMiss;
+}
+
+size_t ServerContextImpl::searchCacheGeneration() const
+{
+    Lock G(_searchCacheMutex);
+    return _searchCacheGeneration;
+}
+
+void ServerContextImpl::updateSearchCache(const std::string& name, const ChannelProvider::shared_pointer& provider, size_t generation)
+{
+    if(!isSearchCacheEnabled())
+        return;
+
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+
+    Lock G(_searchCacheMutex);
+
+    if(!epicsTimeLessThan(&now, &_searchCacheSweep)) {
+        // remove entries which no one has searched for since they expired
+        for(searchCache_t::iterator it(_searchCache.begin()), end(_searchCache.end()); it!=end;) {
+            searchCache_t::iterator cur(it++);
+            if(!epicsTimeLessThan(&now, &cur->second.expires))
+                _searchCache.erase(cur);
+        }
+        _searchCacheSweep = now;
+        epicsTimeAddSeconds(&_searchCacheSweep, _searchCacheTTL);
+    }
+
+    if(generation!=_searchCacheGeneration)
+        return; // invalidated while providers were asked
+
+    SearchCacheEntry& ent = _searchCache[name];
+    ent.provider = provider;
+    ent.found = !!provider;
+    ent.expires = now;
+    epicsTimeAddSeconds(&ent.expires, _searchCacheTTL);
+}
+
+void ServerContextImpl::invalidateSearchCache(const std::string& name)
+{
+    Lock G(_searchCacheMutex);
+    _searchCacheGeneration++;
+    if(name.empty())
+        _searchCache.clear();
+    else
+        _searchCache.erase(name);
+}
+
 Timer::shared_pointer ServerContextImpl::getTimer()
 {
     return _timer;
@@ -519,6 +813,13 @@ epics::pvAccess::TransportRegistry* ServerContextImpl::getTransportRegistry()
     return &_transportRegistry;
 }
 
+std::tr1::shared_ptr<detail::TransportReactor> ServerContextImpl::getTransportReactor()
+{
+    // called by transport constructors on the acceptor thread, while shutdown() may release it
+    Lock guard(_mutex);
+    return _reactor;
+}
+
 Channel::shared_pointer ServerContextImpl::getChannel(pvAccessID /*id*/)
 {
     // not used
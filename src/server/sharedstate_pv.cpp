@@ -55,6 +55,7 @@ void SharedPV::Handler::onRPC(const SharedPV::shared_pointer& pv, Operation& op)
 SharedPV::Config::Config()
     :dropEmptyUpdates(true)
     ,mapperMode(pvd::PVRequestMapper::Mask)
+    ,fanoutMin(2u)
 {}
 
 size_t SharedPV::num_instances;
@@ -159,6 +160,7 @@ void SharedPV::open(const pvd::PVStructure &value, const epics::pvData::BitSet&
         p_getfield.reserve(getfields.size());
 
         type = newtype;
+        equalType.reset();
         current = newvalue;
         this->valid = valid;
 
@@ -278,6 +280,7 @@ void SharedPV::realClose(bool destroy, bool closing, const epics::pvAccess::Chan
 
             if(closing) {
                 type.reset();
+                equalType.reset();
                 current.reset();
             }
         }
@@ -325,6 +328,19 @@ pvd::PVStructure::shared_pointer SharedPV::build()
 
 void SharedPV::post(const pvd::PVStructure& value,
                     const pvd::BitSet& changed)
+{
+    realPost(value, changed, true);
+}
+
+void SharedPV::postUnchecked(const pvd::PVStructure& value,
+                             const pvd::BitSet& changed)
+{
+    realPost(value, changed, false);
+}
+
+void SharedPV::realPost(const pvd::PVStructure& value,
+                        const pvd::BitSet& changed,
+                        bool check)
 {
     typedef std::vector<std::tr1::shared_ptr<pva::MonitorFIFO> > xmonitors_t;
     xmonitors_t p_monitor;
@@ -333,8 +349,15 @@ void SharedPV::post(const pvd::PVStructure& value,
 
         if(!type)
             throw std::logic_error("Not open()");
-        else if(*type!=*value.getStructure())
+
+        const pvd::StructureConstPtr& vtype(value.getStructure());
+        if(!check || vtype==type || vtype==equalType) {
+            // trusted, or the same instance as open() or a previous post()
+        } else if(*type!=*vtype) {
             throw std::logic_error("Type mis-match");
+        } else {
+            equalType = vtype;
+        }
 
         if(current) {
             current->copyUnchecked(value, changed);
@@ -343,8 +366,13 @@ void SharedPV::post(const pvd::PVStructure& value,
 
         p_monitor.reserve(monitors.size()); // ick, for lack of a list with thread-safe iteration
 
+        // shared by all subscribers, who will encode this update once
+        pva::MonitorFanout::shared_pointer fanout;
+        if(config.fanoutMin && monitors.size()>=config.fanoutMin)
+            fanout.reset(new pva::MonitorFanout);
+
         FOR_EACH(monitors_t::const_iterator, it, end, monitors) {
-            (*it)->post(value, changed);
+            (*it)->post(value, changed, pvd::BitSet(), fanout);
             p_monitor.push_back((*it)->shared_from_this());
         }
     }
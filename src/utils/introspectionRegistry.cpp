@@ -34,13 +34,15 @@ void IntrospectionRegistry::reset()
 {
     _pointer = 1;
     _registry.clear();
+    _pointerIndex.clear();
+    _hashIndex.clear();
 }
 
 int16 IntrospectionRegistry::registerIntrospectionInterface(FieldConstPtr const & field, bool& existing)
 {
     int16 key;
-    // TODO this is slow
-    if(registryContainsValue(field, key))
+    size_t fieldHash;
+    if(registryContainsValue(field, key, fieldHash))
     {
         existing = true;
     }
@@ -48,25 +50,120 @@ int16 IntrospectionRegistry::registerIntrospectionInterface(FieldConstPtr const
     {
         existing = false;
         key = _pointer++;
+
+        // key wrapped around, replace oldest entry
+        registryMap_t::iterator it(_registry.find(key));
+        if(it != _registry.end())
+            unindex(key, it->second);
+
         _registry[key] = field;
+        _pointerIndex[field.get()] = key;
+        _hashIndex.insert(std::make_pair(fieldHash, key));
     }
     return key;
 }
 
-// TODO slow !!!!
-bool IntrospectionRegistry::registryContainsValue(FieldConstPtr const & field, int16& key)
+bool IntrospectionRegistry::registryContainsValue(FieldConstPtr const & field, int16& key, size_t& fieldHash)
 {
-    for(registryMap_t::reverse_iterator registryRIter = _registry.rbegin(); registryRIter != _registry.rend(); registryRIter++)
+    // FieldCreate de-duplicates, so the common case is the same instance
+    pointerIndex_t::const_iterator pit(_pointerIndex.find(field.get()));
+    if(pit != _pointerIndex.end())
+    {
+        key = pit->second;
+        return true;
+    }
+
+    // an equal, but distinct, instance
+    fieldHash = hash(*field);
+    std::pair<hashIndex_t::const_iterator, hashIndex_t::const_iterator> range(_hashIndex.equal_range(fieldHash));
+    for(hashIndex_t::const_iterator it(range.first); it != range.second; ++it)
     {
-        if(*(field.get()) == *(registryRIter->second))
+        registryMap_t::const_iterator rit(_registry.find(it->second));
+        if(rit != _registry.end() && *field == *rit->second)
         {
-            key = registryRIter->first;
+            key = it->second;
             return true;
         }
     }
     return false;
 }
 
+void IntrospectionRegistry::unindex(int16 key, FieldConstPtr const & field)
+{
+    pointerIndex_t::iterator pit(_pointerIndex.find(field.get()));
+    if(pit != _pointerIndex.end() && pit->second == key)
+        _pointerIndex.erase(pit);
+
+    std::pair<hashIndex_t::iterator, hashIndex_t::iterator> range(_hashIndex.equal_range(hash(*field)));
+    for(hashIndex_t::iterator it(range.first); it != range.second; ++it)
+    {
+        if(it->second == key)
+        {
+            _hashIndex.erase(it);
+            break;
+        }
+    }
+}
+
+namespace {
+inline void hashCombine(size_t& seed, size_t value)
+{
+    seed ^= value + 0x9e3779b9u + (seed<<6) + (seed>>2);
+}
+
+void hashString(size_t& seed, const std::string& str)
+{
+    size_t h = 5381u;
+    for(size_t i=0, N=str.size(); i<N; i++)
+        h = h*33u + (unsigned char)str[i];
+    hashCombine(seed, h);
+}
+}
+
+size_t IntrospectionRegistry::hash(Field const & field)
+{
+    size_t seed = field.getType();
+    // includes scalar type, bounds, and structure/union ID
+    hashString(seed, field.getID());
+
+    switch(field.getType())
+    {
+    case structure:
+    {
+        const Structure& S(static_cast<const Structure&>(field));
+        const StringArray& names(S.getFieldNames());
+        const FieldConstPtrArray& fields(S.getFields());
+        for(size_t i=0, N=fields.size(); i<N; i++)
+        {
+            hashString(seed, names[i]);
+            hashCombine(seed, hash(*fields[i]));
+        }
+        break;
+    }
+    case union_:
+    {
+        const Union& U(static_cast<const Union&>(field));
+        const StringArray& names(U.getFieldNames());
+        const FieldConstPtrArray& fields(U.getFields());
+        for(size_t i=0, N=fields.size(); i<N; i++)
+        {
+            hashString(seed, names[i]);
+            hashCombine(seed, hash(*fields[i]));
+        }
+        break;
+    }
+    case structureArray:
+        hashCombine(seed, hash(*static_cast<const StructureArray&>(field).getStructure()));
+        break;
+    case unionArray:
+        hashCombine(seed, hash(*static_cast<const UnionArray&>(field).getUnion()));
+        break;
+    default:
+        break;
+    }
+    return seed;
+}
+
 void IntrospectionRegistry::serialize(FieldConstPtr const & field, ByteBuffer* buffer, SerializableControl* control)
 {
     if (field.get() == NULL)
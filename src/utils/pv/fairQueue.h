@@ -16,6 +16,7 @@
 
 #include <epicsEvent.h>
 #include <epicsMutex.h>
+#include <epicsTime.h>
 #include <epicsGuard.h>
 #include <ellLib.h>
 #include <dbDefs.h>
@@ -32,6 +33,21 @@
 namespace epics {
 namespace pvAccess {
 
+//! Queueing statistics of one priority level of a @class fair_queue
+struct fair_queue_stats {
+    //! Number of entries popped from this level
+    size_t count;
+    //! Number of pops from this level forced by the starvation bound
+    size_t starved;
+    //! Number of entries currently queued at this level
+    size_t depth;
+    //! Sum and maximum of time spent queued (seconds)
+    double latencySum, latencyMax;
+
+    fair_queue_stats() :count(0u), starved(0u), depth(0u), latencySum(0.0), latencyMax(0.0) {}
+
+    double latencyMean() const { return count ? latencySum/count : 0.0; }
+};
 
 /** @brief An intrusive, loss-less, unbounded, round-robin queue
  *
@@ -52,6 +68,21 @@ namespace pvAccess {
  *     this order.
  *     Adding [A, A, B, A, C, C] would give out [A, B, C, A, C, A].
  *
+ * @li Prioritized.  push_back() places an entry in one of NumLevels levels,
+ *     level 0 being the most urgent.  Entries are returned round robin
+ *     within a level, and from the most urgent non-empty level first.
+ *     A non-empty level passed over starvationLimit() times in a row
+ *     is served next regardless, so no level waits indefinitely.
+ *     Re-adding a queued entry at a more urgent level moves it to that level.
+ *
+ * @li Grouped.  Entries may share a @class group, whose entries are all
+ *     queued at the level of the first one queued until none remain queued.
+ *     So entries of one group are returned in the order they were first added,
+ *     whatever level is asked of each, and a queued entry of a group is never promoted.
+ *
+ * Queueing latency is only measured after the first call to getStats(),
+ * so that a queue whose statistics are never read does not read the clock.
+ *
  * @warning Only one thread should call pop_front()
  *   as push_back() does not broadcast (only wakes up one waiter)
  */
@@ -62,6 +93,32 @@ class fair_queue
 public:
     typedef std::tr1::shared_ptr<T> value_type;
 
+    enum {
+        //! Number of priority levels
+        NumLevels = 4,
+        //! Default for starvationLimit()
+        DefaultStarvationLimit = 8
+    };
+
+    /** Entries which must be returned in the order added.  cf. entry::setGroup()
+     *  Guarded by the mutex of the queue, so a group's entries should be queued
+     *  on only one queue at a time.
+     */
+    class group {
+        unsigned Qcnt; // number of queued entries of this group
+        unsigned level;
+
+        friend class fair_queue;
+
+        group(const group&);
+        group& operator=(const group&);
+    public:
+        group() :Qcnt(0u), level(0u) {}
+        ~group() {
+            assert(Qcnt==0u);
+        }
+    };
+
     class entry {
         /* In c++, use of ellLib (which implies offsetof()) should be restricted
          * to POD structs.  So enode_t exists as a POD struct for which offsetof()
@@ -73,19 +130,23 @@ public:
             entry *self;
         } enode;
         unsigned Qcnt;
+        unsigned level;
+        epicsTimeStamp queued;
         value_type holder;
         fair_queue *owner;
+        group *grp;
 
         friend class fair_queue;
 
         entry(const entry&);
         entry& operator=(const entry&);
     public:
-        entry() :Qcnt(0), holder()
-            , owner(NULL)
+        entry() :Qcnt(0), level(0), holder()
+            , owner(NULL), grp(NULL)
         {
             enode.node.next = enode.node.previous = NULL;
             enode.self = this;
+            queued.secPastEpoch = queued.nsec = 0u;
         }
         ~entry() {
             // nodes should be removed from the list before deletion
@@ -93,16 +154,29 @@ public:
             assert(Qcnt==0 && !holder);
             assert(!owner);
         }
+
+        //! Join a group, which must outlive any queueing of this entry.  NULL to leave.
+        //! @pre Not queued
+        void setGroup(group *g) {
+            assert(Qcnt==0);
+            grp = g;
+        }
     };
 
     fair_queue()
+        :nqueued(0u)
+        ,limit(DefaultStarvationLimit)
+        ,measure(false)
     {
-        ellInit(&list);
+        for(unsigned i=0; i<NumLevels; i++) {
+            ellInit(&lists[i]);
+            skipped[i] = 0u;
+        }
     }
     ~fair_queue()
     {
         clear();
-        assert(ellCount(&list)==0);
+        assert(nqueued==0u);
     }
 
     //! Remove all items.
@@ -114,45 +188,90 @@ public:
         {
             guard_t G(mutex);
 
-            garbage.resize(unsigned(ellCount(&list)));
+            garbage.resize(nqueued);
             size_t i=0;
 
-            while(ELLNODE *cur = ellGet(&list)) {
-                typedef typename entry::enode_t enode_t;
-                enode_t *PN = CONTAINER(cur, enode_t, node);
-                entry *P = PN->self;
-                assert(P->owner==this);
-                assert(P->Qcnt>0);
+            for(unsigned lvl=0; lvl<NumLevels; lvl++) {
+                while(ELLNODE *cur = ellGet(&lists[lvl])) {
+                    typedef typename entry::enode_t enode_t;
+                    enode_t *PN = CONTAINER(cur, enode_t, node);
+                    entry *P = PN->self;
+                    assert(P->owner==this);
+                    assert(P->Qcnt>0);
 
-                PN->node.previous = PN->node.next = NULL;
-                P->owner = NULL;
-                P->Qcnt = 0u;
-                garbage[i++].swap(P->holder);
+                    PN->node.previous = PN->node.next = NULL;
+                    P->owner = NULL;
+                    P->Qcnt = 0u;
+                    if(P->grp)
+                        P->grp->Qcnt--;
+                    garbage[i++].swap(P->holder);
+                }
+                skipped[lvl] = 0u;
             }
+            nqueued = 0u;
         }
     }
 
     bool empty() const {
         guard_t G(mutex);
-        return ellFirst(&list)==NULL;
+        return nqueued==0u;
+    }
+
+    //! Max. number of consecutive pops which may pass over a non-empty level
+    unsigned starvationLimit() const {
+        guard_t G(mutex);
+        return limit;
+    }
+
+    void setStarvationLimit(unsigned l) {
+        guard_t G(mutex);
+        limit = l ? l : 1u;
     }
 
-    void push_back(const value_type& ent)
+    /** Queue an entry at the given level (0 most urgent).
+     *  Levels outside [0, NumLevels) are clipped to the least urgent.
+     *  The level of an entry whose group is already queued is that of the group.
+     */
+    void push_back(const value_type& ent, unsigned level = 0u)
     {
         bool wake;
         entry *P = ent.get();
+        if(level>=unsigned(NumLevels))
+            level = NumLevels-1u;
         {
             guard_t G(mutex);
-            wake = ellFirst(&list)==NULL; // empty queue
+            wake = nqueued==0u; // empty queue
 
             if(P->Qcnt++==0) {
                 // not in list
                 assert(P->owner==NULL);
+                if(P->grp) {
+                    // keep the order of the group
+                    if(P->grp->Qcnt++==0)
+                        P->grp->level = level;
+                    else
+                        level = P->grp->level;
+                }
                 P->owner = this;
                 P->holder = ent; // the list will hold a reference
-                ellAdd(&list, &P->enode.node); // push_back
-            } else
+                P->level = level;
+                if(measure)
+                    epicsTimeGetCurrent(&P->queued);
+                else
+                    P->queued.secPastEpoch = P->queued.nsec = 0u;
+                ellAdd(&lists[level], &P->enode.node); // push_back
+                nqueued++;
+            } else {
                 assert(P->owner==this);
+                if(level < P->level && !P->grp) {
+                    // promote, keeping the time queued
+                    ellDelete(&lists[P->level], &P->enode.node);
+                    if(ellCount(&lists[P->level])==0)
+                        skipped[P->level] = 0u;
+                    P->level = level;
+                    ellAdd(&lists[level], &P->enode.node);
+                }
+            }
         }
         if(wake) wakeup.signal();
     }
@@ -161,28 +280,73 @@ public:
     {
         ret.reset();
         guard_t G(mutex);
-        ELLNODE *cur = ellGet(&list); // pop_front
-
-        if(cur) {
-            typedef typename entry::enode_t enode_t;
-            enode_t *PN = CONTAINER(cur, enode_t, node);
-            entry *P = PN->self;
-            assert(P->owner==this);
-            assert(P->Qcnt>0);
-            if(--P->Qcnt==0) {
-                PN->node.previous = PN->node.next = NULL;
-                P->owner = NULL;
-
-                ret.swap(P->holder);
-            } else {
-                ellAdd(&list, &P->enode.node); // push_back
 
-                ret = P->holder;
+        if(nqueued==0u)
+            return false;
+
+        // most urgent non-empty level, unless a less urgent level has reached the starvation bound
+        unsigned lvl = NumLevels, starved = NumLevels;
+        for(unsigned i=0; i<NumLevels; i++) {
+            if(ellCount(&lists[i])==0)
+                continue;
+            if(lvl==NumLevels)
+                lvl = i;
+            else if(starved==NumLevels && skipped[i]>=limit)
+                starved = i;
+        }
+        assert(lvl<NumLevels);
+        if(starved<NumLevels) {
+            lvl = starved;
+            stats[lvl].starved++;
+        }
+
+        for(unsigned i=0; i<NumLevels; i++) {
+            if(i!=lvl && ellCount(&lists[i])!=0)
+                skipped[i]++;
+        }
+        skipped[lvl] = 0u;
+
+        ELLNODE *cur = ellGet(&lists[lvl]); // pop_front
+
+        typedef typename entry::enode_t enode_t;
+        enode_t *PN = CONTAINER(cur, enode_t, node);
+        entry *P = PN->self;
+        assert(P->owner==this);
+        assert(P->Qcnt>0);
+
+        fair_queue_stats& S = stats[lvl];
+        S.count++;
+
+        epicsTimeStamp now;
+        now.secPastEpoch = now.nsec = 0u;
+        if(measure) {
+            epicsTimeGetCurrent(&now);
+            // not stamped if queued before measuring began
+            if(P->queued.secPastEpoch || P->queued.nsec) {
+                double latency = epicsTimeDiffInSeconds(&now, &P->queued);
+                if(latency<0.0)
+                    latency = 0.0;
+                S.latencySum += latency;
+                if(S.latencyMax < latency)
+                    S.latencyMax = latency;
             }
-            return true;
+        }
+
+        if(--P->Qcnt==0) {
+            PN->node.previous = PN->node.next = NULL;
+            P->owner = NULL;
+            if(P->grp)
+                P->grp->Qcnt--;
+            nqueued--;
+
+            ret.swap(P->holder);
         } else {
-            return false;
+            P->queued = now;
+            ellAdd(&lists[lvl], &P->enode.node); // push_back
+
+            ret = P->holder;
         }
+        return true;
     }
 
     void pop_front(value_type& ret)
@@ -206,8 +370,29 @@ public:
         }
     }
 
+    //! Fetch per-level statistics, optionally resetting the counters.
+    //! Latency is measured from the first call.
+    //! @post out.size()==NumLevels
+    void getStats(std::vector<fair_queue_stats>& out, bool reset = false) const
+    {
+        out.resize(NumLevels);
+        guard_t G(mutex);
+        measure = true;
+        for(unsigned i=0; i<NumLevels; i++) {
+            out[i] = stats[i];
+            out[i].depth = unsigned(ellCount(&lists[i]));
+            if(reset)
+                stats[i] = fair_queue_stats();
+        }
+    }
+
 private:
-    ELLLIST list;
+    ELLLIST lists[NumLevels];
+    size_t nqueued; // number of entries in all lists
+    unsigned limit;
+    mutable bool measure; // measure latency.  Set by getStats()
+    unsigned skipped[NumLevels];
+    mutable fair_queue_stats stats[NumLevels];
     mutable epicsMutex mutex;
     mutable epicsEvent wakeup;
 };
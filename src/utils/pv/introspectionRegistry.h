@@ -15,6 +15,7 @@
 #   undef epicsExportSharedSymbols
 #endif
 
+#include <shareLib.h>
 #include <pv/lock.h>
 #include <pv/pvIntrospect.h>
 #include <pv/pvData.h>
@@ -42,7 +43,7 @@ typedef std::map<const short,epics::pvData::FieldConstPtr> registryMap_t;
  * Registry is used to cache introspection interfaces to minimize network traffic.
  * @author gjansa
  */
-class IntrospectionRegistry {
+class epicsShareClass IntrospectionRegistry {
     EPICS_NOT_COPYABLE(IntrospectionRegistry)
 public:
     IntrospectionRegistry();
@@ -58,7 +59,8 @@ private:
      * Registers introspection interface and get it's ID. Always OUTGOING.
      * If it is already registered only preassigned ID is returned.
      *
-     * TODO !!!!!!this can get very slow in large maps. We need to change this !!!!!!
+     * Lookup is by pointer identity first, then by structural hash.
+     * A deep comparison is only made against entries with the same hash.
      *
      * @param field introspection interface to register
      *
@@ -102,16 +104,30 @@ public:
      */
     const static epics::pvData::int8 FULL_WITH_ID_TYPE_CODE;
 
+    /**
+     * Structural hash of an introspection interface.
+     * Fields which compare equal have the same hash.
+     */
+    static size_t hash(epics::pvData::Field const & field);
+
 private:
     registryMap_t _registry;
     epics::pvData::int16 _pointer;
 
+    // Indices of OUTGOING entries of _registry.
+    // Pointers stay valid as _registry holds a reference.
+    typedef std::map<const epics::pvData::Field*, epics::pvData::int16> pointerIndex_t;
+    typedef std::multimap<size_t, epics::pvData::int16> hashIndex_t;
+    pointerIndex_t _pointerIndex;
+    hashIndex_t _hashIndex;
+
     /**
      * Field factory.
      */
     static epics::pvData::FieldCreatePtr _fieldCreate;
 
-    bool registryContainsValue(epics::pvData::FieldConstPtr const & field, epics::pvData::int16& key);
+    bool registryContainsValue(epics::pvData::FieldConstPtr const & field, epics::pvData::int16& key, size_t& fieldHash);
+    void unindex(epics::pvData::int16 key, epics::pvData::FieldConstPtr const & field);
 };
 
 }
@@ -0,0 +1,274 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#ifndef SLOTTABLE_H
+#define SLOTTABLE_H
+
+#include <vector>
+#include <deque>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef epicsExportSharedSymbols
+#   define slotTableExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <epicsTypes.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsAtomic.h>
+
+#ifdef slotTableExportSharedSymbols
+#   define epicsExportSharedSymbols
+#   undef slotTableExportSharedSymbols
+#endif
+
+namespace epics {
+namespace pvAccess {
+
+/** @brief A table of values indexed by IDs which the table allocates.
+ *
+ * An alternative to std::map<ID, V> for when we choose the IDs.
+ * Lookup is an array index, and takes only the lock of one shard.
+ *
+ * @li IDs are positive (never zero), and encode a shard, a slot index in that shard,
+ *     and the generation of the slot.
+ *
+ * @li The generation of a slot is incremented each time it is erase()'d,
+ *     so an ID which is no longer valid does not find the next user of a slot
+ *     (until the generation wraps around).
+ *
+ * @li Free slots are re-used in FIFO order, and only once a shard has more than
+ *     MinFree of them.  So a slot is re-used at most once per MinFree erase()s
+ *     in its shard, and a stale ID can only alias after MaxGeneration-1 such cycles.
+ *
+ * @li Allocation rotates between shards, each with its own mutex, so that
+ *     lookups from different threads seldom contend.
+ *
+ * The parameterized type V must be default constructable and copyable,
+ * eg. std::tr1::shared_ptr<> or std::tr1::weak_ptr<>.
+ */
+template<typename V>
+class SlotTable
+{
+    typedef epicsGuard<epicsMutex> guard_t;
+public:
+    typedef V value_type;
+    typedef epicsInt32 id_type;
+
+    enum {
+        ShardBits = 3,
+        IndexBits = 16, //!< per shard
+        GenerationBits = 31 - ShardBits - IndexBits,
+
+        NumShards = 1u<<ShardBits,
+        MaxIndex = 1u<<IndexBits,
+        MaxGeneration = 1u<<GenerationBits,
+
+        MinFree = 64, //!< per shard, free slots held back from re-use
+    };
+
+    SlotTable() :nextShard(0u) {}
+
+    /** Allocate a new ID, with a default constructed value.
+     * @throws std::runtime_error if the table is full.
+     */
+    id_type reserve()
+    {
+        const size_t first = epicsAtomicIncrSizeT(&nextShard);
+        for(size_t n=0; n<NumShards; n++) {
+            const unsigned s = (first+n)%NumShards;
+            Shard& shard = shards[s];
+            guard_t G(shard.mutex);
+
+            epicsUInt32 idx;
+            if(shard.freeList.size() > size_t(MinFree)
+                    || (!shard.freeList.empty() && shard.slots.size() >= size_t(MaxIndex))) {
+                // oldest free slot
+                idx = shard.freeList.front();
+                shard.freeList.pop_front();
+
+            } else if(shard.slots.size() < size_t(MaxIndex)) {
+                idx = epicsUInt32(shard.slots.size());
+                shard.slots.push_back(Slot());
+
+            } else {
+                continue; // this shard is full
+            }
+
+            Slot& slot = shard.slots[idx];
+            slot.used = true;
+            shard.count++;
+            return encode(s, idx, slot.generation);
+        }
+        throw std::runtime_error("SlotTable full");
+    }
+
+    //! Allocate a new ID for a value
+    id_type insert(const value_type& value)
+    {
+        id_type id = reserve();
+        set(id, value);
+        return id;
+    }
+
+    //! Replace the value of a reserve()'d ID.
+    //! @returns false if id is not (or no longer) allocated.
+    bool set(id_type id, const value_type& value)
+    {
+        Shard *shard;
+        epicsUInt32 idx;
+        if(!decode(id, shard, idx))
+            return false;
+        guard_t G(shard->mutex);
+        Slot *slot = shard->lookup(id, idx);
+        if(!slot)
+            return false;
+        slot->value = value;
+        return true;
+    }
+
+    //! Find value by id, or a default constructed value if not found.
+    value_type find(id_type id) const
+    {
+        Shard *shard;
+        epicsUInt32 idx;
+        if(decode(id, shard, idx)) {
+            guard_t G(shard->mutex);
+            const Slot *slot = shard->lookup(id, idx);
+            if(slot)
+                return slot->value;
+        }
+        return value_type();
+    }
+
+    //! Remove by id.  Returns the removed value, or a default constructed value if not found.
+    value_type erase(id_type id)
+    {
+        value_type ret;
+        Shard *shard;
+        epicsUInt32 idx;
+        if(decode(id, shard, idx)) {
+            guard_t G(shard->mutex);
+            Slot *slot = shard->lookup(id, idx);
+            if(slot) {
+                std::swap(ret, slot->value);
+                slot->used = false;
+                slot->generation = nextGeneration(slot->generation);
+                shard->freeList.push_back(idx);
+                shard->count--;
+            }
+        }
+        return ret;
+    }
+
+    //! Number of allocated IDs
+    size_t size() const
+    {
+        size_t ret = 0u;
+        for(size_t s=0; s<NumShards; s++) {
+            guard_t G(shards[s].mutex);
+            ret += shards[s].count;
+        }
+        return ret;
+    }
+
+    //! Append all (allocated) values to out
+    void values(std::vector<value_type>& out) const
+    {
+        for(size_t s=0; s<NumShards; s++) {
+            const Shard& shard = shards[s];
+            guard_t G(shard.mutex);
+            out.reserve(out.size()+shard.count);
+            for(size_t i=0, N=shard.slots.size(); i<N; i++) {
+                if(shard.slots[i].used)
+                    out.push_back(shard.slots[i].value);
+            }
+        }
+    }
+
+    //! Remove all entries, appending their values to out.
+    void clear(std::vector<value_type>& out)
+    {
+        for(size_t s=0; s<NumShards; s++) {
+            Shard& shard = shards[s];
+            guard_t G(shard.mutex);
+            out.reserve(out.size()+shard.count);
+            for(size_t i=0, N=shard.slots.size(); i<N; i++) {
+                Slot& slot = shard.slots[i];
+                if(!slot.used)
+                    continue;
+                out.push_back(value_type());
+                std::swap(out.back(), slot.value);
+                slot.used = false;
+                slot.generation = nextGeneration(slot.generation);
+                shard.freeList.push_back(epicsUInt32(i));
+            }
+            shard.count = 0u;
+        }
+    }
+
+private:
+    struct Slot {
+        value_type value;
+        epicsUInt32 generation;
+        bool used;
+        Slot() :generation(1u), used(false) {}
+    };
+
+    struct Shard {
+        mutable epicsMutex mutex;
+        std::vector<Slot> slots;
+        std::deque<epicsUInt32> freeList; //!< oldest first
+        size_t count;
+
+        Shard() :count(0u) {}
+
+        // call with mutex locked
+        Slot* lookup(id_type id, epicsUInt32 idx)
+        {
+            if(idx >= slots.size())
+                return 0;
+            Slot& slot = slots[idx];
+            if(!slot.used || slot.generation!=(epicsUInt32(id)>>(ShardBits+IndexBits)))
+                return 0;
+            return &slot;
+        }
+    };
+
+    size_t nextShard;
+    mutable Shard shards[NumShards];
+
+    // generations are [1, MaxGeneration) so that no ID is zero
+    static epicsUInt32 nextGeneration(epicsUInt32 gen)
+    {
+        return gen+1u < epicsUInt32(MaxGeneration) ? gen+1u : 1u;
+    }
+
+    static id_type encode(unsigned shard, epicsUInt32 idx, epicsUInt32 gen)
+    {
+        return id_type((gen<<(ShardBits+IndexBits)) | (idx<<ShardBits) | shard);
+    }
+
+    // shards is mutable, so const methods may lock and lookup()
+    bool decode(id_type id, Shard*& shard, epicsUInt32& idx) const
+    {
+        if(id<=0)
+            return false;
+        const epicsUInt32 uid = epicsUInt32(id);
+        shard = &shards[uid%NumShards];
+        idx = (uid>>ShardBits)%MaxIndex;
+        return true;
+    }
+
+    SlotTable(const SlotTable&);
+    SlotTable& operator=(const SlotTable&);
+};
+
+}} // namespace epics::pvAccess
+
+#endif // SLOTTABLE_H
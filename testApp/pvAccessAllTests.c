@@ -14,6 +14,8 @@
 int testAtomicBoolean(void);
 int testHexDump(void);
 int testInetAddressUtils(void);
+int testSlotTable(void);
+int testRoleCache(void);
 
 /* remote */
 int testCodec(void);
@@ -27,6 +29,8 @@ void pvAccessAllTests(void)
     runTest(testAtomicBoolean);
     runTest(testHexDump);
     runTest(testInetAddressUtils);
+    runTest(testSlotTable);
+    runTest(testRoleCache);
 
     /* remote */
     runTest(testCodec);
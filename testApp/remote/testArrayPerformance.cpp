@@ -0,0 +1,225 @@
+/* Measure get() throughput of large waveforms over loopback.
+ *
+ * Runs an in-process server with a double array PV, and times repeated
+ * get() of 8, 16, 32, and 64 MB (by default) through the pva client.
+ * Each size is measured with messages segmented at the buffer size, and
+ * again with large messages ($EPICS_PVA_MAX_MESSAGE_BYTES) negotiated.
+ *
+ * Splitting the data between many smaller array fields (-c) sends it through
+ * the send buffer instead of directly from the array.
+ *
+ *   testArrayPerformance
+ *   testArrayPerformance -m 128 -i 20
+ *   testArrayPerformance -c 1024
+ */
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_MIN_MB 8
+#define DEFAULT_MAX_MB 64
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_TIMEOUT 30.0
+#define DEFAULT_COLUMNS 1
+
+int minMB = DEFAULT_MIN_MB;
+int maxMB = DEFAULT_MAX_MB;
+int iterations = DEFAULT_ITERATIONS;
+int columns = DEFAULT_COLUMNS;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testArrayPerformance [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -n <MB>:           smallest waveform, doubled up to the largest, default is '%d'\n"
+             "  -m <MB>:           largest waveform, default is '%d'\n"
+             "  -i <iterations>:   number of get operations per size, default is '%d'\n"
+             "  -c <columns>:      number of array fields the waveform is split between, default is '%d'\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             , DEFAULT_MIN_MB, DEFAULT_MAX_MB, DEFAULT_ITERATIONS, DEFAULT_COLUMNS, DEFAULT_TIMEOUT);
+}
+
+std::string columnName(int i)
+{
+    if(columns==1)
+        return "value";
+    char name[16];
+    sprintf(name, "c%d", i);
+    return name;
+}
+
+// time get() of each waveform size.  maxMessage of zero segments messages
+bool measure(const char* mode, const pvd::StructureConstPtr& type, unsigned long maxMessage)
+{
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+    pv->open(type);
+
+    pvas::StaticProvider sprov("arrayperf");
+    sprov.add("arrayperf:wf", pv);
+
+    char maxBytes[32], maxMessageBytes[32];
+    sprintf(maxBytes, "%lu", (unsigned long)maxMB*1024u*1024u + 1024u*1024u);
+    sprintf(maxMessageBytes, "%lu", maxMessage);
+
+    pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                pva::ServerContext::Config()
+                .provider(sprov.provider())
+                .config(pva::ConfigurationBuilder()
+                        .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                        .add("EPICS_PVA_SERVER_PORT", "0")
+                        .add("EPICS_PVA_BROADCAST_PORT", "0")
+                        .add("EPICS_PVA_MAX_ARRAY_BYTES", maxBytes)
+                        .add("EPICS_PVA_MAX_MESSAGE_BYTES", maxMessageBytes)
+                        .push_map()
+                        .build())));
+
+    pvac::ClientProvider client("pva", server->getCurrentConfig());
+    pvac::ClientChannel chan(client.connect("arrayperf:wf"));
+
+    bool allok = true;
+
+    for(int mb=minMB; mb<=maxMB; mb*=2) {
+        const size_t nelem = size_t(mb)*1024u*1024u/sizeof(double)/columns;
+
+        {
+            pvd::PVStructurePtr root(pvd::getPVDataCreate()->createPVStructure(type));
+            pvd::PVDoubleArray::svector arr(nelem);
+            for(size_t i=0; i<nelem; i++)
+                arr[i] = double(i);
+            pvd::PVDoubleArray::const_svector carr(pvd::freeze(arr));
+            pvd::BitSet changed;
+            for(int c=0; c<columns; c++) {
+                pvd::PVDoubleArrayPtr fld(root->getSubFieldT<pvd::PVDoubleArray>(columnName(c)));
+                fld->replace(carr);
+                changed.set(fld->getFieldOffset());
+            }
+            pv->post(*root, changed);
+        }
+
+        // first get() connects, and primes the type cache
+        chan.get(timeOut);
+
+        epicsTimeStamp start, end;
+        epicsTimeGetCurrent(&start);
+
+        bool ok = true;
+        for(int n=0; n<iterations; n++) {
+            pvd::PVStructure::const_shared_pointer result(chan.get(timeOut));
+            pvd::PVDoubleArray::const_svector val(result->getSubFieldT<pvd::PVDoubleArray>(columnName(columns-1))->view());
+            ok &= val.size()==nelem && val[nelem-1]==double(nelem-1);
+        }
+
+        epicsTimeGetCurrent(&end);
+        const double duration = epicsTimeDiffInSeconds(&end, &start);
+
+        printf("%s %d %.3f %.1f%s\n", mode, mb, iterations/duration, mb*iterations/duration,
+               ok ? "" : " (data mismatch)");
+        allok &= ok;
+    }
+
+    server->shutdown();
+    return allok;
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hn:m:i:c:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            minMB = atoi(optarg);
+            break;
+        case 'm':
+            maxMB = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'c':
+            columns = atoi(optarg);
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testArrayPerformance -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testArrayPerformance -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testArrayPerformance -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(minMB<1 || maxMB<minMB || iterations<1 || columns<1) {
+        usage();
+        return 1;
+    }
+
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    try {
+        pvd::FieldBuilderPtr builder(pvd::getFieldCreate()->createFieldBuilder());
+        for(int c=0; c<columns; c++)
+            builder->addArray(columnName(c), pvd::pvDouble);
+        pvd::StructureConstPtr type(builder->createStructure());
+
+        // large enough for the largest waveform, and its type description
+        const unsigned long maxMessage = (unsigned long)maxMB*1024u*1024u + 1024u*1024u;
+
+        printf("# mode MB gets/s MB/s\n");
+
+        bool ok = measure("segmented", type, 0u);
+        ok &= measure("large", type, maxMessage);
+
+        if(!ok)
+            return 1;
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
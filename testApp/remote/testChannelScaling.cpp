@@ -0,0 +1,267 @@
+/* Measure latency as the number of channels on one TCP connection grows.
+ *
+ * Runs an in-process server with N PVs, and one client context which
+ * connects to all of them (over a single TCP connection), then times
+ * get() spread across every channel.  Also compares lookup in the
+ * SlotTable used for channel and request IDs with a locked std::map.
+ *
+ *   testChannelScaling
+ *   testChannelScaling -n 100000 -i 2
+ */
+#include <vector>
+#include <map>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/slotTable.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_CHANNELS 50000
+#define DEFAULT_ITERATIONS 4
+#define DEFAULT_TIMEOUT 60.0
+
+int nchannels = DEFAULT_CHANNELS;
+int iterations = DEFAULT_ITERATIONS;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testChannelScaling [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -n <channels>:     number of channels on the one connection, default is '%d'\n"
+             "  -i <iterations>:   number of get operations per channel, default is '%d'\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             , DEFAULT_CHANNELS, DEFAULT_ITERATIONS, DEFAULT_TIMEOUT);
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+struct GetWaiter : public pvac::ClientChannel::GetCallback
+{
+    epicsMutex mutex;
+    epicsEvent done;
+    size_t remaining, failed;
+
+    explicit GetWaiter(size_t n) :remaining(n), failed(0u) {}
+
+    virtual void getDone(const pvac::GetEvent& evt) OVERRIDE FINAL
+    {
+        bool last;
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            if(evt.event!=pvac::GetEvent::Success)
+                failed++;
+            last = --remaining==0u;
+        }
+        if(last)
+            done.signal();
+    }
+};
+
+// issue one get() on every channel concurrently, and wait for all to complete
+bool getAll(std::vector<pvac::ClientChannel>& channels)
+{
+    GetWaiter waiter(channels.size());
+    std::vector<pvac::Operation> ops;
+    ops.reserve(channels.size());
+
+    for(size_t i=0; i<channels.size(); i++)
+        ops.push_back(channels[i].get(&waiter));
+
+    if(!waiter.done.wait(timeOut)) {
+        fprintf(stderr, "Timeout with %u get() incomplete\n", (unsigned)waiter.remaining);
+        return false;
+    }
+    return waiter.failed==0u;
+}
+
+// compare lookup of n live IDs
+void lookupTable(size_t n)
+{
+    typedef std::tr1::shared_ptr<int> value_t;
+    value_t val(new int(42));
+    const size_t nlookup = 10000000u;
+
+    pva::SlotTable<value_t> table;
+    std::vector<pva::SlotTable<value_t>::id_type> ids(n);
+    for(size_t i=0; i<n; i++)
+        ids[i] = table.insert(val);
+
+    epicsMutex mapMutex;
+    std::map<pva::pvAccessID, value_t> map;
+    for(size_t i=0; i<n; i++)
+        map[pva::pvAccessID(i+1)] = val;
+
+    size_t found = 0u;
+    epicsTimeStamp start;
+
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<nlookup; i++) {
+        if(table.find(ids[(i*7919u)%n]))
+            found++;
+    }
+    const double tableTime = elapsed(start);
+
+    epicsTimeGetCurrent(&start);
+    for(size_t i=0; i<nlookup; i++) {
+        epicsGuard<epicsMutex> G(mapMutex);
+        std::map<pva::pvAccessID, value_t>::const_iterator it(map.find(pva::pvAccessID((i*7919u)%n+1)));
+        if(it!=map.end() && it->second)
+            found++;
+    }
+    const double mapTime = elapsed(start);
+
+    printf("lookup of %u IDs: SlotTable %.1f ns, std::map %.1f ns%s\n",
+           (unsigned)n, tableTime*1e9/nlookup, mapTime*1e9/nlookup,
+           found==2u*nlookup ? "" : " (missing entries)");
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hn:i:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            nchannels = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testChannelScaling -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testChannelScaling -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testChannelScaling -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(nchannels<1 || iterations<0) {
+        usage();
+        return 1;
+    }
+
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    try {
+        lookupTable(size_t(nchannels));
+
+        pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                    ->add("value", pvd::pvInt)
+                                    ->createStructure());
+
+        pvas::StaticProvider sprov("chanscaling");
+        std::vector<std::string> names(nchannels);
+        for(int i=0; i<nchannels; i++) {
+            char name[32];
+            epicsSnprintf(name, sizeof(name), "chanscaling:%d", i);
+            names[i] = name;
+
+            pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+            pv->open(type);
+            sprov.add(names[i], pv);
+        }
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                    pva::ServerContext::Config()
+                    .provider(sprov.provider())
+                    .config(pva::ConfigurationBuilder()
+                            .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                            .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                            .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                            .add("EPICS_PVA_SERVER_PORT", "0")
+                            .add("EPICS_PVA_BROADCAST_PORT", "0")
+                            .push_map()
+                            .build())));
+
+        // one client context, so all channels share one TCP connection
+        pvac::ClientProvider client("pva", server->getCurrentConfig());
+        std::vector<pvac::ClientChannel> channels;
+        channels.reserve(nchannels);
+
+        epicsTimeStamp start;
+        epicsTimeGetCurrent(&start);
+
+        for(int i=0; i<nchannels; i++)
+            channels.push_back(client.connect(names[i]));
+
+        // first get() completes the connection
+        bool ok = getAll(channels);
+
+        const double connectTime = elapsed(start);
+
+        epicsTimeGetCurrent(&start);
+        for(int n=0; ok && n<iterations; n++)
+            ok &= getAll(channels);
+        const double getTime = elapsed(start);
+        const double nops = double(iterations)*nchannels;
+
+        printf("channels: %d\n", nchannels);
+        printf("connect: %f s total, %f us per channel\n",
+               connectTime, connectTime*1e6/nchannels);
+        if(nops>0)
+            printf("get: %f ops/s, %f us per operation%s\n",
+                   nops/getTime, getTime*1e6/nops, ok ? "" : " (errors)");
+
+        channels.clear();
+        server->shutdown();
+
+        if(!ok)
+            return 1;
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
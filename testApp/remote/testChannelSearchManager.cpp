@@ -0,0 +1,389 @@
+/*
+ * testChannelSearchManager.cpp
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <osiSock.h>
+#include <epicsStdio.h>
+#include <epicsThread.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/timer.h>
+#include <pv/pvUnitTest.h>
+
+#include <pv/channelSearchManager.h>
+#include <pv/blockingUDP.h>
+#include <pv/remote.h>
+#include <pv/pvaConstants.h>
+#include <pv/configuration.h>
+
+namespace pvd = epics::pvData;
+using namespace epics::pvAccess;
+
+namespace {
+
+// ChannelSearchManager ignores searches triggered outside of the timer,
+// on registration or by a new server, less than 100ms after the last search
+const double TICK = 0.11;
+
+// Counts datagrams sent to it
+struct Receiver {
+    SOCKET sock;
+    osiSockAddr addr;
+
+    Receiver()
+    {
+        sock = epicsSocketCreate(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if(sock==INVALID_SOCKET)
+            testAbort("Can't create UDP socket");
+
+        memset(&addr, 0, sizeof(addr));
+        addr.ia.sin_family = AF_INET;
+        addr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.ia.sin_port = 0;
+        osiSocklen_t slen = sizeof(addr);
+        if(::bind(sock, &addr.sa, sizeof(addr.ia)) || ::getsockname(sock, &addr.sa, &slen))
+            testAbort("Can't bind UDP socket");
+
+        osiSockIoctl_t flag = 1;
+        socket_ioctl(sock, FIONBIO, &flag);
+    }
+    ~Receiver() { epicsSocketDestroy(sock); }
+
+    // number of datagrams received since the last call
+    size_t drain()
+    {
+        char buf[MAX_UDP_RECV];
+        size_t n = 0u;
+        while(::recv(sock, buf, sizeof(buf), 0) >= 0)
+            n++;
+        return n;
+    }
+};
+
+struct TestContext : public Context {
+    POINTER_DEFINITIONS(TestContext);
+
+    Configuration::const_shared_pointer conf;
+    pvd::Timer::shared_pointer timer;
+    BlockingUDPTransport::shared_pointer transport;
+    size_t newServers;
+
+    explicit TestContext(const osiSockAddr& dest)
+        :conf(ConfigurationBuilder().push_map().build())
+        ,timer(new pvd::Timer("testCSM", pvd::lowPriority))
+        ,newServers(0u)
+    {
+        osiSockAddr bindAddr;
+        memset(&bindAddr, 0, sizeof(bindAddr));
+        bindAddr.ia.sin_family = AF_INET;
+        bindAddr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bindAddr.ia.sin_port = 0;
+
+        ResponseHandler::shared_pointer handler(new ResponseHandler(this, "testCSM"));
+        BlockingUDPConnector connector(false);
+        transport = connector.connect(handler, bindAddr, PVA_CLIENT_PROTOCOL_REVISION);
+        if(!transport)
+            testAbort("Can't create search transport");
+
+        InetAddrVector addrs(1, dest);
+        std::vector<bool> unicast(1, true);
+        transport->setSendAddresses(addrs, unicast);
+    }
+    virtual ~TestContext() {
+        timer->close();
+    }
+
+    virtual pvd::Timer::shared_pointer getTimer() OVERRIDE FINAL { return timer; }
+    virtual TransportRegistry* getTransportRegistry() OVERRIDE FINAL { return 0; }
+    virtual Configuration::const_shared_pointer getConfiguration() OVERRIDE FINAL { return conf; }
+    virtual void newServerDetected() OVERRIDE FINAL { newServers++; }
+    virtual std::tr1::shared_ptr<Channel> getChannel(pvAccessID) OVERRIDE FINAL {
+        return std::tr1::shared_ptr<Channel>();
+    }
+    virtual Transport::shared_pointer getSearchTransport() OVERRIDE FINAL { return transport; }
+};
+
+struct TestInstance : public SearchInstance {
+    POINTER_DEFINITIONS(TestInstance);
+
+    const pvAccessID id;
+    const std::string name;
+    int32_t userValue;
+    size_t found;
+
+    TestInstance(pvAccessID id, const std::string& name) :id(id), name(name), userValue(0), found(0u) {}
+    virtual ~TestInstance() {}
+
+    virtual pvAccessID getSearchInstanceID() OVERRIDE FINAL { return id; }
+    virtual const std::string& getSearchInstanceName() OVERRIDE FINAL { return name; }
+    virtual int32_t& getUserValue() OVERRIDE FINAL { return userValue; }
+    virtual void searchResponse(const ServerGUID&, int8_t, osiSockAddr*) OVERRIDE FINAL { found++; }
+};
+
+// The manager is activated, but its periodic timer is cancelled so that the test calls tick()
+struct Fixture {
+    Receiver rx;
+    TestContext::shared_pointer ctxt;
+    ChannelSearchManager::shared_pointer csm;
+
+    explicit Fixture(double maxFramesPerSecond = 0.0, pvd::int32 mtu = 0, bool targeted = false)
+        :ctxt(new TestContext(rx.addr))
+        ,csm(new ChannelSearchManager(ctxt, maxFramesPerSecond, mtu, targeted))
+    {
+        csm->activate();
+        ctxt->timer->cancel(csm);
+    }
+    ~Fixture()
+    {
+        csm->cancel();
+        ctxt->transport->close();
+    }
+
+    void tick()
+    {
+        epicsThreadSleep(TICK);
+        csm->callback();
+    }
+
+    ChannelSearchManager::Stats stats()
+    {
+        ChannelSearchManager::Stats ret;
+        csm->getStats(ret);
+        return ret;
+    }
+};
+
+// A channel is searched at once, and then with the wait doubling after each search
+void testBackoff()
+{
+    testDiag("testBackoff()");
+    Fixture fix;
+
+    TestInstance::shared_pointer inst(new TestInstance(1, "test:backoff"));
+    fix.csm->registerSearchInstance(inst);
+
+    std::vector<size_t> searchedAt;
+    size_t prev = 0u;
+    for(size_t tick = 1u; tick <= 16u; tick++) {
+        if(tick > 1u)
+            fix.tick();
+        ChannelSearchManager::Stats stats(fix.stats());
+        if(stats.namesSent != prev)
+            searchedAt.push_back(tick);
+        prev = stats.namesSent;
+    }
+
+    testEqual(searchedAt.size(), 4u);
+    if(searchedAt.size()==4u) {
+        testEqual(searchedAt[0], 1u);
+        testEqual(searchedAt[1], 3u);
+        testEqual(searchedAt[2], 7u);
+        testEqual(searchedAt[3], 15u);
+    } else {
+        testSkip(4, "wrong number of searches");
+    }
+
+    ChannelSearchManager::Stats stats(fix.stats());
+    testEqual(stats.registered, 1u);
+    testEqual(stats.pending.at(4), 1u);
+    testEqual(stats.framesSent, 4u);
+    testEqual(fix.rx.drain(), 4u);
+
+    // found, no more searches
+    ServerGUID guid;
+    memset(guid.value, 0, sizeof(guid.value));
+    fix.csm->searchResponse(guid, inst->id, 0, PVA_CLIENT_PROTOCOL_REVISION, &fix.rx.addr);
+    testEqual(inst->found, 1u);
+    testEqual(fix.csm->registeredCount(), 0);
+}
+
+// Searches over the per-period frame budget are postponed to the next period
+void testRateLimit()
+{
+    testDiag("testRateLimit()");
+
+    // 256 byte frames hold two of these names
+    const std::string prefix("test:rate:" + std::string(90, 'x'));
+    const size_t nchan = 10u;
+
+    for(unsigned limited = 0; limited < 2; limited++) {
+        testDiag("%s rate limit", limited ? "with" : "without");
+
+        // less than one frame per period, which rounds up to one
+        Fixture fix(limited ? 1.0 : 0.0, 256);
+
+        std::vector<TestInstance::shared_pointer> insts;
+        for(size_t i = 0u; i < nchan; i++) {
+            char suffix[4];
+            epicsSnprintf(suffix, sizeof(suffix), "%02u", unsigned(i));
+            insts.push_back(TestInstance::shared_pointer(new TestInstance(pvAccessID(i+1u), prefix + suffix)));
+            // the first is searched immediately, the remainder in the next period
+            fix.csm->registerSearchInstance(insts.back());
+        }
+        fix.rx.drain();
+
+        ChannelSearchManager::Stats before(fix.stats());
+        testEqual(before.namesSent, 1u);
+        testEqual(before.framesSent, 1u);
+
+        fix.tick();
+        ChannelSearchManager::Stats after(fix.stats());
+
+        if(limited) {
+            testEqual(after.framesSent - before.framesSent, 1u);
+            testEqual(after.namesSent - before.namesSent, 2u);
+            testEqual(after.deferred - before.deferred, nchan - 1u - 2u);
+        } else {
+            testEqual(after.framesSent - before.framesSent, 5u);
+            testEqual(after.namesSent - before.namesSent, nchan - 1u);
+            testEqual(after.deferred - before.deferred, 0u);
+        }
+        testEqual(fix.rx.drain(), after.framesSent - before.framesSent);
+
+        // postponed searches are not lost.  A channel's backoff level counts its searches
+        size_t ticks = 0u, unsearched;
+        while(true) {
+            unsearched = 0u;
+            for(size_t i = 0u; i < nchan; i++)
+                if(insts[i]->userValue == 0)
+                    unsearched++;
+            if(!unsearched || ticks == 20u)
+                break;
+            fix.tick();
+            ticks++;
+        }
+        testOk(unsearched == 0u, "all %u channels searched after %u more periods",
+               unsigned(nchan), unsigned(ticks));
+    }
+}
+
+osiSockAddr loopback(unsigned short port)
+{
+    osiSockAddr addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.ia.sin_family = AF_INET;
+    addr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.ia.sin_port = htons(port);
+    return addr;
+}
+
+// With targeted search, a restarted server is sent the channels last resolved on it,
+// while other channels keep their backoff
+void testRestartKnown()
+{
+    testDiag("testRestartKnown()");
+    Fixture fix(0.0, 0, true);
+
+    ServerGUID guid1, guid2;
+    memset(guid1.value, 1, sizeof(guid1.value));
+    memset(guid2.value, 2, sizeof(guid2.value));
+    osiSockAddr server(loopback(5075));
+
+    TestInstance::shared_pointer a(new TestInstance(1, "test:restart:a")),
+                                 b(new TestInstance(2, "test:restart:b"));
+
+    fix.csm->registerSearchInstance(a);
+    fix.csm->searchResponse(guid1, a->id, 0, PVA_CLIENT_PROTOCOL_REVISION, &server);
+    testEqual(a->found, 1u);
+
+    fix.csm->registerSearchInstance(b);
+    fix.tick();
+
+    // a is disconnected, and searched for again
+    fix.csm->registerSearchInstance(a);
+    fix.rx.drain();
+    const int32_t blevel = b->userValue;
+
+    ChannelSearchManager::Stats before(fix.stats());
+    fix.csm->serverRestarted(guid2, server, fix.rx.addr);
+    ChannelSearchManager::Stats after(fix.stats());
+
+    testEqual(fix.rx.drain(), 1u);
+    testEqual(after.restarts - before.restarts, 1u);
+    testEqual(after.retargeted - before.retargeted, 1u);
+    testEqual(after.namesSent - before.namesSent, 1u);
+    testEqual(b->userValue, blevel);
+}
+
+// A server on which nothing was resolved before boosts all searches, as without targeted search
+void testRestartNew()
+{
+    testDiag("testRestartNew()");
+    Fixture fix(0.0, 0, true);
+
+    ServerGUID guid;
+    memset(guid.value, 3, sizeof(guid.value));
+
+    TestInstance::shared_pointer inst(new TestInstance(1, "test:restart:new"));
+    fix.csm->registerSearchInstance(inst);
+    // searched again at the 2nd tick, and next at the 6th
+    fix.tick();
+    fix.tick();
+    epicsThreadSleep(TICK);
+    fix.rx.drain();
+
+    ChannelSearchManager::Stats before(fix.stats());
+    fix.csm->serverRestarted(guid, loopback(5076), fix.rx.addr);
+    ChannelSearchManager::Stats after(fix.stats());
+
+    // boosted, so searched now from the shortest period
+    testEqual(inst->userValue, 1);
+    testEqual(after.namesSent - before.namesSent, 1u);
+    testEqual(after.restarts - before.restarts, 0u);
+    testEqual(fix.rx.drain(), 1u);
+}
+
+// Searches triggered outside of the timer do not move on the timing wheel
+void testTrigger()
+{
+    testDiag("testTrigger()");
+    Fixture fix;
+
+    // penalized channels wait for the longest period, that of the last backoff bucket.
+    // Being the first registered triggers a search of the channels due now, of which there are none
+    TestInstance::shared_pointer inst(new TestInstance(1, "test:trigger"));
+    fix.csm->registerSearchInstance(inst, true);
+    const size_t period = 1u << (fix.stats().pending.size() - 1u);
+    testEqual(fix.stats().namesSent, 0u);
+
+    // timer ticks are not subject to the 100ms guard
+    size_t ticks = 0u;
+    while(fix.stats().namesSent == 0u && ticks < 2u*period) {
+        fix.csm->callback();
+        ticks++;
+    }
+    testEqual(ticks, period);
+
+    // too soon after the last tick, so postponed to the next
+    ChannelSearchManager::Stats before(fix.stats());
+    fix.csm->newServerDetected();
+    testEqual(fix.stats().namesSent - before.namesSent, 0u);
+    fix.csm->callback();
+    testEqual(fix.stats().namesSent - before.namesSent, 1u);
+    fix.rx.drain();
+}
+
+} // namespace
+
+MAIN(testChannelSearchManager)
+{
+    testPlan(39);
+    osiSockAttach();
+    try {
+        testBackoff();
+        testRateLimit();
+        testRestartKnown();
+        testRestartNew();
+        testTrigger();
+    } catch(std::exception& e) {
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    osiSockRelease();
+    return testDone();
+}
@@ -2,7 +2,13 @@
 * testCodec.cpp
 */
 
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
 #include <epicsExit.h>
+#include <epicsEndian.h>
 #include <epicsUnitTest.h>
 #include <testMain.h>
 #include <pv/byteBuffer.h>
@@ -100,7 +106,19 @@ public:
         _sendBufferFullCount(0),
         _readPollOneCount(0),
         _writePollOneCount(0),
+        _armWritableCount(0),
+        _armSendDrainCount(0),
+        _armSendDrainLow(0),
+        _unsentSocketBytes(0),
+        _writeGatherCount(0),
         _throwExceptionOnSend(false),
+        _directSerialize(false),
+        _directDeserialize(false),
+        _directBytes(0),
+        _directElementSize(1),
+        _directUsed(false),
+        _directMarker(0),
+        _writeFull(false),
         _readPayload(false),
         _disconnected(false),
         _forcePayloadRead(-1),
@@ -169,6 +187,10 @@ public:
         if (_throwExceptionOnSend)
             throw io_exception("text IO exception");
 
+        // as a non-blocking socket with a full send buffer
+        if (_writeFull)
+            return 0;
+
         size_t nmove = std::min(buffer->getRemaining(), _writeBuffer.getRemaining());
 
         for(size_t n=0; n<nmove; n++)
@@ -219,7 +241,16 @@ public:
         PVAMessage caMessage(_version, _flags,
                              _command, _payloadSize);
 
-        if (_readPayload && _payloadSize > 0)
+        // the first message is an array of _directBytes, followed by an int32 marker
+        if (_directDeserialize && _receivedAppMessages.empty())
+        {
+            _directData.assign(_directBytes, 0);
+            _directUsed = directDeserialize(&_socketBuffer, &_directData[0],
+                                            _directBytes/_directElementSize, _directElementSize);
+            ensureData(4);
+            _directMarker = _socketBuffer.getInt();
+        }
+        else if (_readPayload && _payloadSize > 0)
         {
             // no fragmentation supported by this implementation
             std::size_t toRead =
@@ -263,6 +294,28 @@ public:
     }
 
 
+    void armWritable() {
+        _armWritableCount++;
+    }
+
+    void armSendDrain(std::size_t low) {
+        _armSendDrainCount++;
+        _armSendDrainLow = low;
+    }
+
+    std::size_t getUnsentSocketBytes() {
+        return _unsentSocketBytes;
+    }
+
+    // as a BlockingTCPTransportCodec driven by a TransportReactor
+    void setResumableIO() {
+        _resumableIO = true;
+    }
+
+    bool unsentBytes() const {
+        return hasUnsentBytes();
+    }
+
     void close()  {
         _closedCount++;
     }
@@ -284,6 +337,11 @@ public:
         return &_sendBuffer;
     }
 
+    ByteBuffer*  getSocketBuffer()
+    {
+        return &_socketBuffer;
+    }
+
     const osiSockAddr* getLastReadBufferSocketAddress()
     {
         return &_dummyAddress;
@@ -326,14 +384,29 @@ public:
         const char* toSerialize,
         std::size_t elementCount,
         std::size_t elementSize)  {
+        if (_directSerialize)
+            return AbstractCodec::directSerialize(existingBuffer, toSerialize, elementCount, elementSize);
         return false;
     }
 
+    int writeGather(ByteBuffer *head, ByteBuffer *tail) {
+        _writeGatherCount++;
+        int n = write(head);
+        if (n >= 0 && head->getRemaining() == 0) {
+            int m = write(tail);
+            if (m > 0)
+                n += m;
+        }
+        return n;
+    }
+
     bool directDeserialize(
         ByteBuffer *existingBuffer,
         char* deserializeTo,
         std::size_t elementCount,
         std::size_t elementSize)  {
+        if (_directDeserialize)
+            return AbstractCodec::directDeserialize(existingBuffer, deserializeTo, elementCount, elementSize);
         return false;
     }
 
@@ -396,7 +469,20 @@ public:
     std::size_t _sendBufferFullCount;
     std::size_t _readPollOneCount;
     std::size_t _writePollOneCount;
+    std::size_t _armWritableCount;
+    std::size_t _armSendDrainCount;
+    std::size_t _armSendDrainLow;
+    std::size_t _unsentSocketBytes;
+    std::size_t _writeGatherCount;
     bool _throwExceptionOnSend;
+    bool _directSerialize;
+    bool _directDeserialize;
+    std::size_t _directBytes;
+    std::size_t _directElementSize;
+    std::vector<char> _directData;
+    bool _directUsed;
+    int32_t _directMarker;
+    bool _writeFull;
     bool _readPayload;
     bool _disconnected;
     int _forcePayloadRead;
@@ -432,7 +518,7 @@ class CodecTest {
 public:
 
     int runAllTest() {
-        testPlan(5883);
+        testPlan(5946);
         testHeaderProcess();
         testInvalidHeaderMagic();
         testInvalidHeaderSegmentedInNormal();
@@ -456,6 +542,15 @@ public:
         testEnqueueSendDirectRequest();
         testSendException();
         testSendHugeMessagePartes();
+        testSendHugeMessageLarge();
+        testDirectSerializeGather();
+        testDirectDeserialize();
+        testSendBackpressure();
+        testSendBackpressureResumable();
+        testResumableRead();
+        testResumableSegmentedRead();
+        testResumableReadTooLarge();
+        testResumableWrite();
         testRecipient();
         testInvalidArguments();
         testDefaultModes();
@@ -2664,6 +2759,552 @@ private:
     }
 
 
+    // with large messages negotiated, the same message is sent without segmentation
+    void testSendHugeMessageLarge()
+    {
+
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        std::size_t bytesToSent = 10*DEFAULT_BUFFER_SIZE+1;
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+
+        const std::size_t sendBufferSize = codec.getSendBuffer()->getSize();
+        const std::size_t socketBufferSize = codec.getSocketBuffer()->getSize();
+
+        codec.setMaxMessageSize(20*DEFAULT_BUFFER_SIZE);
+        codec.setPeerMaxMessageSize(20*DEFAULT_BUFFER_SIZE);
+
+        codec._readPayload = true;
+        codec._readBuffer.reset(
+            new ByteBuffer(11*DEFAULT_BUFFER_SIZE));
+
+        std::tr1::shared_ptr<TransportSender> sender =
+            std::tr1::shared_ptr<TransportSender>(
+                new TransportSenderForTestSendHugeMessagePartes(
+                    codec, bytesToSent));
+
+        codec._writePollOneCallback.reset(new WritePollOneCallbackForTestSendHugeMessagePartes
+                                          (codec));
+
+        // process
+        codec.enqueueSendRequest(sender);
+        codec.breakSender();
+        try {
+            codec.processSendQueue();
+        } catch(sender_break&) {
+            testDiag("sender_break");
+        }
+
+        testOk(codec.getSendBuffer()->getSize() == sendBufferSize,
+               "%s: send buffer returned to %u bytes", CURRENT_FUNCTION, (unsigned)sendBufferSize);
+
+        codec.addToReadBuffer();
+
+        codec.processRead();
+
+        testOk(codec._invalidDataStreamCount == 0,
+               "%s: codec._invalidDataStreamCount == 0",
+               CURRENT_FUNCTION);
+        testOk(codec._closedCount == 0,
+               "%s: codec._closedCount == 0", CURRENT_FUNCTION);
+        testOk(codec._receivedControlMessages.size() == 0,
+               "%s: codec._receivedControlMessages.size() == 0 ",
+               CURRENT_FUNCTION);
+        testOk(codec._receivedAppMessages.size() == 1,
+               "%s: codec._receivedAppMessages.size() == 1",
+               CURRENT_FUNCTION);
+        testOk(codec.getSocketBuffer()->getSize() == socketBufferSize,
+               "%s: receive buffer returned to %u bytes", CURRENT_FUNCTION, (unsigned)socketBufferSize);
+
+        if (codec._receivedAppMessages.size() != 1) {
+            testSkip(3, "no message");
+            return;
+        }
+
+        PVAMessage header = codec._receivedAppMessages[0];
+
+        // no segment flags
+        testOk(header._flags == (int8_t)(EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG ? 0x80 : 0x00),
+               "%s: header._flags == (int8_t)0x(0|8)0", CURRENT_FUNCTION);
+        testOk(std::size_t(header._payloadSize) == bytesToSent,
+               "%s: header._payloadSize %d == %u", CURRENT_FUNCTION,
+               (int)header._payloadSize, (unsigned)bytesToSent);
+
+        bool match = header._payload.get() != 0;
+        if (match) {
+            header._payload->flip();
+            match = header._payload->getLimit() == bytesToSent;
+            for (std::size_t i = 0; match && i < bytesToSent; i++)
+                match = (int8_t)i == header._payload->getByte();
+        }
+        testOk(match, "%s: payload content", CURRENT_FUNCTION);
+    }
+
+
+    class TransportSenderForTestDirectSerializeGather:
+        public TransportSender {
+    public:
+
+        TransportSenderForTestDirectSerializeGather(
+            TestCodec & codec, const std::vector<char>& data):
+            _codec(codec), _data(data), _direct(false) {}
+
+        void send(epics::pvData::ByteBuffer* buffer,
+                  TransportSendControl* control)
+        {
+            _codec.startMessage((int8_t)0x20, 4);
+            buffer->putInt(0x12345678);
+            _direct = _codec.directSerialize(buffer, &_data[0], _data.size(), 1);
+            _codec.endMessage();
+        }
+
+    private:
+        TestCodec &_codec;
+        const std::vector<char>& _data;
+    public:
+        bool _direct;
+    };
+
+    void testDirectSerializeGather()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        // large enough to hold everything written
+        TestCodec codec(DEFAULT_BUFFER_SIZE, 256*1024);
+        codec._directSerialize = true;
+
+        std::vector<char> data(100*1024);
+        for (std::size_t i = 0; i < data.size(); i++)
+            data[i] = char(i*7u);
+
+        std::tr1::shared_ptr<TransportSenderForTestDirectSerializeGather> sender(
+            new TransportSenderForTestDirectSerializeGather(codec, data));
+
+        codec.enqueueSendRequest(sender);
+        codec.processSendQueue();
+
+        testOk(sender->_direct, "%s: array sent directly", CURRENT_FUNCTION);
+        testOk(codec._writeGatherCount == 1,
+               "%s: pending bytes and array in one gather write (%u)",
+               CURRENT_FUNCTION, (unsigned)codec._writeGatherCount);
+
+        // array appears unmodified, following the message started before it
+        const char *written = codec._writeBuffer.getBuffer();
+        const char *end = written + codec._writeBuffer.getPosition();
+        const char *found = std::search(written, end, data.begin(), data.end());
+        testOk(found != end, "%s: array found in output", CURRENT_FUNCTION);
+        testOk(found - written >= std::ptrdiff_t(2*PVA_MESSAGE_HEADER_SIZE + 4),
+               "%s: array follows the message header, value, and segment header (offset %d)",
+               CURRENT_FUNCTION, int(found - written));
+
+        // not for arrays which must be byte swapped, or whose size overflows the payload size
+        const int otherOrder = EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG ? EPICS_ENDIAN_LITTLE : EPICS_ENDIAN_BIG;
+        TestCodec swapped(DEFAULT_BUFFER_SIZE, 256*1024);
+        swapped._directSerialize = true;
+        swapped.setByteOrder(otherOrder);
+        testOk(!swapped.directSerialize(swapped.getSendBuffer(), &data[0], data.size()/2, 2),
+               "%s: not when byte order differs", CURRENT_FUNCTION);
+        testOk(!codec.directSerialize(codec.getSendBuffer(), &data[0], std::size_t(1u)<<30, 4),
+               "%s: not when larger than the int32 payload size", CURRENT_FUNCTION);
+    }
+
+
+    class TransportSenderForTestSendBackpressure:
+        public TransportSender {
+    public:
+
+        TransportSenderForTestSendBackpressure(
+            TestCodec & codec, std::size_t payload, bool deferrable):
+            _codec(codec), _payload(payload), _deferrable(deferrable),
+            _sentCount(0), _deferredCount(0) {}
+
+        void send(epics::pvData::ByteBuffer* buffer,
+                  TransportSendControl* control)
+        {
+            if (_deferrable && _codec.deferIfCongested(_self.lock())) {
+                _deferredCount++;
+                return;
+            }
+
+            _codec.startMessage((int8_t)0x20, _payload);
+            for (std::size_t i = 0; i < _payload; i++)
+                buffer->putByte((int8_t)i);
+            _codec.endMessage();
+            _sentCount++;
+        }
+
+        std::tr1::weak_ptr<TransportSender> _self;
+
+    private:
+        TestCodec &_codec;
+        std::size_t _payload;
+        bool _deferrable;
+    public:
+        std::size_t _sentCount;
+        std::size_t _deferredCount;
+    };
+
+    // a large array is received directly into place, whether it is split across reads
+    // or across segments, and in either byte order
+    void testDirectDeserialize()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        const std::size_t nelem = 16*1024; // 64 KB, the direct threshold
+        const int32_t marker = 0x12345678;
+
+        for (int swapped = 0; swapped < 2; swapped++)
+        {
+            for (int segmented = 0; segmented < 2; segmented++)
+            {
+                const int byteOrder = swapped ?
+                            (EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG ? EPICS_ENDIAN_LITTLE : EPICS_ENDIAN_BIG) :
+                            EPICS_BYTE_ORDER;
+                const int8_t orderFlag = byteOrder == EPICS_ENDIAN_BIG ? (int8_t)0x80 : (int8_t)0x00;
+
+                TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+                codec.setByteOrder(byteOrder);
+                codec._directDeserialize = true;
+                codec._directBytes = nelem*4;
+                codec._directElementSize = 4;
+
+                // the array and the marker, as sent by the peer
+                ByteBuffer payload(nelem*4 + 4, byteOrder);
+                for (std::size_t i = 0; i < nelem; i++)
+                    payload.putInt(int32_t(i*3 + 1));
+                payload.putInt(marker);
+                payload.flip();
+
+                // much more than one read of the socket buffer
+                codec._readBuffer.reset(new ByteBuffer(256*1024, byteOrder));
+
+                std::vector<std::size_t> segments;
+                if (segmented)
+                {
+                    segments.push_back(20000);
+                    segments.push_back(30000);
+                }
+                segments.push_back(payload.getRemaining() - (segmented ? 50000 : 0));
+
+                for (std::size_t seg = 0; seg < segments.size(); seg++)
+                {
+                    int8_t flags = orderFlag;
+                    if (segments.size() > 1)
+                        flags |= seg == 0 ? 0x10 : seg + 1 == segments.size() ? 0x20 : 0x30;
+                    codec._readBuffer->put(PVA_MAGIC);
+                    codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+                    codec._readBuffer->put(flags);
+                    codec._readBuffer->put((int8_t)0x23);
+                    codec._readBuffer->putInt(int32_t(segments[seg]));
+                    for (std::size_t i = 0; i < segments[seg]; i++)
+                        codec._readBuffer->put(payload.getByte());
+                }
+
+                // a following message, found only if the array was consumed exactly
+                codec._readBuffer->put(PVA_MAGIC);
+                codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+                codec._readBuffer->put(orderFlag);
+                codec._readBuffer->put((int8_t)0x24);
+                codec._readBuffer->putInt(0);
+                codec._readBuffer->flip();
+
+                codec.processRead();
+
+                testDiag("%s, %s byte order", segmented ? "segmented" : "split", swapped ? "opposite" : "same");
+                testOk(codec._directUsed,
+                       "%s: directDeserialize() used", CURRENT_FUNCTION);
+
+                std::size_t wrong = 0;
+                for (std::size_t i = 0; i < nelem && codec._directData.size() == nelem*4; i++)
+                {
+                    int32_t val;
+                    memcpy(&val, &codec._directData[i*4], 4);
+                    if (val != int32_t(i*3 + 1))
+                        wrong++;
+                }
+                testOk(codec._directData.size() == nelem*4 && wrong == 0,
+                       "%s: array contents (%u wrong)", CURRENT_FUNCTION, (unsigned)wrong);
+                testOk(codec._directMarker == marker,
+                       "%s: marker 0x%x follows the array", CURRENT_FUNCTION, (unsigned)codec._directMarker);
+                testOk(codec._invalidDataStreamCount == 0 && codec._receivedAppMessages.size() == 2
+                       && codec._receivedAppMessages[1]._command == 0x24,
+                       "%s: following message received", CURRENT_FUNCTION);
+            }
+        }
+    }
+
+
+    void testSendBackpressure()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+        codec.setSendWatermarks(1000, 100);
+
+        std::tr1::shared_ptr<TransportSenderForTestSendBackpressure> filler(
+            new TransportSenderForTestSendBackpressure(codec, 2000, false));
+        std::tr1::shared_ptr<TransportSenderForTestSendBackpressure> monitor(
+            new TransportSenderForTestSendBackpressure(codec, 8, true));
+        monitor->_self = monitor;
+
+        // the filler leaves more than the high watermark in the send buffer, so
+        // the monitor is deferred, then re-queued once the buffer has been flushed.
+        codec.enqueueSendRequest(filler);
+        codec.enqueueSendRequest(monitor);
+        codec.processSendQueue();
+
+        testOk(monitor->_deferredCount == 1,
+               "%s: monitor->_deferredCount == 1 (%u)", CURRENT_FUNCTION, (unsigned)monitor->_deferredCount);
+        testOk(monitor->_sentCount == 1,
+               "%s: monitor->_sentCount == 1 (%u)", CURRENT_FUNCTION, (unsigned)monitor->_sentCount);
+
+        std::size_t congested = 0, deferred = 0;
+        codec.getBackpressureStats(congested, deferred);
+        testOk(congested == 1 && deferred == 1,
+               "%s: congested == 1 && deferred == 1 (%u, %u)", CURRENT_FUNCTION,
+               (unsigned)congested, (unsigned)deferred);
+
+        codec._readPayload = true;
+        codec.transferToReadBuffer();
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 2,
+               "%s: codec._receivedAppMessages.size() == 2", CURRENT_FUNCTION);
+        testOk(!codec.deferIfCongested(monitor),
+               "%s: !codec.deferIfCongested() once drained", CURRENT_FUNCTION);
+    }
+
+
+    // as driven by a TransportReactor, a congested socket is waited for by
+    // armSendDrain(), and a sender deferred twice is resumed once
+    void testSendBackpressureResumable()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+        codec.setSendWatermarks(1000, 100);
+        codec._unsentSocketBytes = 5000;
+
+        std::tr1::shared_ptr<TransportSenderForTestSendBackpressure> monitor(
+            new TransportSenderForTestSendBackpressure(codec, 8, true));
+        monitor->_self = monitor;
+
+        codec.enqueueSendRequest(monitor);
+        codec.processSendQueue();
+        codec.enqueueSendRequest(monitor);
+        codec.processSendQueue();
+
+        testOk(monitor->_deferredCount == 2 && monitor->_sentCount == 0,
+               "%s: monitor->_deferredCount == 2 && monitor->_sentCount == 0 (%u, %u)", CURRENT_FUNCTION,
+               (unsigned)monitor->_deferredCount, (unsigned)monitor->_sentCount);
+        testOk(codec._armSendDrainCount == 2,
+               "%s: codec._armSendDrainCount == 2 (%u)", CURRENT_FUNCTION, (unsigned)codec._armSendDrainCount);
+        testOk(codec._armSendDrainLow == 100,
+               "%s: codec._armSendDrainLow == 100 (%u)", CURRENT_FUNCTION, (unsigned)codec._armSendDrainLow);
+        testOk(monitor->sendDeferred, "%s: monitor->sendDeferred", CURRENT_FUNCTION);
+
+        // socket drained, as on EPOLLOUT
+        codec._unsentSocketBytes = 0;
+        codec.processSendQueue();
+
+        testOk(monitor->_sentCount == 1,
+               "%s: monitor->_sentCount == 1 (%u)", CURRENT_FUNCTION, (unsigned)monitor->_sentCount);
+        testOk(!monitor->sendDeferred, "%s: !monitor->sendDeferred", CURRENT_FUNCTION);
+    }
+
+
+    void testResumableRead()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+        codec.setResumableIO();
+        codec._readPayload = true;
+
+        // header, and half of the payload
+        codec._readBuffer->put(PVA_MAGIC);
+        codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+        codec._readBuffer->put((int8_t)0x80);
+        codec._readBuffer->put((int8_t)0x23);
+        codec._readBuffer->putInt(4);
+        codec._readBuffer->put((int8_t)1);
+        codec._readBuffer->put((int8_t)2);
+        codec._readBuffer->flip();
+
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 0,
+               "%s: incomplete message not processed", CURRENT_FUNCTION);
+        testOk(codec._readPollOneCount == 0,
+               "%s: codec._readPollOneCount == 0", CURRENT_FUNCTION);
+        testOk(codec._closedCount == 0 && codec._invalidDataStreamCount == 0,
+               "%s: connection not closed", CURRENT_FUNCTION);
+
+        codec._readBuffer->clear();
+        codec._readBuffer->put((int8_t)3);
+        codec._readBuffer->put((int8_t)4);
+        codec._readBuffer->flip();
+
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 1,
+               "%s: codec._receivedAppMessages.size() == 1", CURRENT_FUNCTION);
+        if (codec._receivedAppMessages.size() == 1)
+        {
+            PVAMessage& msg = codec._receivedAppMessages[0];
+            msg._payload->flip();
+            testOk(msg._command == 0x23 && msg._payload->getLimit() == 4
+                   && msg._payload->getByte(0) == 1 && msg._payload->getByte(3) == 4,
+                   "%s: complete payload", CURRENT_FUNCTION);
+        }
+        else
+            testFail("%s: complete payload", CURRENT_FUNCTION);
+        testOk(codec._readPollOneCount == 0,
+               "%s: codec._readPollOneCount == 0", CURRENT_FUNCTION);
+    }
+
+
+    void testResumableSegmentedRead()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+        codec.setResumableIO();
+        codec._readPayload = true;
+        codec._forcePayloadRead = 4;
+
+        // first segment
+        codec._readBuffer->put(PVA_MAGIC);
+        codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+        codec._readBuffer->put((int8_t)(0x80 | 0x10));
+        codec._readBuffer->put((int8_t)0x23);
+        codec._readBuffer->putInt(2);
+        codec._readBuffer->put((int8_t)1);
+        codec._readBuffer->put((int8_t)2);
+        codec._readBuffer->flip();
+
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 0,
+               "%s: not processed before the last segment", CURRENT_FUNCTION);
+
+        // last segment
+        codec._readBuffer->clear();
+        codec._readBuffer->put(PVA_MAGIC);
+        codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+        codec._readBuffer->put((int8_t)(0x80 | 0x20));
+        codec._readBuffer->put((int8_t)0x23);
+        codec._readBuffer->putInt(2);
+        codec._readBuffer->put((int8_t)3);
+        codec._readBuffer->put((int8_t)4);
+        codec._readBuffer->flip();
+
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 1,
+               "%s: codec._receivedAppMessages.size() == 1", CURRENT_FUNCTION);
+        testOk(codec._readPollOneCount == 0 && codec._closedCount == 0,
+               "%s: no wait, not closed", CURRENT_FUNCTION);
+    }
+
+
+    // a header claiming a payload beyond what the buffer may grow to closes the connection
+    void testResumableReadTooLarge()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+
+        for (int segmented = 0; segmented < 2; segmented++)
+        {
+            TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+            codec.setResumableIO();
+            codec._readPayload = true;
+
+            if (!segmented)
+            {
+                // almost 4 GB, as the payload size is unsigned
+                codec._readBuffer->put(PVA_MAGIC);
+                codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+                codec._readBuffer->put((int8_t)0x80);
+                codec._readBuffer->put((int8_t)0x23);
+                codec._readBuffer->putInt((int32_t)0xfffffff0);
+            }
+            else
+            {
+                // each segment is allowed, but not their sum
+                codec.setMaxMessageSize(64*1024);
+                codec._readBuffer.reset(new ByteBuffer(128*1024));
+                for (int i = 0; i < 2; i++)
+                {
+                    codec._readBuffer->put(PVA_MAGIC);
+                    codec._readBuffer->put(PVA_CLIENT_PROTOCOL_REVISION);
+                    codec._readBuffer->put((int8_t)(0x80 | (i==0 ? 0x10 : 0x20)));
+                    codec._readBuffer->put((int8_t)0x23);
+                    codec._readBuffer->putInt(40*1024);
+                    if (i==0)
+                        for (int j = 0; j < 40*1024; j++)
+                            codec._readBuffer->put((int8_t)j);
+                }
+            }
+            codec._readBuffer->flip();
+
+            codec.processRead();
+
+            testOk(codec._invalidDataStreamCount == 1,
+                   "%s: %s: codec._invalidDataStreamCount == 1", CURRENT_FUNCTION,
+                   segmented ? "segmented" : "single");
+            testOk(codec._receivedAppMessages.size() == 0,
+                   "%s: codec._receivedAppMessages.size() == 0", CURRENT_FUNCTION);
+            testOk(codec.getSocketBuffer()->getSize() < 128*1024,
+                   "%s: receive buffer not grown beyond the limit (%u)", CURRENT_FUNCTION,
+                   (unsigned)codec.getSocketBuffer()->getSize());
+        }
+    }
+
+
+    void testResumableWrite()
+    {
+        testDiag("BEGIN TEST %s:", CURRENT_FUNCTION);
+        TestCodec codec(DEFAULT_BUFFER_SIZE,DEFAULT_BUFFER_SIZE);
+        codec.setResumableIO();
+
+        std::tr1::shared_ptr<TransportSenderForTestSendBackpressure> first(
+            new TransportSenderForTestSendBackpressure(codec, 100, false));
+        std::tr1::shared_ptr<TransportSenderForTestSendBackpressure> second(
+            new TransportSenderForTestSendBackpressure(codec, 100, false));
+
+        // socket accepts nothing
+        codec._writeFull = true;
+        codec.enqueueSendRequest(first);
+        codec.processSendQueue();
+
+        testOk(first->_sentCount == 1 && codec.unsentBytes(),
+               "%s: message kept for sending", CURRENT_FUNCTION);
+        testOk(codec._armWritableCount == 1,
+               "%s: codec._armWritableCount == 1 (%u)", CURRENT_FUNCTION, (unsigned)codec._armWritableCount);
+        testOk(codec._sendBufferFullCount == 0 && codec._writePollOneCount == 0,
+               "%s: did not wait", CURRENT_FUNCTION);
+
+        // still full, so the next sender waits in the queue
+        codec.enqueueSendRequest(second);
+        codec.processSendQueue();
+
+        testOk(second->_sentCount == 0,
+               "%s: second->_sentCount == 0", CURRENT_FUNCTION);
+
+        // writable again
+        codec._writeFull = false;
+        codec.processSendQueue();
+
+        testOk(second->_sentCount == 1 && !codec.unsentBytes(),
+               "%s: all sent once writable", CURRENT_FUNCTION);
+
+        codec._readPayload = true;
+        codec.transferToReadBuffer();
+        codec.processRead();
+
+        testOk(codec._receivedAppMessages.size() == 2,
+               "%s: codec._receivedAppMessages.size() == 2", CURRENT_FUNCTION);
+    }
+
+
     void testRecipient()
     {
         // nothing to test, depends on implementation
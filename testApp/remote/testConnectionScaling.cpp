@@ -0,0 +1,215 @@
+/* Measure resource usage and latency as the number of TCP connections grows.
+ *
+ * Runs an in-process server and N client contexts, each of which opens its
+ * own TCP connection.  Compare per-connection threads with the I/O reactor:
+ *
+ *   testConnectionScaling -n 1000
+ *   testConnectionScaling -n 1000 -S 4 -C 4
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
+#include <epicsGetopt.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_CONNECTIONS 100
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_TIMEOUT 10.0
+
+int connections = DEFAULT_CONNECTIONS;
+int iterations = DEFAULT_ITERATIONS;
+int serverThreads = 0;
+int clientThreads = 0;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testConnectionScaling [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -n <connections>:  number of client contexts, each with one TCP connection, default is '%d'\n"
+             "  -i <iterations>:   number of get operations per connection, default is '%d'\n"
+             "  -S <threads>:      server $EPICS_PVAS_IO_THREADS (0 means thread per connection), default is '0'\n"
+             "  -C <threads>:      client $EPICS_PVA_IO_THREADS (0 means thread per connection), default is '0'\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             , DEFAULT_CONNECTIONS, DEFAULT_ITERATIONS, DEFAULT_TIMEOUT);
+}
+
+// number of threads in this process, or -1 if unknown
+long threadCount()
+{
+    std::ifstream strm("/proc/self/status");
+    std::string line;
+    while(std::getline(strm, line)) {
+        if(line.compare(0, 8, "Threads:")==0)
+            return atol(line.c_str()+8);
+    }
+    return -1;
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hn:i:S:C:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            connections = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'S':
+            serverThreads = atoi(optarg);
+            break;
+        case 'C':
+            clientThreads = atoi(optarg);
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testConnectionScaling -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testConnectionScaling -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testConnectionScaling -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    try {
+        char sthreads[16], cthreads[16];
+        epicsSnprintf(sthreads, sizeof(sthreads), "%d", serverThreads);
+        epicsSnprintf(cthreads, sizeof(cthreads), "%d", clientThreads);
+
+        const long baseThreads = threadCount();
+
+        pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                    ->add("value", pvd::pvInt)
+                                    ->createStructure());
+
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+        pv->open(type);
+
+        pvas::StaticProvider sprov("scaling");
+        sprov.add("scaling:pv", pv);
+
+        pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                    pva::ServerContext::Config()
+                    .provider(sprov.provider())
+                    .config(pva::ConfigurationBuilder()
+                            .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                            .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                            .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                            .add("EPICS_PVA_SERVER_PORT", "0")
+                            .add("EPICS_PVA_BROADCAST_PORT", "0")
+                            .add("EPICS_PVAS_IO_THREADS", sthreads)
+                            .push_map()
+                            .build())));
+
+        pva::Configuration::shared_pointer cliconf(pva::ConfigurationBuilder()
+                                                   .push_config(server->getCurrentConfig())
+                                                   .add("EPICS_PVA_IO_THREADS", cthreads)
+                                                   .push_map()
+                                                   .build());
+
+        const long serverOnlyThreads = threadCount();
+
+        std::vector<pvac::ClientProvider> clients;
+        std::vector<pvac::ClientChannel> channels;
+        clients.reserve(connections);
+        channels.reserve(connections);
+
+        epicsTimeStamp start;
+        epicsTimeGetCurrent(&start);
+
+        for(int i=0; i<connections; i++) {
+            clients.push_back(pvac::ClientProvider("pva", cliconf));
+            channels.push_back(clients.back().connect("scaling:pv"));
+        }
+
+        // first get() completes the connection
+        for(int i=0; i<connections; i++)
+            channels[i].get(timeOut);
+
+        const double connectTime = elapsed(start);
+        const long connectedThreads = threadCount();
+
+        epicsTimeGetCurrent(&start);
+        for(int n=0; n<iterations; n++) {
+            for(int i=0; i<connections; i++)
+                channels[i].get(timeOut);
+        }
+        const double getTime = elapsed(start);
+        const double nops = double(iterations)*connections;
+
+        printf("connections: %d, server I/O threads: %d, client I/O threads: %d\n",
+               connections, serverThreads, clientThreads);
+        printf("threads: base %ld, server %ld, connected %ld (%.2f per connection)\n",
+               baseThreads, serverOnlyThreads, connectedThreads,
+               connections ? double(connectedThreads-serverOnlyThreads)/connections : 0.0);
+        printf("connect: %f s total, %f ms per connection\n",
+               connectTime, connections ? connectTime*1e3/connections : 0.0);
+        if(nops>0)
+            printf("get: %f ops/s, %f us mean latency\n",
+                   nops/getTime, getTime*1e6/nops);
+
+        channels.clear();
+        clients.clear();
+        server->shutdown();
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
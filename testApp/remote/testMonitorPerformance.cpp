@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <string>
+#include <set>
 
 #include <stdlib.h>
 
@@ -23,6 +24,11 @@
 #endif
 
 #include <pv/event.h>
+#include <pv/thread.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
 
 using namespace std;
 namespace TR1 = std::tr1;
@@ -35,6 +41,7 @@ using namespace epics::pvAccess;
 #define DEFAULT_CHANNELS 1
 #define DEFAULT_ARRAY_SIZE 0
 #define DEFAULT_RUNS 1
+#define DEFAULT_BATCH -1
 
 bool verbose = false;
 
@@ -42,6 +49,7 @@ int iterations = DEFAULT_ITERATIONS;
 int channels = DEFAULT_CHANNELS;
 int runs = DEFAULT_RUNS;
 int arraySize = DEFAULT_ARRAY_SIZE;          // 0 means scalar
+int serverBatch = DEFAULT_BATCH;             // <0 means use an external server
 Mutex waitLoopPtrMutex;
 TR1::shared_ptr<Event> waitLoopEvent;
 
@@ -80,10 +88,119 @@ void usage (void)
              "                         each test is defined by a \"<c> <s> <i> <l>\" line\n"
              "                         output is a space separated list of get operations per second for each run, one line per test\n"
              "  -v                 enable verbose output when configuration is read from the file\n"
+             "  -B <batch>:        run an in-process server, which posts continuously, with $EPICS_PVAS_MONITOR_BATCH=<batch>\n"
+             "                         compare eg. '-B 1' with '-B 16'.  Default is to use an external server (eg. testServer)\n"
              "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
              , DEFAULT_REQUEST, DEFAULT_ITERATIONS, DEFAULT_CHANNELS, DEFAULT_ARRAY_SIZE, DEFAULT_RUNS, DEFAULT_TIMEOUT);
 }
 
+// in-process server, when serverBatch>=0
+struct LocalServer
+{
+    pvas::StaticProvider sprov;
+    ServerContext::shared_pointer server;
+
+    Mutex mutex;
+    bool running;
+    struct PV {
+        pvas::SharedPV::shared_pointer pv;
+        PVStructure::shared_pointer root;
+        BitSet changed;
+    };
+    vector<PV> pvs;
+    set<string> names;
+
+    TR1::shared_ptr<epics::pvData::Thread> poster;
+
+    LocalServer(int batch)
+        :sprov("testMonitorPerformance")
+        ,running(true)
+    {
+        char buf[16];
+        sprintf(buf, "%d", batch);
+
+        server = ServerContext::create(ServerContext::Config()
+                                       .provider(sprov.provider())
+                                       .config(ConfigurationBuilder()
+                                               .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                                               .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                                               .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                                               .add("EPICS_PVA_SERVER_PORT", "0")
+                                               .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                               .add("EPICS_PVAS_MONITOR_BATCH", buf)
+                                               .push_map()
+                                               .build()));
+
+        poster.reset(new epics::pvData::Thread(epics::pvData::Thread::Config(this, &LocalServer::run)
+                                               .name("poster")
+                                               .autostart(true)));
+    }
+
+    ~LocalServer()
+    {
+        {
+            Lock G(mutex);
+            running = false;
+        }
+        poster->exitWait();
+        server->shutdown();
+    }
+
+    void addPV(const string& name)
+    {
+        if(names.find(name)!=names.end())
+            return;
+        names.insert(name);
+
+        FieldBuilderPtr builder(getFieldCreate()->createFieldBuilder());
+        if(arraySize > 0)
+            builder->addArray("value", pvDouble);
+        else
+            builder->add("value", pvDouble);
+
+        PV ent;
+        ent.root = getPVDataCreate()->createPVStructure(builder->createStructure());
+        ent.changed.set(ent.root->getSubFieldT("value")->getFieldOffset());
+        if(arraySize > 0) {
+            PVDoubleArray::svector arr(arraySize, 0.0);
+            ent.root->getSubFieldT<PVDoubleArray>("value")->replace(freeze(arr));
+        }
+        ent.pv = pvas::SharedPV::buildMailbox();
+        ent.pv->open(*ent.root, ent.changed);
+        sprov.add(name, ent.pv);
+
+        Lock G(mutex);
+        pvs.push_back(ent);
+    }
+
+    void run()
+    {
+        double count = 0.0;
+        while(true) {
+            vector<PV> current;
+            {
+                Lock G(mutex);
+                if(!running)
+                    break;
+                current = pvs;
+            }
+            if(current.empty()) {
+                epicsThreadSleep(0.1);
+                continue;
+            }
+
+            count += 1.0;
+            for(size_t i=0; i<current.size(); i++) {
+                PVScalar::shared_pointer scalar(current[i].root->getSubField<PVScalar>("value"));
+                if(scalar)
+                    scalar->putFrom(count);
+                current[i].pv->post(*current[i].root, current[i].changed);
+            }
+        }
+    }
+};
+TR1::shared_ptr<LocalServer> localServer;
+
 // TODO thread-safety
 ChannelProvider::shared_pointer provider;
 vector<Monitor::shared_pointer> channelMonitorList;
@@ -290,6 +407,8 @@ void runTest()
         else
             sprintf(buf, "test%d", i);
         channelNames.push_back(buf);
+        if (localServer)
+            localServer->addPV(buf);
     }
 
     vector<Channel::shared_pointer> channels;
@@ -374,7 +493,7 @@ int main (int argc, char *argv[])
 
     setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
 
-    while ((opt = getopt(argc, argv, ":hr:w:i:c:s:l:f:v")) != -1) {
+    while ((opt = getopt(argc, argv, ":hr:w:i:c:s:l:f:vB:")) != -1) {
         switch (opt) {
         case 'h':               // Print usage
             usage();
@@ -408,6 +527,9 @@ int main (int argc, char *argv[])
         case 'v':               // testFile
             verbose = true;
             break;
+        case 'B':               // in-process server batch size
+            serverBatch = atoi(optarg);
+            break;
         case '?':
             fprintf(stderr,
                     "Unrecognized option: '-%c'. ('testGetPerformance -h' for help.)\n",
@@ -434,7 +556,15 @@ int main (int argc, char *argv[])
     }
 
     ClientFactory::start();
-    provider = ChannelProviderRegistry::clients()->getProvider("pva");
+    if (serverBatch >= 0)
+    {
+        localServer.reset(new LocalServer(serverBatch));
+        provider = ChannelProviderRegistry::clients()->createProvider("pva", localServer->server->getCurrentConfig());
+        if (verbose)
+            printf("in-process server with EPICS_PVAS_MONITOR_BATCH=%d\n", serverBatch);
+    }
+    else
+        provider = ChannelProviderRegistry::clients()->getProvider("pva");
 
     if (!testFile.empty())
     {
@@ -488,6 +618,9 @@ int main (int argc, char *argv[])
         runTest();
     }
 
+    provider.reset();
+    localServer.reset();
+
     //ClientFactory::stop();
 
     return 0;
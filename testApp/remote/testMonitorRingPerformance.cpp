@@ -0,0 +1,215 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/* Compare producer/consumer throughput of MonitorFIFO and MonitorRing.
+ * One thread post()s as fast as it can while another poll()s.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsGetopt.h>
+
+#include <pv/pvAccess.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_COUNT 200000
+#define DEFAULT_QUEUE 4
+#define DEFAULT_RUNS 1
+
+const pvd::PVStructure::const_shared_pointer pvReqEmpty(pvd::getPVDataCreate()->createPVStructure(
+                                                            pvd::getFieldCreate()->createFieldBuilder()
+                                                              ->createStructure()));
+
+pvd::StructureConstPtr intType()
+{
+    return pvd::getFieldCreate()->createFieldBuilder()
+            ->add("value", pvd::pvInt)
+            ->createStructure();
+}
+
+struct BenchRequester : public pva::MonitorRequester {
+    POINTER_DEFINITIONS(BenchRequester);
+    epicsEvent wakeup;
+    size_t events;
+    BenchRequester() :events(0u) {}
+    virtual ~BenchRequester() {}
+    virtual std::string getRequesterName() OVERRIDE FINAL {return "BenchRequester";}
+    virtual void channelDisconnect(bool destroy) OVERRIDE FINAL {}
+    virtual void monitorConnect(epics::pvData::Status const & status,
+        pva::MonitorPtr const & monitor, epics::pvData::StructureConstPtr const & structure) OVERRIDE FINAL {}
+    virtual void monitorEvent(pva::MonitorPtr const & monitor) OVERRIDE FINAL {
+        events++;
+        wakeup.signal();
+    }
+    virtual void unlisten(pva::MonitorPtr const & monitor) OVERRIDE FINAL {}
+};
+
+std::tr1::shared_ptr<pva::MonitorFIFO> makeMonitor(pva::MonitorFIFO*,
+                                                   const BenchRequester::shared_pointer& req,
+                                                   pva::MonitorFIFO::Config *conf)
+{
+    return std::tr1::shared_ptr<pva::MonitorFIFO>(new pva::MonitorFIFO(req, pvReqEmpty,
+                                                                       pva::MonitorFIFO::Source::shared_pointer(), conf));
+}
+
+std::tr1::shared_ptr<pva::MonitorRing> makeMonitor(pva::MonitorRing*,
+                                                   const BenchRequester::shared_pointer& req,
+                                                   pva::MonitorFIFO::Config *conf)
+{
+    return std::tr1::shared_ptr<pva::MonitorRing>(new pva::MonitorRing(req, pvReqEmpty, conf));
+}
+
+template<typename MON>
+struct BenchProducer : public epicsThreadRunable {
+    MON& mon;
+    const pvd::int32 count;
+    epicsThread thread;
+
+    BenchProducer(MON& mon, pvd::int32 count)
+        :mon(mon)
+        ,count(count)
+        ,thread(*this, "producer", epicsThreadGetStackSize(epicsThreadStackSmall))
+    {}
+    virtual ~BenchProducer() {}
+
+    virtual void run() OVERRIDE FINAL {
+        const pvd::StructureConstPtr type(intType());
+        pvd::PVStructurePtr V(pvd::getPVDataCreate()->createPVStructure(type));
+        pvd::PVIntPtr fld(V->getSubFieldT<pvd::PVInt>("value"));
+        pvd::BitSet changed;
+        changed.set(fld->getFieldOffset());
+
+        for(pvd::int32 i=0; i<count; i++) {
+            fld->put(i);
+            mon.post(*V, changed);
+            mon.notify();
+        }
+    }
+};
+
+template<typename MON>
+bool benchContention(const char *name, pvd::int32 count, size_t queueSize)
+{
+    pva::MonitorFIFO::Config conf;
+    conf.maxCount = conf.defCount = queueSize;
+    BenchRequester::shared_pointer requester(new BenchRequester);
+    std::tr1::shared_ptr<MON> mon(makeMonitor((MON*)0, requester, &conf));
+
+    mon->open(intType());
+    mon->start();
+    mon->notify();
+
+    BenchProducer<MON> producer(*mon, count);
+
+    epicsTimeStamp start, end;
+    epicsTimeGetCurrent(&start);
+
+    producer.thread.start();
+
+    bool ordered = true;
+    pvd::int32 last = -1;
+    size_t received = 0u, overruns = 0u;
+
+    while(last != count-1) {
+        bool any = false;
+        for(pva::MonitorElement::Ref it(mon); it; ++it) {
+            pvd::int32 val = it->pvStructurePtr->getSubFieldT<pvd::PVInt>("value")->get();
+            ordered &= val > last;
+            last = val;
+            received++;
+            if(!it->overrunBitSet->isEmpty())
+                overruns++;
+            any = true;
+        }
+        if(!any)
+            requester->wakeup.wait(0.1);
+    }
+
+    epicsTimeGetCurrent(&end);
+    producer.thread.exitWait();
+
+    const double duration = epicsTimeDiffInSeconds(&end, &start);
+
+    printf("%s: %.0f posts/s, received %u (%u with overrun), %u events%s\n",
+           name, count/duration, (unsigned)received, (unsigned)overruns, (unsigned)requester->events,
+           ordered ? "" : ", OUT OF ORDER");
+
+    mon->close();
+    return ordered;
+}
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testMonitorRingPerformance [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -i <iterations>:   number of post()s per run, default is %d\n"
+             "  -q <queue size>:   monitor queue size, default is %d\n"
+             "  -l <runs>:         number of runs, default is %d\n\n",
+             DEFAULT_COUNT, DEFAULT_QUEUE, DEFAULT_RUNS);
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    int count = DEFAULT_COUNT;
+    int queueSize = DEFAULT_QUEUE;
+    int runs = DEFAULT_RUNS;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hi:q:l:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'i':
+            count = atoi(optarg);
+            break;
+        case 'q':
+            queueSize = atoi(optarg);
+            break;
+        case 'l':
+            runs = atoi(optarg);
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testMonitorRingPerformance -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testMonitorRingPerformance -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(count <= 0 || queueSize < 2) {
+        usage();
+        return 1;
+    }
+
+    bool ok = true;
+    for(int i=0; i<runs; i++) {
+        ok &= benchContention<pva::MonitorFIFO>("MonitorFIFO", count, queueSize);
+        ok &= benchContention<pva::MonitorRing>("MonitorRing", count, queueSize);
+    }
+
+    return ok ? 0 : 1;
+}
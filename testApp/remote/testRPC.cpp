@@ -1,4 +1,13 @@
 
+#include <string.h>
+
+#include <sstream>
+
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+
 #include <pv/epicsException.h>
 #include <pv/valueBuilder.h>
 
@@ -13,6 +22,9 @@
 namespace pvd = epics::pvData;
 namespace pva = epics::pvAccess;
 
+typedef epicsGuard<epicsMutex> Guard;
+typedef epicsGuardRelease<epicsMutex> UnGuard;
+
 namespace {
 
 pvd::StructureConstPtr reply_type(pvd::getFieldCreate()->createFieldBuilder()
@@ -106,11 +118,245 @@ void testRPCFail(const pva::ChannelProvider::shared_pointer& cli_prov)
     }
 }
 
+void testStats(const pva::RPCServer& serv)
+{
+    testDiag("Stats");
+
+    std::vector<pva::RPCServer::ServiceStats> stats;
+    serv.stats(stats);
+    testOk(stats.size()==2u, "%u services", (unsigned)stats.size());
+
+    for(size_t i=0; i<stats.size(); i++) {
+        const pva::RPCServer::ServiceStats& S = stats[i];
+        size_t binned = 0u;
+        for(size_t b=0; b<pva::RPCServer::nLatencyBins; b++)
+            binned += S.latency[b];
+        testOk(S.completed==1u && binned==1u && S.running==0u && S.queued==0u && S.rejected==0u,
+               "%s completed=%u binned=%u running=%u queued=%u rejected=%u", S.name.c_str(),
+               (unsigned)S.completed, (unsigned)binned, (unsigned)S.running, (unsigned)S.queued, (unsigned)S.rejected);
+    }
+}
+
+// Holds each request until open()
+struct GateService : public pva::RPCService
+{
+    POINTER_DEFINITIONS(GateService);
+
+    epicsMutex lock;
+    epicsEvent entry, change;
+    size_t entered;
+    bool opened;
+
+    GateService() :entered(0u), opened(false) {}
+
+    virtual epics::pvData::PVStructure::shared_pointer request(
+        epics::pvData::PVStructure::shared_pointer const & args
+    ) OVERRIDE FINAL
+    {
+        {
+            Guard G(lock);
+            entered++;
+        }
+        entry.signal();
+        {
+            Guard G(lock);
+            while(!opened) {
+                UnGuard U(G);
+                change.wait();
+            }
+        }
+        change.signal(); // let the next one through
+
+        pvd::PVStructure::shared_pointer reply(pvd::getPVDataCreate()->createPVStructure(reply_type));
+        reply->getSubFieldT<pvd::PVDouble>("value")->put(1.0);
+        return reply;
+    }
+
+    size_t count()
+    {
+        Guard G(lock);
+        return entered;
+    }
+
+    bool waitEntered(size_t n)
+    {
+        while(count() < n)
+            if(!entry.wait(5.0))
+                return false;
+        return true;
+    }
+
+    void open()
+    {
+        {
+            Guard G(lock);
+            opened = true;
+        }
+        change.signal();
+    }
+};
+
+pvd::PVStructurePtr makeArgs(const std::string& path, const std::string& op = std::string())
+{
+    pvd::ValueBuilder args("epics:nt/NTURI:1.0");
+    args.add<pvd::pvString>("scheme", "pva")
+        .add<pvd::pvString>("path", path);
+    return args.addNested("query")
+                   .add<pvd::pvString>("op", op)
+               .endNested()
+               .buildPVStructure();
+}
+
+pva::RPCServer::ServiceStats serviceStats(const pva::RPCServer& serv, const std::string& name)
+{
+    std::vector<pva::RPCServer::ServiceStats> stats;
+    serv.stats(stats);
+    for(size_t i=0; i<stats.size(); i++)
+        if(stats[i].name==name)
+            return stats[i];
+    testAbort("No stats for %s", name.c_str());
+    return stats.at(0); // not reached
+}
+
+bool waitQueued(const pva::RPCServer& serv, const std::string& name, size_t n)
+{
+    for(unsigned i=0; i<500u; i++) {
+        if(serviceStats(serv, name).queued >= n)
+            return true;
+        epicsThreadSleep(0.01);
+    }
+    return false;
+}
+
+typedef std::vector<std::tr1::shared_ptr<pva::RPCClient> > clients_t;
+
+void connectClients(clients_t& clients, size_t n, const std::string& name,
+                    const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    for(size_t i=0; i<n; i++) {
+        clients.push_back(std::tr1::shared_ptr<pva::RPCClient>(new pva::RPCClient(name, pvd::createRequest("field()"), cli_prov)));
+        if(!clients.back()->connect(5.0))
+            testAbort("%s not connected", name.c_str());
+    }
+}
+
+// number of clients with a successful reply
+size_t waitReplies(clients_t& clients)
+{
+    size_t ok = 0u;
+    for(size_t i=0; i<clients.size(); i++) {
+        try {
+            if(clients[i]->waitResponse(5.0))
+                ok++;
+        }catch(std::exception& e){
+            testDiag("client %u: %s", (unsigned)i, e.what());
+        }
+    }
+    return ok;
+}
+
+void testLimits(pva::RPCServer& serv, const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("Limits");
+
+    GateService::shared_pointer gate(new GateService);
+    pva::RPCServer::ServiceLimits limits;
+    limits.maxConcurrent = 1u;
+    limits.maxQueue = 1u;
+    serv.registerService("gate", gate, limits);
+
+    clients_t clients;
+    connectClients(clients, 3u, "gate", cli_prov);
+
+    clients[0]->issueRequest(makeArgs("gate"));
+    testOk(gate->waitEntered(1u), "first request running");
+
+    clients[1]->issueRequest(makeArgs("gate"));
+    testOk(waitQueued(serv, "gate", 1u), "second request queued");
+    epicsThreadSleep(0.1);
+    testOk(gate->count()==1u, "second request held back by maxConcurrent, %u running", (unsigned)gate->count());
+
+    clients[2]->issueRequest(makeArgs("gate"));
+    try {
+        (void)clients[2]->waitResponse(5.0);
+        testFail("third request not rejected");
+    }catch(pva::RPCRequestException& e){
+        testOk(strstr(e.what(), "too many requests")!=0, "third request rejected: %s", e.what());
+    }
+    clients.pop_back();
+
+    gate->open();
+    testOk1(waitReplies(clients)==2u);
+
+    pva::RPCServer::ServiceStats S(serviceStats(serv, "gate"));
+    testOk(S.completed==2u && S.rejected==1u && S.running==0u && S.queued==0u,
+           "gate completed=%u rejected=%u running=%u queued=%u",
+           (unsigned)S.completed, (unsigned)S.rejected, (unsigned)S.running, (unsigned)S.queued);
+}
+
+// By default, a slow service leaves one worker for the others
+void testDefaultLimits(pva::RPCServer& serv, const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("Default limits");
+
+    GateService::shared_pointer gate(new GateService);
+    serv.registerService("slow", gate);
+
+    clients_t clients;
+    connectClients(clients, 4u, "slow", cli_prov);
+    for(size_t i=0; i<clients.size(); i++)
+        clients[i]->issueRequest(makeArgs("slow"));
+
+    testOk(gate->waitEntered(3u), "3 requests running");
+    testOk(waitQueued(serv, "slow", 1u), "4th request queued");
+    epicsThreadSleep(0.1);
+    testOk(gate->count()==3u, "%u requests running", (unsigned)gate->count());
+
+    try {
+        pva::RPCClient client("sum", pvd::createRequest("field()"), cli_prov);
+        pvd::ValueBuilder args("epics:nt/NTURI:1.0");
+        args.add<pvd::pvString>("scheme", "pva")
+            .add<pvd::pvString>("path", "sum");
+        pvd::PVStructurePtr reply(client.request(args.addNested("query")
+                                                     .add<pvd::pvDouble>("lhs", 1.0)
+                                                     .add<pvd::pvDouble>("rhs", 2.0)
+                                                 .endNested()
+                                                 .buildPVStructure(), 5.0));
+        testOk(reply->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::int32>()==3, "sum served while slow is busy");
+    }catch(std::exception& e){
+        testFail("sum not served while slow is busy: %s", e.what());
+    }
+
+    gate->open();
+    testOk1(waitReplies(clients)==4u);
+}
+
+void testServerRPCStats(pva::RPCServer& serv, const pva::ChannelProvider::shared_pointer& cli_prov)
+{
+    testDiag("server op=rpc");
+
+    // the "server" channel is not searched for, so needs an address
+    std::ostringstream addr;
+    addr<<"127.0.0.1:"<<serv.getServer()->getServerPort();
+    pva::RPCClient client("server", pvd::createRequest("field()"), cli_prov, addr.str());
+    pvd::PVStructurePtr reply(client.request(makeArgs("server", "rpc"), 5.0));
+
+    testOk(reply->getStructure()->getID()=="epics:nt/NTTable:1.0", "reply is %s", reply->getStructure()->getID().c_str());
+
+    pvd::PVStringArray::const_svector names(reply->getSubFieldT<pvd::PVStringArray>("value.name")->view());
+    pvd::PVULongArray::const_svector completed(reply->getSubFieldT<pvd::PVULongArray>("value.completed")->view());
+    size_t sum = 0u;
+    for(size_t i=0; i<names.size() && i<completed.size(); i++)
+        if(names[i]=="sum")
+            sum = completed[i];
+    testOk(sum==2u, "sum completed %u", (unsigned)sum);
+}
+
 } // namespace
 
 MAIN(testRPC)
 {
-    testPlan(3);
+    testPlan(19);
     try {
         pva::Configuration::shared_pointer conf(pva::ConfigurationBuilder()
                                                 //.push_env()
@@ -120,6 +366,7 @@ MAIN(testRPC)
                                                 .add("EPICS_PVA_AUTO_ADDR_LIST","0")
                                                 .add("EPICS_PVA_SERVER_PORT", "0")
                                                 .add("EPICS_PVA_BROADCAST_PORT", "0")
+                                                .add("EPICS_PVAS_RPC_THREADS", "4")
                                                 .push_map()
                                                 .build());
 
@@ -148,6 +395,10 @@ MAIN(testRPC)
 
         testSum(cli_prov);
         testRPCFail(cli_prov);
+        testStats(serv);
+        testLimits(serv, cli_prov);
+        testDefaultLimits(serv, cli_prov);
+        testServerRPCStats(serv, cli_prov);
 
     }catch(std::exception& e){
         PRINT_EXCEPTION(e);
@@ -0,0 +1,227 @@
+/* Measure client startup connect time as the number of channels grows.
+ *
+ * For each channel count, runs an in-process server with that many PVs,
+ * and a new client context which connects to all of them at once, as an
+ * application does on startup.  Both are bound to the loopback interface.
+ * The client searches with frames filled up to $EPICS_PVA_SEARCH_MTU.
+ *
+ *   testSearchStartup
+ *   testSearchStartup -s 1000 -n 100000 -m 9000
+ */
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_START 100
+#define DEFAULT_CHANNELS 100000
+#define DEFAULT_MTU 1500
+#define DEFAULT_TIMEOUT 60.0
+
+int nstart = DEFAULT_START;
+int nchannels = DEFAULT_CHANNELS;
+int mtu = DEFAULT_MTU;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testSearchStartup [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -s <channels>:     smallest number of channels, default is '%d'\n"
+             "  -n <channels>:     largest number of channels, default is '%d'\n"
+             "  -m <mtu>:          $EPICS_PVA_SEARCH_MTU of the client, default is '%d'\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             "Channel count is multiplied by 10 from -s up to -n.\n\n"
+             , DEFAULT_START, DEFAULT_CHANNELS, DEFAULT_MTU, DEFAULT_TIMEOUT);
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+struct GetWaiter : public pvac::ClientChannel::GetCallback
+{
+    epicsMutex mutex;
+    epicsEvent done;
+    size_t remaining, failed;
+
+    explicit GetWaiter(size_t n) :remaining(n), failed(0u) {}
+
+    virtual void getDone(const pvac::GetEvent& evt) OVERRIDE FINAL
+    {
+        bool last;
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            if(evt.event!=pvac::GetEvent::Success)
+                failed++;
+            last = --remaining==0u;
+        }
+        if(last)
+            done.signal();
+    }
+};
+
+bool run(int count)
+{
+    pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                ->add("value", pvd::pvInt)
+                                ->createStructure());
+
+    pvas::StaticProvider sprov("searchstartup");
+    std::vector<std::string> names(count);
+    for(int i=0; i<count; i++) {
+        char name[40];
+        epicsSnprintf(name, sizeof(name), "searchstartup:%d", i);
+        names[i] = name;
+
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+        pv->open(type);
+        sprov.add(names[i], pv);
+    }
+
+    pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                pva::ServerContext::Config()
+                .provider(sprov.provider())
+                .config(pva::ConfigurationBuilder()
+                        .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                        .add("EPICS_PVA_SERVER_PORT", "0")
+                        .add("EPICS_PVA_BROADCAST_PORT", "0")
+                        .push_map()
+                        .build())));
+
+    pvac::ClientProvider client("pva", pva::ConfigurationBuilder()
+                                .push_config(server->getCurrentConfig())
+                                .add("EPICS_PVA_SEARCH_MTU", mtu)
+                                .push_map()
+                                .build());
+
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+
+    std::vector<pvac::ClientChannel> channels;
+    channels.reserve(count);
+    for(int i=0; i<count; i++)
+        channels.push_back(client.connect(names[i]));
+
+    // first get() completes the connection
+    GetWaiter waiter(channels.size());
+    std::vector<pvac::Operation> ops;
+    ops.reserve(channels.size());
+    for(size_t i=0; i<channels.size(); i++)
+        ops.push_back(channels[i].get(&waiter));
+
+    bool ok = waiter.done.wait(timeOut);
+    const double connectTime = elapsed(start);
+
+    if(!ok)
+        fprintf(stderr, "Timeout with %u get() incomplete\n", (unsigned)waiter.remaining);
+    ok &= waiter.failed==0u;
+
+    printf("%8d channels: connect %f s, %f us per channel%s\n",
+           count, connectTime, connectTime*1e6/count,
+           ok ? "" : " (errors)");
+
+    ops.clear();
+    channels.clear();
+    server->shutdown();
+
+    return ok;
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hs:n:m:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 's':
+            nstart = atoi(optarg);
+            break;
+        case 'n':
+            nchannels = atoi(optarg);
+            break;
+        case 'm':
+            mtu = atoi(optarg);
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testSearchStartup -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testSearchStartup -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testSearchStartup -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(nstart<1 || nchannels<nstart || mtu<0) {
+        usage();
+        return 1;
+    }
+
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    try {
+        printf("search MTU: %d\n", mtu);
+
+        bool ok = true;
+        for(int count=nstart; ok && count<=nchannels; count*=10)
+            ok &= run(count);
+
+        if(!ok)
+            return 1;
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+/* Measure name resolution under a storm of searches for unknown names.
+ *
+ * Runs an in-process server with N PVs, and one client which searches
+ * for U names no server has, while connecting to the N which exist.
+ * Both are bound to the loopback interface.  Repeated once with a UDP
+ * receive thread per socket, and once with the UDPDispatcher.
+ *
+ *   testSearchStorm
+ *   testSearchStorm -n 1000 -u 50000
+ */
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/serverContext.h>
+#include <pv/reactor.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_CHANNELS 1000
+#define DEFAULT_UNKNOWN 20000
+#define DEFAULT_TIMEOUT 60.0
+
+int nchannels = DEFAULT_CHANNELS;
+int nunknown = DEFAULT_UNKNOWN;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testSearchStorm [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -n <channels>:     number of PVs served and connected, default is '%d'\n"
+             "  -u <unknown>:      number of names searched which no server has, default is '%d'\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             , DEFAULT_CHANNELS, DEFAULT_UNKNOWN, DEFAULT_TIMEOUT);
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+struct GetWaiter : public pvac::ClientChannel::GetCallback
+{
+    epicsMutex mutex;
+    epicsEvent done;
+    size_t remaining, failed;
+
+    explicit GetWaiter(size_t n) :remaining(n), failed(0u) {}
+
+    virtual void getDone(const pvac::GetEvent& evt) OVERRIDE FINAL
+    {
+        bool last;
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            if(evt.event!=pvac::GetEvent::Success)
+                failed++;
+            last = --remaining==0u;
+        }
+        if(last)
+            done.signal();
+    }
+};
+
+bool run(bool dispatch)
+{
+    pvd::StructureConstPtr type(pvd::getFieldCreate()->createFieldBuilder()
+                                ->add("value", pvd::pvInt)
+                                ->createStructure());
+
+    pvas::StaticProvider sprov("searchstorm");
+    std::vector<std::string> names(nchannels);
+    for(int i=0; i<nchannels; i++) {
+        char name[32];
+        epicsSnprintf(name, sizeof(name), "searchstorm:%d", i);
+        names[i] = name;
+
+        pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+        pv->open(type);
+        sprov.add(names[i], pv);
+    }
+
+    pva::ServerContext::shared_pointer server(pva::ServerContext::create(
+                pva::ServerContext::Config()
+                .provider(sprov.provider())
+                .config(pva::ConfigurationBuilder()
+                        .add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+                        .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+                        .add("EPICS_PVA_SERVER_PORT", "0")
+                        .add("EPICS_PVA_BROADCAST_PORT", "0")
+                        .add("EPICS_PVA_UDP_DISPATCH", dispatch ? "YES" : "NO")
+                        .push_map()
+                        .build())));
+
+    // client inherits EPICS_PVA_UDP_DISPATCH
+    pvac::ClientProvider client("pva", server->getCurrentConfig());
+
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+
+    // searches for these are never answered, and keep being repeated
+    std::vector<pvac::ClientChannel> unknown;
+    unknown.reserve(nunknown);
+    for(int i=0; i<nunknown; i++) {
+        char name[32];
+        epicsSnprintf(name, sizeof(name), "searchstorm:none:%d", i);
+        unknown.push_back(client.connect(name));
+    }
+
+    std::vector<pvac::ClientChannel> channels;
+    channels.reserve(nchannels);
+    for(int i=0; i<nchannels; i++)
+        channels.push_back(client.connect(names[i]));
+
+    // first get() completes the connection
+    GetWaiter waiter(channels.size());
+    std::vector<pvac::Operation> ops;
+    ops.reserve(channels.size());
+    for(size_t i=0; i<channels.size(); i++)
+        ops.push_back(channels[i].get(&waiter));
+
+    bool ok = waiter.done.wait(timeOut);
+    const double connectTime = elapsed(start);
+
+    if(!ok)
+        fprintf(stderr, "Timeout with %u get() incomplete\n", (unsigned)waiter.remaining);
+    ok &= waiter.failed==0u;
+
+    printf("%s: %d channels connected in %f s (%f us per channel) while searching %d unknown names%s\n",
+           dispatch ? "dispatcher" : "thread per socket",
+           nchannels, connectTime, connectTime*1e6/nchannels, nunknown,
+           ok ? "" : " (errors)");
+
+    ops.clear();
+    channels.clear();
+    unknown.clear();
+    server->shutdown();
+
+    return ok;
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hn:u:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            nchannels = atoi(optarg);
+            break;
+        case 'u':
+            nunknown = atoi(optarg);
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testSearchStorm -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testSearchStorm -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testSearchStorm -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(nchannels<1 || nunknown<0) {
+        usage();
+        return 1;
+    }
+
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    try {
+        bool ok = run(false);
+        if(pva::detail::TransportReactor::isSupported())
+            ok &= run(true);
+        else
+            printf("UDPDispatcher not supported on this target\n");
+
+        if(!ok)
+            return 1;
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
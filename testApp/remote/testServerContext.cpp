@@ -2,9 +2,24 @@
  * testServerContext.cpp
  */
 
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <utility>
+
 #include <pv/serverContext.h>
+#include <pv/configuration.h>
+#include <pv/createRequest.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include <pva/client.h>
 #include <epicsExit.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsEvent.h>
 #include <testMain.h>
+#include <pv/pvUnitTest.h>
 
 #include <epicsUnitTest.h>
 
@@ -12,6 +27,23 @@ using namespace epics::pvAccess;
 using namespace epics::pvData;
 using namespace std;
 
+typedef std::map<std::string, std::string> config_t;
+
+// Server, and its clients, on the loopback interface with ports chosen by the OS,
+// plus any extra configuration.
+Configuration::shared_pointer testServerConfig(const config_t& extra = config_t())
+{
+    ConfigurationBuilder builder;
+    builder.add("EPICS_PVAS_INTF_ADDR_LIST", "127.0.0.1")
+           .add("EPICS_PVA_ADDR_LIST", "127.0.0.1")
+           .add("EPICS_PVA_AUTO_ADDR_LIST","0")
+           .add("EPICS_PVA_SERVER_PORT", "0")
+           .add("EPICS_PVA_BROADCAST_PORT", "0");
+    for(config_t::const_iterator it(extra.begin()), end(extra.end()); it!=end; ++it)
+        builder.add(it->first, it->second);
+    return builder.push_map().build();
+}
+
 class TestChannelProvider : public ChannelProvider
 {
 public:
@@ -79,11 +111,520 @@ void testServerContext()
     testOk(!wctx.lock(), "# ServerContext cleanup leaves use_count=%u", (unsigned)wctx.use_count());
 }
 
+// counts the searches which reach the provider
+struct CountingHandler : public pvas::DynamicProvider::Handler
+{
+    epicsMutex mutex;
+    size_t searches;
+    pvas::SharedPV::shared_pointer pv;
+
+    CountingHandler() :searches(0u), pv(pvas::SharedPV::buildMailbox())
+    {
+        pv->open(getFieldCreate()->createFieldBuilder()
+                 ->add("value", pvInt)
+                 ->createStructure());
+    }
+    virtual ~CountingHandler() {}
+
+    virtual void hasChannels(pvas::DynamicProvider::search_type& names) OVERRIDE FINAL
+    {
+        for(pvas::DynamicProvider::search_type::iterator it(names.begin()), end(names.end()); it!=end; ++it) {
+            if(it->name()=="cache:pv") {
+                epicsGuard<epicsMutex> G(mutex);
+                searches++;
+                it->claim();
+            }
+        }
+    }
+
+    virtual Channel::shared_pointer createChannel(const ChannelProvider::shared_pointer& provider,
+                                                  const std::string& name,
+                                                  const ChannelRequester::shared_pointer& requester) OVERRIDE FINAL
+    {
+        return pv->connect(provider, name, requester);
+    }
+
+    size_t count()
+    {
+        epicsGuard<epicsMutex> G(mutex);
+        return searches;
+    }
+};
+
+void testSearchCache()
+{
+    testDiag("testSearchCache()");
+
+    std::tr1::shared_ptr<CountingHandler> handler(new CountingHandler);
+    pvas::DynamicProvider dprov("cache", handler);
+
+    config_t extra;
+    extra["EPICS_PVAS_SEARCH_CACHE_TTL"] = "60";
+
+    ServerContext::shared_pointer ctx(ServerContext::create(ServerContext::Config()
+                                                                .provider(dprov.provider())
+                                                                .config(testServerConfig(extra))));
+
+    // each client context searches anew
+    for(size_t i=0; i<3; i++) {
+        pvac::ClientProvider client("pva", ctx->getCurrentConfig());
+        client.connect("cache:pv").get(5.0);
+    }
+    testEqual(handler->count(), 1u);
+
+    ctx->invalidateSearchCache("cache:pv");
+    {
+        pvac::ClientProvider client("pva", ctx->getCurrentConfig());
+        client.connect("cache:pv").get(5.0);
+    }
+    testEqual(handler->count(), 2u);
+
+    // StaticProvider::add() and remove() invalidate the caches of all servers
+    pvas::SharedPV::shared_pointer spv(pvas::SharedPV::buildMailbox());
+    spv->open(getFieldCreate()->createFieldBuilder()
+              ->add("value", pvInt)
+              ->createStructure());
+    pvas::StaticProvider sprov("cachestatic");
+    sprov.add("cache:pv", spv);
+    {
+        pvac::ClientProvider client("pva", ctx->getCurrentConfig());
+        client.connect("cache:pv").get(5.0);
+    }
+    testEqual(handler->count(), 3u);
+
+    sprov.remove("cache:pv");
+    {
+        pvac::ClientProvider client("pva", ctx->getCurrentConfig());
+        client.connect("cache:pv").get(5.0);
+    }
+    testEqual(handler->count(), 4u);
+
+    ctx->shutdown();
+}
+
+struct CountingMonitorRequester : public MonitorRequester
+{
+    POINTER_DEFINITIONS(CountingMonitorRequester);
+    epicsEvent wakeup;
+    epicsMutex mutex;
+    bool connected;
+    size_t connects;
+
+    CountingMonitorRequester() :connected(false), connects(0u) {}
+    virtual ~CountingMonitorRequester() {}
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "CountingMonitorRequester"; }
+    virtual void channelDisconnect(bool destroy) OVERRIDE FINAL {}
+    virtual void monitorConnect(Status const & status,
+                                MonitorPtr const & monitor, StructureConstPtr const & structure) OVERRIDE FINAL
+    {
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            connected = status.isSuccess();
+            if(connected)
+                connects++;
+        }
+        if(status.isSuccess())
+            monitor->start();
+        wakeup.signal();
+    }
+    virtual void monitorEvent(MonitorPtr const & monitor) OVERRIDE FINAL { wakeup.signal(); }
+    virtual void unlisten(MonitorPtr const & monitor) OVERRIDE FINAL {}
+};
+
+// The client monitor queue allocates elements once, and then only re-uses them
+void testMonitorAllocations()
+{
+    testDiag("testMonitorAllocations()");
+
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+    pv->open(getFieldCreate()->createFieldBuilder()
+             ->add("value", pvInt)
+             ->createStructure());
+
+    pvas::StaticProvider sprov("alloc");
+    sprov.add("alloc:pv", pv);
+
+    ServerContext::shared_pointer ctx(ServerContext::create(ServerContext::Config()
+                                                                .provider(sprov.provider())
+                                                                .config(testServerConfig())));
+
+    ChannelProvider::shared_pointer client(ChannelProviderRegistry::clients()->createProvider("pva", ctx->getCurrentConfig()));
+    Channel::shared_pointer chan(client->createChannel("alloc:pv", DefaultChannelRequester::build()));
+
+    CountingMonitorRequester::shared_pointer req(new CountingMonitorRequester);
+    PVStructurePtr pvReq(getPVDataCreate()->createPVStructure(getFieldCreate()->createFieldBuilder()
+                                                              ->addNestedStructure("record")
+                                                                ->addNestedStructure("_options")
+                                                                  ->add("queueSize", pvInt)
+                                                                ->endNested()
+                                                              ->endNested()
+                                                              ->createStructure()));
+    pvReq->getSubFieldT<PVInt>("record._options.queueSize")->put(4);
+
+    Monitor::shared_pointer mon(chan->createMonitor(req, pvReq));
+
+    bool connected = false;
+    for(unsigned i=0; !connected && i<50; i++) {
+        req->wakeup.wait(0.1);
+        epicsGuard<epicsMutex> G(req->mutex);
+        connected = req->connected;
+    }
+    testOk1(connected);
+
+    Monitor::Stats before, after;
+    mon->getStats(before);
+    testEqual(before.nallocated, 4u);
+
+    PVStructurePtr val(pv->build());
+    PVIntPtr fld(val->getSubFieldT<PVInt>("value"));
+    BitSet changed;
+    changed.set(fld->getFieldOffset());
+
+    // post more updates than the queue holds, so some are squashed
+    int last = -1;
+    for(int n=1; n<=200; n++) {
+        fld->put(n);
+        pv->post(*val, changed);
+        for(MonitorElement::Ref it(*mon); it; ++it)
+            last = it->pvStructurePtr->getSubFieldT<PVInt>("value")->get();
+    }
+    for(unsigned i=0; last!=200 && i<50; i++) {
+        req->wakeup.wait(0.1);
+        for(MonitorElement::Ref it(*mon); it; ++it)
+            last = it->pvStructurePtr->getSubFieldT<PVInt>("value")->get();
+    }
+    testEqual(last, 200);
+
+    mon->getStats(after);
+    testEqual(after.nallocated, before.nallocated);
+    testEqual(after.nempty + after.nfilled + after.noutstanding, 4u);
+
+    mon->destroy();
+    chan->destroy();
+    client->destroy();
+    ctx->shutdown();
+}
+
+// Elements poll()'d before a re-connect still belong to the queue, which neither
+// allocates replacements for them nor takes them back twice.
+void testMonitorReconnect()
+{
+    testDiag("testMonitorReconnect()");
+
+    StructureConstPtr type(getFieldCreate()->createFieldBuilder()
+                           ->add("value", pvInt)
+                           ->createStructure());
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+    pv->open(type);
+
+    pvas::StaticProvider sprov("recon");
+    sprov.add("recon:pv", pv);
+
+    ServerContext::shared_pointer ctx(ServerContext::create(ServerContext::Config()
+                                                                .provider(sprov.provider())
+                                                                .config(testServerConfig())));
+
+    ChannelProvider::shared_pointer client(ChannelProviderRegistry::clients()->createProvider("pva", ctx->getCurrentConfig()));
+    Channel::shared_pointer chan(client->createChannel("recon:pv", DefaultChannelRequester::build()));
+
+    CountingMonitorRequester::shared_pointer req(new CountingMonitorRequester);
+    PVStructurePtr pvReq(getPVDataCreate()->createPVStructure(getFieldCreate()->createFieldBuilder()
+                                                              ->addNestedStructure("record")
+                                                                ->addNestedStructure("_options")
+                                                                  ->add("queueSize", pvInt)
+                                                                ->endNested()
+                                                              ->endNested()
+                                                              ->createStructure()));
+    pvReq->getSubFieldT<PVInt>("record._options.queueSize")->put(4);
+
+    Monitor::shared_pointer mon(chan->createMonitor(req, pvReq));
+
+    size_t connects = 0u;
+    for(unsigned i=0; connects<1u && i<50; i++) {
+        req->wakeup.wait(0.1);
+        epicsGuard<epicsMutex> G(req->mutex);
+        connects = req->connects;
+    }
+    testEqual(connects, 1u);
+
+    PVStructurePtr val(pv->build());
+    PVIntPtr fld(val->getSubFieldT<PVInt>("value"));
+    BitSet changed;
+    changed.set(fld->getFieldOffset());
+
+    // poll() two updates, and hold on to them
+    std::vector<MonitorElementPtr> held;
+    for(int n=1; n<=2; n++) {
+        fld->put(n);
+        pv->post(*val, changed);
+        for(unsigned i=0; held.size()<size_t(n) && i<50; i++) {
+            if(MonitorElementPtr elem = mon->poll())
+                held.push_back(elem);
+            else
+                req->wakeup.wait(0.1);
+        }
+    }
+    testEqual(held.size(), 2u);
+
+    Monitor::Stats stats;
+    mon->getStats(stats);
+    testEqual(stats.noutstanding, 2u);
+    const size_t allocated = stats.nallocated;
+
+    // force the client to re-connect, and re-subscribe with the same type
+    pv->close();
+    pv->open(type);
+
+    connects = 0u;
+    for(unsigned i=0; connects<2u && i<100; i++) {
+        req->wakeup.wait(0.1);
+        epicsGuard<epicsMutex> G(req->mutex);
+        connects = req->connects;
+    }
+    testEqual(connects, 2u);
+
+    mon->getStats(stats);
+    testEqual(stats.noutstanding, 2u);
+    testEqual(stats.nempty + stats.nfilled + stats.noutstanding, 4u);
+    testEqual(stats.nallocated, allocated);
+
+    // held elements are taken back once
+    for(size_t i=0; i<held.size(); i++)
+        mon->release(held[i]);
+    mon->release(held[0]);
+    held.clear();
+
+    mon->getStats(stats);
+    testEqual(stats.noutstanding, 0u);
+    testEqual(stats.nempty + stats.nfilled, 4u);
+
+    // and the queue still works
+    int last = -1;
+    for(int n=10; n<=30; n++) {
+        fld->put(n);
+        pv->post(*val, changed);
+        for(MonitorElement::Ref it(*mon); it; ++it)
+            last = it->pvStructurePtr->getSubFieldT<PVInt>("value")->get();
+    }
+    for(unsigned i=0; last!=30 && i<50; i++) {
+        req->wakeup.wait(0.1);
+        for(MonitorElement::Ref it(*mon); it; ++it)
+            last = it->pvStructurePtr->getSubFieldT<PVInt>("value")->get();
+    }
+    testEqual(last, 30);
+
+    mon->getStats(stats);
+    testEqual(stats.nempty + stats.nfilled + stats.noutstanding, 4u);
+    testEqual(stats.nallocated, allocated);
+
+    mon->destroy();
+    chan->destroy();
+    client->destroy();
+    ctx->shutdown();
+}
+
+// Two subscribers of one SharedPV, over separate connections, receive the same
+// complete values.  One is pipelined with a short queue, and falls behind.
+typedef std::pair<int32, std::string> fanout_state_t; // (value, label)
+
+fanout_state_t fanoutExpected(int n)
+{
+    // odd updates change value, even updates change label
+    fanout_state_t ret(0, std::string());
+    if(n>=1)
+        ret.first = (n%2) ? n : n-1;
+    if(n>=2) {
+        std::ostringstream strm;
+        strm<<"L"<<((n%2) ? n-1 : n);
+        ret.second = strm.str();
+    }
+    return ret;
+}
+
+struct FanoutSubscriber {
+    ChannelProvider::shared_pointer client;
+    Channel::shared_pointer chan;
+    CountingMonitorRequester::shared_pointer req;
+    Monitor::shared_pointer mon;
+    std::vector<fanout_state_t> states;
+    size_t overruns;
+    PVStructurePtr last;
+
+    FanoutSubscriber(const Configuration::shared_pointer& conf, const char *request)
+        :client(ChannelProviderRegistry::clients()->createProvider("pva", conf))
+        ,chan(client->createChannel("fanout:pv", DefaultChannelRequester::build()))
+        ,req(new CountingMonitorRequester)
+        ,mon(chan->createMonitor(req, createRequest(request)))
+        ,overruns(0u)
+    {}
+    ~FanoutSubscriber()
+    {
+        mon->destroy();
+        chan->destroy();
+        client->destroy();
+    }
+
+    bool connected()
+    {
+        for(unsigned i=0; i<50; i++) {
+            {
+                epicsGuard<epicsMutex> G(req->mutex);
+                if(req->connected)
+                    return true;
+            }
+            req->wakeup.wait(0.1);
+        }
+        return false;
+    }
+
+    // poll() and release() until the latest value is expected
+    bool waitFor(const fanout_state_t& expected)
+    {
+        for(unsigned i=0; i<50; i++) {
+            for(MonitorElement::Ref it(*mon); it; ++it) {
+                last = getPVDataCreate()->createPVStructure(it->pvStructurePtr);
+                states.push_back(fanout_state_t(last->getSubFieldT<PVInt>("value")->get(),
+                                                last->getSubFieldT<PVString>("label")->get()));
+                if(!it->overrunBitSet->isEmpty())
+                    overruns++;
+            }
+            if(!states.empty() && states.back()==expected)
+                return true;
+            req->wakeup.wait(0.1);
+        }
+        return false;
+    }
+};
+
+void testMonitorFanout()
+{
+    testDiag("testMonitorFanout()");
+
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildMailbox());
+    pv->open(getFieldCreate()->createFieldBuilder()
+             ->add("value", pvInt)
+             ->add("label", pvString)
+             ->createStructure());
+
+    pvas::StaticProvider sprov("fanout");
+    sprov.add("fanout:pv", pv);
+
+    ServerContext::shared_pointer ctx(ServerContext::create(ServerContext::Config()
+                                                                .provider(sprov.provider())
+                                                                .config(testServerConfig())));
+
+    const int nupdates = 20;
+
+    // A keeps up.  B does not poll() while updates are posted.
+    FanoutSubscriber A(ctx->getCurrentConfig(), "record[queueSize=100]field()"),
+                     B(ctx->getCurrentConfig(), "record[queueSize=2,pipeline=true]field()");
+    testOk1(A.connected());
+    testOk1(B.connected());
+
+    PVStructurePtr val(pv->build());
+    PVIntPtr value(val->getSubFieldT<PVInt>("value"));
+    PVStringPtr label(val->getSubFieldT<PVString>("label"));
+
+    bool kept = A.waitFor(fanoutExpected(0));
+    for(int n=1; n<=nupdates; n++) {
+        BitSet changed;
+        if(n%2) {
+            value->put(n);
+            changed.set(value->getFieldOffset());
+        } else {
+            std::ostringstream strm;
+            strm<<"L"<<n;
+            label->put(strm.str());
+            changed.set(label->getFieldOffset());
+        }
+        pv->post(*val, changed);
+        kept &= A.waitFor(fanoutExpected(n));
+    }
+    testOk(kept, "A received each update");
+
+    std::vector<fanout_state_t> expected;
+    for(int n=0; n<=nupdates; n++)
+        expected.push_back(fanoutExpected(n));
+    testOk(A.states==expected, "A received %u of %u updates, in order",
+           unsigned(A.states.size()), unsigned(expected.size()));
+    testEqual(A.overruns, 0u);
+
+    // B catches up.  Squashed updates arrive as complete values
+    testOk1(B.waitFor(fanoutExpected(nupdates)));
+    testOk(B.states.size() < expected.size(), "B received %u of %u updates",
+           unsigned(B.states.size()), unsigned(expected.size()));
+    testOk1(B.overruns > 0u);
+    bool complete = true;
+    for(size_t i=0; i<B.states.size(); i++)
+        complete &= std::find(expected.begin(), expected.end(), B.states[i])!=expected.end();
+    testOk(complete, "B received only complete values");
+
+    // once both are caught up, an update reaches both in full
+    value->put(nupdates+1);
+    BitSet changed;
+    changed.set(value->getFieldOffset());
+    pv->post(*val, changed);
+    fanout_state_t latest(nupdates+1, fanoutExpected(nupdates).second);
+    testOk1(A.waitFor(latest));
+    testOk1(B.waitFor(latest));
+    testOk1(A.last && B.last && *A.last==*B.last);
+
+    ctx->shutdown();
+}
+
+// Socket options are read from configuration, and reported by printInfo()
+void testSocketOptions()
+{
+    testDiag("testSocketOptions()");
+
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+    pv->open(getFieldCreate()->createFieldBuilder()
+             ->add("value", pvInt)
+             ->createStructure());
+
+    pvas::StaticProvider sprov("sockopt");
+    sprov.add("sockopt:pv", pv);
+
+    config_t extra;
+    extra["EPICS_PVA_SOCK_SNDBUF"] = "65536";
+    extra["EPICS_PVAS_SOCK_RCVBUF"] = "131072";
+    extra["EPICS_PVAS_SOCK_QUICKACK"] = "YES";
+
+    ServerContext::shared_pointer ctx(ServerContext::create(ServerContext::Config()
+                                                                .provider(sprov.provider())
+                                                                .config(testServerConfig(extra))));
+
+    Configuration::shared_pointer conf(ctx->getCurrentConfig());
+    testEqual(conf->getPropertyAsInteger("EPICS_PVAS_SOCK_SNDBUF", 0), 65536);
+    testEqual(conf->getPropertyAsInteger("EPICS_PVAS_SOCK_RCVBUF", 0), 131072);
+    testEqual(conf->getPropertyAsInteger("EPICS_PVAS_SOCK_BUSY_POLL", -1), 0);
+    testOk1(conf->getPropertyAsBoolean("EPICS_PVAS_SOCK_QUICKACK", false));
+
+    {
+        pvac::ClientProvider client("pva", conf);
+        pvac::ClientChannel chan(client.connect("sockopt:pv"));
+        testOk1(!!chan.get(5.0));
+    }
+
+    std::ostringstream strm;
+    ctx->printInfo(strm, 0);
+    testDiag("%s", strm.str().c_str());
+    testOk1(strm.str().find("EPICS_PVAS_SOCK_RCVBUF = 131072")!=std::string::npos);
+    testOk1(strm.str().find("TCP socket options applied: SO_SNDBUF=")!=std::string::npos);
+
+    ctx->shutdown();
+}
+
 MAIN(testServerContext)
 {
     testPlan(0);
 
     testServerContext();
+    testSearchCache();
+    testMonitorAllocations();
+    testMonitorReconnect();
+    testMonitorFanout();
+    testSocketOptions();
 
     return testDone();
 }
@@ -0,0 +1,250 @@
+/*
+ * testUDPDispatcher.cpp
+ */
+
+#include <string.h>
+
+#include <osiSock.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/timer.h>
+#include <pv/pvUnitTest.h>
+
+#include <pv/reactor.h>
+#include <pv/blockingUDP.h>
+#include <pv/remote.h>
+#include <pv/pvaConstants.h>
+#include <pv/configuration.h>
+
+namespace pvd = epics::pvData;
+using namespace epics::pvAccess;
+
+typedef epicsGuard<epicsMutex> Guard;
+
+namespace {
+
+struct TestContext : public Context {
+    POINTER_DEFINITIONS(TestContext);
+
+    Configuration::const_shared_pointer conf;
+
+    TestContext() :conf(ConfigurationBuilder().push_map().build()) {}
+    virtual ~TestContext() {}
+
+    virtual pvd::Timer::shared_pointer getTimer() OVERRIDE FINAL { return pvd::Timer::shared_pointer(); }
+    virtual TransportRegistry* getTransportRegistry() OVERRIDE FINAL { return 0; }
+    virtual Configuration::const_shared_pointer getConfiguration() OVERRIDE FINAL { return conf; }
+    virtual void newServerDetected() OVERRIDE FINAL {}
+    virtual std::tr1::shared_ptr<Channel> getChannel(pvAccessID) OVERRIDE FINAL {
+        return std::tr1::shared_ptr<Channel>();
+    }
+    virtual Transport::shared_pointer getSearchTransport() OVERRIDE FINAL { return Transport::shared_pointer(); }
+};
+
+// Lingers in handleResponse() to widen the window in which close() races the dispatch thread
+struct SlowHandler : public ResponseHandler {
+    epicsMutex lock;
+    bool closed; // set once close() has returned
+    size_t received, late;
+
+    explicit SlowHandler(Context* ctxt)
+        :ResponseHandler(ctxt, "SlowHandler")
+        ,closed(false)
+        ,received(0u)
+        ,late(0u)
+    {}
+    virtual ~SlowHandler() {}
+
+    void check()
+    {
+        Guard G(lock);
+        if(closed)
+            late++;
+    }
+
+    virtual void handleResponse(osiSockAddr*, Transport::shared_pointer const &,
+                                pvd::int8, pvd::int8, std::size_t, pvd::ByteBuffer*) OVERRIDE FINAL
+    {
+        check();
+        {
+            Guard G(lock);
+            received++;
+        }
+        epicsThreadSleep(0.001);
+        check();
+    }
+};
+
+// Closes its transport from within the dispatch thread
+struct ClosingHandler : public ResponseHandler {
+    BlockingUDPTransport::shared_pointer transport;
+    epicsEvent done;
+
+    explicit ClosingHandler(Context* ctxt) :ResponseHandler(ctxt, "ClosingHandler") {}
+    virtual ~ClosingHandler() {}
+
+    virtual void handleResponse(osiSockAddr*, Transport::shared_pointer const &,
+                                pvd::int8, pvd::int8, std::size_t, pvd::ByteBuffer*) OVERRIDE FINAL
+    {
+        if(transport) {
+            transport->close();
+            done.signal();
+        }
+    }
+};
+
+// Sends empty PVA messages to the current target until stopped
+struct Sender : public epicsThreadRunable {
+    SOCKET sock;
+    epicsMutex lock;
+    osiSockAddr dest;
+    bool running;
+    epicsThread thread;
+
+    Sender()
+        :running(true)
+        ,thread(*this, "sender", epicsThreadGetStackSize(epicsThreadStackSmall))
+    {
+        sock = epicsSocketCreate(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if(sock==INVALID_SOCKET)
+            testAbort("Can't create UDP socket");
+        memset(&dest, 0, sizeof(dest));
+        thread.start();
+    }
+    virtual ~Sender()
+    {
+        {
+            Guard G(lock);
+            running = false;
+        }
+        thread.exitWait();
+        epicsSocketDestroy(sock);
+    }
+
+    void target(const osiSockAddr& addr)
+    {
+        Guard G(lock);
+        dest = addr;
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // magic, version, flags (little endian, client), command, zero length payload
+        const char msg[PVA_MESSAGE_HEADER_SIZE] = {char(PVA_MAGIC), PVA_CLIENT_PROTOCOL_REVISION, 0, CMD_ECHO, 0, 0, 0, 0};
+
+        for(unsigned n=0u; true; n++) {
+            osiSockAddr to;
+            {
+                Guard G(lock);
+                if(!running)
+                    break;
+                to = dest;
+            }
+            if(to.ia.sin_port)
+                (void)::sendto(sock, msg, sizeof(msg), 0, &to.sa, sizeof(to.ia));
+            if(n%16u==0u)
+                epicsThreadSleep(0.0);
+        }
+    }
+};
+
+BlockingUDPTransport::shared_pointer openTransport(const detail::UDPDispatcher::shared_pointer& dispatcher,
+                                                   const ResponseHandler::shared_pointer& handler)
+{
+    osiSockAddr bindAddr;
+    memset(&bindAddr, 0, sizeof(bindAddr));
+    bindAddr.ia.sin_family = AF_INET;
+    bindAddr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bindAddr.ia.sin_port = 0;
+
+    BlockingUDPConnector connector(false, 0u, dispatcher);
+    BlockingUDPTransport::shared_pointer transport(connector.connect(handler, bindAddr, PVA_CLIENT_PROTOCOL_REVISION));
+    if(!transport)
+        testAbort("Can't create UDP transport");
+    transport->start();
+    return transport;
+}
+
+// close() must not return while the dispatch thread is in reactorRead() of the same transport
+void testCloseWhileReceiving()
+{
+    testDiag("testCloseWhileReceiving()");
+
+    TestContext ctxt;
+    detail::UDPDispatcher::shared_pointer dispatcher(new detail::UDPDispatcher("testUDPDispatch"));
+    Sender sender;
+
+    size_t received = 0u, late = 0u;
+
+    for(unsigned i=0u; i<50u; i++) {
+        std::tr1::shared_ptr<SlowHandler> handler(new SlowHandler(&ctxt));
+        BlockingUDPTransport::shared_pointer transport(openTransport(dispatcher, handler));
+
+        sender.target(transport->getRemoteAddress());
+        epicsThreadSleep(0.01);
+
+        transport->close();
+        {
+            Guard G(handler->lock);
+            handler->closed = true;
+        }
+        // any dispatch still running, or starting, would be counted
+        epicsThreadSleep(0.005);
+
+        Guard G(handler->lock);
+        received += handler->received;
+        late += handler->late;
+    }
+
+    testOk(received>0u, "dispatched %u datagrams", unsigned(received));
+    testEqual(late, 0u);
+    testEqual(dispatcher->size(), 0u);
+
+    dispatcher->close();
+}
+
+// close() from within reactorRead() must not wait for itself
+void testCloseFromDispatch()
+{
+    testDiag("testCloseFromDispatch()");
+
+    TestContext ctxt;
+    detail::UDPDispatcher::shared_pointer dispatcher(new detail::UDPDispatcher("testUDPDispatch"));
+    std::tr1::shared_ptr<ClosingHandler> handler(new ClosingHandler(&ctxt));
+    BlockingUDPTransport::shared_pointer transport(openTransport(dispatcher, handler));
+    handler->transport = transport;
+
+    Sender sender;
+    sender.target(transport->getRemoteAddress());
+
+    testOk(handler->done.wait(5.0), "closed from the dispatch thread");
+    testEqual(dispatcher->size(), 0u);
+
+    handler->transport.reset();
+    dispatcher->close();
+}
+
+} // namespace
+
+MAIN(testUDPDispatcher)
+{
+    testPlan(5);
+    osiSockAttach();
+    try {
+        if(!detail::TransportReactor::isSupported()) {
+            testSkip(5, "UDPDispatcher not supported on this target");
+        } else {
+            testCloseWhileReceiving();
+            testCloseFromDispatch();
+        }
+    } catch(std::exception& e) {
+        testAbort("Unexpected exception: %s", e.what());
+    }
+    osiSockRelease();
+    return testDone();
+}
@@ -123,11 +123,11 @@ struct Tester {
         mon.reset(new pva::MonitorFIFO(requester, pvReq, H, conf));
     }
 
-    void reset() {
+    static void reset() {
         timeline.clear();
     }
 
-    void testTimeline(std::initializer_list<cb_t> l) {
+    static void testTimeline(std::initializer_list<cb_t> l) {
         size_t i=0;
         for(auto event : l) {
             if(i >= timeline.size()) {
@@ -793,11 +793,124 @@ void checkBadRequest()
     tester.testTimeline({});
 }
 
+pvd::StructureConstPtr intType()
+{
+    return pvd::getFieldCreate()->createFieldBuilder()
+            ->add("value", pvd::pvInt)
+            ->createStructure();
+}
+
+template<typename MON>
+void postInt(MON& mon, pvd::int32 val)
+{
+    static const pvd::StructureConstPtr type(intType());
+    pvd::PVStructurePtr V(pvd::getPVDataCreate()->createPVStructure(type));
+    pvd::PVIntPtr fld(V->getSubFieldT<pvd::PVInt>("value"));
+    fld->put(val);
+    pvd::BitSet changed;
+    changed.set(fld->getFieldOffset());
+    mon.post(*V, changed);
+}
+
+// Same sequence as checkSaturate() with the lock-free ring
+void checkRingSaturate()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    pva::MonitorFIFO::Config conf;
+    conf.maxCount=4;
+    conf.defCount=2;
+    Tester::Requester::shared_pointer requester(new Tester::Requester);
+    pva::MonitorRing::shared_pointer mon(new pva::MonitorRing(requester, pvReqEmpty, &conf));
+
+    testEqual(conf.actualCount, 2u);
+
+    mon->open(intType());
+    mon->notify();
+    Tester::testTimeline({Tester::Connect});
+
+    mon->start();
+    testEqual(mon->freeCount(), 2u);
+
+    // fill up and overflow
+    postInt(*mon, 5);
+    postInt(*mon, 6);
+    postInt(*mon, 7);
+    postInt(*mon, 8);
+    mon->notify();
+    Tester::testTimeline({Tester::Event});
+
+    testShow()<<"Overrun "<<*mon;
+
+    testPop(*mon, 5);
+    postInt(*mon, 9);
+    mon->notify();
+    Tester::testTimeline({});
+
+    testPop(*mon, 6);
+    postInt(*mon, 10);
+    mon->notify();
+    Tester::testTimeline({});
+
+    testPop(*mon, 8, true);
+    postInt(*mon, 11);
+    mon->notify();
+    Tester::testTimeline({});
+
+    testPop(*mon, 9);
+    testPop(*mon, 10);
+    testPop(*mon, 11);
+    testEmpty(*mon);
+    Tester::testTimeline({});
+
+    // the consumer is now waiting
+    postInt(*mon, 12);
+    mon->notify();
+    Tester::testTimeline({Tester::Event});
+
+    testPop(*mon, 12);
+    testEmpty(*mon);
+
+    mon->stop();
+    mon->close();
+    mon->notify();
+    Tester::testTimeline({Tester::Close});
+}
+
+// finish() with a non-empty ring.  Unlisten after the last poll()
+void checkRingFinish()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    Tester::Requester::shared_pointer requester(new Tester::Requester);
+    pva::MonitorRing::shared_pointer mon(new pva::MonitorRing(requester, pvReqEmpty));
+
+    mon->open(intType());
+    mon->start();
+    mon->notify();
+    Tester::testTimeline({Tester::Connect});
+
+    postInt(*mon, 1);
+    postInt(*mon, 2);
+    mon->finish();
+    mon->notify();
+    Tester::testTimeline({Tester::Event});
+
+    testThrows(std::logic_error, mon->open(intType()));
+
+    testPop(*mon, 1);
+    Tester::testTimeline({});
+    testPop(*mon, 2);
+    Tester::testTimeline({Tester::Unlisten});
+    testEmpty(*mon);
+    Tester::testTimeline({});
+
+    mon->close();
+}
+
 } // namespace
 
 MAIN(testmonitorfifo)
 {
-    testPlan(189);
+    testPlan(217);
     checkPlain();
     checkAfterClose();
     checkReOpenLost();
@@ -808,6 +921,8 @@ MAIN(testmonitorfifo)
     checkSpam();
     checkCountdown();
     checkBadRequest();
+    checkRingSaturate();
+    checkRingFinish();
     return testDone();
 }
 
@@ -3,13 +3,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsEndian.h>
+
 #include <pv/pvUnitTest.h>
 #include <testMain.h>
 
 #include <pva/client.h>
 #include <pva/sharedstate.h>
 #include <pv/current_function.h>
-//#include <pv/pvAccess.h>
+#include <pv/pvAccess.h>
 
 namespace pvd = epics::pvData;
 namespace pva = epics::pvAccess;
@@ -37,6 +39,46 @@ void testNoClient()
     testThrows(std::logic_error, pv->build()); // not open()'d
 }
 
+void testPostType()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    pvas::SharedPV::shared_pointer pv(pvas::SharedPV::buildReadOnly());
+    pv->open(type);
+
+    pvd::BitSet changed;
+    changed.set(1);
+
+    // same type instance
+    pvd::PVStructurePtr inst(pv->build());
+    inst->getSubFieldT<pvd::PVScalar>("value")->putFrom<pvd::uint32>(1);
+    pv->post(*inst, changed);
+
+    // equal type, possibly another instance.  deep compare once, then remembered
+    pvd::PVStructurePtr other(pvd::getPVDataCreate()->createPVStructure(pvd::getFieldCreate()->createFieldBuilder()
+                                                                         ->add("value", pvd::pvInt)
+                                                                         ->createStructure()));
+    other->getSubFieldT<pvd::PVScalar>("value")->putFrom<pvd::uint32>(2);
+    pv->post(*other, changed);
+    pv->post(*other, changed);
+
+    pvd::PVStructurePtr wrong(pvd::getPVDataCreate()->createPVStructure(pvd::getFieldCreate()->createFieldBuilder()
+                                                                         ->add("value", pvd::pvDouble)
+                                                                         ->createStructure()));
+    testThrows(std::logic_error, pv->post(*wrong, changed));
+
+    inst->getSubFieldT<pvd::PVScalar>("value")->putFrom<pvd::uint32>(3);
+    pv->postUnchecked(*inst, changed);
+
+    pvd::PVStructurePtr result(pv->build());
+    pvd::BitSet valid;
+    pv->fetch(*result, valid);
+    testEqual(result->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::uint32>(), 3u);
+
+    pv->close();
+    testThrows(std::logic_error, pv->postUnchecked(*inst, changed));
+}
+
 void testGetMon()
 {
     testDiag("==== %s ====", CURRENT_FUNCTION);
@@ -186,16 +228,88 @@ void testPutRPC()
     testEqual(reply->getSubFieldT<pvd::PVScalar>("value")->getAs<pvd::uint32>(), 100u);
 }
 
+struct NullMonitorRequester : public pva::MonitorRequester
+{
+    virtual ~NullMonitorRequester() {}
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "NullMonitorRequester"; }
+    virtual void monitorConnect(pvd::Status const & status,
+                                pva::MonitorPtr const & monitor, pvd::StructureConstPtr const & structure) OVERRIDE FINAL {}
+    virtual void monitorEvent(pva::MonitorPtr const & monitor) OVERRIDE FINAL {}
+    virtual void unlisten(pva::MonitorPtr const & monitor) OVERRIDE FINAL {}
+};
+
+// subscribers with the same field mask share one encoding of each update
+void testFanout()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    std::tr1::shared_ptr<pvas::StaticProvider> prov(new pvas::StaticProvider("test"));
+    std::tr1::shared_ptr<pvas::SharedPV> pv(pvas::SharedPV::buildReadOnly());
+
+    prov->add("pv:name", pv);
+
+    pv->open(type);
+
+    pva::Channel::shared_pointer chan(prov->provider()->createChannel("pv:name", pva::DefaultChannelRequester::build()));
+    pva::MonitorRequester::shared_pointer req(new NullMonitorRequester);
+    pvd::PVStructurePtr pvReq(pvd::createRequest("field()"));
+
+    pva::Monitor::shared_pointer monA(chan->createMonitor(req, pvReq)),
+                                 monB(chan->createMonitor(req, pvReq));
+    monA->start();
+    monB->start();
+
+    {
+        // initial updates are per subscriber
+        pva::MonitorElement::Ref A(*monA), B(*monB);
+        testOk1(A && !A->fanout);
+        testOk1(B && !B->fanout);
+    }
+
+    pvd::PVStructurePtr inst(pv->build());
+    pvd::BitSet changed;
+    pvd::PVScalarPtr value(inst->getSubFieldT<pvd::PVScalar>("value"));
+    value->putFrom<pvd::uint32>(42);
+    changed.set(value->getFieldOffset());
+
+    pv->post(*inst, changed);
+
+    pva::MonitorElementPtr A(monA->poll()), B(monB->poll());
+    testOk1(A && B);
+    if(A && B) {
+        testOk1(A->fanout && A->fanout==B->fanout);
+
+        testOk1(!A->fanout->find(*A, EPICS_BYTE_ORDER));
+        pva::MonitorFanout::encoded_t enc(new pva::MonitorFanout::buffer_t(4u, 'x'));
+        testOk1(A->fanout->store(*A, EPICS_BYTE_ORDER, enc)==enc);
+        testOk1(B->fanout->find(*B, EPICS_BYTE_ORDER)==enc);
+        // byte order is part of the key
+        testOk1(!B->fanout->find(*B, EPICS_BYTE_ORDER==EPICS_ENDIAN_BIG ? EPICS_ENDIAN_LITTLE : EPICS_ENDIAN_BIG));
+
+        monA->release(A);
+        testOk1(!A->fanout);
+        monB->release(B);
+    } else {
+        testSkip(6, "No data");
+    }
+
+    monA->destroy();
+    monB->destroy();
+    chan->destroy();
+}
+
 } // namespace
 
 MAIN(testsharedstate)
 {
-    testPlan(19);
+    testPlan(31);
     try {
         testNoClient();
+        testPostType();
         testGetMon();
         testPutRPCCancel();
         testPutRPC();
+        testFanout();
     }catch(std::exception& e){
         testAbort("Unexpected exception: %s", e.what());
     }
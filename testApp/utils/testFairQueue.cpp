@@ -67,9 +67,116 @@ void testOrder()
     }
 }
 
+typedef epics::pvAccess::fair_queue<Qnode> queue_t;
+
+static
+std::vector<unsigned> drain(queue_t& Q)
+{
+    std::vector<unsigned> ret;
+    queue_t::value_type E;
+    while(Q.pop_front_try(E))
+        ret.push_back(E->i);
+    return ret;
+}
+
+static
+void testLevels()
+{
+    testDiag("Priority levels");
+
+    queue_t Q;
+    queue_t::value_type A(new Qnode(0)), B(new Qnode(1)), C(new Qnode(2)), D(new Qnode(3));
+
+    Q.push_back(C, 2);
+    Q.push_back(B, 1);
+    Q.push_back(A, 0);
+    Q.push_back(B, 1);
+    Q.push_back(D, 3);
+    Q.push_back(D, 0); // promote, and queue again
+
+    std::vector<unsigned> out(drain(Q));
+    static const unsigned expect[] = {0, 3, 3, 1, 1, 2};
+
+    testOk(out.size()==NELEMENTS(expect), "sizes match actual %u expected %u",
+           (unsigned)out.size(), (unsigned)NELEMENTS(expect));
+    for(unsigned i=0; i<NELEMENTS(expect) && i<out.size(); i++)
+        testOk(out[i]==expect[i], "[%u] %u == %u", i, out[i], expect[i]);
+
+    testOk1(Q.empty());
+}
+
+static
+void testStarvation()
+{
+    testDiag("Starvation bound");
+
+    queue_t Q;
+    Q.setStarvationLimit(2);
+    testOk1(Q.starvationLimit()==2u);
+
+    queue_t::value_type H(new Qnode(0)), L(new Qnode(1));
+
+    for(unsigned i=0; i<10; i++)
+        Q.push_back(H, 0);
+    Q.push_back(L, queue_t::NumLevels); // clipped to least urgent
+
+    std::vector<unsigned> out(drain(Q));
+    testOk(out.size()==11u, "drained %u", (unsigned)out.size());
+    testOk(out.size()>2u && out[2]==1u, "low level served after two passes");
+
+    std::vector<epics::pvAccess::fair_queue_stats> stats;
+    Q.getStats(stats, true);
+    testOk1(stats.size()==size_t(queue_t::NumLevels));
+    testOk1(stats[0].count==10u && stats[0].starved==0u && stats[0].depth==0u);
+    testOk1(stats[queue_t::NumLevels-1].count==1u && stats[queue_t::NumLevels-1].starved==1u);
+    testOk1(stats[0].latencyMax>=0.0 && stats[0].latencyMean()<=stats[0].latencyMax);
+
+    Q.push_back(L, 1);
+    Q.getStats(stats);
+    testOk1(stats[0].count==0u && stats[1].depth==1u);
+    Q.clear();
+    testOk1(Q.empty());
+}
+
+static
+void testGroups()
+{
+    testDiag("Groups");
+
+    queue_t Q;
+    queue_t::group G;
+    queue_t::value_type A(new Qnode(0)), B(new Qnode(1)), C(new Qnode(2)), D(new Qnode(3));
+    A->setGroup(&G);
+    B->setGroup(&G);
+    C->setGroup(&G);
+
+    Q.push_back(A, 3);
+    Q.push_back(D, 2);
+    Q.push_back(B, 0); // joins A at level 3
+    Q.push_back(A, 0); // not promoted ahead of B
+    Q.push_back(C, 1);
+
+    std::vector<unsigned> out(drain(Q));
+    static const unsigned expect[] = {3, 0, 1, 2, 0};
+
+    testOk(out.size()==NELEMENTS(expect), "sizes match actual %u expected %u",
+           (unsigned)out.size(), (unsigned)NELEMENTS(expect));
+    for(unsigned i=0; i<NELEMENTS(expect) && i<out.size(); i++)
+        testOk(out[i]==expect[i], "[%u] %u == %u", i, out[i], expect[i]);
+
+    // once none are queued, the group takes the level of the next queued
+    Q.push_back(B, 0);
+    Q.push_back(D, 1);
+    out = drain(Q);
+    testOk(out.size()==2u && out[0]==1u && out[1]==3u, "group level follows B");
+}
+
 MAIN(testFairQueue)
 {
-    testPlan(12);
+    testPlan(36);
     testOrder();
+    testLevels();
+    testStarvation();
+    testGroups();
     return testDone();
 }
@@ -0,0 +1,182 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <vector>
+#include <sstream>
+
+#include <epicsTime.h>
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/pvData.h>
+#include <pv/introspectionRegistry.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+struct TestControl : public pvd::SerializableControl
+{
+    virtual void flushSerializeBuffer() OVERRIDE FINAL {}
+    virtual void ensureBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual void alignBuffer(std::size_t) OVERRIDE FINAL {}
+    virtual bool directSerialize(pvd::ByteBuffer*, const char*,
+                                 std::size_t, std::size_t) OVERRIDE FINAL
+    {
+        return false;
+    }
+    virtual void cachedSerialize(std::tr1::shared_ptr<const pvd::Field> const & field,
+                                 pvd::ByteBuffer* buffer) OVERRIDE FINAL
+    {
+        field->serialize(buffer, this);
+    }
+};
+
+// Each type differs in ID and in the name of a nested field
+pvd::StructureConstPtr makeType(size_t i)
+{
+    std::ostringstream id, name;
+    id<<"test:type"<<i<<":1.0";
+    name<<"field"<<i;
+    return pvd::getFieldCreate()->createFieldBuilder()
+            ->setId(id.str())
+            ->add("value", pvd::pvDouble)
+            ->addNestedStructure("alarm")
+                ->add("severity", pvd::pvInt)
+                ->add(name.str(), pvd::pvString)
+            ->endNested()
+            ->addArray("array", pvd::pvInt)
+            ->createStructure();
+}
+
+// serialize and return the type code and key
+pvd::int8 doSerialize(pva::IntrospectionRegistry& reg, const pvd::FieldConstPtr& field, pvd::int16& key)
+{
+    pvd::ByteBuffer buf(16*1024);
+    TestControl ctrl;
+    reg.serialize(field, &buf, &ctrl);
+    buf.flip();
+    pvd::int8 code = buf.getByte();
+    key = code==pva::IntrospectionRegistry::NULL_TYPE_CODE ? 0 : buf.getShort();
+    return code;
+}
+
+void testRegister()
+{
+    testDiag("testRegister()");
+
+    pva::IntrospectionRegistry reg;
+    pvd::StructureConstPtr A(makeType(0)), B(makeType(1));
+    pvd::int16 keyA, keyB, key;
+
+    testOk1(doSerialize(reg, A, keyA)==pva::IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE);
+    testOk1(doSerialize(reg, B, keyB)==pva::IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE);
+    testOk1(keyA!=keyB);
+
+    testOk1(doSerialize(reg, A, key)==pva::IntrospectionRegistry::ONLY_ID_TYPE_CODE);
+    testOk1(key==keyA);
+    testOk1(doSerialize(reg, B, key)==pva::IntrospectionRegistry::ONLY_ID_TYPE_CODE);
+    testOk1(key==keyB);
+
+    // an equal type, which may or may not be the same instance
+    pvd::StructureConstPtr A2(makeType(0));
+    testOk1(doSerialize(reg, A2, key)==pva::IntrospectionRegistry::ONLY_ID_TYPE_CODE);
+    testOk1(key==keyA);
+
+    reg.reset();
+    testOk1(doSerialize(reg, B, key)==pva::IntrospectionRegistry::FULL_WITH_ID_TYPE_CODE);
+}
+
+void testHash()
+{
+    testDiag("testHash()");
+
+    pvd::StructureConstPtr A(makeType(0)), A2(makeType(0)), B(makeType(1));
+
+    testOk1(pva::IntrospectionRegistry::hash(*A)==pva::IntrospectionRegistry::hash(*A2));
+    testOk1(pva::IntrospectionRegistry::hash(*A)!=pva::IntrospectionRegistry::hash(*B));
+
+    pvd::StructureConstPtr C(pvd::getFieldCreate()->createFieldBuilder()
+                             ->add("value", pvd::pvDouble)
+                             ->createStructure()),
+                           D(pvd::getFieldCreate()->createFieldBuilder()
+                             ->add("value", pvd::pvFloat)
+                             ->createStructure());
+    testOk1(pva::IntrospectionRegistry::hash(*C)!=pva::IntrospectionRegistry::hash(*D));
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+// Compare cache hits against the previous linear search with deep Field compare
+void benchLookup(size_t ntypes, size_t nloops)
+{
+    testDiag("benchLookup(%u types, %u loops)", (unsigned)ntypes, (unsigned)nloops);
+
+    std::vector<pvd::FieldConstPtr> types(ntypes);
+    for(size_t i=0; i<ntypes; i++)
+        types[i] = makeType(i);
+
+    pva::IntrospectionRegistry reg;
+    pvd::ByteBuffer buf(16*1024);
+    TestControl ctrl;
+
+    for(size_t i=0; i<ntypes; i++) {
+        buf.clear();
+        reg.serialize(types[i], &buf, &ctrl);
+    }
+
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+
+    bool allhit = true;
+    for(size_t n=0; n<nloops; n++) {
+        for(size_t i=0; i<ntypes; i++) {
+            buf.clear();
+            reg.serialize(types[i], &buf, &ctrl);
+            allhit &= buf.getByte(0)==pva::IntrospectionRegistry::ONLY_ID_TYPE_CODE;
+        }
+    }
+    const double indexed = elapsed(start);
+    testOk(allhit, "All cache hits");
+
+    epicsTimeGetCurrent(&start);
+
+    size_t found = 0;
+    for(size_t n=0; n<nloops; n++) {
+        for(size_t i=0; i<ntypes; i++) {
+            for(size_t j=ntypes; j>0; j--) {
+                if(*types[i]==*types[j-1]) {
+                    found++;
+                    break;
+                }
+            }
+        }
+    }
+    const double linear = elapsed(start);
+    testOk1(found==ntypes*nloops);
+
+    const double nops = double(ntypes)*nloops;
+    testDiag("indexed %.1f ns/lookup, linear %.1f ns/lookup",
+             indexed*1e9/nops, linear*1e9/nops);
+}
+
+} // namespace
+
+MAIN(testIntrospectionRegistry)
+{
+    testPlan(17);
+    testRegister();
+    testHash();
+    benchLookup(10, 1000);
+    benchLookup(500, 20);
+    return testDone();
+}
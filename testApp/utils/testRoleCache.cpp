@@ -0,0 +1,234 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <string>
+#include <sstream>
+
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsThread.h>
+
+#include <pv/sharedPtr.h>
+#include <pv/current_function.h>
+#include <pv/security.h>
+#include <pv/configuration.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+namespace pva = epics::pvAccess;
+
+namespace {
+
+typedef epicsGuard<epicsMutex> Guard;
+
+epicsMutex lookupMutex;
+size_t nlookups;
+// lookups wait for this to be signaled, when set
+epicsEvent *lookupGate;
+
+// role is "<account><N>" where N counts lookups
+void fakeLookup(const std::string& account, pva::PeerInfo::roles_t& roles)
+{
+    if(lookupGate)
+        lookupGate->wait();
+
+    size_t n;
+    {
+        Guard G(lookupMutex);
+        n = ++nlookups;
+    }
+    std::ostringstream strm;
+    strm<<account<<n;
+    roles.insert(strm.str());
+}
+
+void resetLookups()
+{
+    Guard G(lookupMutex);
+    nlookups = 0u;
+}
+
+size_t lookups()
+{
+    Guard G(lookupMutex);
+    return nlookups;
+}
+
+struct Waiter : public pva::RoleCache::Listener
+{
+    epicsEvent done;
+    size_t count;
+    Waiter() :count(0u) {}
+    virtual ~Waiter() {}
+    virtual void rolesCached(const std::string& /*account*/)
+    {
+        count++;
+        done.signal();
+    }
+};
+
+void testSync()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    resetLookups();
+
+    pva::RoleCache cache(60.0, &fakeLookup);
+
+    pva::PeerInfo::roles_t roles;
+    testOk1(!cache.lookup("alice", roles));
+    testOk1(roles.empty());
+
+    cache.getRoles("alice", roles);
+    testOk1(roles.size()==1u && roles.count("alice1")==1u);
+
+    roles.clear();
+    testOk1(cache.lookup("alice", roles));
+    testOk1(roles.count("alice1")==1u);
+    testOk1(lookups()==1u);
+
+    pva::RoleCache::Stats stats;
+    cache.stats(stats);
+    testOk(stats.hits==1u && stats.misses==2u && stats.entries==1u,
+           "hits=%u misses=%u entries=%u", unsigned(stats.hits), unsigned(stats.misses), unsigned(stats.entries));
+
+    cache.clear();
+    testOk1(!cache.lookup("alice", roles));
+}
+
+void testFetch()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    resetLookups();
+
+    pva::RoleCache cache(60.0, &fakeLookup);
+
+    epicsEvent gate;
+    lookupGate = &gate;
+
+    std::tr1::shared_ptr<Waiter> A(new Waiter), B(new Waiter);
+    cache.fetch("bob", A);
+    cache.fetch("bob", B); // joins the pending lookup
+
+    epicsThreadSleep(0.1);
+    testOk1(A->count==0u && B->count==0u);
+
+    pva::RoleCache::Stats stats;
+    cache.stats(stats);
+    testOk1(stats.pending==1u);
+
+    gate.signal();
+    testOk1(A->done.wait(5.0));
+    testOk1(B->done.wait(5.0));
+    lookupGate = 0;
+
+    testOk1(lookups()==1u);
+
+    pva::PeerInfo::roles_t roles;
+    testOk1(cache.lookup("bob", roles));
+    testOk1(roles.count("bob1")==1u);
+
+    // already cached, listener called immediately
+    std::tr1::shared_ptr<Waiter> C(new Waiter);
+    cache.fetch("bob", C);
+    testOk1(C->count==1u);
+    testOk1(lookups()==1u);
+}
+
+void testRefresh()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    resetLookups();
+
+    pva::RoleCache cache(0.5, &fakeLookup);
+
+    std::tr1::shared_ptr<Waiter> A(new Waiter);
+    cache.fetch("carol", A);
+    testOk1(A->done.wait(5.0));
+
+    pva::PeerInfo::roles_t roles;
+    testOk1(cache.lookup("carol", roles) && roles.count("carol1")==1u);
+
+    // used since cached, so refreshed by the worker once expired
+    epicsThreadSleep(0.8);
+
+    pva::RoleCache::Stats stats;
+    cache.stats(stats);
+    testOk(stats.refreshes>=1u, "refreshes=%u", unsigned(stats.refreshes));
+
+    roles.clear();
+    testOk1(cache.lookup("carol", roles) && roles.count("carol1")==0u);
+
+    // refreshed again, then not used after that refresh, so evicted once expired
+    epicsThreadSleep(1.5);
+    cache.stats(stats);
+    testOk(stats.evictions==1u && stats.entries==0u,
+           "evictions=%u entries=%u", unsigned(stats.evictions), unsigned(stats.entries));
+}
+
+void testDisabled()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    resetLookups();
+
+    pva::RoleCache cache(0.0, &fakeLookup);
+
+    pva::PeerInfo::roles_t roles;
+    testOk1(!cache.lookup("dave", roles));
+
+    std::tr1::shared_ptr<Waiter> A(new Waiter);
+    cache.fetch("dave", A);
+    testOk1(A->count==1u);
+
+    cache.getRoles("dave", roles);
+    cache.getRoles("dave", roles);
+    testOk1(lookups()==2u);
+}
+
+void testConfigure()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+    resetLookups();
+
+    pva::RoleCache cache(60.0, &fakeLookup);
+
+    std::tr1::shared_ptr<Waiter> A(new Waiter);
+    cache.fetch("erin", A);
+    testOk1(A->done.wait(5.0));
+
+    // not set, so unchanged
+    cache.configure(*pva::ConfigurationBuilder().push_map().build());
+    testOk1(cache.timeToLive()==60.0);
+
+    pva::PeerInfo::roles_t roles;
+    testOk1(cache.lookup("erin", roles));
+
+    cache.configure(*pva::ConfigurationBuilder()
+                    .add("EPICS_PVAS_ROLES_CACHE_TTL", "0")
+                    .push_map()
+                    .build());
+    testOk1(cache.timeToLive()==0.0);
+    testOk1(!cache.lookup("erin", roles));
+
+    // nothing to wait for
+    std::tr1::shared_ptr<Waiter> B(new Waiter);
+    cache.fetch("erin", B);
+    testOk1(B->count==1u);
+}
+
+} // namespace
+
+MAIN(testRoleCache)
+{
+    testPlan(31);
+    testSync();
+    testFetch();
+    testRefresh();
+    testDisabled();
+    testConfigure();
+    return testDone();
+}
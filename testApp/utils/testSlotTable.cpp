@@ -0,0 +1,174 @@
+/**
+ * Copyright - See the COPYRIGHT that is included with this distribution.
+ * pvAccessCPP is distributed subject to a Software License Agreement found
+ * in file LICENSE that is included with this distribution.
+ */
+
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include <pv/sharedPtr.h>
+#include <pv/current_function.h>
+#include <pv/slotTable.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+namespace {
+
+typedef epics::pvAccess::SlotTable<std::tr1::shared_ptr<int> > table_t;
+typedef table_t::id_type id_type;
+
+void testBasic()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    table_t T;
+    testOk1(T.size()==0u);
+
+    std::tr1::shared_ptr<int> A(new int(1)), B(new int(2));
+
+    id_type a = T.insert(A), b = T.insert(B);
+    testOk(a>0 && b>0 && a!=b, "IDs a=%d b=%d", (int)a, (int)b);
+    testOk1(T.size()==2u);
+
+    testOk1(T.find(a)==A);
+    testOk1(T.find(b)==B);
+    testOk1(!T.find(0));
+    testOk1(!T.find(-1));
+    testOk1(!T.find(a^(1<<table_t::ShardBits))); // same shard, another (unused) index
+
+    id_type c = T.reserve();
+    testOk1(T.size()==3u);
+    testOk1(!T.find(c));
+    testOk1(T.set(c, A));
+    testOk1(T.find(c)==A);
+
+    testOk1(T.erase(a)==A);
+    testOk1(T.size()==2u);
+    testOk1(!T.find(a));
+    testOk1(!T.erase(a));
+    testOk1(!T.set(a, B));
+    testOk1(T.find(b)==B);
+}
+
+bool sameSlot(id_type a, id_type b)
+{
+    return (a%table_t::NumShards)==(b%table_t::NumShards) &&
+            ((a>>table_t::ShardBits)%table_t::MaxIndex)==((b>>table_t::ShardBits)%table_t::MaxIndex);
+}
+
+void testGeneration()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    table_t T;
+    std::tr1::shared_ptr<int> A(new int(1)), B(new int(2));
+
+    id_type a = T.insert(A);
+    T.erase(a);
+
+    // allocate and free until the slot of 'a' is re-used
+    id_type b = 0;
+    unsigned i;
+    for(i=0; i<4u*(table_t::MinFree+1u)*table_t::NumShards; i++) {
+        id_type id = T.insert(B);
+        if(sameSlot(id, a)) {
+            b = id;
+            break;
+        }
+        T.erase(id);
+    }
+    // held back until more than MinFree slots of its shard are free
+    testOk(i >= table_t::MinFree*table_t::NumShards, "re-used after %u allocations", i);
+
+    testOk(b!=0, "slot re-used a=%d b=%d", (int)a, (int)b);
+    testOk1(a!=b);
+    testOk1(!T.find(a));
+    testOk1(T.find(b)==B);
+    testOk1(!T.erase(a));
+    testOk1(T.find(b)==B);
+}
+
+// A stale ID is not found again until the generation of its slot wraps around
+void testGenerationWrap()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    table_t T;
+    std::tr1::shared_ptr<int> A(new int(1)), B(new int(2));
+
+    const id_type a = T.insert(A);
+    T.erase(a);
+
+    size_t reuses = 0u;
+    bool aliased = false, wrapped = false;
+    const size_t limit = 2u*table_t::MaxGeneration*(table_t::MinFree+2u)*table_t::NumShards;
+    for(size_t i=0; i<limit && !wrapped; i++) {
+        id_type id = T.insert(B);
+        if(sameSlot(id, a)) {
+            reuses++;
+            if(id==a)
+                wrapped = true;
+            else
+                aliased |= !!T.find(a);
+        }
+        T.erase(id);
+    }
+
+    testOk1(wrapped);
+    testOk1(!aliased);
+    // generations are [1, MaxGeneration)
+    testOk(reuses==size_t(table_t::MaxGeneration-1), "slot re-used %u times before 'a' is valid again",
+           unsigned(reuses));
+}
+
+void testMany()
+{
+    testDiag("==== %s ====", CURRENT_FUNCTION);
+
+    table_t T;
+    std::tr1::shared_ptr<int> A(new int(1));
+
+    const size_t N = 10000u;
+    std::vector<id_type> ids(N);
+    std::set<id_type> unique;
+    for(size_t i=0; i<N; i++) {
+        ids[i] = T.insert(A);
+        unique.insert(ids[i]);
+    }
+    testOk1(unique.size()==N);
+    testOk1(T.size()==N);
+
+    bool ok = true;
+    for(size_t i=0; i<N; i++)
+        ok &= T.find(ids[i])==A;
+    testOk(ok, "find all");
+
+    for(size_t i=0; i<N; i+=2)
+        T.erase(ids[i]);
+    testOk1(T.size()==N/2u);
+
+    std::vector<std::tr1::shared_ptr<int> > vals;
+    T.values(vals);
+    testOk1(vals.size()==N/2u);
+
+    vals.clear();
+    T.clear(vals);
+    testOk1(vals.size()==N/2u);
+    testOk1(T.size()==0u);
+    testOk1(!T.find(ids[1]));
+}
+
+} // namespace
+
+MAIN(testSlotTable)
+{
+    testPlan(36);
+    testBasic();
+    testGeneration();
+    testGenerationWrap();
+    testMany();
+    return testDone();
+}
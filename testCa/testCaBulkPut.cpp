@@ -0,0 +1,303 @@
+/* Measure bulk puts through the ca provider, as when loading setpoints.
+ *
+ * Runs an embedded IOC with N ao records, connects a ChannelPut to each
+ * through provider ca, then puts to all of them with record[block=true]
+ * and waits for every putDone.  Repeated with each request flushed
+ * (EPICS_PVA_CA_FLUSH_DELAY=0) and with flushing batched.
+ *
+ *   testCaBulkPut
+ *   testCaBulkPut -n 10000 -d 0.01
+ */
+#include <vector>
+#include <string>
+#include <sstream>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsStdlib.h>
+#include <epicsStdio.h>
+#include <epicsGetopt.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsGuard.h>
+#include <epicsTime.h>
+#include <epicsVersion.h>
+#include <epicsUnitTest.h>
+
+#if defined(EPICS_VERSION_INT) && EPICS_VERSION_INT >= VERSION_INT(3,16,2,0)
+#  define USE_DBUNITTEST
+#  define USE_TYPED_RSET
+#  include <dbAccess.h>
+#  include <errlog.h>
+#  include <dbUnitTest.h>
+
+extern "C" int testIoc_registerRecordDeviceDriver(struct dbBase *pbase);
+#endif
+
+#include <pv/pvData.h>
+#include <pv/logger.h>
+#include <pv/configuration.h>
+#include <pv/createRequest.h>
+#include <pv/pvAccess.h>
+#include <pv/caProvider.h>
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+namespace {
+
+#define DEFAULT_CHANNELS 1000
+#define DEFAULT_DELAY 0.01
+#define DEFAULT_TIMEOUT 60.0
+
+int nchannels = DEFAULT_CHANNELS;
+double flushDelay = DEFAULT_DELAY;
+double timeOut = DEFAULT_TIMEOUT;
+
+void usage (void)
+{
+    fprintf (stderr, "\nUsage: testCaBulkPut [options]\n\n"
+             "  -h: Help: Print this message\n"
+             "options:\n"
+             "  -n <channels>:     number of records put to, default is '%d'\n"
+             "  -d <sec>:          $EPICS_PVA_CA_FLUSH_DELAY when batching, default is %f second(s)\n"
+             "  -w <sec>:          wait time, specifies timeout, default is %f second(s)\n\n"
+             , DEFAULT_CHANNELS, DEFAULT_DELAY, DEFAULT_TIMEOUT);
+}
+
+double elapsed(const epicsTimeStamp& start)
+{
+    epicsTimeStamp now;
+    epicsTimeGetCurrent(&now);
+    return epicsTimeDiffInSeconds(&now, &start);
+}
+
+// Counts down connections, then put completions
+struct Waiter : public pva::ChannelRequester,
+                public pva::ChannelPutRequester
+{
+    POINTER_DEFINITIONS(Waiter);
+
+    epicsMutex mutex;
+    epicsEvent done;
+    size_t remaining, failed;
+    pvd::StructureConstPtr type;
+
+    Waiter() :remaining(0u), failed(0u) {}
+    virtual ~Waiter() {}
+
+    void expect(size_t n)
+    {
+        epicsGuard<epicsMutex> G(mutex);
+        remaining = n;
+    }
+
+    void complete(bool ok)
+    {
+        bool last;
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            if(!ok)
+                failed++;
+            last = --remaining==0u;
+        }
+        if(last)
+            done.signal();
+    }
+
+    virtual std::string getRequesterName() OVERRIDE FINAL { return "testCaBulkPut"; }
+
+    virtual void channelCreated(const pvd::Status& status,
+                                pva::Channel::shared_pointer const & /*channel*/) OVERRIDE FINAL
+    {
+        if(!status.isSuccess())
+            complete(false);
+    }
+
+    virtual void channelStateChange(pva::Channel::shared_pointer const & /*channel*/,
+                                    pva::Channel::ConnectionState connectionState) OVERRIDE FINAL
+    {
+        if(connectionState==pva::Channel::CONNECTED)
+            complete(true);
+    }
+
+    virtual void channelPutConnect(const pvd::Status& status,
+                                   pva::ChannelPut::shared_pointer const & /*channelPut*/,
+                                   pvd::StructureConstPtr const & structure) OVERRIDE FINAL
+    {
+        {
+            epicsGuard<epicsMutex> G(mutex);
+            if(!type)
+                type = structure;
+        }
+        complete(status.isSuccess());
+    }
+
+    virtual void putDone(const pvd::Status& status,
+                         pva::ChannelPut::shared_pointer const & /*channelPut*/) OVERRIDE FINAL
+    {
+        complete(status.isSuccess());
+    }
+
+    virtual void getDone(const pvd::Status& /*status*/,
+                         pva::ChannelPut::shared_pointer const & /*channelPut*/,
+                         pvd::PVStructurePtr const & /*pvStructure*/,
+                         pvd::BitSetPtr const & /*bitSet*/) OVERRIDE FINAL
+    {}
+};
+
+bool run(double delay)
+{
+    std::ostringstream strm;
+    strm<<delay;
+
+    pva::ChannelProvider::shared_pointer provider(pva::ChannelProviderRegistry::clients()->createProvider(
+                "ca", pva::ConfigurationBuilder()
+                        .push_env()
+                        .add("EPICS_PVA_CA_FLUSH_DELAY", strm.str())
+                        .push_map()
+                        .build()));
+    if(!provider)
+        throw std::runtime_error("No provider ca");
+
+    Waiter::shared_pointer waiter(new Waiter);
+
+    waiter->expect(nchannels);
+    std::vector<pva::Channel::shared_pointer> channels(nchannels);
+    for(int i=0; i<nchannels; i++) {
+        char name[40];
+        epicsSnprintf(name, sizeof(name), "bulkput:%d", i);
+        channels[i] = provider->createChannel(name, waiter);
+    }
+    if(!waiter->done.wait(timeOut) || waiter->failed)
+        throw std::runtime_error("Channels not connected");
+
+    pvd::PVStructurePtr pvRequest(pvd::createRequest("record[block=true]field(value)"));
+    waiter->expect(nchannels);
+    std::vector<pva::ChannelPut::shared_pointer> puts(nchannels);
+    for(int i=0; i<nchannels; i++)
+        puts[i] = channels[i]->createChannelPut(waiter, pvRequest);
+    if(!waiter->done.wait(timeOut) || waiter->failed)
+        throw std::runtime_error("Puts not connected");
+
+    pvd::PVStructurePtr value(pvd::getPVDataCreate()->createPVStructure(waiter->type));
+    pvd::BitSetPtr changed(new pvd::BitSet);
+    changed->set(value->getSubFieldT<pvd::PVField>("value")->getFieldOffset());
+    value->getSubFieldT<pvd::PVScalar>("value")->putFrom<double>(delay);
+
+    epicsTimeStamp start;
+    epicsTimeGetCurrent(&start);
+
+    waiter->expect(nchannels);
+    for(int i=0; i<nchannels; i++)
+        puts[i]->put(value, changed);
+    const double issueTime = elapsed(start);
+    provider->flush();
+
+    bool ok = waiter->done.wait(timeOut);
+    const double putTime = elapsed(start);
+
+    if(!ok)
+        fprintf(stderr, "Timeout with %u put() incomplete\n", (unsigned)waiter->remaining);
+    ok &= waiter->failed==0u;
+
+    printf("flush delay %f s: %d puts issued in %f s, completed in %f s (%f us per put)%s\n",
+           delay, nchannels, issueTime, putTime, putTime*1e6/nchannels,
+           ok ? "" : " (errors)");
+
+    puts.clear();
+    channels.clear();
+
+    return ok;
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    int opt;
+
+    setvbuf(stdout,NULL,_IOLBF,BUFSIZ);    // Set stdout to line buffering
+
+    while ((opt = getopt(argc, argv, ":hn:d:w:")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            nchannels = atoi(optarg);
+            break;
+        case 'd':
+            if((epicsScanDouble(optarg, &flushDelay)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid delay value "
+                        "- ignored. ('testCaBulkPut -h' for help.)\n", optarg);
+                flushDelay = DEFAULT_DELAY;
+            }
+            break;
+        case 'w':
+            if((epicsScanDouble(optarg, &timeOut)) != 1)
+            {
+                fprintf(stderr, "'%s' is not a valid timeout value "
+                        "- ignored. ('testCaBulkPut -h' for help.)\n", optarg);
+                timeOut = DEFAULT_TIMEOUT;
+            }
+            break;
+        case '?':
+            fprintf(stderr,
+                    "Unrecognized option: '-%c'. ('testCaBulkPut -h' for help.)\n",
+                    optopt);
+            return 1;
+        case ':':
+            fprintf(stderr,
+                    "Option '-%c' requires an argument. ('testCaBulkPut -h' for help.)\n",
+                    optopt);
+            return 1;
+        default :
+            usage();
+            return 1;
+        }
+    }
+
+    if(nchannels<1 || flushDelay<=0.0) {
+        usage();
+        return 1;
+    }
+
+#ifdef USE_DBUNITTEST
+    SET_LOG_LEVEL(pva::logLevelError);
+
+    testdbPrepare();
+    testdbReadDatabase("testIoc.dbd", NULL, NULL);
+    testIoc_registerRecordDeviceDriver(pdbbase);
+    for(int i=0; i<nchannels; i++) {
+        char macros[32];
+        epicsSnprintf(macros, sizeof(macros), "N=%d", i);
+        testdbReadDatabase("testCaBulkPut.db", NULL, macros);
+    }
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    bool ok = true;
+    try {
+        pva::ca::CAClientFactory::start();
+
+        ok &= run(0.0);
+        ok &= run(flushDelay);
+
+    }catch(std::exception& e){
+        fprintf(stderr, "Error: %s\n", e.what());
+        ok = false;
+    }
+
+    testIocShutdownOk();
+    testdbCleanup();
+
+    return ok ? 0 : 1;
+#else
+    fprintf(stderr, "testCaBulkPut needs Base >= 3.16.2\n");
+    return 1;
+#endif
+}